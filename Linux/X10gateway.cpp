@@ -0,0 +1,516 @@
+/************************************************************************/
+/* X10 gateway daemon, serial link shared by many local clients, v1.0.  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10gateway.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Messages printed by the example sketches
+#define MSG_DATA_ERROR "SD:_ExSyntax"
+#define MSG_RECEIVE_TIMEOUT "SD:_ExTimOut"
+
+X10gateway::X10gateway()
+{
+  serialFd = -1;
+  listenFd = -1;
+  nextClientId = 1;
+  isInFlight = false;
+  isSyncing = false;
+  synced = false;
+  sentMs = 0;
+  receivedMs = 0;
+  stats = X10gatewayStats();
+}
+
+X10gateway::~X10gateway()
+{
+  end();
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Opens serial port in raw mode, returns file descriptor or -1 on error
+int X10gateway::openSerial(const char *device, int baudRate)
+{
+  speed_t speed;
+  switch(baudRate)
+  {
+    case 9600: speed = B9600; break;
+    case 19200: speed = B19200; break;
+    case 38400: speed = B38400; break;
+    case 57600: speed = B57600; break;
+    case 115200: speed = B115200; break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if(fd < 0) return -1;
+  termios tty;
+  if(tcgetattr(fd, &tty))
+  {
+    close(fd);
+    return -1;
+  }
+  cfmakeraw(&tty);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  if(tcsetattr(fd, TCSANOW, &tty))
+  {
+    close(fd);
+    return -1;
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+// Starts listening for clients on socket path, and requests module state from
+// controller. Serial file descriptor is closed by end. Returns true on error.
+bool X10gateway::begin(int serialFd, const char *socketPath)
+{
+  end();
+  sockaddr_un address = sockaddr_un();
+  address.sun_family = AF_UNIX;
+  if(strlen(socketPath) >= sizeof(address.sun_path)) return 1;
+  strcpy(address.sun_path, socketPath);
+  listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(listenFd < 0) return 1;
+  // Socket left behind by a gateway that was not stopped
+  unlink(socketPath);
+  if(bind(listenFd, (sockaddr *)&address, sizeof(address)) || listen(listenFd, 16))
+  {
+    close(listenFd);
+    listenFd = -1;
+    return 1;
+  }
+  this->serialFd = serialFd;
+  this->socketPath = socketPath;
+  startSync();
+  return 0;
+}
+
+// Disconnects clients, and closes socket and serial port
+void X10gateway::end()
+{
+  for(size_t i = 0; i < clients.size(); i++) close(clients[i].fd);
+  clients.clear();
+  if(listenFd >= 0)
+  {
+    close(listenFd);
+    unlink(socketPath.c_str());
+    listenFd = -1;
+  }
+  if(serialFd >= 0)
+  {
+    close(serialFd);
+    serialFd = -1;
+  }
+  outbox.clear();
+  heldQueries.clear();
+  isInFlight = false;
+  isSyncing = false;
+  synced = false;
+}
+
+// Waits up to timeoutMs (-1 = until something happens) for serial and client
+// input, and handles it. Call in a loop.
+void X10gateway::poll(int timeoutMs)
+{
+  sendNext();
+  if(isInFlight)
+  {
+    uint64_t now = getMs();
+    uint64_t deadline = isSyncing ? receivedMs + X10_GATEWAY_QUIET_MS : sentMs + X10_GATEWAY_TIMEOUT_MS;
+    int left = deadline > now ? deadline - now : 0;
+    if(timeoutMs < 0 || left < timeoutMs) timeoutMs = left;
+  }
+  std::vector<pollfd> fds(2 + clients.size());
+  fds[0].fd = serialFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = listenFd;
+  fds[1].events = POLLIN;
+  for(size_t i = 0; i < clients.size(); i++)
+  {
+    fds[2 + i].fd = clients[i].fd;
+    fds[2 + i].events = clients[i].output.empty() ? POLLIN : POLLIN | POLLOUT;
+  }
+  if(::poll(&fds[0], fds.size(), timeoutMs) < 0 && errno != EINTR) return;
+  if(fds[0].revents) readSerial();
+  // Clients are read before new clients are accepted, so that fds match clients
+  std::vector<bool> isClosed(clients.size());
+  for(size_t i = 0; i < clients.size(); i++)
+  {
+    if(fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR)) isClosed[i] = readClient(clients[i]);
+  }
+  checkTimeouts();
+  sendNext();
+  for(size_t i = 0; i < clients.size(); i++)
+  {
+    if(!isClosed[i] && !clients[i].output.empty()) isClosed[i] = writeClient(clients[i]);
+  }
+  for(size_t i = clients.size(); i-- > 0;)
+  {
+    if(!isClosed[i]) continue;
+    close(clients[i].fd);
+    clients.erase(clients.begin() + i);
+  }
+  if(fds[1].revents & POLLIN) acceptClient();
+}
+
+// Returns true when module state has been received from controller
+bool X10gateway::isSynced()
+{
+  return synced;
+}
+
+const X10moduleCache &X10gateway::getCache()
+{
+  return cache;
+}
+
+X10gatewayStats X10gateway::getStats()
+{
+  return stats;
+}
+
+size_t X10gateway::getClientCount()
+{
+  return clients.size();
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+void X10gateway::acceptClient()
+{
+  int fd;
+  while((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+  {
+    Client client;
+    client.id = nextClientId++;
+    client.fd = fd;
+    clients.push_back(client);
+  }
+}
+
+// Reads and handles client messages, returns true when client is gone
+bool X10gateway::readClient(Client &client)
+{
+  uint32_t id = client.id;
+  char buffer[512];
+  ssize_t length;
+  while((length = read(client.fd, buffer, sizeof(buffer))) > 0)
+  {
+    client.input.append(buffer, length);
+  }
+  bool isGone = !length || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+  size_t end;
+  while((end = client.input.find('\n')) != std::string::npos)
+  {
+    std::string line = client.input.substr(0, end);
+    client.input.erase(0, end + 1);
+    handleClientLine(id, line);
+  }
+  if(client.input.size() > X10_GATEWAY_LINE_MAX)
+  {
+    client.input.clear();
+    send(id, MSG_DATA_ERROR);
+  }
+  return isGone;
+}
+
+// Sends buffered output, returns true when client is gone or not reading
+bool X10gateway::writeClient(Client &client)
+{
+  ssize_t length = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  if(length > 0) client.output.erase(0, length);
+  else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return 1;
+  return client.output.size() > X10_GATEWAY_OUTPUT_MAX;
+}
+
+void X10gateway::readSerial()
+{
+  char buffer[512];
+  ssize_t length;
+  while((length = read(serialFd, buffer, sizeof(buffer))) > 0)
+  {
+    serialInput.append(buffer, length);
+    receivedMs = getMs();
+  }
+  size_t end;
+  while((end = serialInput.find('\n')) != std::string::npos)
+  {
+    std::string line = serialInput.substr(0, end);
+    serialInput.erase(0, end + 1);
+    if(!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+    if(!line.empty()) handleSerialLine(line);
+  }
+  // Noise, e.g. wrong baud rate
+  if(serialInput.size() > X10_GATEWAY_LINE_MAX) serialInput.clear();
+}
+
+void X10gateway::handleClientLine(uint32_t id, const std::string &line)
+{
+  size_t start = line.find_first_not_of(" \t\r");
+  if(start == std::string::npos) return;
+  std::string text = line.substr(start, line.find_last_not_of(" \t\r") + 1 - start);
+  X10message message;
+  if(x10parseMessage(text, message))
+  {
+    send(id, MSG_DATA_ERROR);
+    return;
+  }
+  // State requests are answered from cache
+  if(message.type == X10_MESSAGE_STATE)
+  {
+    if(synced)
+    {
+      answerQuery(id, message);
+    }
+    else
+    {
+      Query query = { id, message };
+      heldQueries.push_back(query);
+    }
+    return;
+  }
+  // Merge with identical message waiting to be sent, unless sending it twice
+  // has a different result than sending it once
+  if(message.type != X10_MESSAGE_STANDARD || (message.command != X10_CMD_DIM && message.command != X10_CMD_BRIGHT))
+  {
+    for(size_t i = 0; i < outbox.size(); i++)
+    {
+      if(!outbox[i].isSync && outbox[i].message.text == message.text)
+      {
+        outbox[i].owners.push_back(id);
+        stats.coalesced++;
+        return;
+      }
+    }
+  }
+  Request request;
+  request.message = message;
+  request.owners.push_back(id);
+  request.isSync = false;
+  outbox.push_back(request);
+}
+
+void X10gateway::handleSerialLine(const std::string &line)
+{
+  // Controller restarted: module state may have been lost
+  if(line == "X10")
+  {
+    if(isInFlight && !inFlight.isSync) send(inFlight.owners, MSG_RECEIVE_TIMEOUT);
+    isInFlight = false;
+    isSyncing = false;
+    broadcast(line);
+    startSync();
+    return;
+  }
+  std::string type = line.size() > 3 && line[2] == ':' ? line.substr(0, 2) : std::string();
+  std::string body = type.empty() ? line : line.substr(3);
+  char house;
+  uint8_t unit, command, extCommand, extData;
+  if(type == "SD")
+  {
+    handleReply(body, line);
+    return;
+  }
+  if(type == "MS")
+  {
+    // Module state wiped, e.g. MS:B__ or MS:*__
+    if(body.size() == 3 && body[1] == '_' && body[2] == '_')
+    {
+      cache.wipe(body[0]);
+    }
+    else if(!x10parseEvent(body, house, unit, command, extCommand, extData))
+    {
+      cache.setState(house, unit, command, extData);
+    }
+    // Replies to state request sent by gateway are not passed on
+    if(isSyncing) return;
+  }
+  else if(type == "PL" && !x10parseEvent(body, house, unit, command, extCommand, extData) && unit)
+  {
+    cache.update(house, unit, command, extCommand, extData);
+  }
+  stats.events++;
+  broadcast(line);
+}
+
+// Handles echo or error reply to message sent by serial port
+void X10gateway::handleReply(const std::string &body, const std::string &line)
+{
+  if(!body.compare(0, 3, "_Ex"))
+  {
+    // Buffer errors follow the echo of the message that was not buffered,
+    // other errors are in stead of an echo
+    if(body != "_ExBuffer" && isInFlight && !isSyncing)
+    {
+      lastOwners = inFlight.owners;
+      isInFlight = false;
+      if(inFlight.isSync) endSync();
+    }
+    send(lastOwners, line);
+    return;
+  }
+  if(!isInFlight || isSyncing) return;
+  lastOwners = inFlight.owners;
+  send(lastOwners, line);
+  // State request echo is followed by module state messages
+  if(inFlight.isSync) isSyncing = true;
+  else isInFlight = false;
+}
+
+// Replies to state request, the same way as process3BMessage
+void X10gateway::answerQuery(uint32_t id, const X10message &message)
+{
+  send(id, "SD:" + message.text);
+  char first = message.house == '*' ? 'A' : message.house;
+  char last = message.house == '*' ? 'P' : message.house;
+  for(char house = first; house <= last; house++)
+  {
+    for(uint8_t unit = 1; unit <= 16; unit++)
+    {
+      if(message.unit && unit != message.unit) continue;
+      std::string line = cache.format(house, unit);
+      if(!line.empty()) send(id, line);
+    }
+  }
+  stats.cached++;
+}
+
+// Requests state of all modules, before any other message is sent
+void X10gateway::startSync()
+{
+  for(size_t i = 0; i < outbox.size(); i++)
+  {
+    if(outbox[i].isSync) return;
+  }
+  Request request;
+  x10parseMessage("R**", request.message);
+  request.isSync = true;
+  outbox.push_front(request);
+  cache.clear();
+  synced = false;
+}
+
+void X10gateway::endSync()
+{
+  isInFlight = false;
+  isSyncing = false;
+  synced = true;
+  std::vector<Query> queries;
+  queries.swap(heldQueries);
+  for(size_t i = 0; i < queries.size(); i++) answerQuery(queries[i].owner, queries[i].message);
+}
+
+// Sends next message to controller, when the last one is done
+void X10gateway::sendNext()
+{
+  if(isInFlight || outbox.empty() || serialFd < 0) return;
+  inFlight = outbox.front();
+  outbox.pop_front();
+  const std::string &text = inFlight.message.text;
+  size_t sent = 0;
+  while(sent < text.size())
+  {
+    ssize_t length = write(serialFd, text.data() + sent, text.size() - sent);
+    if(length > 0)
+    {
+      sent += length;
+    }
+    else if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    {
+      pollfd fd = { serialFd, POLLOUT, 0 };
+      ::poll(&fd, 1, X10_GATEWAY_TIMEOUT_MS);
+    }
+    // Reply times out
+    else
+    {
+      break;
+    }
+  }
+  isInFlight = true;
+  sentMs = getMs();
+  stats.sent++;
+}
+
+void X10gateway::checkTimeouts()
+{
+  uint64_t now = getMs();
+  if(isSyncing)
+  {
+    if(now - receivedMs >= X10_GATEWAY_QUIET_MS) endSync();
+  }
+  else if(isInFlight && now - sentMs >= X10_GATEWAY_TIMEOUT_MS)
+  {
+    send(inFlight.owners, MSG_RECEIVE_TIMEOUT);
+    lastOwners.clear();
+    isInFlight = false;
+    // Controller is not answering, state requests are answered from empty cache
+    if(inFlight.isSync) endSync();
+  }
+}
+
+// Lines are ended the same way as by the serial port
+void X10gateway::send(uint32_t id, const std::string &line)
+{
+  for(size_t i = 0; i < clients.size(); i++)
+  {
+    if(clients[i].id != id) continue;
+    clients[i].output += line;
+    clients[i].output += "\r\n";
+    return;
+  }
+}
+
+void X10gateway::send(const std::vector<uint32_t> &ids, const std::string &line)
+{
+  for(size_t i = 0; i < ids.size(); i++) send(ids[i], line);
+}
+
+void X10gateway::broadcast(const std::string &line)
+{
+  for(size_t i = 0; i < clients.size(); i++)
+  {
+    clients[i].output += line;
+    clients[i].output += "\r\n";
+  }
+}
+
+uint64_t X10gateway::getMs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
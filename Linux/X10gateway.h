@@ -0,0 +1,137 @@
+/************************************************************************/
+/* X10 gateway daemon, serial link shared by many local clients, v1.0.  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10gateway_h
+#define X10gateway_h
+
+#include "X10message.h"
+#include "X10moduleCache.h"
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Message sent to controller is failed with _ExTimOut when it's not echoed
+// within this many milliseconds (same as SERIAL_DATA_THRESHOLD in sketches)
+#define X10_GATEWAY_TIMEOUT_MS    1000
+// Module state sync is done when no more messages are received for this many
+// milliseconds after the state request echo
+#define X10_GATEWAY_QUIET_MS        50
+// Clients that don't read their output are disconnected when this many bytes
+// are waiting to be sent
+#define X10_GATEWAY_OUTPUT_MAX   65536
+// Longest line accepted from client
+#define X10_GATEWAY_LINE_MAX       128
+
+struct X10gatewayStats
+{
+  // Messages sent to controller
+  uint32_t sent;
+  // Client messages merged with an identical message waiting to be sent
+  uint32_t coalesced;
+  // State requests answered from cache
+  uint32_t cached;
+  // Messages from controller passed on to all clients
+  uint32_t events;
+};
+
+// Owns the serial link to a controller running one of the X10ex example
+// sketches, and serves many local clients over a Unix domain socket. Clients
+// use the same text protocol as the serial port, one message per line:
+//
+// A12          -> SD:A12 (and SD:_ExBuffer when not buffered by controller)
+// RA2          -> SD:RA2, MS:A2Dx00x3E (from cache, not sent to controller)
+// xyz          -> SD:_ExSyntax (not sent to controller)
+//
+// PL, RF, IR, RS and MS messages from controller are passed on to all
+// clients. Messages are sent to controller one at a time, in the order
+// received; a message that is identical to a message already waiting to be
+// sent is not sent again, and the reply goes to both clients (bright and dim
+// are always sent, since they are not idempotent). Module state is requested
+// from controller at startup and every time it restarts (prints "X10"), and
+// kept up to date from PL messages. State requests received before state is
+// synced are answered when sync is done.
+class X10gateway
+{
+
+  public:
+    X10gateway();
+    ~X10gateway();
+    // Public methods
+    static int openSerial(const char *device, int baudRate);
+    bool begin(int serialFd, const char *socketPath);
+    void end();
+    void poll(int timeoutMs);
+    bool isSynced();
+    const X10moduleCache &getCache();
+    X10gatewayStats getStats();
+    size_t getClientCount();
+
+  private:
+    struct Client
+    {
+      uint32_t id;
+      int fd;
+      std::string input;
+      std::string output;
+    };
+    struct Request
+    {
+      X10message message;
+      std::vector<uint32_t> owners;
+      bool isSync;
+    };
+    struct Query
+    {
+      uint32_t owner;
+      X10message message;
+    };
+    int serialFd, listenFd;
+    std::string socketPath;
+    std::string serialInput;
+    std::vector<Client> clients;
+    uint32_t nextClientId;
+    std::deque<Request> outbox;
+    Request inFlight;
+    bool isInFlight, isSyncing, synced;
+    uint64_t sentMs, receivedMs;
+    std::vector<uint32_t> lastOwners;
+    std::vector<Query> heldQueries;
+    X10moduleCache cache;
+    X10gatewayStats stats;
+    // Private methods
+    void acceptClient();
+    bool readClient(Client &client);
+    bool writeClient(Client &client);
+    void readSerial();
+    void handleClientLine(uint32_t id, const std::string &line);
+    void handleSerialLine(const std::string &line);
+    void handleReply(const std::string &body, const std::string &line);
+    void answerQuery(uint32_t id, const X10message &message);
+    void startSync();
+    void endSync();
+    void sendNext();
+    void checkTimeouts();
+    void send(uint32_t id, const std::string &line);
+    void send(const std::vector<uint32_t> &ids, const std::string &line);
+    void broadcast(const std::string &line);
+    static uint64_t getMs();
+};
+
+#endif
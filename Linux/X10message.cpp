@@ -0,0 +1,167 @@
+/************************************************************************/
+/* X10 gateway daemon, serial message parser and formatter, v1.0.       */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10message.h"
+#include <ctype.h>
+
+// Returns 0-15, or 0xFF when not a hex digit
+static uint8_t hexToDecimal(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return 0xFF;
+}
+
+static bool isHouse(char c)
+{
+  return c >= 'A' && c <= 'P';
+}
+
+// Parses "xHH", returns true when not valid
+static bool parseHexByte(const std::string &text, size_t ix, uint8_t &data)
+{
+  if(toupper(text[ix]) != 'X') return 1;
+  uint8_t high = hexToDecimal(text[ix + 1]);
+  uint8_t low = hexToDecimal(text[ix + 2]);
+  if(high > 0xF || low > 0xF) return 1;
+  data = high << 4 | low;
+  return 0;
+}
+
+static void appendHexByte(std::string &text, uint8_t data)
+{
+  const char hex[] = "0123456789ABCDEF";
+  text += 'x';
+  text += hex[data >> 4];
+  text += hex[data & 0xF];
+}
+
+bool x10parseMessage(const std::string &text, X10message &message)
+{
+  if(text.size() != 3 && text.size() != 9) return 1;
+  std::string upper;
+  for(size_t i = 0; i < text.size(); i++) upper += toupper(text[i]);
+  message = X10message();
+  message.house = upper[0];
+  // Standard or extended message: house, unit and command
+  if(isHouse(upper[0]))
+  {
+    uint8_t unit = hexToDecimal(upper[1]);
+    uint8_t command = hexToDecimal(upper[2]);
+    if((unit > 0xF && upper[1] != '_') || (command > 0xF && upper[2] != '_')) return 1;
+    if(upper[1] == '_' && upper[2] == '_') return 1;
+    message.unit = unit <= 0xF ? unit + 1 : 0;
+    message.command = command;
+    // Extended messages are 9 bytes, and standard messages 3 bytes
+    bool isExtended = command == X10_CMD_EXTENDED_CODE || command == X10_CMD_EXTENDED_DATA;
+    if(isExtended != (upper.size() == 9)) return 1;
+    if(isExtended)
+    {
+      if(parseHexByte(upper, 3, message.extCommand) || parseHexByte(upper, 6, message.extData)) return 1;
+      message.type = X10_MESSAGE_EXTENDED;
+    }
+    else
+    {
+      message.type = X10_MESSAGE_STANDARD;
+    }
+    message.text = upper;
+    for(size_t i = 3; i < message.text.size(); i += 3) message.text[i] = 'x';
+    return 0;
+  }
+  if(upper.size() != 3) return 1;
+  // Scenario execute
+  if(upper[0] == 'S')
+  {
+    uint8_t high = hexToDecimal(upper[1]);
+    uint8_t low = hexToDecimal(upper[2]);
+    if(high > 0xF || low > 0xF) return 1;
+    message.type = X10_MESSAGE_SCENARIO;
+    message.house = 0;
+    message.scenario = high << 4 | low;
+    message.text = upper;
+    return 0;
+  }
+  // Wipe module state, of one house code or all
+  if(upper[0] == 'R' && upper[1] == 'W')
+  {
+    if(!isHouse(upper[2]) && upper[2] != '*') return 1;
+    message.type = X10_MESSAGE_WIPE;
+    message.house = upper[2];
+    message.text = upper;
+    return 0;
+  }
+  // Request module state, unit is not a hex digit when all units are requested
+  if(upper[0] == 'R' && (isHouse(upper[1]) || upper[1] == '*'))
+  {
+    uint8_t unit = hexToDecimal(upper[2]);
+    message.type = X10_MESSAGE_STATE;
+    message.house = upper[1];
+    message.unit = upper[1] != '*' && unit <= 0xF ? unit + 1 : 0;
+    message.text = upper.substr(0, 2);
+    message.text += message.unit ? upper[2] : '*';
+    return 0;
+  }
+  return 1;
+}
+
+bool x10parseEvent(
+  const std::string &text, char &house, uint8_t &unit, uint8_t &command,
+  uint8_t &extCommand, uint8_t &extData)
+{
+  if(text.size() != 3 && text.size() != 9) return 1;
+  house = toupper(text[0]);
+  if(!isHouse(house)) return 1;
+  unit = hexToDecimal(text[1]);
+  if(unit > 0xF && text[1] != '_') return 1;
+  unit = unit <= 0xF ? unit + 1 : 0;
+  command = hexToDecimal(text[2]);
+  if(command > 0xF)
+  {
+    if(text[2] != '_') return 1;
+    command = X10_DATA_UNKNOWN;
+  }
+  extCommand = 0;
+  extData = 0;
+  if(text.size() == 9 && (parseHexByte(text, 3, extCommand) || parseHexByte(text, 6, extData))) return 1;
+  return 0;
+}
+
+std::string x10formatEvent(
+  const char *type, char house, uint8_t unit, uint8_t command,
+  uint8_t extCommand, uint8_t extData)
+{
+  const char hex[] = "0123456789ABCDEF";
+  std::string text = type;
+  text += house;
+  text += unit && unit <= 16 ? hex[unit - 1] : '_';
+  // Non X10 commands like the CMD_ADDRESS command used by the IR library are printed as '_'
+  if(command > 0xF)
+  {
+    text += '_';
+    return text;
+  }
+  text += hex[command];
+  if(extCommand || (extData && (command == X10_CMD_STATUS_ON || command == X10_CMD_STATUS_OFF)))
+  {
+    appendHexByte(text, extCommand);
+    appendHexByte(text, extCommand == X10_EXC_PRE_SET_DIM ? extData & 0x3F : extData);
+  }
+  return text;
+}
@@ -0,0 +1,79 @@
+/************************************************************************/
+/* X10 gateway daemon, serial message parser and formatter, v1.0.       */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10message_h
+#define X10message_h
+
+#include <stdint.h>
+#include <string>
+
+// Same values as in X10ex.h
+#define X10_DATA_UNKNOWN         0xF0
+#define X10_CMD_ON               0x2
+#define X10_CMD_OFF              0x3
+#define X10_CMD_DIM              0x4
+#define X10_CMD_BRIGHT           0x5
+#define X10_CMD_EXTENDED_CODE    0x7
+#define X10_CMD_PRE_SET_DIM_0    0xA
+#define X10_CMD_EXTENDED_DATA    0xC
+#define X10_CMD_STATUS_ON        0xD
+#define X10_CMD_STATUS_OFF       0xE
+#define X10_EXC_PRE_SET_DIM      0x31
+
+// Serial message types, see process3BMessage in the example sketches
+#define X10_MESSAGE_STANDARD     1
+#define X10_MESSAGE_EXTENDED     2
+#define X10_MESSAGE_SCENARIO     3
+#define X10_MESSAGE_STATE        4
+#define X10_MESSAGE_WIPE         5
+
+// Serial message sent to controller, e.g. A12, A37x31x21, S03, RA2 or RWB.
+// House is '*' when state request or wipe is for all house codes, unit is 0
+// when there is no unit or the request is for all units.
+struct X10message
+{
+  uint8_t type;
+  char house;
+  uint8_t unit;
+  uint8_t command;
+  uint8_t extCommand;
+  uint8_t extData;
+  uint8_t scenario;
+  // Message as sent to controller: upper case, '*' for all units
+  std::string text;
+};
+
+// Parses serial message, the same messages are accepted as by
+// process3BMessage. Returns true when message is not valid.
+bool x10parseMessage(const std::string &text, X10message &message);
+
+// Parses house, unit and command of PL and MS messages printed by
+// printX10Message, e.g. A12, A_6, A37x31x3E and A2Dx00x3E. Unit is 0 and
+// command is X10_DATA_UNKNOWN when printed as '_'. Returns true when message
+// is not valid.
+bool x10parseEvent(
+  const std::string &text, char &house, uint8_t &unit, uint8_t &command,
+  uint8_t &extCommand, uint8_t &extData);
+
+// Formats message the same way as printX10Message, e.g. MS:A2Dx00x3E
+std::string x10formatEvent(
+  const char *type, char house, uint8_t unit, uint8_t command,
+  uint8_t extCommand, uint8_t extData);
+
+#endif
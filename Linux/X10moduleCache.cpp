@@ -0,0 +1,127 @@
+/************************************************************************/
+/* X10 gateway daemon, mirror of controller module state, v1.0.         */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10moduleCache.h"
+#include "X10message.h"
+#include <string.h>
+
+X10moduleCache::X10moduleCache()
+{
+  clear();
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+void X10moduleCache::clear()
+{
+  memset(state, 0, sizeof(state));
+}
+
+// Wipes state of modules using house code, or all modules when house is '*'
+void X10moduleCache::wipe(char house)
+{
+  if(house == '*')
+  {
+    clear();
+  }
+  else if(getIndex(house, 1) >= 0)
+  {
+    memset(state + getIndex(house, 1), 0, 16);
+  }
+}
+
+// Updates state from power line message, see X10ex::updateModuleState
+void X10moduleCache::update(char house, uint8_t unit, uint8_t command, uint8_t extCommand, uint8_t extData)
+{
+  int ix = getIndex(house, unit);
+  if(ix < 0) return;
+  uint8_t brightness = state[ix] & 0x3F;
+  // If not seen, set seen
+  if(!(state[ix] & 0xC0)) state[ix] |= 0x40;
+  // Dim and bright: estimate brightness
+  if(command == X10_CMD_DIM)
+  {
+    brightness = state[ix] >> 6 == 1 ? 62 : brightness > 9 ? brightness - 9 : 1;
+  }
+  else if(command == X10_CMD_BRIGHT)
+  {
+    brightness = state[ix] >> 6 == 1 ? 11 : brightness <= 53 ? brightness + 9 : 62;
+  }
+  if(command == X10_CMD_OFF || command == X10_CMD_STATUS_OFF)
+  {
+    state[ix] = brightness | 0x80;
+  }
+  else if(command == X10_CMD_DIM || command == X10_CMD_BRIGHT || command == X10_CMD_ON || command == X10_CMD_STATUS_ON)
+  {
+    state[ix] = brightness | 0xC0;
+  }
+  // Extended code pre set dim: brightness 0 is off
+  else if(command == X10_CMD_EXTENDED_CODE && extCommand == X10_EXC_PRE_SET_DIM)
+  {
+    extData &= 0x3F;
+    state[ix] = extData ? extData | 0xC0 : brightness | 0x80;
+  }
+}
+
+// Sets state from module state message: command is status on, status off or
+// X10_DATA_UNKNOWN (seen, but state not known)
+void X10moduleCache::setState(char house, uint8_t unit, uint8_t command, uint8_t data)
+{
+  int ix = getIndex(house, unit);
+  if(ix < 0) return;
+  if(command == X10_CMD_STATUS_ON) state[ix] = (data & 0x3F) | 0xC0;
+  else if(command == X10_CMD_STATUS_OFF) state[ix] = (data & 0x3F) | 0x80;
+  else state[ix] = 0x40;
+}
+
+X10moduleState X10moduleCache::getState(char house, uint8_t unit) const
+{
+  X10moduleState moduleState = X10moduleState();
+  int ix = getIndex(house, unit);
+  if(ix < 0) return moduleState;
+  moduleState.isSeen = state[ix] & 0xC0;
+  moduleState.isKnown = state[ix] & 0x80;
+  moduleState.isOn = (state[ix] & 0xC0) == 0xC0;
+  moduleState.data = state[ix] & 0x3F;
+  return moduleState;
+}
+
+// Formats state as module state message, the same way as sdPrintModuleState
+// in the example sketches. Returns empty string when module is not seen.
+std::string X10moduleCache::format(char house, uint8_t unit) const
+{
+  X10moduleState moduleState = getState(house, unit);
+  if(!moduleState.isSeen) return std::string();
+  return x10formatEvent(
+    "MS:", house, unit,
+    moduleState.isKnown ? moduleState.isOn ? X10_CMD_STATUS_ON : X10_CMD_STATUS_OFF : X10_DATA_UNKNOWN,
+    0, moduleState.data);
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+int X10moduleCache::getIndex(char house, uint8_t unit)
+{
+  if(house < 'A' || house > 'P' || unit < 1 || unit > 16) return -1;
+  return (house - 'A') << 4 | (unit - 1);
+}
@@ -0,0 +1,60 @@
+/************************************************************************/
+/* X10 gateway daemon, mirror of controller module state, v1.0.         */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10moduleCache_h
+#define X10moduleCache_h
+
+#include <stdint.h>
+#include <string>
+
+// Same fields as X10state in X10ex.h
+struct X10moduleState
+{
+  bool isSeen;
+  bool isKnown;
+  bool isOn;
+  uint8_t data;
+};
+
+// Mirror of the module state kept by X10ex on the controller. State is set
+// from MS messages (replies to module state requests) and updated from PL
+// messages the same way X10ex updates its state, so that state requests can
+// be answered without asking the controller. Standard pre-set dim commands
+// only mark the module as seen, since their level isn't printed.
+class X10moduleCache
+{
+
+  public:
+    X10moduleCache();
+    // Public methods
+    void clear();
+    void wipe(char house);
+    void update(char house, uint8_t unit, uint8_t command, uint8_t extCommand, uint8_t extData);
+    void setState(char house, uint8_t unit, uint8_t command, uint8_t data);
+    X10moduleState getState(char house, uint8_t unit) const;
+    std::string format(char house, uint8_t unit) const;
+
+  private:
+    // Same encoding as X10ex: seen and known bits, and 6 bits of brightness
+    uint8_t state[256];
+    // Private methods
+    static int getIndex(char house, uint8_t unit);
+};
+
+#endif
@@ -0,0 +1,88 @@
+/************************************************************************/
+/* X10 library host benchmarks, minimal benchmark runner, v1.0.         */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10bench.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+struct X10benchEntry
+{
+  const char *name;
+  X10benchFunction function;
+};
+
+// Created on first use, since benchmarks are registered by static constructors
+static std::vector<X10benchEntry> &getBenchmarks()
+{
+  static std::vector<X10benchEntry> benchmarks;
+  return benchmarks;
+}
+
+static volatile unsigned long sink;
+
+static long long getNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+X10benchTimer::X10benchTimer()
+{
+  startNs = 0;
+}
+
+void X10benchTimer::start()
+{
+  startNs = getNs();
+}
+
+void X10benchTimer::stop(unsigned long operations, const char *unit)
+{
+  double ns = getNs() - startNs;
+  printf("  %10.1f ns/%s\n", operations ? ns / operations : ns, unit);
+}
+
+X10benchCase::X10benchCase(const char *name, X10benchFunction function)
+{
+  X10benchEntry entry = { name, function };
+  getBenchmarks().push_back(entry);
+}
+
+void x10benchUse(unsigned long value)
+{
+  sink = sink + value;
+}
+
+// Runs all benchmarks, or the benchmarks with name containing the first argument
+int main(int argc, char *argv[])
+{
+  for(size_t i = 0; i < getBenchmarks().size(); i++)
+  {
+    const X10benchEntry &benchmark = getBenchmarks()[i];
+    if(argc > 1 && !strstr(benchmark.name, argv[1])) continue;
+    printf("%s\n", benchmark.name);
+    fflush(stdout);
+    X10benchTimer timer;
+    benchmark.function(timer);
+  }
+  return 0;
+}
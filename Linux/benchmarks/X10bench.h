@@ -0,0 +1,62 @@
+/************************************************************************/
+/* X10 library host benchmarks, minimal benchmark runner, v1.0.         */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10bench_h
+#define X10bench_h
+
+// Minimal benchmark runner, in the style of the test runner:
+//
+// X10_BENCH(decodesEdges)
+// {
+//   timer.start();
+//   for(long i = 0; i < 1000000; i++) decodeEdge(...);
+//   timer.stop(1000000, "edge");
+// }
+//
+// Each stop prints the time per operation. The library is built for the
+// host, so times are only useful to compare implementations with each other,
+// not as AVR cycle counts.
+class X10benchTimer
+{
+
+  public:
+    X10benchTimer();
+    void start();
+    void stop(unsigned long operations, const char *unit);
+
+  private:
+    long long startNs;
+};
+
+typedef void (*X10benchFunction)(X10benchTimer &timer);
+
+struct X10benchCase
+{
+  X10benchCase(const char *name, X10benchFunction function);
+};
+
+// Keeps the compiler from removing work whose result is not used
+void x10benchUse(unsigned long value);
+
+#define X10_BENCH(name) \
+  static void name(X10benchTimer &timer); \
+  static X10benchCase name##Case(#name, name); \
+  static void name(X10benchTimer &timer)
+
+#endif
@@ -0,0 +1,73 @@
+/************************************************************************/
+/* X10 library host benchmarks, house and unit code decode, v1.0.       */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10bench.h"
+#include "X10codec.h"
+
+// Cost of the lookup tables used by the receive interrupts, compared to the
+// linear search of the house code list they replaced (v1.x findCodeIndex)
+
+#define BENCH_ROUNDS 10000000
+
+static const uint8_t BASELINE_HOUSE_CODE[16] =
+{
+  B0110, B1110, B0010, B1010, B0001, B1001, B0101, B1101,
+  B0111, B1111, B0011, B1011, B0000, B1000, B0100, B1100,
+};
+
+static int8_t findCodeIndex(const uint8_t codeList[16], uint8_t code)
+{
+  for(uint8_t i = 0; i <= 0xF; i++)
+  {
+    if(codeList[i] == code) return i;
+  }
+  return -1;
+}
+
+// Codes vary with the loop counter, through a volatile so the compiler can't
+// precompute the results
+static volatile uint8_t codeStep = 7;
+
+X10_BENCH(codecDecode)
+{
+  unsigned long sum = 0;
+  uint8_t step = codeStep;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_ROUNDS; i++) sum += x10decode(i * step);
+  timer.stop(BENCH_ROUNDS, "decode (table)");
+  x10benchUse(sum);
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_ROUNDS; i++) sum += findCodeIndex(BASELINE_HOUSE_CODE, i * step & 0xF);
+  timer.stop(BENCH_ROUNDS, "decode (v1.x linear search)");
+  x10benchUse(sum);
+}
+
+X10_BENCH(codecEncode)
+{
+  unsigned long sum = 0;
+  uint8_t step = codeStep;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_ROUNDS; i++) sum += x10encode(i * step);
+  timer.stop(BENCH_ROUNDS, "encode (table)");
+  x10benchUse(sum);
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_ROUNDS; i++) sum += BASELINE_HOUSE_CODE[i * step & 0xF];
+  timer.stop(BENCH_ROUNDS, "encode (v1.x array)");
+  x10benchUse(sum);
+}
@@ -0,0 +1,91 @@
+/************************************************************************/
+/* X10 library benchmarks, HTTP request parser, v1.0.                   */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10bench.h"
+#include "X10http.h"
+
+// Parser cost per request and per byte, with requests read from a loopback
+// stand-in for the Ethernet client, the way the X10_Ethernet example reads
+// them: one byte at a time while bytes are available
+
+#define BENCH_REQUESTS 200000UL
+
+// Client that reads back what was written to it
+class X10loopbackClient
+{
+
+  public:
+    X10loopbackClient() : start(0), end(0) { }
+    void write(const char *data)
+    {
+      while(*data && end < sizeof(buffer)) buffer[end++] = *data++;
+    }
+    int available() { return end - start; }
+    int read() { return start < end ? (uint8_t)buffer[start++] : -1; }
+    void rewind() { start = 0; }
+
+  private:
+    char buffer[512];
+    uint16_t start, end;
+};
+
+// Parses every request written to client, returns number of fields parsed
+static unsigned long parseRequests(X10benchTimer &timer, const char *request, const char *unit)
+{
+  X10loopbackClient client;
+  client.write(request);
+  X10http http;
+  unsigned long fields = 0;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_REQUESTS; i++)
+  {
+    client.rewind();
+    http.begin();
+    while(client.available() && !http.isDone())
+    {
+      if(http.parse(client.read()) & X10_HTTP_FIELD) fields++;
+    }
+  }
+  timer.stop(BENCH_REQUESTS, unit);
+  x10benchUse(fields);
+  return fields;
+}
+
+X10_BENCH(httpGetRequest)
+{
+  parseRequests(timer,
+    "GET /plc/A1/On HTTP/1.1\r\nHost: 192.168.0.10\r\nUser-Agent: curl/7.68.0\r\nAccept: */*\r\n\r\n",
+    "GET request (85 bytes)");
+}
+
+X10_BENCH(httpUrlEncodedPost)
+{
+  parseRequests(timer,
+    "POST /plc HTTP/1.1\r\nHost: 192.168.0.10\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 43\r\n\r\nA1=ON&A2=OFF&B5=DIM%3A50&name=\"Hall+light\"&",
+    "url encoded POST (4 fields)");
+}
+
+X10_BENCH(httpJsonPost)
+{
+  parseRequests(timer,
+    "POST /plc HTTP/1.1\r\nHost: 192.168.0.10\r\nContent-Type: application/json\r\n"
+    "Content-Length: 68\r\n\r\n[{\"house\":\"A\",\"unit\":1,\"on\":true},{\"house\":\"B\",\"unit\":5,\"on\":false}]",
+    "JSON POST (6 fields)");
+}
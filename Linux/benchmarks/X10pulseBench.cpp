@@ -0,0 +1,432 @@
+/************************************************************************/
+/* X10 library host benchmarks, RF and IR decode cost per edge, v1.0.   */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10bench.h"
+#include "X10rf.h"
+#include "X10ir.h"
+#include "X10irDecoder.h"
+#include <vector>
+
+// Decode cost per edge of the RF and IR receivers, built on the shared pulse
+// engine, compared to the receive methods they replaced (v1.x, kept here as
+// they were, apart from the names). The pulse engine times include poll,
+// called once per message, since v1.x passed messages on from the interrupt.
+
+#define BENCH_IR_PIN 3
+#define BENCH_ROUNDS 2000
+#define RF_GAP_US 40560
+#define IR_GAP_US 500000
+
+static unsigned long receivedCount;
+
+static void received(char, uint8_t, uint8_t, bool)
+{
+  receivedCount++;
+}
+
+static const uint8_t BASELINE_HOUSE_CODE[16] =
+{
+  B0110, B1110, B0010, B1010, B0001, B1001, B0101, B1101,
+  B0111, B1111, B0011, B1011, B0000, B1000, B0100, B1100,
+};
+
+//////////////////////////////
+/// RF
+//////////////////////////////
+
+class X10rfBaseline
+{
+
+  public:
+    X10rfBaseline()
+    {
+      riseUs = 0;
+      receiveEnded = 0;
+      receivedCount = 0;
+    }
+    void receive()
+    {
+      uint16_t lengthUs = micros() - riseUs;
+      riseUs = micros();
+      if(lengthUs >= X10_RF_RSB_MIN && lengthUs <= X10_RF_SB_MAX)
+      {
+        if(receiveEnded && millis() > receiveEnded && millis() - receiveEnded < X10_RF_REPEAT_THRESHOLD)
+        {
+          receiveEnded = millis();
+          received(house, unit, command, 1);
+        }
+        else
+        {
+          receiveEnded = 0;
+          receiveBuffer = 0;
+          if(lengthUs >= X10_RF_SB_MIN) receivedCount = 1;
+        }
+      }
+      else if(receivedCount)
+      {
+        if(lengthUs >= X10_RF_BIT1_MIN && lengthUs <= X10_RF_BIT1_MAX)
+        {
+          receiveBuffer += 1LU << receivedCount - 1;
+        }
+        else if(lengthUs < X10_RF_BIT0_MIN || lengthUs > X10_RF_BIT0_MAX)
+        {
+          receivedCount = -1;
+        }
+        if(
+          (receivedCount == 8 && (receiveBuffer & B11010000) != 0) ||
+          (receivedCount == 24 && ((receiveBuffer >> 16) & B11100000) != 0))
+        {
+          receivedCount = -1;
+        }
+        else if(
+          ((receivedCount > 8 && receivedCount <= 16) || (receivedCount > 24 && receivedCount <= 32)) &&
+          (receiveBuffer >> receivedCount - 9) & B1 == (receiveBuffer >> receivedCount - 1) & B1)
+        {
+          receivedCount = -1;
+        }
+        if(receivedCount == 32)
+        {
+          receivedCount = -1;
+          handleCommand(receiveBuffer & 0xFF, (receiveBuffer >> 16) & 0xFF);
+        }
+        receivedCount++;
+      }
+    }
+
+  private:
+    uint32_t riseUs, receiveEnded;
+    char house;
+    uint8_t unit, command;
+    int8_t receivedCount;
+    uint32_t receiveBuffer;
+    void handleCommand(uint8_t byte1, uint8_t byte2)
+    {
+      receiveEnded = millis();
+      house = 'A';
+      for(uint8_t i = 0; i <= 0xF; i++)
+      {
+        if(BASELINE_HOUSE_CODE[i] == (byte1 & B1111)) house = i + 65;
+      }
+      if(byte2 & B1)
+      {
+        unit = 0;
+        command = byte2 >> 3 & B1 ^ B101;
+      }
+      else
+      {
+        unit = (byte2 >> 3 | byte2 << 1 & B100 | byte1 >> 2 & B1000) + 1;
+        command = byte2 >> 2 & B1 | B10;
+      }
+      received(house, unit, command, 0);
+    }
+};
+
+// Time between rising edges of the standard RF messages for every house and
+// on/off of units 1-4: start burst, 32 bits and the gap to the next message
+static std::vector<uint16_t> getRfEdges()
+{
+  std::vector<uint16_t> edges;
+  for(uint8_t house = 0; house < 16; house++)
+  {
+    for(uint8_t unit = 0; unit < 4; unit++)
+    {
+      uint8_t byte1 = x10encode(house);
+      uint8_t byte2 = (unit & B11) << 3 | (house & B1) << 2;
+      uint32_t frame =
+        byte1 | (uint16_t)(uint8_t)~byte1 << 8 |
+        (uint32_t)byte2 << 16 | (uint32_t)(uint8_t)~byte2 << 24;
+      edges.push_back(13440);
+      for(uint8_t bit = 0; bit < 32; bit++) edges.push_back(frame >> bit & 1 ? 2240 : 1120);
+      edges.push_back(RF_GAP_US);
+    }
+  }
+  return edges;
+}
+
+X10_BENCH(rfDecodePerEdge)
+{
+  std::vector<uint16_t> edges = getRfEdges();
+  X10rf rf(0, 2, received, NULL);
+  receivedCount = 0;
+  timer.start();
+  for(int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    for(size_t i = 0; i < edges.size(); i++)
+    {
+      x10testAdvanceMicros(edges[i]);
+      rf.receive();
+      // Loop passes each message on before the next one is received
+      if(edges[i] == RF_GAP_US) rf.poll();
+    }
+  }
+  timer.stop(BENCH_ROUNDS * edges.size(), "edge (pulse engine)");
+  x10benchUse(receivedCount);
+  X10rfBaseline baseline;
+  receivedCount = 0;
+  timer.start();
+  for(int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    for(size_t i = 0; i < edges.size(); i++)
+    {
+      x10testAdvanceMicros(edges[i]);
+      baseline.receive();
+    }
+  }
+  timer.stop(BENCH_ROUNDS * edges.size(), "edge (v1.x receive)");
+  x10benchUse(receivedCount);
+}
+
+//////////////////////////////
+/// IR
+//////////////////////////////
+
+class X10irBaseline
+{
+
+  public:
+    X10irBaseline()
+    {
+      lowUs = 0;
+      receiveEnded = 0;
+      receivedCount = 0;
+      house = 'A';
+      unit = 0;
+      command = DATA_UNKNOWN;
+    }
+    void receive()
+    {
+      if(!(*portInputRegister(BENCH_IR_PIN) & 1))
+      {
+        lowUs = micros();
+      }
+      else if(lowUs)
+      {
+        lowUs = micros() - lowUs;
+        if(lowUs >= X10_IR_SB_MIN && lowUs <= X10_IR_SB_MAX)
+        {
+          if(receiveEnded && (millis() - receiveEnded > X10_IR_UNIT_RESET_TIME || receiveEnded > millis()))
+          {
+            house = 'A';
+            unit = 0;
+          }
+          if(receiveEnded && millis() > receiveEnded && millis() - receiveEnded < X10_IR_REPEAT_THRESHOLD)
+          {
+            receiveEnded = millis();
+            triggerCallback(1);
+          }
+          else
+          {
+            receiveEnded = 0;
+            receiveBuffer = 0;
+            receivedCount = 1;
+          }
+        }
+        else if(receivedCount)
+        {
+          if(receivedCount > 11)
+          {
+            receivedCount = -1;
+          }
+          else if(lowUs >= X10_IR_BIT1_MIN && lowUs <= X10_IR_BIT1_MAX)
+          {
+            receiveBuffer += B1 << (16 - receivedCount);
+          }
+          else if(lowUs < X10_IR_BIT0_MIN || lowUs > X10_IR_BIT0_MAX)
+          {
+            if(lowUs > X10_IR_EB_MIN)
+            {
+              if(receivedCount == 11 && validateData(receiveBuffer, 5))
+              {
+                handleCommand(receiveBuffer >> 8 & B11111000);
+              }
+              else if(receivedCount == 9 && validateData(receiveBuffer, 4))
+              {
+                handleCommand(receiveBuffer >> 8 & B11110000 | B1);
+              }
+            }
+            receivedCount = -1;
+          }
+          receivedCount++;
+        }
+      }
+    }
+
+  private:
+    uint32_t lowUs, receiveEnded;
+    char house;
+    uint8_t unit, command;
+    int8_t receivedCount;
+    uint16_t receiveBuffer;
+    void handleCommand(uint8_t data)
+    {
+      receiveEnded = millis();
+      switch(data & B1111)
+      {
+        case X10_IR_TYPE_HOUSE:
+          house = findCodeIndex(data >> 4) + 65;
+          unit = 0;
+          command = DATA_UNKNOWN;
+          break;
+        case X10_IR_TYPE_UNIT:
+          unit = findCodeIndex(data >> 4) + 1;
+          command = CMD_ADDRESS;
+          triggerCallback(0);
+          break;
+        case X10_IR_TYPE_COMMAND:
+          command = data >> 4;
+          triggerCallback(0);
+          break;
+      }
+    }
+    void triggerCallback(bool isRepeat)
+    {
+      if(command == CMD_ALL_UNITS_OFF || command == CMD_ALL_LIGHTS_ON || command == CMD_DIM || command == CMD_BRIGHT)
+      {
+        received(house, 0, command, isRepeat);
+      }
+      else if(unit > 0)
+      {
+        received(house, unit, command, isRepeat);
+      }
+    }
+    bool validateData(uint16_t data, uint8_t bits)
+    {
+      for(uint8_t i = 0; i < bits; i++)
+      {
+        if(data >> 15 - i & B1 == data >> 15 - bits - i & B1) return 0;
+      }
+      return 1;
+    }
+    int8_t findCodeIndex(uint8_t code)
+    {
+      for(uint8_t i = 0; i <= 0xF; i++)
+      {
+        if(BASELINE_HOUSE_CODE[i] == code) return i;
+      }
+      return -1;
+    }
+};
+
+struct BenchEdge
+{
+  bool isHigh;
+  uint32_t us;
+};
+
+static void addX10irFrame(std::vector<BenchEdge> &edges, uint8_t data, uint8_t dataBits)
+{
+  BenchEdge start = { 0, 4000 };
+  edges.push_back(start);
+  for(int8_t bit = dataBits * 2 - 1; bit >= 0; bit--)
+  {
+    bool isSet = bit >= dataBits ? data >> (bit - dataBits) & 1 : !(data >> bit & 1);
+    BenchEdge space = { 1, 500 };
+    BenchEdge mark = { 0, isSet ? 3750U : 1150U };
+    edges.push_back(space);
+    edges.push_back(mark);
+  }
+  BenchEdge space = { 1, 500 };
+  BenchEdge end = { 0, 12000 };
+  BenchEdge silence = { 1, IR_GAP_US };
+  edges.push_back(space);
+  edges.push_back(end);
+  edges.push_back(silence);
+}
+
+// X10 IR house, unit and on/off command for every house and unit 1-4
+static std::vector<BenchEdge> getIrEdges()
+{
+  std::vector<BenchEdge> edges;
+  for(uint8_t house = 0; house < 16; house++)
+  {
+    addX10irFrame(edges, x10encode(house), 4);
+    for(uint8_t unit = 0; unit < 4; unit++)
+    {
+      addX10irFrame(edges, x10encode(unit) << 1, 5);
+      addX10irFrame(edges, (CMD_ON | (unit & B1)) << 1 | 1, 5);
+    }
+  }
+  return edges;
+}
+
+static void feedIrEdges(X10ir &receiver, const std::vector<BenchEdge> &edges)
+{
+  for(size_t i = 0; i < edges.size(); i++)
+  {
+    x10testSetPin(BENCH_IR_PIN, edges[i].isHigh);
+    receiver.receive();
+    // Loop passes each command on before the next one is received
+    if(edges[i].us == IR_GAP_US) receiver.poll();
+    x10testAdvanceMicros(edges[i].us);
+  }
+}
+
+static void feedIrEdges(X10irBaseline &receiver, const std::vector<BenchEdge> &edges)
+{
+  for(size_t i = 0; i < edges.size(); i++)
+  {
+    x10testSetPin(BENCH_IR_PIN, edges[i].isHigh);
+    receiver.receive();
+    x10testAdvanceMicros(edges[i].us);
+  }
+}
+
+const X10irCode benchCodes[] PROGMEM =
+{
+  X10_IR_CODE(0x0412, 'D', 4, CMD_ON),
+  X10_IR_CODE(0x0095, 'F', 9, CMD_ON),
+};
+
+X10_BENCH(irDecodePerEdge)
+{
+  std::vector<BenchEdge> edges = getIrEdges();
+  x10testSetPin(BENCH_IR_PIN, 1);
+  X10ir ir(1, BENCH_IR_PIN, 'A', received);
+  receivedCount = 0;
+  timer.start();
+  for(int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    feedIrEdges(ir, edges);
+  }
+  timer.stop(BENCH_ROUNDS * edges.size(), "edge (pulse engine)");
+  x10benchUse(receivedCount);
+  // Third party decoders are run on every edge as well
+  X10irNec nec(benchCodes, 2);
+  X10irRc5 rc5(benchCodes, 2);
+  X10irSony sony(benchCodes, 2);
+  ir.addDecoder(&nec);
+  ir.addDecoder(&rc5);
+  ir.addDecoder(&sony);
+  timer.start();
+  for(int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    feedIrEdges(ir, edges);
+  }
+  timer.stop(BENCH_ROUNDS * edges.size(), "edge (pulse engine, NEC, RC5 and Sony decoders)");
+  x10benchUse(receivedCount);
+  X10irBaseline baseline;
+  receivedCount = 0;
+  timer.start();
+  for(int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    feedIrEdges(baseline, edges);
+  }
+  timer.stop(BENCH_ROUNDS * edges.size(), "edge (v1.x receive)");
+  x10benchUse(receivedCount);
+}
@@ -0,0 +1,91 @@
+/************************************************************************/
+/* X10 library host benchmarks, timer wheel scheduler, v1.0.            */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10bench.h"
+#include "X10scheduler.h"
+
+// Scheduler cost with all X10_SCHEDULER_MAX_TIMERS timers pending: each tick
+// only checks the timers hashed to its wheel slot
+
+#define BENCH_TICKS 1000000UL
+
+static unsigned long firedCount;
+
+static void timerFired(uint16_t)
+{
+  firedCount++;
+}
+
+static X10ex x10ex(0, 2, 9, 8, 0, NULL);
+
+X10_BENCH(schedulerPollWithManyTimers)
+{
+  X10scheduler scheduler(&x10ex);
+  // Periods are spread so timers fire on different ticks
+  for(uint8_t i = 0; i < X10_SCHEDULER_MAX_TIMERS; i++)
+  {
+    scheduler.schedule(100 * (i + 1), 100 * (i * 7 % 31 + 1), timerFired);
+  }
+  firedCount = 0;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_TICKS; i++)
+  {
+    x10testAdvanceMicros(X10_SCHEDULER_TICK_MS * 1000UL);
+    scheduler.poll();
+  }
+  // About 4 timers fire per tick
+  timer.stop(BENCH_TICKS, "tick");
+  x10benchUse(firedCount);
+}
+
+X10_BENCH(schedulerRearmWithManyTimers)
+{
+  X10scheduler scheduler(&x10ex);
+  uint16_t ids[X10_SCHEDULER_MAX_TIMERS];
+  for(uint8_t i = 0; i < X10_SCHEDULER_MAX_TIMERS; i++)
+  {
+    ids[i] = scheduler.schedule(100000, 0, timerFired);
+  }
+  unsigned long failed = 0;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_TICKS; i++)
+  {
+    failed += scheduler.rearm(ids[i % X10_SCHEDULER_MAX_TIMERS], 100 * (i % 97 + 1));
+  }
+  timer.stop(BENCH_TICKS, "rearm");
+  x10benchUse(failed);
+}
+
+X10_BENCH(schedulerScheduleAndCancelWithManyTimers)
+{
+  X10scheduler scheduler(&x10ex);
+  // All but one timer pending
+  for(uint8_t i = 1; i < X10_SCHEDULER_MAX_TIMERS; i++)
+  {
+    scheduler.schedule(100 * i, 0, timerFired);
+  }
+  unsigned long failed = 0;
+  timer.start();
+  for(unsigned long i = 0; i < BENCH_TICKS; i++)
+  {
+    failed += scheduler.cancel(scheduler.schedule(100 * (i % 97 + 1), 0, timerFired));
+  }
+  timer.stop(BENCH_TICKS, "schedule and cancel");
+  x10benchUse(failed);
+}
@@ -0,0 +1,264 @@
+/************************************************************************/
+/* X10 gateway daemon tests, fake controller on pseudo terminal, v1.0.  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10fakeController.h"
+#include "X10message.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define CMD_STATUS_REQUEST 0xF
+
+static uint8_t charHexToDecimal(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return c;
+}
+
+X10fakeController::X10fakeController()
+{
+  isRunning = false;
+  isPaused = false;
+  isBufferFull = false;
+  bmHouse = 0;
+  slaveFd = -1;
+  masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+  if(masterFd < 0 || grantpt(masterFd) || unlockpt(masterFd)) return;
+  devicePath = ptsname(masterFd);
+  // Slave is kept open, so that output written before the gateway opens the
+  // port is kept, and raw, so that it's not changed
+  slaveFd = open(devicePath.c_str(), O_RDWR | O_NOCTTY);
+  termios tty;
+  if(slaveFd >= 0 && !tcgetattr(slaveFd, &tty))
+  {
+    cfmakeraw(&tty);
+    tcsetattr(slaveFd, TCSANOW, &tty);
+  }
+}
+
+X10fakeController::~X10fakeController()
+{
+  stop();
+  if(slaveFd >= 0) close(slaveFd);
+  if(masterFd >= 0) close(masterFd);
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Returns path of serial port the gateway opens
+const char *X10fakeController::getDevicePath()
+{
+  return devicePath.c_str();
+}
+
+// Starts handling messages, and prints "X10" like the sketches do at startup
+void X10fakeController::start()
+{
+  if(isRunning) return;
+  isRunning = true;
+  thread = std::thread(&X10fakeController::run, this);
+  print("X10");
+}
+
+void X10fakeController::stop()
+{
+  if(!isRunning) return;
+  isRunning = false;
+  thread.join();
+}
+
+// Prints "X10" again, module state is kept like when it's stored in EEPROM
+void X10fakeController::restart()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  bmHouse = 0;
+  print("X10");
+}
+
+// Messages are left unread in the pseudo terminal while paused
+void X10fakeController::pause()
+{
+  isPaused = true;
+}
+
+void X10fakeController::resume()
+{
+  isPaused = false;
+}
+
+// Power line messages are not buffered, and _ExBuffer is printed after echo
+void X10fakeController::setBufferFull(bool isBufferFull)
+{
+  this->isBufferFull = isBufferFull;
+}
+
+void X10fakeController::setModuleState(char house, uint8_t unit, uint8_t command, uint8_t data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  state.setState(house, unit, command, data);
+}
+
+// Prints line to serial port, e.g. an RF message
+void X10fakeController::print(const std::string &line)
+{
+  std::lock_guard<std::mutex> lock(writeMutex);
+  std::string text = line + "\r\n";
+  size_t sent = 0;
+  while(sent < text.size())
+  {
+    ssize_t length = write(masterFd, text.data() + sent, text.size() - sent);
+    if(length <= 0) return;
+    sent += length;
+  }
+}
+
+// Returns messages handled, extended messages as one message
+std::vector<std::string> X10fakeController::getReceived()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return received;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+void X10fakeController::run()
+{
+  while(isRunning)
+  {
+    if(isPaused)
+    {
+      usleep(2000);
+      continue;
+    }
+    pollfd fd = { masterFd, POLLIN, 0 };
+    if(poll(&fd, 1, 10) <= 0) continue;
+    char buffer[64];
+    ssize_t length = read(masterFd, buffer, sizeof(buffer));
+    if(length <= 0)
+    {
+      usleep(2000);
+      continue;
+    }
+    input.append(buffer, length);
+    // Read 3 bytes at a time, like serialEvent
+    while(input.size() >= 3)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      process3BMessage(toupper(input[0]), toupper(input[1]), toupper(input[2]));
+      input.erase(0, 3);
+    }
+  }
+}
+
+// Same as process3BMessage in the example sketches
+void X10fakeController::process3BMessage(char byte1, char byte2, char byte3)
+{
+  const char hex[] = "0123456789ABCDEF";
+  std::string text;
+  text += byte1;
+  text += byte2;
+  text += byte3;
+  uint8_t unit = byte1 != 'R' ? charHexToDecimal(byte2) : byte2;
+  uint8_t command = byte1 != 'R' || byte2 != 'W' ? charHexToDecimal(byte3) : byte3;
+  // Standard message
+  if(byte1 >= 'A' && byte1 <= 'P' && (unit <= 0xF || byte2 == '_') && (command <= 0xF || byte3 == '_') && (byte2 != '_' || byte3 != '_'))
+  {
+    bmHouse = byte1;
+    bmUnit = byte2 == '_' ? 0 : unit + 1;
+    bmCommand = byte3 == '_' ? CMD_STATUS_REQUEST : command;
+    bmExtCommand = 0;
+    bmText = text;
+    if(bmCommand != X10_CMD_EXTENDED_CODE && bmCommand != X10_CMD_EXTENDED_DATA)
+    {
+      received.push_back(text);
+      print(x10formatEvent("SD:", bmHouse, bmUnit, byte3 == '_' ? X10_DATA_UNKNOWN : command, 0, 0));
+      sendPowerLine(bmHouse, bmUnit, bmCommand, 0, 0);
+      bmHouse = 0;
+    }
+  }
+  // Extended message: extended command and then extended data
+  else if(byte1 == 'X' && bmHouse)
+  {
+    uint8_t data = unit * 16 + command;
+    bmText += text;
+    if(!bmExtCommand)
+    {
+      bmExtCommand = data;
+    }
+    else
+    {
+      received.push_back(bmText);
+      print(x10formatEvent("SD:", bmHouse, bmUnit, bmCommand, bmExtCommand, data));
+      sendPowerLine(bmHouse, bmUnit, bmCommand, bmExtCommand, data);
+      bmHouse = 0;
+    }
+  }
+  // Scenario execute
+  else if(byte1 == 'S')
+  {
+    uint8_t scenario = unit * 16 + command;
+    received.push_back(text);
+    print(std::string("SD:S") + hex[scenario >> 4] + hex[scenario & 0xF]);
+  }
+  // Request module state
+  else if(byte1 == 'R' && ((byte2 >= 'A' && byte2 <= 'P') || byte2 == '*'))
+  {
+    received.push_back(text);
+    print(std::string("SD:R") + byte2 + (byte2 != '*' && command <= 0xF ? hex[command] : '*'));
+    for(int i = 0; i < 256; i++)
+    {
+      char house = 'A' + (i >> 4);
+      if((byte2 != '*' && house != byte2) || (byte2 != '*' && command <= 0xF && (i & 0xF) != command)) continue;
+      std::string line = state.format(house, (i & 0xF) + 1);
+      if(!line.empty()) print(line);
+    }
+  }
+  // Wipe module state
+  else if(byte1 == 'R' && byte2 == 'W' && ((byte3 >= 'A' && byte3 <= 'P') || byte3 == '*'))
+  {
+    received.push_back(text);
+    print(std::string("SD:RW") + byte3);
+    state.wipe(byte3);
+    print(std::string("MS:") + byte3 + "__");
+  }
+  else
+  {
+    print("SD:_ExSyntax");
+  }
+}
+
+// Prints transmitted message like the X10ex echo, and updates module state
+void X10fakeController::sendPowerLine(char house, uint8_t unit, uint8_t command, uint8_t extCommand, uint8_t extData)
+{
+  if(isBufferFull)
+  {
+    print("SD:_ExBuffer");
+    return;
+  }
+  print(x10formatEvent("PL:", house, unit, command, extCommand, extData));
+  if(unit) state.update(house, unit, command, extCommand, extData);
+}
@@ -0,0 +1,75 @@
+/************************************************************************/
+/* X10 gateway daemon tests, fake controller on pseudo terminal, v1.0.  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10fakeController_h
+#define X10fakeController_h
+
+#include "X10moduleCache.h"
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Controller running one of the example sketches, on the other end of a
+// pseudo terminal. Serial messages are handled the same way as by
+// process3BMessage: echoed with "SD:", and power line messages are sent
+// (printed with "PL:", like the X10ex transmit echo) and update module state.
+// Module state requests and wipes are answered from module state.
+class X10fakeController
+{
+
+  public:
+    X10fakeController();
+    ~X10fakeController();
+    // Public methods
+    const char *getDevicePath();
+    void start();
+    void stop();
+    void restart();
+    void pause();
+    void resume();
+    void setBufferFull(bool isBufferFull);
+    void setModuleState(char house, uint8_t unit, uint8_t command, uint8_t data);
+    void print(const std::string &line);
+    std::vector<std::string> getReceived();
+
+  private:
+    int masterFd, slaveFd;
+    std::string devicePath;
+    std::thread thread;
+    std::atomic<bool> isRunning, isPaused, isBufferFull;
+    // Module state and received messages are shared with test thread
+    std::mutex mutex;
+    std::mutex writeMutex;
+    X10moduleCache state;
+    std::vector<std::string> received;
+    std::string input;
+    // Extended message received in three parts, like in the sketches
+    char bmHouse;
+    uint8_t bmUnit, bmCommand, bmExtCommand;
+    std::string bmText;
+    // Private methods
+    void run();
+    void process3BMessage(char byte1, char byte2, char byte3);
+    void sendPowerLine(char house, uint8_t unit, uint8_t command, uint8_t extCommand, uint8_t extData);
+};
+
+#endif
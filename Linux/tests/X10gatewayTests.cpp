@@ -0,0 +1,315 @@
+/************************************************************************/
+/* X10 gateway daemon tests, gateway with fake controller, v1.0.        */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10test.h"
+#include "X10gateway.h"
+#include "X10fakeController.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Replies and events are expected well within this time
+#define TEST_TIMEOUT_MS 2000
+
+// Gateway connected to fake controller, with socket in a temporary directory
+struct TestSetup
+{
+  X10fakeController controller;
+  X10gateway gateway;
+  std::string socketPath;
+
+  TestSetup()
+  {
+    char path[] = "/tmp/x10d_testXXXXXX";
+    socketPath = std::string(mkdtemp(path)) + "/x10d.sock";
+  }
+
+  ~TestSetup()
+  {
+    gateway.end();
+    controller.stop();
+    rmdir(socketPath.substr(0, socketPath.rfind('/')).c_str());
+  }
+
+  bool begin()
+  {
+    int fd = X10gateway::openSerial(controller.getDevicePath(), 115200);
+    return fd < 0 || gateway.begin(fd, socketPath.c_str());
+  }
+
+  void poll(int ms)
+  {
+    for(int i = 0; i < ms / 5; i++) gateway.poll(5);
+  }
+
+  bool waitSynced()
+  {
+    for(int i = 0; i < TEST_TIMEOUT_MS / 5 && !gateway.isSynced(); i++) gateway.poll(5);
+    return gateway.isSynced();
+  }
+};
+
+// Client connected to gateway socket, the gateway is polled while waiting
+struct TestClient
+{
+  int fd;
+  std::string input;
+  TestSetup &setup;
+
+  TestClient(TestSetup &setup) : setup(setup)
+  {
+    sockaddr_un address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, setup.socketPath.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    connect(fd, (sockaddr *)&address, sizeof(address));
+    // Accept connection
+    size_t count = setup.gateway.getClientCount();
+    for(int i = 0; i < 100 && setup.gateway.getClientCount() == count; i++) setup.gateway.poll(5);
+  }
+
+  ~TestClient()
+  {
+    close(fd);
+  }
+
+  void send(const std::string &line)
+  {
+    std::string text = line + "\n";
+    ::send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+  }
+
+  // Returns next line, or empty string on timeout
+  std::string readLine()
+  {
+    for(int i = 0; i < TEST_TIMEOUT_MS / 5; i++)
+    {
+      size_t end = input.find("\r\n");
+      if(end != std::string::npos)
+      {
+        std::string line = input.substr(0, end);
+        input.erase(0, end + 2);
+        return line;
+      }
+      setup.gateway.poll(5);
+      char buffer[256];
+      ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if(length > 0) input.append(buffer, length);
+    }
+    return std::string();
+  }
+
+  // Returns next line starting with prefix, other lines are skipped
+  std::string readLine(const std::string &prefix)
+  {
+    std::string line;
+    do
+    {
+      line = readLine();
+    }
+    while(!line.empty() && line.compare(0, prefix.size(), prefix));
+    return line;
+  }
+
+  // Returns true when there is no input for a while
+  bool isIdle()
+  {
+    setup.poll(50);
+    char buffer[256];
+    ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if(length > 0) input.append(buffer, length);
+    return input.empty();
+  }
+};
+
+static std::string join(const std::vector<std::string> &lines)
+{
+  std::string text;
+  for(size_t i = 0; i < lines.size(); i++) text += (i ? "," : "") + lines[i];
+  return text;
+}
+
+X10_TEST(syncsStateAndAnswersFromCache)
+{
+  TestSetup setup;
+  setup.controller.setModuleState('A', 3, X10_CMD_STATUS_ON, 62);
+  setup.controller.setModuleState('B', 1, X10_CMD_STATUS_OFF, 0);
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client(setup);
+  client.send("ra*");
+  X10_CHECK_EQUAL(std::string("SD:RA*"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:A2Dx00x3E"), client.readLine());
+  client.send("R**");
+  X10_CHECK_EQUAL(std::string("SD:R**"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:A2Dx00x3E"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:B0E"), client.readLine());
+  client.send("RB1");
+  X10_CHECK_EQUAL(std::string("SD:RB1"), client.readLine());
+  X10_CHECK(client.isIdle());
+  // Only the gateway's own state request reaches controller
+  X10_CHECK_EQUAL(std::string("R**"), join(setup.controller.getReceived()));
+  X10_CHECK_EQUAL(3u, setup.gateway.getStats().cached);
+}
+
+X10_TEST(answersQueriesReceivedBeforeSync)
+{
+  TestSetup setup;
+  setup.controller.setModuleState('C', 5, X10_CMD_STATUS_ON, 0);
+  setup.controller.pause();
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  TestClient client(setup);
+  client.send("RC4");
+  X10_CHECK(client.isIdle());
+  X10_CHECK(!setup.gateway.isSynced());
+  setup.controller.resume();
+  X10_CHECK_EQUAL(std::string("SD:RC4"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:C4D"), client.readLine());
+}
+
+X10_TEST(commandsUpdateCache)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client(setup);
+  client.send("a02");
+  X10_CHECK_EQUAL(std::string("SD:A02"), client.readLine());
+  X10_CHECK_EQUAL(std::string("PL:A02"), client.readLine());
+  client.send("A07x31x1F");
+  X10_CHECK_EQUAL(std::string("SD:A07x31x1F"), client.readLine());
+  X10_CHECK_EQUAL(std::string("PL:A07x31x1F"), client.readLine());
+  client.send("RA0");
+  X10_CHECK_EQUAL(std::string("SD:RA0"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:A0Dx00x1F"), client.readLine());
+  // Wipe is sent to controller, and wipes cache
+  client.send("RWA");
+  X10_CHECK_EQUAL(std::string("SD:RWA"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:A__"), client.readLine());
+  client.send("RA0");
+  X10_CHECK_EQUAL(std::string("SD:RA0"), client.readLine());
+  X10_CHECK(client.isIdle());
+}
+
+X10_TEST(coalescesDuplicateCommands)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client1(setup), client2(setup), client3(setup);
+  // Controller is busy with the first message while the others are received
+  setup.controller.pause();
+  client1.send("B12");
+  setup.poll(20);
+  client2.send("A13");
+  client3.send("A13");
+  client2.send("A14");
+  client3.send("A14");
+  setup.poll(50);
+  X10_CHECK_EQUAL(1u, setup.gateway.getStats().coalesced);
+  setup.controller.resume();
+  X10_CHECK_EQUAL(std::string("SD:B12"), client1.readLine("SD:"));
+  X10_CHECK_EQUAL(std::string("SD:A13"), client2.readLine("SD:"));
+  X10_CHECK_EQUAL(std::string("SD:A13"), client3.readLine("SD:"));
+  // Dim is not idempotent, so it's sent for both clients
+  X10_CHECK_EQUAL(std::string("SD:A14"), client2.readLine("SD:"));
+  X10_CHECK_EQUAL(std::string("SD:A14"), client3.readLine("SD:"));
+  X10_CHECK_EQUAL(std::string("R**,B12,A13,A14,A14"), join(setup.controller.getReceived()));
+}
+
+X10_TEST(sendsErrorsToSender)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client1(setup), client2(setup);
+  setup.controller.setBufferFull(true);
+  client1.send("A12");
+  X10_CHECK_EQUAL(std::string("SD:A12"), client1.readLine());
+  X10_CHECK_EQUAL(std::string("SD:_ExBuffer"), client1.readLine());
+  // Invalid messages are not sent to controller
+  client2.send("Q12");
+  X10_CHECK_EQUAL(std::string("SD:_ExSyntax"), client2.readLine());
+  X10_CHECK(client2.isIdle());
+  X10_CHECK_EQUAL(std::string("R**,A12"), join(setup.controller.getReceived()));
+}
+
+X10_TEST(passesEventsToAllClients)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client1(setup), client2(setup);
+  setup.controller.print("RF:C13");
+  setup.controller.print("PL:D43");
+  X10_CHECK_EQUAL(std::string("RF:C13"), client1.readLine());
+  X10_CHECK_EQUAL(std::string("RF:C13"), client2.readLine());
+  X10_CHECK_EQUAL(std::string("PL:D43"), client1.readLine());
+  X10_CHECK_EQUAL(std::string("PL:D43"), client2.readLine());
+  X10_CHECK(!setup.gateway.getCache().getState('D', 5).isOn);
+  X10_CHECK(setup.gateway.getCache().getState('D', 5).isKnown);
+}
+
+X10_TEST(resyncsWhenControllerRestarts)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client(setup);
+  // State changed while gateway was not listening
+  setup.controller.setModuleState('E', 2, X10_CMD_STATUS_ON, 20);
+  setup.controller.restart();
+  X10_CHECK_EQUAL(std::string("X10"), client.readLine());
+  X10_CHECK(setup.waitSynced());
+  client.send("RE1");
+  X10_CHECK_EQUAL(std::string("SD:RE1"), client.readLine());
+  X10_CHECK_EQUAL(std::string("MS:E1Dx00x14"), client.readLine());
+  X10_CHECK_EQUAL(std::string("R**,R**"), join(setup.controller.getReceived()));
+}
+
+X10_TEST(dropsRepliesToClosedClient)
+{
+  TestSetup setup;
+  setup.controller.start();
+  X10_CHECK(!setup.begin());
+  X10_CHECK(setup.waitSynced());
+  TestClient client1(setup);
+  {
+    TestClient client2(setup);
+    setup.controller.pause();
+    client2.send("F12");
+    setup.poll(20);
+  }
+  setup.poll(20);
+  X10_CHECK_EQUAL(1u, setup.gateway.getClientCount());
+  setup.controller.resume();
+  X10_CHECK_EQUAL(std::string("PL:F12"), client1.readLine());
+  client1.send("F13");
+  X10_CHECK_EQUAL(std::string("SD:F13"), client1.readLine());
+}
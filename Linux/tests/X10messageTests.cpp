@@ -0,0 +1,127 @@
+/************************************************************************/
+/* X10 gateway daemon tests, message parser and module state, v1.0.     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10test.h"
+#include "X10message.h"
+#include "X10moduleCache.h"
+
+X10_TEST(parsesStandardMessage)
+{
+  X10message message;
+  X10_CHECK(!x10parseMessage("ab3", message));
+  X10_CHECK_EQUAL(X10_MESSAGE_STANDARD, message.type);
+  X10_CHECK_EQUAL('A', message.house);
+  X10_CHECK_EQUAL(12, message.unit);
+  X10_CHECK_EQUAL(X10_CMD_OFF, message.command);
+  X10_CHECK_EQUAL(std::string("AB3"), message.text);
+  X10_CHECK(!x10parseMessage("A_5", message));
+  X10_CHECK_EQUAL(0, message.unit);
+  X10_CHECK(!x10parseMessage("P0_", message));
+  X10_CHECK_EQUAL(1, message.unit);
+}
+
+X10_TEST(parsesExtendedMessage)
+{
+  X10message message;
+  X10_CHECK(!x10parseMessage("A37X31X21", message));
+  X10_CHECK_EQUAL(X10_MESSAGE_EXTENDED, message.type);
+  X10_CHECK_EQUAL(4, message.unit);
+  X10_CHECK_EQUAL(X10_EXC_PRE_SET_DIM, message.extCommand);
+  X10_CHECK_EQUAL(0x21, message.extData);
+  X10_CHECK_EQUAL(std::string("A37x31x21"), message.text);
+}
+
+X10_TEST(parsesScenarioStateAndWipe)
+{
+  X10message message;
+  X10_CHECK(!x10parseMessage("S14", message));
+  X10_CHECK_EQUAL(X10_MESSAGE_SCENARIO, message.type);
+  X10_CHECK_EQUAL(20, message.scenario);
+  X10_CHECK(!x10parseMessage("RA2", message));
+  X10_CHECK_EQUAL(X10_MESSAGE_STATE, message.type);
+  X10_CHECK_EQUAL(3, message.unit);
+  X10_CHECK(!x10parseMessage("Rg_", message));
+  X10_CHECK_EQUAL('G', message.house);
+  X10_CHECK_EQUAL(0, message.unit);
+  X10_CHECK_EQUAL(std::string("RG*"), message.text);
+  X10_CHECK(!x10parseMessage("R*3", message));
+  X10_CHECK_EQUAL(std::string("R**"), message.text);
+  X10_CHECK(!x10parseMessage("RWb", message));
+  X10_CHECK_EQUAL(X10_MESSAGE_WIPE, message.type);
+  X10_CHECK_EQUAL('B', message.house);
+}
+
+X10_TEST(rejectsInvalidMessage)
+{
+  X10message message;
+  X10_CHECK(x10parseMessage("", message));
+  X10_CHECK(x10parseMessage("A1", message));
+  X10_CHECK(x10parseMessage("Q12", message));
+  X10_CHECK(x10parseMessage("A__", message));
+  X10_CHECK(x10parseMessage("AG2", message));
+  // Extended command without data, and standard command with data
+  X10_CHECK(x10parseMessage("A37", message));
+  X10_CHECK(x10parseMessage("A32x31x21", message));
+  X10_CHECK(x10parseMessage("A37x31y21", message));
+  X10_CHECK(x10parseMessage("SG1", message));
+  X10_CHECK(x10parseMessage("RWX", message));
+}
+
+X10_TEST(parsesAndFormatsEvent)
+{
+  char house;
+  uint8_t unit, command, extCommand, extData;
+  X10_CHECK(!x10parseEvent("A2Dx00x3E", house, unit, command, extCommand, extData));
+  X10_CHECK_EQUAL(3, unit);
+  X10_CHECK_EQUAL(X10_CMD_STATUS_ON, command);
+  X10_CHECK_EQUAL(0x3E, extData);
+  X10_CHECK(!x10parseEvent("B__", house, unit, command, extCommand, extData));
+  X10_CHECK_EQUAL(0, unit);
+  X10_CHECK_EQUAL(X10_DATA_UNKNOWN, command);
+  X10_CHECK_EQUAL(std::string("MS:A2Dx00x3E"), x10formatEvent("MS:", 'A', 3, X10_CMD_STATUS_ON, 0, 0x3E));
+  X10_CHECK_EQUAL(std::string("MS:A2E"), x10formatEvent("MS:", 'A', 3, X10_CMD_STATUS_OFF, 0, 0));
+  X10_CHECK_EQUAL(std::string("PL:C_6"), x10formatEvent("PL:", 'C', 0, 6, 0, 0));
+  X10_CHECK_EQUAL(std::string("PL:A37x31x21"), x10formatEvent("PL:", 'A', 4, 7, X10_EXC_PRE_SET_DIM, 0xE1));
+}
+
+X10_TEST(cacheUpdatesLikeX10ex)
+{
+  X10moduleCache cache;
+  X10_CHECK(!cache.getState('A', 1).isSeen);
+  // Dim of module that is seen but not known sets full brightness, bright
+  // increases brightness
+  cache.update('A', 1, X10_CMD_DIM, 0, 0);
+  X10_CHECK_EQUAL(62, cache.getState('A', 1).data);
+  X10_CHECK(cache.getState('A', 1).isOn);
+  cache.update('A', 1, X10_CMD_DIM, 0, 0);
+  X10_CHECK_EQUAL(53, cache.getState('A', 1).data);
+  cache.update('A', 1, X10_CMD_BRIGHT, 0, 0);
+  X10_CHECK_EQUAL(62, cache.getState('A', 1).data);
+  cache.update('A', 1, X10_CMD_OFF, 0, 0);
+  X10_CHECK(!cache.getState('A', 1).isOn);
+  X10_CHECK(cache.getState('A', 1).isKnown);
+  X10_CHECK_EQUAL(std::string("MS:A0Ex00x3E"), cache.format('A', 1));
+  cache.update('A', 1, X10_CMD_EXTENDED_CODE, X10_EXC_PRE_SET_DIM, 0x1F);
+  X10_CHECK_EQUAL(std::string("MS:A0Dx00x1F"), cache.format('A', 1));
+  cache.update('B', 16, X10_DATA_UNKNOWN, 0, 0);
+  X10_CHECK_EQUAL(std::string("MS:BF_"), cache.format('B', 16));
+  cache.wipe('A');
+  X10_CHECK(!cache.getState('A', 1).isSeen);
+  X10_CHECK(cache.getState('B', 16).isSeen);
+}
@@ -0,0 +1,69 @@
+/************************************************************************/
+/* X10 gateway daemon tests, minimal test runner, v1.0.                 */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10test.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct X10testEntry
+{
+  const char *name;
+  X10testFunction function;
+};
+
+// Created on first use, since test cases are registered by static constructors
+static std::vector<X10testEntry> &getTests()
+{
+  static std::vector<X10testEntry> tests;
+  return tests;
+}
+
+static int failCount;
+
+X10testCase::X10testCase(const char *name, X10testFunction function)
+{
+  X10testEntry entry = { name, function };
+  getTests().push_back(entry);
+}
+
+void x10testFail(const std::string &text, const char *file, int line)
+{
+  printf("  %s:%d: %s\n", file, line, text.c_str());
+  failCount++;
+}
+
+// Runs all tests, or the tests with name containing the first argument
+int main(int argc, char *argv[])
+{
+  int testCount = 0, failedCount = 0;
+  for(size_t i = 0; i < getTests().size(); i++)
+  {
+    const X10testEntry &test = getTests()[i];
+    if(argc > 1 && !strstr(test.name, argv[1])) continue;
+    printf("%s\n", test.name);
+    fflush(stdout);
+    int failsBefore = failCount;
+    test.function();
+    testCount++;
+    if(failCount > failsBefore) failedCount++;
+  }
+  printf("%d tests, %d failed\n", testCount, failedCount);
+  return failedCount ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+/************************************************************************/
+/* X10 gateway daemon tests, minimal test runner, v1.0.                 */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10test_h
+#define X10test_h
+
+#include <sstream>
+#include <string>
+
+// Minimal test runner, so that tests build without other libraries:
+//
+// X10_TEST(parsesStandardMessage)
+// {
+//   X10_CHECK_EQUAL(std::string("A12"), message.text);
+// }
+//
+// Tests run in the order they are defined in each file. A failed check is
+// printed and the test goes on.
+typedef void (*X10testFunction)();
+
+struct X10testCase
+{
+  X10testCase(const char *name, X10testFunction function);
+};
+
+void x10testFail(const std::string &text, const char *file, int line);
+
+template<typename Expected, typename Actual>
+void x10testEqual(const Expected &expected, const Actual &actual, const char *text, const char *file, int line)
+{
+  if(expected == actual) return;
+  std::ostringstream out;
+  out << text << ": expected \"" << expected << "\", got \"" << actual << "\"";
+  x10testFail(out.str(), file, line);
+}
+
+#define X10_TEST(name) \
+  static void name(); \
+  static X10testCase name##Case(#name, name); \
+  static void name()
+
+#define X10_CHECK(expression) \
+  do { if(!(expression)) x10testFail(#expression, __FILE__, __LINE__); } while(0)
+
+#define X10_CHECK_EQUAL(expected, actual) \
+  x10testEqual(expected, actual, #actual, __FILE__, __LINE__)
+
+#endif
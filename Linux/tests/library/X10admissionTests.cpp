@@ -0,0 +1,114 @@
+/************************************************************************/
+/* X10 library host tests, admission control, v1.0.                     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10admission.h"
+
+X10_TEST(admissionLimitsSourceToBurst)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  X10_CHECK_EQUAL(X10_ADMISSION_BURST, admission.getCredits(X10_ADMISSION_SOURCE_NETWORK));
+  for(uint8_t ix = 0; ix < X10_ADMISSION_BURST; ix++)
+  {
+    X10_CHECK(!admission.sendCmd(X10_ADMISSION_SOURCE_NETWORK, 'A', ix + 1, CMD_ON, 1));
+  }
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCE_NETWORK, 'A', 5, CMD_ON, 1));
+  X10_CHECK_EQUAL(0, admission.getCredits(X10_ADMISSION_SOURCE_NETWORK));
+  X10_CHECK_EQUAL(1, admission.getStats(X10_ADMISSION_SOURCE_NETWORK).limited);
+  // Other sources have their own bucket
+  X10_CHECK(!admission.sendCmd(X10_ADMISSION_SOURCE_SERIAL, 'B', 1, CMD_ON, 1));
+}
+
+X10_TEST(admissionRefillsOneTokenPerPeriod)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  admission.setRate(X10_ADMISSION_SOURCE_RF, 2, 100);
+  X10_CHECK(!admission.sendCmd(X10_ADMISSION_SOURCE_RF, 'A', 1, CMD_ON, 1));
+  X10_CHECK(!admission.sendCmd(X10_ADMISSION_SOURCE_RF, 'A', 1, CMD_OFF, 1));
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCE_RF, 'A', 1, CMD_ON, 1));
+  x10testAdvanceMicros(99000);
+  X10_CHECK_EQUAL(0, admission.getCredits(X10_ADMISSION_SOURCE_RF));
+  x10testAdvanceMicros(1000);
+  X10_CHECK_EQUAL(1, admission.getCredits(X10_ADMISSION_SOURCE_RF));
+  // Tokens are not saved up beyond the burst while source is idle
+  x10testAdvanceMicros(10000000);
+  X10_CHECK_EQUAL(2, admission.getCredits(X10_ADMISSION_SOURCE_RF));
+}
+
+X10_TEST(admissionRejectsWhenQueueIsFull)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  admission.setRate(X10_ADMISSION_SOURCE_SERIAL, 10, 0);
+  for(uint8_t ix = 0; ix < X10_ADMISSION_QUEUE_SIZE; ix++)
+  {
+    X10_CHECK(!admission.sendCmd(X10_ADMISSION_SOURCE_SERIAL, 'C', ix + 1, CMD_ON, 1));
+  }
+  X10_CHECK_EQUAL(0, admission.getCredits(X10_ADMISSION_SOURCE_SERIAL));
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCE_SERIAL, 'C', 9, CMD_ON, 1));
+  X10_CHECK_EQUAL(1, admission.getStats(X10_ADMISSION_SOURCE_SERIAL).overflows);
+  X10_CHECK_EQUAL(X10_ADMISSION_QUEUE_SIZE, admission.getQueuedCount(X10_ADMISSION_SOURCE_SERIAL));
+}
+
+X10_TEST(admissionInvalidMessagesUseNoTokens)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCE_IR, 'Q', 1, CMD_ON, 1));
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCE_IR, 'A', 17, CMD_ON, 1));
+  X10_CHECK(admission.sendCmd(X10_ADMISSION_SOURCES, 'A', 1, CMD_ON, 1));
+  X10_CHECK_EQUAL(X10_ADMISSION_BURST, admission.getCredits(X10_ADMISSION_SOURCE_IR));
+}
+
+X10_TEST(admissionPollKeepsSendBufferShort)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  for(uint8_t ix = 0; ix < X10_ADMISSION_BURST; ix++)
+  {
+    admission.sendCmd(X10_ADMISSION_SOURCE_NETWORK, 'A', ix + 1, CMD_ON, 1);
+  }
+  admission.poll();
+  X10_CHECK_EQUAL(X10_ADMISSION_MAX_BUFFERED + 1, x10ex.getBufferedCount());
+  X10_CHECK_EQUAL(X10_ADMISSION_BURST - X10_ADMISSION_MAX_BUFFERED - 1, admission.getQueuedCount(X10_ADMISSION_SOURCE_NETWORK));
+  admission.poll();
+  X10_CHECK_EQUAL(X10_ADMISSION_MAX_BUFFERED + 1, x10ex.getBufferedCount());
+}
+
+X10_TEST(admissionSharesCyclesBetweenSources)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10admission admission(&x10ex);
+  // An extended message uses a full quantum, two standard messages fit in one
+  admission.sendExt(X10_ADMISSION_SOURCE_NETWORK, 'A', 1, CMD_EXTENDED_CODE, 31, EXC_PRE_SET_DIM, 1);
+  admission.sendExt(X10_ADMISSION_SOURCE_NETWORK, 'A', 2, CMD_EXTENDED_CODE, 31, EXC_PRE_SET_DIM, 1);
+  admission.sendCmd(X10_ADMISSION_SOURCE_SERIAL, 'B', 1, CMD_ON, 1);
+  admission.sendCmd(X10_ADMISSION_SOURCE_SERIAL, 'B', 2, CMD_ON, 1);
+  admission.poll();
+  X10_CHECK_EQUAL(1, admission.getStats(X10_ADMISSION_SOURCE_NETWORK).sent);
+  X10_CHECK_EQUAL(1, admission.getStats(X10_ADMISSION_SOURCE_SERIAL).sent);
+}
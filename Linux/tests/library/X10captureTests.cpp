@@ -0,0 +1,69 @@
+/************************************************************************/
+/* X10 library host tests, receive edge capture buffer, v1.0.           */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10capture.h"
+
+// Captures a standard RF message: start burst, 32 bits and stop pulse
+static void captureRfMessage(X10capture &capture, uint16_t &ticks)
+{
+  for(uint8_t edge = 0; edge < 66; edge++)
+  {
+    ticks += edge < 2 ? 2240 : 140;
+    capture.capture(ticks, edge % 2);
+  }
+}
+
+X10_TEST(captureBuffersWholeRfMessages)
+{
+  X10capture capture;
+  uint16_t ticks = 0;
+  // One message is buffered while the next is received, before loop reads any
+  captureRfMessage(capture, ticks);
+  X10_CHECK_EQUAL(0, capture.getOverflowCount());
+  bool level;
+  uint16_t lengthUs;
+  uint8_t edges = 0;
+  while(capture.read(level, lengthUs)) edges++;
+  X10_CHECK_EQUAL(66, edges);
+}
+
+X10_TEST(captureCountsEdgesDroppedWhenFull)
+{
+  X10capture capture;
+  uint16_t ticks = 0;
+  captureRfMessage(capture, ticks);
+  captureRfMessage(capture, ticks);
+  X10_CHECK_EQUAL(132 - (X10_CAPTURE_BUFFER_SIZE - 1), capture.getOverflowCount());
+}
+
+X10_TEST(captureReadsLevelAndLength)
+{
+  X10capture capture;
+  capture.capture(1000, 0);
+  capture.capture(1250, 1);
+  bool level;
+  uint16_t lengthUs;
+  X10_CHECK(capture.read(level, lengthUs));
+  X10_CHECK(capture.read(level, lengthUs));
+  // Rising edge ends a low level, length is 250 ticks of 4us
+  X10_CHECK(!level);
+  X10_CHECK_EQUAL(1000, lengthUs);
+  X10_CHECK(!capture.read(level, lengthUs));
+}
@@ -0,0 +1,86 @@
+/************************************************************************/
+/* X10 library host tests, house and unit code encode and decode, v1.0. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10codec.h"
+
+// House and unit codes as listed in the X10 protocol documentation
+static const uint8_t documentedCodes[16] =
+{
+  B0110, B1110, B0010, B1010, B0001, B1001, B0101, B1101,
+  B0111, B1111, B0011, B1011, B0000, B1000, B0100, B1100,
+};
+
+X10_TEST(codecEncodesDocumentedCodes)
+{
+  for(uint8_t index = 0; index <= 0xF; index++)
+  {
+    X10_CHECK_EQUAL((int)documentedCodes[index], (int)x10encode(index));
+    X10_CHECK_EQUAL((int)documentedCodes[index], (int)x10encodeConst(index));
+  }
+}
+
+X10_TEST(codecRoundTripsEveryIndexAndCode)
+{
+  for(uint8_t index = 0; index <= 0xF; index++)
+  {
+    X10_CHECK_EQUAL((int)index, (int)x10decode(x10encode(index)));
+  }
+  for(uint8_t code = 0; code <= 0xF; code++)
+  {
+    X10_CHECK_EQUAL((int)code, (int)x10encode(x10decode(code)));
+    X10_CHECK_EQUAL((int)x10decodeConst(code), (int)x10decode(code));
+  }
+}
+
+X10_TEST(codecUsesLowNibbleOfEveryByte)
+{
+  for(uint16_t value = 0; value <= 0xFF; value++)
+  {
+    X10_CHECK_EQUAL((int)x10encode(value & 0xF), (int)x10encode(value));
+    X10_CHECK_EQUAL((int)x10decode(value & 0xF), (int)x10decode(value));
+  }
+}
+
+X10_TEST(codecParsesEveryHouse)
+{
+  for(uint8_t index = 0; index <= 0xF; index++)
+  {
+    X10_CHECK_EQUAL((int)index, (int)x10parseHouse('A' + index));
+    X10_CHECK_EQUAL((int)index, (int)x10parseHouse('a' + index));
+    X10_CHECK_EQUAL((int)index, (int)x10parseHouse(index));
+  }
+  // Everything else is invalid
+  for(uint16_t house = 0; house <= 0xFF; house++)
+  {
+    bool isValid = house <= 0xF || (house >= 'A' && house <= 'P') || (house >= 'a' && house <= 'p');
+    if(!isValid) X10_CHECK(x10parseHouse(house) > 0xF);
+  }
+}
+
+X10_TEST(codecReversesEveryNibbleAndByte)
+{
+  for(uint16_t value = 0; value <= 0xFF; value++)
+  {
+    uint8_t reversed = 0;
+    for(uint8_t bit = 0; bit < 8; bit++) reversed |= (value >> bit & 1) << (7 - bit);
+    X10_CHECK_EQUAL((int)reversed, (int)x10reverseByte(value));
+    X10_CHECK_EQUAL((int)(reversed >> 4), (int)x10reverseNibble(value));
+  }
+}
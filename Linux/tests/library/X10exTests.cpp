@@ -0,0 +1,184 @@
+/************************************************************************/
+/* X10 library host tests, power line interface, v1.0.                  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10ex.h"
+#include <math.h>
+#include <new>
+#include <string>
+
+struct SmallConfig : X10exConfig
+{
+  static const uint8_t bufferSize = 3;
+};
+
+struct SceneConfig : X10exConfig
+{
+  static const uint8_t bufferSize = 33;
+};
+
+// Returns number of messages buffered before the buffer is full
+static uint8_t fillBuffer(X10ex &x10ex)
+{
+  uint8_t count = 0;
+  while(count < 255 && !x10ex.sendCmd('A', count % 16 + 1, count < 16 ? CMD_ON : CMD_OFF, 1)) count++;
+  return count;
+}
+
+X10_TEST(exBufferHoldsConfiguredNumberOfMessages)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10exConfigured<SmallConfig> small(0, 2, 9, 8, 0, NULL, 1, 50, 3);
+  X10exConfigured<SceneConfig> scene(0, 2, 9, 8, 0, NULL, 1, 50, 4);
+  X10_CHECK_EQUAL(X10_BUFFER_SIZE - 1, fillBuffer(x10ex));
+  X10_CHECK_EQUAL(2, fillBuffer(small));
+  X10_CHECK_EQUAL(32, fillBuffer(scene));
+  X10_CHECK_EQUAL(2, small.getBufferedCount());
+  X10_CHECK_EQUAL(32, scene.getBufferedCount());
+}
+
+X10_TEST(exBatchMustFitConfiguredBuffer)
+{
+  X10exConfigured<SmallConfig> small(0, 2, 9, 8, 0, NULL);
+  X10_CHECK(small.beginBatch(3));
+  X10_CHECK(!small.beginBatch(2));
+  X10_CHECK(!small.sendCmd('B', 1, CMD_ON, 1));
+  X10_CHECK(!small.sendCmd('B', 2, CMD_ON, 1));
+  X10_CHECK(!small.endBatch());
+  X10_CHECK_EQUAL(2, small.getBufferedCount());
+}
+
+X10_TEST(exInterfaceWithoutTimerBuffersNothing)
+{
+  // Timer2 is 8 bit, so it can't be an IO timer
+  X10ex x10ex(0, 2, 9, 8, 0, NULL, 1, 50, 2);
+  X10_CHECK(x10ex.sendCmd('A', 1, CMD_ON, 1));
+  X10_CHECK_EQUAL(0, x10ex.getBufferedCount());
+}
+
+static_assert(x10percentToBrightness(100) == 62, "Full brightness is 62");
+static_assert(x10percentToBrightness(0, EXC_DIM_TIME_300) == B11000000, "Dim time is in the upper bits");
+static_assert(x10brightnessToPercent(x10percentToBrightness(50, EXC_DIM_TIME_30)) == 50, "Round trip");
+
+X10_TEST(exBrightnessMatchesFloatingPointRounding)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  for(uint16_t percent = 0; percent <= 0xFF; percent++)
+  {
+    for(uint8_t time = 0; time < 5; time++)
+    {
+      uint8_t expected = percent >= 100 ? 62 : (uint8_t)round(percent * 62 / 100.0);
+      expected |= time >= B11 ? B11000000 : time << 6;
+      X10_CHECK_EQUAL((int)expected, (int)x10percentToBrightness(percent, time));
+      X10_CHECK_EQUAL((int)expected, (int)x10ex.percentToX10Brightness(percent, time));
+    }
+  }
+  for(uint16_t brightness = 0; brightness <= 0xFF; brightness++)
+  {
+    uint8_t expected = round((brightness & B111111) * 100 / 62.0);
+    X10_CHECK_EQUAL((int)expected, (int)x10brightnessToPercent(brightness));
+    X10_CHECK_EQUAL((int)expected, (int)x10ex.x10BrightnessToPercent(brightness));
+  }
+}
+
+X10_TEST(exModuleVersionsAreSharedByInterfaces)
+{
+  X10ex phase1(0, 2, 9, 8, 0, NULL, 1, 50, 1);
+  X10ex phase2(1, 5, 6, 7, 0, NULL, 1, 50, 3);
+  uint16_t version = phase1.getStateVersion();
+  phase2.setSensorState('D', 4, true);
+  X10_CHECK_EQUAL(version + 1, phase1.getStateVersion());
+  X10_CHECK_EQUAL(phase2.getStateVersion(), phase1.getStateVersion());
+  X10_CHECK(phase1.isModuleChanged('D', 4, version));
+  X10_CHECK(!phase1.isModuleChanged('D', 5, version));
+  // A later interface doesn't reset versions clients have seen
+  X10ex phase3(2, 10, 11, 12, 0, NULL, 1, 50, 4);
+  X10_CHECK_EQUAL(version + 1, phase3.getStateVersion());
+}
+
+// Sends the way the power line receive callback does, with interrupts disabled
+static bool sendFromInterrupt(X10ex &x10ex, uint8_t house, uint8_t unit, uint8_t command)
+{
+  uint8_t sreg = SREG;
+  cli();
+  bool error = x10ex.sendCmd(house, unit, command, 1);
+  SREG = sreg;
+  return error;
+}
+
+X10_TEST(exInterruptSendIsNotPartOfBatch)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10_CHECK(!x10ex.sendCmd('A', 1, CMD_BRIGHT, 2));
+  X10_CHECK(!x10ex.beginBatch(2));
+  X10_CHECK(!x10ex.sendCmd('B', 1, CMD_ON, 1));
+  // Repeat of message being sent resets its repetitions
+  X10_CHECK(!sendFromInterrupt(x10ex, 'A', 1, CMD_BRIGHT));
+  // Other messages are rejected, and the batch is kept
+  X10_CHECK(sendFromInterrupt(x10ex, 'C', 1, CMD_ON));
+  X10_CHECK(sendFromInterrupt(x10ex, 'Q', 1, CMD_ON));
+  X10_CHECK(!x10ex.sendCmd('B', 2, CMD_ON, 1));
+  X10_CHECK(!x10ex.endBatch());
+  X10_CHECK_EQUAL(3, x10ex.getBufferedCount());
+  // Accepted again when batch is done
+  X10_CHECK(!sendFromInterrupt(x10ex, 'C', 1, CMD_ON));
+  X10_CHECK_EQUAL(4, x10ex.getBufferedCount());
+}
+
+X10_TEST(exBatchRepeatingMessageBeingSentIsBuffered)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10_CHECK(!x10ex.sendCmd('A', 1, CMD_ON, 1));
+  X10_CHECK(!x10ex.beginBatch(1));
+  X10_CHECK(!x10ex.sendCmd('A', 1, CMD_ON, 1));
+  X10_CHECK(!x10ex.endBatch());
+  X10_CHECK_EQUAL(2, x10ex.getBufferedCount());
+}
+
+static std::string loopbackReceived;
+
+static void loopbackEvent(char house, uint8_t unit, uint8_t command, uint8_t, uint8_t, uint8_t)
+{
+  loopbackReceived += house + std::to_string(unit) + ":" + std::to_string(command) + ";";
+}
+
+X10_TEST(exInterfaceInDirtyMemorySendsAndReceives)
+{
+  // Interfaces don't have to be globals, so nothing may depend on memory
+  // being cleared before the constructor runs
+  alignas(X10ex) uint8_t memory[sizeof(X10ex)];
+  memset(memory, 0xA5, sizeof(memory));
+  X10ex *x10ex = new(memory) X10ex(0, 2, 9, 8, true, loopbackEvent);
+  x10ex->begin();
+  loopbackReceived.clear();
+  X10_CHECK(!x10ex->sendCmd('K', 7, CMD_OFF, 1));
+  // Receive pin is the inverted transmit pin, as with a PLC interface
+  for(uint16_t zc = 0; zc < 200; zc++)
+  {
+    x10ex->zeroCross();
+    for(uint8_t i = 0; i < 20 && (TCCR1B & _BV(CS10)); i++)
+    {
+      x10testSetPin(8, !x10testGetPin(9));
+      x10ex->ioTimer();
+    }
+  }
+  X10_CHECK_EQUAL(0, x10ex->getBufferedCount());
+  X10_CHECK_EQUAL(std::string("K7:3;"), loopbackReceived);
+  x10ex->~X10ex();
+}
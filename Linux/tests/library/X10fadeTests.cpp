@@ -0,0 +1,188 @@
+/************************************************************************/
+/* X10 library host tests, dimmer fades, v1.0.                          */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10fade.h"
+#include <string>
+
+#define FADE_TRANSMIT_PIN 9
+#define FADE_RECEIVE_PIN 8
+
+static X10fade *fader;
+static std::string received;
+
+// Power line receive callback: logs messages, e.g. "A1 dim 2" or "A1 off",
+// and forwards them to the fade like the examples do
+static void powerLineEvent(char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand, uint8_t)
+{
+  if(!received.empty()) received += ",";
+  received += house + std::to_string(unit);
+  if(command == CMD_EXTENDED_CODE && extCommand == EXC_PRE_SET_DIM) received += " dim " + std::to_string(extData & B111111);
+  else if(command == CMD_OFF) received += " off";
+  else received += " command " + std::to_string(command);
+  if(fader) fader->receive(house, unit, command, extData, extCommand);
+}
+
+// Power line interface that receives what it transmits, the receive pin is
+// the inverted transmit pin, as with a PLC interface
+struct FadeSetup
+{
+  X10ex x10ex;
+  X10fade fade;
+
+  FadeSetup() :
+    x10ex(0, 2, FADE_TRANSMIT_PIN, FADE_RECEIVE_PIN, true, powerLineEvent),
+    fade(&x10ex)
+  {
+    x10testSetMicros(0);
+    x10ex.begin();
+    x10ex.wipeModuleState();
+    fader = &fade;
+    received.clear();
+  }
+
+  ~FadeSetup()
+  {
+    fader = NULL;
+  }
+
+  // Runs zero crossings until the send buffer is empty and the last message
+  // has been received. Time is not moved, so fades see no time pass.
+  void transmit()
+  {
+    uint16_t idle = 0;
+    while(idle < 20)
+    {
+      idle = x10ex.getBufferedCount() ? 0 : idle + 1;
+      x10ex.zeroCross();
+      for(uint8_t i = 0; i < 20 && (TCCR1B & _BV(CS10)); i++)
+      {
+        x10testSetPin(FADE_RECEIVE_PIN, !x10testGetPin(FADE_TRANSMIT_PIN));
+        x10ex.ioTimer();
+      }
+    }
+  }
+
+  // Polls fade and sends the step buffered
+  void poll()
+  {
+    fade.poll();
+    transmit();
+  }
+};
+
+X10_TEST(fadeAtTargetSendsTargetOnce)
+{
+  FadeSetup setup;
+  // Unknown module state is assumed off
+  X10_CHECK(!setup.fade.fade('A', 3, 0, 1000));
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("A3 off"), received);
+  X10_CHECK(!setup.fade.isFading('A', 3));
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("A3 off"), received);
+}
+
+X10_TEST(fadeSkipsStepsSmallerThanMinStep)
+{
+  FadeSetup setup;
+  // One level per second
+  setup.fade.fade('A', 1, 100, 62000);
+  setup.poll();
+  x10testSetMicros(1000000);
+  setup.poll();
+  X10_CHECK_EQUAL(std::string(""), received);
+  x10testSetMicros(X10_FADE_MIN_STEP * 1000000UL);
+  setup.poll();
+  x10testSetMicros(X10_FADE_MIN_STEP * 1000000UL + 1000000);
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("A1 dim ") + std::to_string(X10_FADE_MIN_STEP), received);
+  // Last step is sent whatever its size
+  x10testSetMicros(61000000);
+  setup.poll();
+  x10testSetMicros(62000000);
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("A1 dim 2,A1 dim 61,A1 dim 62"), received);
+  X10_CHECK_EQUAL(0, setup.fade.getFadingCount());
+}
+
+X10_TEST(fadeStepsTakeTurns)
+{
+  FadeSetup setup;
+  setup.fade.fade('B', 1, 100, 62000);
+  setup.fade.fade('B', 2, 100, 62000);
+  x10testSetMicros(10000000);
+  setup.poll();
+  setup.poll();
+  setup.poll();
+  x10testSetMicros(20000000);
+  setup.poll();
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("B2 dim 10,B1 dim 10,B2 dim 20,B1 dim 20"), received);
+}
+
+X10_TEST(fadeIgnoresEchoButIsCancelledByOtherCommands)
+{
+  FadeSetup setup;
+  setup.fade.fade('C', 1, 100, 62000);
+  x10testSetMicros(10000000);
+  // Echo of the step is received through the receive callback
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("C1 dim 10"), received);
+  X10_CHECK(setup.fade.isFading('C', 1));
+  // Brightness outside the steps sent is another command
+  setup.fade.receive('C', 1, CMD_EXTENDED_CODE, 40, EXC_PRE_SET_DIM);
+  X10_CHECK(!setup.fade.isFading('C', 1));
+  setup.fade.fade('C', 1, 100, 62000);
+  setup.fade.fade('C', 2, 100, 62000);
+  setup.fade.receive('C', 2, CMD_ON, 0, 0);
+  X10_CHECK(setup.fade.isFading('C', 1));
+  X10_CHECK(!setup.fade.isFading('C', 2));
+  // Unit 0 cancels every fade in house
+  setup.fade.receive('C', 0, CMD_ALL_UNITS_OFF, 0, 0);
+  X10_CHECK_EQUAL(0, setup.fade.getFadingCount());
+}
+
+X10_TEST(fadeReplacedMidFadeContinuesFromLastStep)
+{
+  FadeSetup setup;
+  setup.fade.fade('D', 1, 100, 62000);
+  x10testSetMicros(10000000);
+  setup.poll();
+  // Fade down over 10 seconds, from the 10 just sent
+  X10_CHECK(!setup.fade.fade('D', 1, 0, 10000));
+  X10_CHECK_EQUAL(1, setup.fade.getFadingCount());
+  x10testSetMicros(15000000);
+  setup.poll();
+  x10testSetMicros(20000000);
+  setup.poll();
+  X10_CHECK_EQUAL(std::string("D1 dim 10,D1 dim 5,D1 off"), received);
+  X10_CHECK(!setup.fade.isFading('D', 1));
+}
+
+X10_TEST(fadeRejectsInvalidInputAndTooManyFades)
+{
+  FadeSetup setup;
+  X10_CHECK(setup.fade.fade('Q', 1, 50, 1000));
+  X10_CHECK(setup.fade.fade('A', 17, 50, 1000));
+  for(uint8_t unit = 1; unit <= X10_FADE_MAX; unit++) X10_CHECK(!setup.fade.fade('E', unit, 50, 1000));
+  X10_CHECK(setup.fade.fade('E', X10_FADE_MAX + 1, 50, 1000));
+  X10_CHECK(!setup.fade.cancel('E', 0));
+  X10_CHECK(setup.fade.cancel('E', 0));
+}
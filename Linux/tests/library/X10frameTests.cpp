@@ -0,0 +1,115 @@
+/************************************************************************/
+/* X10 library host tests, serial frame codec, v1.0.                    */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10frame.h"
+
+// Parses bytes, returns the last event
+static uint8_t parse(X10frame &parser, const uint8_t *data, uint8_t length)
+{
+  uint8_t event = X10_FRAME_NONE;
+  for(uint8_t ix = 0; ix < length; ix++) event = parser.parse(data[ix]);
+  return event;
+}
+
+X10_TEST(frameCrcIsCcitt)
+{
+  // CRC-16/CCITT-FALSE check value
+  uint16_t crc = 0xFFFF;
+  for(const char *c = "123456789"; *c; c++) crc = X10frame::crc16(crc, *c);
+  X10_CHECK_EQUAL(0x29B1, crc);
+}
+
+X10_TEST(frameEncodedFramesAreParsed)
+{
+  uint8_t payload[X10_FRAME_PAYLOAD_MAX] = { 'A', 3, 2, 0, 0, 1, X10_FRAME_SYNC, 0xFF };
+  X10frame parser;
+  for(uint8_t length = 0; length <= X10_FRAME_PAYLOAD_MAX; length++)
+  {
+    uint8_t frame[X10_FRAME_SIZE_MAX];
+    X10_CHECK_EQUAL(length + X10_FRAME_OVERHEAD, X10frame::encode(frame, X10_FRAME_COMMAND, length * 3, payload, length));
+    X10_CHECK_EQUAL(X10_FRAME_DONE, parse(parser, frame, length + X10_FRAME_OVERHEAD));
+    X10_CHECK_EQUAL(X10_FRAME_COMMAND, parser.getType());
+    X10_CHECK_EQUAL(length * 3, parser.getSequence());
+    X10_CHECK_EQUAL(length, parser.getLength());
+    X10_CHECK(!memcmp(payload, parser.getPayload(), length));
+    X10_CHECK(!parser.isStarted());
+  }
+  X10_CHECK_EQUAL(0, parser.getErrorCount());
+}
+
+X10_TEST(frameEncodeRejectsLongPayload)
+{
+  uint8_t payload[X10_FRAME_PAYLOAD_MAX + 1] = { 0 };
+  uint8_t frame[X10_FRAME_SIZE_MAX + 1];
+  X10_CHECK_EQUAL(0, X10frame::encode(frame, X10_FRAME_COMMAND, 0, payload, X10_FRAME_PAYLOAD_MAX + 1));
+}
+
+X10_TEST(frameTextBeforeSyncIsSkipped)
+{
+  const uint8_t text[] = "A3ON\r\n";
+  uint8_t frame[X10_FRAME_SIZE_MAX];
+  uint8_t payload[] = { 5 };
+  uint8_t length = X10frame::encode(frame, X10_FRAME_SCENARIO, 7, payload, 1);
+  X10frame parser;
+  X10_CHECK_EQUAL(X10_FRAME_NONE, parse(parser, text, sizeof(text) - 1));
+  X10_CHECK(!parser.isStarted());
+  X10_CHECK_EQUAL(X10_FRAME_DONE, parse(parser, frame, length));
+  X10_CHECK_EQUAL(X10_FRAME_SCENARIO, parser.getType());
+  X10_CHECK_EQUAL(5, parser.getPayload()[0]);
+}
+
+X10_TEST(frameCrcMismatchIsDropped)
+{
+  uint8_t frame[X10_FRAME_SIZE_MAX];
+  uint8_t payload[] = { 'B', 2 };
+  uint8_t length = X10frame::encode(frame, X10_FRAME_STATE, 1, payload, 2);
+  X10frame parser;
+  frame[4] ^= 0x01;
+  X10_CHECK_EQUAL(X10_FRAME_ERROR, parse(parser, frame, length));
+  X10_CHECK_EQUAL(1, parser.getErrorCount());
+  // Next frame is parsed
+  frame[4] ^= 0x01;
+  X10_CHECK_EQUAL(X10_FRAME_DONE, parse(parser, frame, length));
+  X10_CHECK_EQUAL(1, parser.getErrorCount());
+}
+
+X10_TEST(frameTooLongIsDropped)
+{
+  const uint8_t data[] = { X10_FRAME_SYNC, X10_FRAME_PAYLOAD_MAX + 1 };
+  X10frame parser;
+  X10_CHECK_EQUAL(X10_FRAME_ERROR, parse(parser, data, sizeof(data)));
+  X10_CHECK_EQUAL(1, parser.getErrorCount());
+  X10_CHECK(!parser.isStarted());
+}
+
+X10_TEST(frameBeginResynchronizes)
+{
+  uint8_t frame[X10_FRAME_SIZE_MAX];
+  uint8_t payload[] = { 1 };
+  uint8_t length = X10frame::encode(frame, X10_FRAME_HELLO, 0, payload, 1);
+  X10frame parser;
+  // Frame stops half way, e.g. host was restarted
+  X10_CHECK_EQUAL(X10_FRAME_NONE, parse(parser, frame, 4));
+  X10_CHECK(parser.isStarted());
+  parser.begin();
+  X10_CHECK(!parser.isStarted());
+  X10_CHECK_EQUAL(X10_FRAME_DONE, parse(parser, frame, length));
+  X10_CHECK_EQUAL(X10_FRAME_HELLO, parser.getType());
+}
@@ -0,0 +1,131 @@
+/************************************************************************/
+/* X10 library host tests, multi interface dispatcher, v1.0.            */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10group.h"
+
+static char lastHouse;
+static uint8_t lastUnit, receiveCount;
+
+static void groupReceived(char house, uint8_t unit, uint8_t, uint8_t, uint8_t, uint8_t)
+{
+  lastHouse = house;
+  lastUnit = unit;
+  receiveCount++;
+}
+
+// Two interfaces (one per phase) on Timer1 and Timer3
+struct GroupSetup
+{
+  X10ex phase1, phase2;
+  X10ex *interfaces[2];
+  X10group group;
+
+  GroupSetup(uint8_t route = X10_GROUP_ROUTE_HOUSE) :
+    phase1(0, 2, 3, 4, true, NULL, 1, 50, 1),
+    phase2(1, 5, 6, 7, true, NULL, 1, 50, 3),
+    group(interfaces, 2, route, groupReceived)
+  {
+    interfaces[0] = &phase1;
+    interfaces[1] = &phase2;
+    phase1.wipeModuleState();
+    phase2.wipeModuleState();
+  }
+};
+
+X10_TEST(groupStateComesFromInterfaceThatLastReceived)
+{
+  GroupSetup setup;
+  // Module heard on second phase only
+  setup.phase2.setSensorState('B', 3, true);
+  setup.group.receive(1, 'B', 3, CMD_ON, 0, 0, 0);
+  X10_CHECK(!setup.phase1.getModuleState('B', 3).isSeen);
+  X10_CHECK(setup.group.getModuleState('B', 3).isOn);
+  // Then turned off through first phase, second phase has stale state
+  setup.phase1.setSensorState('B', 3, false);
+  setup.group.receive(0, 'B', 3, CMD_OFF, 0, 0, 0);
+  X10_CHECK(setup.phase2.getModuleState('B', 3).isOn);
+  X10_CHECK(setup.group.getModuleState('B', 3).isKnown);
+  X10_CHECK(!setup.group.getModuleState('B', 3).isOn);
+}
+
+X10_TEST(groupStateFallsBackToInterfaceThatHasSeenModule)
+{
+  GroupSetup setup;
+  setup.phase2.setSensorState('C', 16, true);
+  X10_CHECK(setup.group.getModuleState('C', 16).isSeen);
+  X10_CHECK(setup.group.getModuleState('C', 16).isOn);
+  X10_CHECK(!setup.group.getModuleState('C', 15).isSeen);
+}
+
+X10_TEST(groupDropsMessageReceivedOnBothPhases)
+{
+  GroupSetup setup;
+  receiveCount = 0;
+  setup.group.receive(0, 'D', 2, CMD_ON, 0, 0, 0);
+  setup.group.receive(1, 'D', 2, CMD_ON, 0, 0, 0);
+  X10_CHECK_EQUAL(1, receiveCount);
+  X10_CHECK_EQUAL('D', lastHouse);
+  X10_CHECK_EQUAL(2, lastUnit);
+  // Repeat on the same phase is passed on
+  setup.group.receive(0, 'D', 2, CMD_ON, 0, 0, 0);
+  X10_CHECK_EQUAL(2, receiveCount);
+}
+
+X10_TEST(groupRoundRobinUsesInterfacesInTurn)
+{
+  x10testSetMicros(10000000);
+  GroupSetup setup(X10_GROUP_ROUTE_ROUND_ROBIN);
+  X10_CHECK(!setup.group.sendCmd('E', 1, CMD_ON, 1));
+  X10_CHECK(!setup.group.sendCmd('E', 2, CMD_ON, 1));
+  X10_CHECK(!setup.group.sendCmd('E', 3, CMD_ON, 1));
+  X10_CHECK_EQUAL(2, setup.phase1.getBufferedCount());
+  X10_CHECK_EQUAL(1, setup.phase2.getBufferedCount());
+}
+
+X10_TEST(groupRoundRobinSkipsFullInterface)
+{
+  x10testSetMicros(10000000);
+  GroupSetup setup(X10_GROUP_ROUTE_ROUND_ROBIN);
+  while(!setup.phase2.sendCmd('F', setup.phase2.getBufferedCount() + 1, CMD_ON, 1));
+  uint8_t full = setup.phase2.getBufferedCount();
+  X10_CHECK(!setup.group.sendCmd('G', 1, CMD_ON, 1));
+  X10_CHECK(!setup.group.sendCmd('G', 2, CMD_ON, 1));
+  X10_CHECK_EQUAL(2, setup.phase1.getBufferedCount());
+  X10_CHECK_EQUAL(full, setup.phase2.getBufferedCount());
+}
+
+X10_TEST(groupRoundRobinKeepsRepeatsOnSameInterface)
+{
+  x10testSetMicros(10000000);
+  GroupSetup setup(X10_GROUP_ROUTE_ROUND_ROBIN);
+  X10_CHECK(!setup.group.sendCmd('H', 1, CMD_ON, 1));
+  // Held button: bright is sent again within the rebuffer delay
+  X10_CHECK(!setup.group.sendCmd('H', 2, CMD_BRIGHT, 2));
+  x10testAdvanceMicros(200000);
+  X10_CHECK(!setup.group.sendCmd('H', 2, CMD_BRIGHT, 2));
+  x10testAdvanceMicros(200000);
+  X10_CHECK(!setup.group.sendCmd('H', 2, CMD_BRIGHT, 2));
+  X10_CHECK_EQUAL(1, setup.phase1.getBufferedCount());
+  X10_CHECK_EQUAL(1, setup.phase2.getBufferedCount());
+  // Round robin goes on when the delay has passed
+  x10testAdvanceMicros(X10_REBUFFER_DELAY * 1000UL);
+  X10_CHECK(!setup.group.sendCmd('H', 2, CMD_BRIGHT, 2));
+  X10_CHECK_EQUAL(2, setup.phase1.getBufferedCount());
+}
@@ -0,0 +1,148 @@
+/************************************************************************/
+/* X10 library host tests, HTTP request parser, v1.0.                   */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10http.h"
+#include <string>
+
+// Parses request and returns the events as text, e.g.
+// "REQUEST GET /a|HEADER HOST=x|DONE". Parsing stops when request is done.
+static std::string parse(X10http &http, const std::string &request)
+{
+  std::string text;
+  for(size_t ix = 0; ix < request.size() && !http.isDone(); ix++)
+  {
+    uint8_t events = http.parse(request[ix]);
+    if(events & X10_HTTP_REQUEST)
+    {
+      text += std::string("|REQUEST ") + http.getName() + " " + http.getPath();
+    }
+    if(events & X10_HTTP_HEADER) text += std::string("|HEADER ") + http.getName() + "=" + http.getValue();
+    if(events & X10_HTTP_BODY) text += "|BODY";
+    if(events & X10_HTTP_FIELD) text += std::string("|FIELD ") + http.getName() + "=" + http.getValue();
+    if(events & X10_HTTP_ERROR) text += "|ERROR";
+    if(events & X10_HTTP_DONE) text += "|DONE";
+  }
+  return text.empty() ? text : text.substr(1);
+}
+
+static std::string parse(const std::string &request)
+{
+  X10http http;
+  return parse(http, request);
+}
+
+X10_TEST(httpParsesRequestLine)
+{
+  X10http http;
+  X10_CHECK_EQUAL(std::string("REQUEST GET /plc/A1|DONE"), parse(http, "GET /plc/A1 HTTP/1.1\r\n\r\n"));
+  X10_CHECK_EQUAL(X10_HTTP_METHOD_GET, http.getMethod());
+  X10_CHECK(http.isHttp11());
+  http.begin();
+  X10_CHECK_EQUAL(std::string("REQUEST DELETE /info|DONE"), parse(http, "DELETE /info HTTP/1.0\n\n"));
+  X10_CHECK_EQUAL(X10_HTTP_METHOD_DELETE, http.getMethod());
+  X10_CHECK(!http.isHttp11());
+  http.begin();
+  parse(http, "PUT / HTTP/1.1\r\n\r\n");
+  X10_CHECK_EQUAL(X10_HTTP_METHOD_UNKNOWN, http.getMethod());
+}
+
+X10_TEST(httpDecodesRequestPath)
+{
+  X10_CHECK_EQUAL(std::string("REQUEST GET /a b/%|DONE"), parse("GET /a%20b/%25 HTTP/1.1\r\n\r\n"));
+}
+
+X10_TEST(httpIgnoresEmptyLinesBeforeRequest)
+{
+  X10_CHECK_EQUAL(std::string("REQUEST GET /|DONE"), parse("\r\n\r\nGET / HTTP/1.1\r\n\r\n"));
+}
+
+X10_TEST(httpMalformedRequestLineIsError)
+{
+  X10http http;
+  X10_CHECK_EQUAL(std::string("ERROR|DONE"), parse(http, "GET\r\nHost: x\r\n\r\n"));
+  X10_CHECK(http.isDone());
+  X10_CHECK_EQUAL(X10_HTTP_NONE, http.parse('G'));
+}
+
+X10_TEST(httpParsesHeaders)
+{
+  X10_CHECK_EQUAL(
+    std::string("REQUEST GET /|HEADER HOST=arduino.local|HEADER X-EMPTY=|DONE"),
+    parse("GET / HTTP/1.1\r\nhost:   arduino.local  \r\nNo colon\r\nX-Empty:\r\n\r\n"));
+}
+
+X10_TEST(httpParsesUrlEncodedBody)
+{
+  X10http http;
+  X10_CHECK_EQUAL(
+    std::string(
+      "REQUEST POST /plc|HEADER CONTENT-LENGTH=31|BODY|"
+      "FIELD A1=ON|FIELD NAME=Hall light|FIELD X=%|DONE"),
+    parse(http, "POST /plc HTTP/1.1\r\nContent-Length: 31\r\n\r\na1=on&name=\"Hall+light\"&x=%25&&"));
+  X10_CHECK_EQUAL(X10_HTTP_METHOD_POST, http.getMethod());
+}
+
+X10_TEST(httpBodyEndsAtContentLength)
+{
+  X10http http;
+  X10_CHECK_EQUAL(
+    std::string("REQUEST POST /|HEADER CONTENT-LENGTH=5|BODY|FIELD A1=ON|DONE"),
+    parse(http, "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nA1=ONGET / HTTP/1.1\r\n\r\n"));
+  X10_CHECK_EQUAL(X10_HTTP_NONE, http.parse('x'));
+}
+
+X10_TEST(httpBodyWithoutContentLengthIsEmpty)
+{
+  X10_CHECK_EQUAL(std::string("REQUEST POST /|DONE"), parse("POST / HTTP/1.1\r\n\r\nA1=ON"));
+}
+
+X10_TEST(httpParsesJsonBody)
+{
+  std::string body = "[{\"house\":\"a\",\"unit\":3,\"on\":true},{\"Name\":\"Say \\\"hi\\\"\",\"x\":{\"y\":null}}]";
+  std::string request =
+    "POST /plc HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: " +
+    std::to_string(body.size()) + "\r\n\r\n" + body;
+  X10_CHECK_EQUAL(
+    std::string(
+      "REQUEST POST /plc|HEADER CONTENT-TYPE=application/json|HEADER CONTENT-LENGTH=" + std::to_string(body.size()) +
+      "|BODY|FIELD HOUSE=a|FIELD UNIT=3|FIELD ON=TRUE|FIELD NAME=Say \"hi\"|FIELD Y=NULL|DONE"),
+    parse(request));
+}
+
+X10_TEST(httpTruncatesLongLines)
+{
+  X10http http;
+  std::string path(X10_HTTP_BUFFER_MAX * 2, 'p');
+  X10_CHECK_EQUAL(std::string("ERROR|DONE"), parse(http, "GET /" + path + " HTTP/1.1\r\n\r\n"));
+  http.begin();
+  std::string value(X10_HTTP_BUFFER_MAX * 2, 'v');
+  std::string body = "a=" + value + "&b=1";
+  parse(http, "POST / HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n");
+  std::string fields;
+  for(size_t ix = 0; ix < body.size(); ix++)
+  {
+    if(http.parse(body[ix]) & X10_HTTP_FIELD)
+    {
+      fields += std::string(http.getName()) + "=" + std::to_string(http.getValueLength()) + ";";
+    }
+  }
+  X10_CHECK_EQUAL(std::string("A=") + std::to_string(X10_HTTP_BUFFER_MAX - 2) + ";B=1;", fields);
+  X10_CHECK(http.isDone());
+}
@@ -0,0 +1,374 @@
+/************************************************************************/
+/* X10 library host tests, IR receiver and third party decoders, v1.0.  */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10ir.h"
+#include "X10irDecoder.h"
+#include <string>
+#include <vector>
+
+#define IR_RECEIVE_PIN 3
+
+static std::vector<std::string> received;
+
+static void irReceived(char house, uint8_t unit, uint8_t command, bool isRepeat)
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%c%d:%d%s", house, unit, command, isRepeat ? "r" : "");
+  received.push_back(text);
+}
+
+static std::string join(const std::vector<std::string> &lines)
+{
+  std::string text;
+  for(size_t i = 0; i < lines.size(); i++) text += (i ? "," : "") + lines[i];
+  return text;
+}
+
+// Sets the receive pin and runs the receive interrupt, the level then lasts
+// for the given time. The IR receiver module outputs low when a mark is received.
+static void level(X10ir &ir, bool isHigh, uint32_t us)
+{
+  if(x10testGetPin(IR_RECEIVE_PIN) != isHigh)
+  {
+    x10testSetPin(IR_RECEIVE_PIN, isHigh);
+    ir.receive();
+  }
+  x10testAdvanceMicros(us);
+}
+
+static X10ir *startReceiver(X10irDecoder *decoder)
+{
+  static X10ir *ir;
+  delete ir;
+  received.clear();
+  // Commands received by the last test are no longer within repeat thresholds
+  x10testAdvanceMicros(1000000);
+  x10testSetPin(IR_RECEIVE_PIN, 1);
+  ir = new X10ir(1, IR_RECEIVE_PIN, 'A', irReceived);
+  if(decoder) ir->addDecoder(decoder);
+  ir->begin();
+  return ir;
+}
+
+//////////////////////////////
+/// X10 IR
+//////////////////////////////
+
+// X10 IR pulses are the time the pin is low: start burst, 5 data bits and 5
+// complementary bits (4 + 4 for house codes) sent most significant bit first
+static void sendX10(X10ir &ir, uint8_t data, uint8_t dataBits, uint32_t silenceUs = 500000)
+{
+  level(ir, 0, 4000);
+  for(int8_t bit = dataBits * 2 - 1; bit >= 0; bit--)
+  {
+    bool isSet = bit >= dataBits ? data >> (bit - dataBits) & 1 : !(data >> bit & 1);
+    level(ir, 1, 500);
+    level(ir, 0, isSet ? 3750 : 1150);
+  }
+  level(ir, 1, 500);
+  level(ir, 0, 12000);
+  // Separate button presses: next start burst is not within repeat threshold
+  level(ir, 1, silenceUs);
+}
+
+static void sendX10House(X10ir &ir, char house)
+{
+  sendX10(ir, x10encode(house - 'A'), 4);
+}
+
+static void sendX10Unit(X10ir &ir, uint8_t unit)
+{
+  sendX10(ir, x10encode(unit - 1) << 1, 5);
+}
+
+static void sendX10Command(X10ir &ir, uint8_t command, uint32_t silenceUs = 500000)
+{
+  sendX10(ir, command << 1 | 1, 5, silenceUs);
+}
+
+X10_TEST(irX10HouseUnitAndCommand)
+{
+  X10ir &ir = *startReceiver(NULL);
+  sendX10House(ir, 'C');
+  sendX10Unit(ir, 7);
+  sendX10Command(ir, CMD_OFF);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("C7:16,C7:3"), join(received));
+}
+
+X10_TEST(irX10UnitIsResetAfterSilence)
+{
+  X10ir &ir = *startReceiver(NULL);
+  sendX10House(ir, 'C');
+  sendX10Unit(ir, 7);
+  x10testAdvanceMicros((X10_IR_UNIT_RESET_TIME + 1000) * 1000UL);
+  // Unit was reset: command without unit is dropped, house is back to default
+  sendX10Command(ir, CMD_ON);
+  sendX10Unit(ir, 2);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("C7:16,A2:16"), join(received));
+}
+
+X10_TEST(irX10RepeatedStartBurstIsRepeat)
+{
+  X10ir &ir = *startReceiver(NULL);
+  sendX10House(ir, 'B');
+  sendX10Unit(ir, 1);
+  sendX10Command(ir, CMD_BRIGHT, 100000);
+  ir.poll();
+  // Held button: start bursts within the repeat threshold are repeats
+  level(ir, 0, 4000);
+  level(ir, 1, 100000);
+  ir.poll();
+  level(ir, 0, 4000);
+  level(ir, 1, 100000);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("B1:16,B0:5,B0:5r,B0:5r"), join(received));
+}
+
+X10_TEST(irX10HeldButtonKeepsUnit)
+{
+  X10ir &ir = *startReceiver(NULL);
+  sendX10House(ir, 'C');
+  sendX10Unit(ir, 7);
+  sendX10Command(ir, CMD_ON, 100000);
+  // Button held for longer than the unit reset time
+  for(uint16_t i = 0; i < X10_IR_UNIT_RESET_TIME / 100; i++)
+  {
+    level(ir, 0, 4000);
+    level(ir, 1, 96000);
+    ir.poll();
+  }
+  x10testAdvanceMicros(300000);
+  received.clear();
+  sendX10Command(ir, CMD_OFF);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("C7:3"), join(received));
+}
+
+//////////////////////////////
+/// NEC
+//////////////////////////////
+
+const X10irCode necCodes[] PROGMEM =
+{
+  X10_IR_CODE(0x0412, 'D', 4, CMD_ON),
+  X10_IR_CODE(0x0413, 'D', 4, CMD_OFF),
+};
+
+static void sendNec(X10ir &ir, uint8_t address, uint8_t command)
+{
+  uint32_t frame =
+    address | (uint32_t)(uint8_t)~address << 8 |
+    (uint32_t)command << 16 | (uint32_t)(uint8_t)~command << 24;
+  level(ir, 0, 9000);
+  level(ir, 1, 4500);
+  for(uint8_t bit = 0; bit < 32; bit++)
+  {
+    level(ir, 0, 560);
+    level(ir, 1, frame >> bit & 1 ? 1690 : 560);
+  }
+  level(ir, 0, 560);
+  level(ir, 1, 40000);
+}
+
+static void sendNecRepeat(X10ir &ir)
+{
+  level(ir, 0, 9000);
+  level(ir, 1, 2250);
+  level(ir, 0, 560);
+  level(ir, 1, 96000);
+}
+
+X10_TEST(irNecCodeIsMapped)
+{
+  X10irNec nec(necCodes, 2);
+  X10ir &ir = *startReceiver(&nec);
+  sendNec(ir, 0x04, 0x13);
+  // Unmapped code is ignored
+  sendNec(ir, 0x05, 0x13);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("D4:3"), join(received));
+}
+
+X10_TEST(irNecRepeatCodesAreRepeats)
+{
+  X10irNec nec(necCodes, 2);
+  X10ir &ir = *startReceiver(&nec);
+  sendNec(ir, 0x04, 0x12);
+  ir.poll();
+  sendNecRepeat(ir);
+  ir.poll();
+  sendNecRepeat(ir);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("D4:2,D4:2r,D4:2r"), join(received));
+}
+
+// A repeat code received before any code has nothing to repeat, also when
+// code 0 is mapped and the receiver was just started
+X10_TEST(irNecLeadingRepeatCodeIsIgnored)
+{
+  const X10irCode zeroCodes[] PROGMEM = { X10_IR_CODE(0x0000, 'F', 1, CMD_ON) };
+  X10irNec nec(zeroCodes, 1);
+  X10ir &ir = *startReceiver(&nec);
+  x10testSetMicros(100000);
+  sendNecRepeat(ir);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string(""), join(received));
+  sendNec(ir, 0x00, 0x00);
+  ir.poll();
+  sendNecRepeat(ir);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("F1:2,F1:2r"), join(received));
+}
+
+//////////////////////////////
+/// RC5
+//////////////////////////////
+
+const X10irCode rc5Codes[] PROGMEM =
+{
+  X10_IR_CODE(0x0510, 'E', 2, CMD_ON),
+  X10_IR_CODE(0x0550, 'E', 2, CMD_OFF),
+};
+
+// Bi-phase bits: 1 is high then low, 0 is low then high (889us half bits)
+static void sendRc5(X10ir &ir, bool toggle, uint8_t address, uint8_t command)
+{
+  uint16_t frame = 1 << 13 | !(command & 0x40) << 12 | toggle << 11 | (address & 0x1F) << 6 | (command & 0x3F);
+  for(int8_t bit = 13; bit >= 0; bit--)
+  {
+    bool isSet = frame >> bit & 1;
+    level(ir, isSet, 889);
+    level(ir, !isSet, 889);
+  }
+  level(ir, 1, 100000);
+}
+
+X10_TEST(irRc5CodeIsMapped)
+{
+  X10irRc5 rc5(rc5Codes, 2);
+  X10ir &ir = *startReceiver(&rc5);
+  sendRc5(ir, 0, 0x05, 0x10);
+  // RC5X command: seventh bit is sent as the inverted field bit
+  sendRc5(ir, 1, 0x05, 0x50);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("E2:2,E2:3"), join(received));
+}
+
+X10_TEST(irRc5ToggleBitStartsNewPress)
+{
+  X10irRc5 rc5(rc5Codes, 2);
+  X10ir &ir = *startReceiver(&rc5);
+  sendRc5(ir, 0, 0x05, 0x10);
+  ir.poll();
+  sendRc5(ir, 0, 0x05, 0x10);
+  ir.poll();
+  // Button released and pressed again within the repeat threshold
+  sendRc5(ir, 1, 0x05, 0x10);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("E2:2,E2:2r,E2:2"), join(received));
+}
+
+//////////////////////////////
+/// Sony
+//////////////////////////////
+
+const X10irCode sonyCodes[] PROGMEM =
+{
+  X10_IR_CODE(0x0095, 'F', 9, CMD_ON),
+  X10_IR_CODE(0x0094, 'F', 9, CMD_OFF),
+  X10_IR_CODE(0x1095, 'F', 10, CMD_ON),
+  X10_IR_CODE(0x4095, 'F', 11, CMD_ON),
+};
+
+// Header mark, then bits as 600us (0) or 1200us (1) mark, each after a 600us space
+static void sendSony(X10ir &ir, uint32_t code, uint8_t bits)
+{
+  level(ir, 0, 2400);
+  for(uint8_t bit = 0; bit < bits; bit++)
+  {
+    level(ir, 1, 600);
+    level(ir, 0, code >> bit & 1 ? 1200 : 600);
+  }
+  // Frames are repeated every 45ms, silence follows the last one
+  level(ir, 1, 45000 - 3000 - bits * 1800);
+}
+
+X10_TEST(irSonyFrameLengths)
+{
+  X10irSony sony(sonyCodes, 4);
+  X10ir &ir = *startReceiver(&sony);
+  sendSony(ir, 0x095, 12);
+  ir.poll();
+  x10testAdvanceMicros(300000);
+  sendSony(ir, 0x1095, 15);
+  ir.poll();
+  x10testAdvanceMicros(300000);
+  // Only the lower 9 address bits are kept from 20 bit frames
+  sendSony(ir, 0xE4095, 20);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("F9:2,F10:2,F11:2"), join(received));
+}
+
+X10_TEST(irSonyLastFrameIsEndedWhenIdle)
+{
+  X10irSony sony(sonyCodes, 4);
+  X10ir &ir = *startReceiver(&sony);
+  // Button held for three frames: the last frame is passed on by poll once
+  // the receiver is idle, not when the next press starts
+  sendSony(ir, 0x095, 12);
+  sendSony(ir, 0x095, 12);
+  ir.poll();
+  sendSony(ir, 0x095, 12);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("F9:2,F9:2r,F9:2r"), join(received));
+  // Next press much later: no stale repeat of the last press
+  received.clear();
+  x10testAdvanceMicros(5000000);
+  ir.poll();
+  sendSony(ir, 0x094, 12);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("F9:3"), join(received));
+}
+
+X10_TEST(irSonyFrameIsNotEndedBeforeIdle)
+{
+  X10irSony sony(sonyCodes, 4);
+  X10ir &ir = *startReceiver(&sony);
+  // Poll in the space after bit 12 of a 15 bit frame
+  level(ir, 0, 2400);
+  for(uint8_t bit = 0; bit < 12; bit++)
+  {
+    level(ir, 1, 600);
+    level(ir, 0, 0x1095 >> bit & 1 ? 1200 : 600);
+    ir.poll();
+  }
+  level(ir, 1, 600);
+  ir.poll();
+  for(uint8_t bit = 12; bit < 15; bit++)
+  {
+    level(ir, 0, 0x1095 >> bit & 1 ? 1200 : 600);
+    level(ir, 1, 600);
+  }
+  level(ir, 1, 20000);
+  ir.poll();
+  X10_CHECK_EQUAL(std::string("F10:2"), join(received));
+}
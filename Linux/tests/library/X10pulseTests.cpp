@@ -0,0 +1,91 @@
+/************************************************************************/
+/* X10 library host tests, learned pulse length windows, v1.0.          */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10pulse.h"
+
+X10_TEST(pulseClassStartsWithFixedWindow)
+{
+  X10pulseClass bit(1000, 1200);
+  X10_CHECK_EQUAL(1100, bit.getCenterUs());
+  X10_CHECK(bit.match(1000));
+  X10_CHECK(bit.match(1200));
+  X10_CHECK(!bit.match(999));
+  X10_CHECK(!bit.match(1201));
+}
+
+X10_TEST(pulseClassMovesFractionOfFrameAverage)
+{
+  X10pulseClass bit(1000, 1200);
+  // A 32 bit frame where every bit is 64us long moves the center 64/2^5
+  for(uint8_t i = 0; i < 32; i++) bit.sample(1164);
+  bit.learn();
+  X10_CHECK_EQUAL(1102, bit.getCenterUs());
+  X10_CHECK_EQUAL(1002, bit.getMinUs());
+  X10_CHECK_EQUAL(1202, bit.getMaxUs());
+  // Frame length does not change how far the center moves
+  for(uint8_t i = 0; i < 4; i++) bit.sample(1038);
+  bit.learn();
+  X10_CHECK_EQUAL(1100, bit.getCenterUs());
+}
+
+X10_TEST(pulseClassLearnsSmallOffsetsBothWays)
+{
+  X10pulseClass bit(1000, 1200);
+  // Samples 20us above center: the center moves until it's less than half a
+  // step (16us) away
+  for(uint8_t frame = 0; frame < 50; frame++)
+  {
+    for(uint8_t i = 0; i < 32; i++) bit.sample(1120);
+    bit.learn();
+  }
+  X10_CHECK_EQUAL(1105, bit.getCenterUs());
+  X10_CHECK_EQUAL(1005, bit.getMinUs());
+  bit.reset();
+  for(uint8_t frame = 0; frame < 50; frame++)
+  {
+    for(uint8_t i = 0; i < 32; i++) bit.sample(1080);
+    bit.learn();
+  }
+  X10_CHECK_EQUAL(1095, bit.getCenterUs());
+}
+
+X10_TEST(pulseClassTracksDriftWithinBounds)
+{
+  X10pulseClass bit(1000, 1200);
+  for(uint16_t frame = 0; frame < 500; frame++)
+  {
+    for(uint8_t i = 0; i < 32; i++) bit.sample(bit.getMaxUs());
+    bit.learn();
+  }
+  // Window may extend 1/2^2 of the fixed max above it
+  X10_CHECK_EQUAL(1500, bit.getMaxUs());
+  X10_CHECK_EQUAL(1300, bit.getMinUs());
+  bit.reset();
+  X10_CHECK_EQUAL(1100, bit.getCenterUs());
+}
+
+X10_TEST(pulseClassIgnoresDiscardedSamples)
+{
+  X10pulseClass bit(1000, 1200);
+  for(uint8_t i = 0; i < 32; i++) bit.sample(1200);
+  bit.discard();
+  bit.learn();
+  X10_CHECK_EQUAL(1100, bit.getCenterUs());
+}
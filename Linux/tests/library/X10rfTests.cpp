@@ -0,0 +1,135 @@
+/************************************************************************/
+/* X10 library host tests, RF transmit and receive, v1.0.               */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10rf.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Transmit timer interrupt, called when the simulated Timer2 period ends
+extern "C" void TIMER2_COMPA_vect(void);
+
+#define RF_TRANSMIT_PIN 12
+
+static std::vector<std::string> received;
+static X10rf *receiver;
+
+// Repeats collapsed into the event by the event buffer are appended as +n
+static void rfReceived(char house, uint8_t unit, uint8_t command, bool isRepeat)
+{
+  char text[24];
+  snprintf(text, sizeof(text), "%c%d:%d%s", house, unit, command, isRepeat ? "r" : "");
+  if(receiver->getEvent().repeats)
+  {
+    snprintf(text + strlen(text), 8, "+%d", receiver->getEvent().repeats);
+  }
+  received.push_back(text);
+}
+
+static std::string join(const std::vector<std::string> &lines)
+{
+  std::string text;
+  for(size_t i = 0; i < lines.size(); i++) text += (i ? "," : "") + lines[i];
+  return text;
+}
+
+// Runs Timer2 until the transmit buffer is empty. Every rising edge of the
+// generated waveform is passed to the receive interrupt of the receiver, the
+// first one is made by sendCmd when it starts the timer.
+static void transmitTo(X10rf &rf)
+{
+  receiver = &rf;
+  bool level = 0;
+  for(long i = 0; i < 100000; i++)
+  {
+    bool isHigh = x10testGetPin(RF_TRANSMIT_PIN);
+    if(isHigh && !level) rf.receive();
+    level = isHigh;
+    if(!TCCR2B) break;
+    // Prescaler 64: 4us per tick at 16MHz
+    x10testAdvanceMicros((OCR2A + 1UL) * 4);
+    TIMER2_COMPA_vect();
+  }
+  // Stop pulse ends the last bit, a late rising edge ends the frame
+  x10testAdvanceMicros(300000);
+  rf.receive();
+  rf.poll();
+}
+
+X10_TEST(rfTransmitIsDecodedByReceiver)
+{
+  X10rf rf(0, 2, rfReceived, NULL, RF_TRANSMIT_PIN);
+  rf.begin();
+  received.clear();
+  X10_CHECK(!rf.sendCmd('A', 3, CMD_ON, 1));
+  transmitTo(rf);
+  X10_CHECK_EQUAL(std::string("A3:2"), join(received));
+  X10_CHECK(!TCCR2B);
+}
+
+X10_TEST(rfTransmitsEveryHouseAndUnit)
+{
+  X10rf rf(0, 2, rfReceived, NULL, RF_TRANSMIT_PIN);
+  rf.begin();
+  for(char house = 'A'; house <= 'P'; house++)
+  {
+    for(uint8_t unit = 1; unit <= 16; unit++)
+    {
+      for(uint8_t command = CMD_ON; command <= CMD_OFF; command++)
+      {
+        received.clear();
+        rf.sendCmd(house, unit, command, 1);
+        transmitTo(rf);
+        char text[16];
+        snprintf(text, sizeof(text), "%c%d:%d", house, unit, command);
+        X10_CHECK_EQUAL(std::string(text), join(received));
+      }
+    }
+  }
+}
+
+X10_TEST(rfRepetitionsAreReceivedAsRepeats)
+{
+  X10rf rf(0, 2, rfReceived, NULL, RF_TRANSMIT_PIN);
+  rf.begin();
+  received.clear();
+  rf.sendCmd('C', 0, CMD_DIM, 3);
+  // The second and third frame are repeats, collapsed into one event since
+  // poll is only called at the end
+  transmitTo(rf);
+  X10_CHECK_EQUAL(std::string("C0:4,C0:4r+1"), join(received));
+}
+
+X10_TEST(rfBufferedMessagesAreSentInOrder)
+{
+  X10rf rf(0, 2, rfReceived, NULL, RF_TRANSMIT_PIN);
+  rf.begin();
+  received.clear();
+  X10_CHECK(!rf.sendCmd('B', 1, CMD_ON, 1));
+  X10_CHECK(!rf.sendCmd('B', 2, CMD_ON, 1));
+  X10_CHECK(!rf.sendCmd('P', 16, CMD_OFF, 1));
+  X10_CHECK(!rf.sendCmd('A', 0, CMD_BRIGHT, 1));
+  // Buffer holds X10_RF_BUFFER_SIZE - 1 messages
+  X10_CHECK(rf.sendCmd('A', 5, CMD_ON, 1));
+  // Only on, off, bright and dim can be sent (not extended code)
+  X10_CHECK(rf.sendCmd('A', 5, B0111, 1));
+  transmitTo(rf);
+  X10_CHECK_EQUAL(std::string("B1:2,B2:2,P16:3,A0:5"), join(received));
+}
@@ -0,0 +1,200 @@
+/************************************************************************/
+/* X10 library host tests, rule router, v1.0.                           */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10router.h"
+#include <string>
+
+static std::string scenes;
+
+static bool sceneCalled(uint8_t scene, uint8_t command)
+{
+  scenes += std::to_string(scene) + ":" + std::to_string(command) + ";";
+  return 0;
+}
+
+static X10rule rule(
+  uint8_t sources, char house, uint8_t unit, uint8_t command, uint8_t flags,
+  uint8_t action, char targetHouse, uint8_t targetUnit, uint8_t data)
+{
+  X10rule rule = { sources, house, unit, command, flags, action, targetHouse, targetUnit, data };
+  return rule;
+}
+
+X10_TEST(routerSendsToTarget)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex);
+  X10_CHECK(!router.addRule(rule(X10_ROUTER_SOURCE_RF, 'a', 5, CMD_ON, 0, X10_ACTION_SEND, 'a', 11, X10_ROUTER_SAME)));
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_IR, 'A', 5, CMD_ON, false));
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_OFF, false));
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 6, CMD_ON, false));
+  X10_CHECK_EQUAL(0, x10ex.getBufferedCount());
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'a', 5, CMD_ON, false));
+  X10_CHECK_EQUAL(1, x10ex.getBufferedCount());
+}
+
+X10_TEST(routerIgnoresRepeatsUnlessRuleAllowsThem)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex, sceneCalled);
+  router.addRule(rule(X10_ROUTER_SOURCE_IR, 'B', 0, X10_ROUTER_SAME, 0, X10_ACTION_SCENE, 0, 0, 1));
+  router.addRule(rule(X10_ROUTER_SOURCE_IR, 'B', 0, CMD_DIM, X10_RULE_REPEAT, X10_ACTION_SCENE, 0, 0, 2));
+  scenes.clear();
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_IR, 'B', 0, CMD_DIM, false));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_IR, 'B', 0, CMD_DIM, true));
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_IR, 'B', 0, CMD_BRIGHT, true));
+  X10_CHECK_EQUAL(std::string("1:4;2:4;2:4;"), scenes);
+}
+
+// Placeholder unit, like the X10_Ethernet default rules: on and off trigger
+// scenes, every other command and repeat is handled without sending anything
+X10_TEST(routerDropsOtherCommandsToPlaceholderUnit)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex, sceneCalled);
+  router.addRule(rule(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_ON, 0, X10_ACTION_SCENE, 0, 0, 2));
+  router.addRule(rule(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_OFF, 0, X10_ACTION_SCENE, 0, 0, 18));
+  router.addRule(rule(X10_ROUTER_SOURCE_RF, 'A', 5, X10_ROUTER_SAME, X10_RULE_REPEAT, X10_ACTION_DROP, 0, 0, 0));
+  scenes.clear();
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_ON, false));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_ON, true));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_BRIGHT, false));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_DIM, true));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 5, CMD_OFF, false));
+  X10_CHECK_EQUAL(std::string("2:2;18:3;"), scenes);
+  X10_CHECK_EQUAL(0, x10ex.getBufferedCount());
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_RF, 'A', 6, CMD_DIM, false));
+}
+
+X10_TEST(routerRunsMatchingRulesInOrderAdded)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex, sceneCalled);
+  // Rules in the same hash bucket, and other rules added in between
+  for(uint8_t scene = 0; scene < 6; scene++)
+  {
+    router.addRule(rule(X10_ROUTER_SOURCE_USER, scene % 2 ? 'C' : 'D', 1, CMD_ON, 0, X10_ACTION_SCENE, 0, 0, scene));
+  }
+  scenes.clear();
+  router.route(X10_ROUTER_SOURCE_USER, 'C', 1, CMD_ON, false);
+  X10_CHECK_EQUAL(std::string("1:2;3:2;5:2;"), scenes);
+  // Index is rebuilt when a rule is removed
+  X10_CHECK(!router.removeRule(3));
+  X10_CHECK(router.removeRule(5));
+  scenes.clear();
+  router.route(X10_ROUTER_SOURCE_USER, 'C', 1, CMD_ON, false);
+  X10_CHECK_EQUAL(std::string("1:2;5:2;"), scenes);
+}
+
+X10_TEST(routerDoesNotRouteItsOwnEcho)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex, sceneCalled);
+  router.addRule(rule(X10_ROUTER_SOURCE_RF, 'E', 1, CMD_ON, 0, X10_ACTION_SEND, 'E', 2, X10_ROUTER_SAME));
+  router.addRule(rule(X10_ROUTER_SOURCE_PLC, 'E', 2, CMD_ON, 0, X10_ACTION_SCENE, 0, 0, 7));
+  router.route(X10_ROUTER_SOURCE_RF, 'E', 1, CMD_ON, false);
+  scenes.clear();
+  // Echo of E2 ON sent by router
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_PLC, 'E', 2, CMD_ON, false));
+  // Echo is only matched once
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_PLC, 'E', 2, CMD_ON, false));
+  X10_CHECK_EQUAL(std::string("7:2;"), scenes);
+  // Echo received after timeout is routed
+  router.route(X10_ROUTER_SOURCE_RF, 'E', 1, CMD_ON, false);
+  x10testAdvanceMicros(X10_ROUTER_ECHO_TIMEOUT * 1000UL);
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_PLC, 'E', 2, CMD_ON, false));
+}
+
+X10_TEST(routerDoesNotRouteEchoOfAnyRepetition)
+{
+  x10testSetMicros(0);
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex);
+  // Rules routing into each other, bright is sent with 2 repetitions
+  router.addRule(rule(X10_ROUTER_SOURCE_PLC, 'J', 1, CMD_BRIGHT, 0, X10_ACTION_SEND, 'K', 1, X10_ROUTER_SAME));
+  router.addRule(rule(X10_ROUTER_SOURCE_PLC, 'K', 1, CMD_BRIGHT, 0, X10_ACTION_SEND, 'J', 1, X10_ROUTER_SAME));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_PLC, 'J', 1, CMD_BRIGHT, false));
+  X10_CHECK_EQUAL(1, x10ex.getBufferedCount());
+  // One echo per repetition
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_PLC, 'K', 1, CMD_BRIGHT, false));
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_PLC, 'K', 1, CMD_BRIGHT, false));
+  X10_CHECK_EQUAL(1, x10ex.getBufferedCount());
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_PLC, 'K', 1, CMD_BRIGHT, false));
+}
+
+X10_TEST(routerReportsBufferError)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex);
+  router.addRule(rule(X10_ROUTER_SOURCE_USER, 'F', 1, CMD_ON, 0, X10_ACTION_DIM, 'F', X10_ROUTER_SAME, 50));
+  while(!x10ex.sendCmd('G', x10ex.getBufferedCount() + 1, CMD_ON, 1));
+  X10_CHECK_EQUAL(X10_BUFFER_SIZE - 1, x10ex.getBufferedCount());
+  X10_CHECK_EQUAL(X10_ROUTE_BUFFER_ERROR, router.route(X10_ROUTER_SOURCE_USER, 'F', 1, CMD_ON, false));
+}
+
+X10_TEST(routerParsesHexRules)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex);
+  X10_CHECK(!router.addRule("034105020000410b02"));
+  X10_CHECK(router.addRule("034105020000410B0"));
+  X10_CHECK(router.addRule("034105020000410B0X"));
+  X10_CHECK_EQUAL(1, router.getRuleCount());
+  X10rule added;
+  X10_CHECK(!router.getRule(0, added));
+  X10_CHECK_EQUAL(3, added.sources);
+  X10_CHECK_EQUAL('A', added.house);
+  X10_CHECK_EQUAL(5, added.unit);
+  X10_CHECK_EQUAL(CMD_ON, added.command);
+  X10_CHECK_EQUAL(X10_ACTION_SEND, added.action);
+  X10_CHECK_EQUAL(11, added.targetUnit);
+  X10_CHECK(router.getRule(1, added));
+}
+
+X10_TEST(routerTableHoldsMaxRules)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex);
+  for(uint8_t ix = 0; ix < X10_ROUTER_MAX_RULES; ix++)
+  {
+    X10_CHECK(!router.addRule(rule(X10_ROUTER_SOURCE_RF, 'H', ix % 16 + 1, CMD_ON, 0, X10_ACTION_DROP, 0, 0, 0)));
+  }
+  X10_CHECK(router.addRule(rule(X10_ROUTER_SOURCE_RF, 'H', 1, CMD_OFF, 0, X10_ACTION_DROP, 0, 0, 0)));
+  X10_CHECK_EQUAL(X10_ROUTE_DONE, router.route(X10_ROUTER_SOURCE_RF, 'H', 16, CMD_ON, false));
+  router.clearRules();
+  X10_CHECK_EQUAL(0, router.getRuleCount());
+  X10_CHECK_EQUAL(X10_ROUTE_NONE, router.route(X10_ROUTER_SOURCE_RF, 'H', 16, CMD_ON, false));
+}
+
+X10_TEST(routerRulesAreSavedInEeprom)
+{
+  X10ex x10ex(0, 2, 9, 8, 0, NULL);
+  X10router router(&x10ex, sceneCalled);
+  router.addRule(rule(X10_ROUTER_SOURCE_IR, 'I', 3, CMD_OFF, 0, X10_ACTION_SCENE, 0, 0, 9));
+  router.addRule(rule(X10_ROUTER_SOURCE_IR, 'I', 4, CMD_OFF, 0, X10_ACTION_SCENE, 0, 0, 8));
+  X10_CHECK(!router.save());
+  X10router loaded(&x10ex, sceneCalled);
+  X10_CHECK(!loaded.load());
+  X10_CHECK_EQUAL(2, loaded.getRuleCount());
+  scenes.clear();
+  loaded.route(X10_ROUTER_SOURCE_IR, 'I', 4, CMD_OFF, false);
+  X10_CHECK_EQUAL(std::string("8:3;"), scenes);
+}
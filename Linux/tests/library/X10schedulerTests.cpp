@@ -0,0 +1,143 @@
+/************************************************************************/
+/* X10 library host tests, timer wheel scheduler, v1.0.                 */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10scheduler.h"
+#include <vector>
+
+static std::vector<uint16_t> fired;
+
+static void timerFired(uint16_t id)
+{
+  fired.push_back(id);
+}
+
+// Runs poll every millisecond for the given time
+static void runFor(X10scheduler &scheduler, uint32_t ms)
+{
+  for(uint32_t i = 0; i < ms; i++)
+  {
+    x10testAdvanceMicros(1000);
+    scheduler.poll();
+  }
+}
+
+static X10ex x10ex(0, 2, 9, 8, 0, NULL);
+
+X10_TEST(schedulerFiresAfterDelay)
+{
+  X10scheduler scheduler(&x10ex);
+  fired.clear();
+  uint16_t id = scheduler.schedule(1000, 0, timerFired);
+  X10_CHECK(id != X10_TIMER_NONE);
+  runFor(scheduler, 999);
+  X10_CHECK_EQUAL(0U, fired.size());
+  X10_CHECK(scheduler.isPending(id));
+  runFor(scheduler, 1);
+  X10_CHECK_EQUAL(1U, fired.size());
+  X10_CHECK_EQUAL(id, fired[0]);
+  X10_CHECK(!scheduler.isPending(id));
+  X10_CHECK_EQUAL(0, scheduler.getPendingCount());
+}
+
+X10_TEST(schedulerRepeatsPeriodicTimers)
+{
+  X10scheduler scheduler(&x10ex);
+  fired.clear();
+  uint16_t id = scheduler.schedule(500, 200, timerFired);
+  runFor(scheduler, 1100);
+  X10_CHECK_EQUAL(4U, fired.size());
+  X10_CHECK(!scheduler.cancel(id));
+  runFor(scheduler, 1000);
+  X10_CHECK_EQUAL(4U, fired.size());
+}
+
+X10_TEST(schedulerRearmRestartsDelay)
+{
+  X10scheduler scheduler(&x10ex);
+  fired.clear();
+  uint16_t id = scheduler.schedule(1000, 0, timerFired);
+  runFor(scheduler, 800);
+  X10_CHECK(!scheduler.rearm(id, 1000));
+  runFor(scheduler, 900);
+  X10_CHECK_EQUAL(0U, fired.size());
+  runFor(scheduler, 100);
+  X10_CHECK_EQUAL(1U, fired.size());
+}
+
+X10_TEST(schedulerStaleIdDoesNotMatchReusedTimer)
+{
+  X10scheduler scheduler(&x10ex);
+  fired.clear();
+  uint16_t offTimer = scheduler.schedule(100, 0, timerFired);
+  runFor(scheduler, 100);
+  // Timer fired and its slot is reused by another timer
+  uint16_t other = scheduler.schedule(5000, 0, timerFired);
+  X10_CHECK_EQUAL(offTimer & 0xFF, other & 0xFF);
+  X10_CHECK(other != offTimer);
+  // Rearm pattern: stale id is not rearmed, so a new timer is scheduled
+  if(scheduler.rearm(offTimer, 300)) offTimer = scheduler.schedule(300, 0, timerFired);
+  X10_CHECK(offTimer != other);
+  X10_CHECK(scheduler.cancel(fired[0]));
+  X10_CHECK(scheduler.isPending(other));
+  runFor(scheduler, 300);
+  X10_CHECK_EQUAL(2U, fired.size());
+  X10_CHECK_EQUAL(offTimer, fired[1]);
+  X10_CHECK(scheduler.isPending(other));
+}
+
+X10_TEST(schedulerCancelledIdIsStale)
+{
+  X10scheduler scheduler(&x10ex);
+  uint16_t id = scheduler.schedule(100, 0, timerFired);
+  X10_CHECK(!scheduler.cancel(id));
+  X10_CHECK(scheduler.cancel(id));
+  uint16_t reused = scheduler.schedule(100, 0, timerFired);
+  X10_CHECK(scheduler.cancel(id));
+  X10_CHECK(scheduler.rearm(id, 100));
+  X10_CHECK(scheduler.isPending(reused));
+}
+
+X10_TEST(schedulerReturnsNoneWhenAllTimersArePending)
+{
+  X10scheduler scheduler(&x10ex);
+  for(uint8_t i = 0; i < X10_SCHEDULER_MAX_TIMERS; i++)
+  {
+    X10_CHECK(scheduler.schedule(1000, 0, timerFired) != X10_TIMER_NONE);
+  }
+  X10_CHECK_EQUAL(X10_TIMER_NONE, scheduler.schedule(1000, 0, timerFired));
+  X10_CHECK_EQUAL(X10_SCHEDULER_MAX_TIMERS, scheduler.getPendingCount());
+}
+
+X10_TEST(schedulerSendsCommandsAndRetriesWhenBufferIsFull)
+{
+  X10ex full(0, 2, 9, 8, 0, NULL, 1, 50, 3);
+  X10scheduler scheduler(&full);
+  uint8_t count = 0;
+  while(!full.sendCmd('B', count % 16 + 1, count < 16 ? CMD_ON : CMD_OFF, 1)) count++;
+  scheduler.schedule(100, 0, 'C', 1, CMD_ON);
+  runFor(scheduler, 500);
+  X10_CHECK_EQUAL(1, scheduler.getPendingCount());
+  X10exConfigured<> room(0, 2, 9, 8, 0, NULL, 1, 50, 4);
+  X10scheduler roomScheduler(&room);
+  roomScheduler.schedule(100, 0, 'C', 1, CMD_ON);
+  runFor(roomScheduler, 100);
+  X10_CHECK_EQUAL(0, roomScheduler.getPendingCount());
+  X10_CHECK_EQUAL(1, room.getBufferedCount());
+}
@@ -0,0 +1,143 @@
+/************************************************************************/
+/* X10 library host tests, event stream, v1.0.                          */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10stream.h"
+#include "X10ex.h"
+#include <string>
+
+// Reads all events queued for subscriber, returns them as text, e.g.
+// "PL A1:2,MS A1"
+static std::string readAll(X10stream &stream, uint8_t subscriber)
+{
+  static const char *types[] = { "PL", "RF", "IR", "MS" };
+  std::string text;
+  X10streamEvent event;
+  while(stream.read(subscriber, event))
+  {
+    text += (text.empty() ? "" : ",") + std::string(types[event.type]) + " " + event.house + std::to_string(event.unit);
+    if(event.type != X10_STREAM_MODULE_STATE) text += ":" + std::to_string(event.command);
+  }
+  return text;
+}
+
+X10_TEST(streamPassesEventsToEverySubscriber)
+{
+  X10stream stream;
+  X10_CHECK(stream.subscribe(X10_STREAM_SUBSCRIBERS));
+  X10_CHECK(!stream.subscribe(0));
+  stream.publish(X10_STREAM_PLC, 'A', 1, CMD_ON, 0, 0);
+  X10_CHECK(!stream.subscribe(2));
+  stream.publish(X10_STREAM_RF, 'B', 2, CMD_OFF, 0, 0);
+  stream.publish(X10_STREAM_IR, 'C', 3, CMD_DIM, 0, 0);
+  X10_CHECK_EQUAL(2, stream.getSubscriberCount());
+  X10_CHECK_EQUAL(3, stream.getQueuedCount(0));
+  X10_CHECK_EQUAL(std::string("PL A1:2,RF B2:3,IR C3:4"), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("RF B2:3,IR C3:4"), readAll(stream, 2));
+  X10_CHECK_EQUAL(std::string(""), readAll(stream, 1));
+  X10_CHECK_EQUAL(0, stream.getQueuedCount(0));
+}
+
+// A subscriber that falls a full buffer behind is dropped, without blocking
+// or dropping the subscriber that keeps up, and gets the events published
+// after it subscribes again
+X10_TEST(streamDropsSlowSubscriberUntilResubscribed)
+{
+  X10stream stream;
+  stream.subscribe(0);
+  stream.subscribe(1);
+  for(int i = 0; i < X10_STREAM_BUFFER_SIZE; i++)
+  {
+    stream.publish(X10_STREAM_PLC, 'A', 1 + i % 16, CMD_ON, 0, 0);
+    X10_CHECK(!readAll(stream, 1).empty());
+  }
+  X10_CHECK_EQUAL(X10_STREAM_BUFFER_SIZE, stream.getQueuedCount(0));
+  X10_CHECK(!stream.isDropped(0));
+  stream.publish(X10_STREAM_PLC, 'B', 1, CMD_OFF, 0, 0);
+  X10_CHECK(stream.isDropped(0));
+  X10_CHECK(!stream.isSubscribed(0));
+  X10_CHECK_EQUAL(1, stream.getDroppedCount());
+  X10_CHECK_EQUAL(std::string(""), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("PL B1:3"), readAll(stream, 1));
+  X10_CHECK(!stream.isDropped(1));
+  // Dropped flag stays set until subscriber subscribes again
+  stream.publish(X10_STREAM_PLC, 'B', 2, CMD_OFF, 0, 0);
+  X10_CHECK(stream.isDropped(0));
+  X10_CHECK_EQUAL(1, stream.getDroppedCount());
+  stream.subscribe(0);
+  X10_CHECK(!stream.isDropped(0));
+  stream.publish(X10_STREAM_PLC, 'B', 3, CMD_ON, 0, 0);
+  X10_CHECK_EQUAL(std::string("PL B3:2"), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("PL B2:3,PL B3:2"), readAll(stream, 1));
+}
+
+// Read positions wrap around with the 8 bit counters
+X10_TEST(streamKeepsOrderWhenCountersWrap)
+{
+  X10stream stream;
+  stream.subscribe(0);
+  for(int i = 0; i < 300; i++)
+  {
+    stream.publish(X10_STREAM_PLC, 'A' + i % 16, 1, CMD_ON, 0, 0);
+    if(i % 10 == 9)
+    {
+      std::string expected;
+      for(int j = i - 9; j <= i; j++) expected += std::string(expected.empty() ? "" : ",") + "PL " + (char)('A' + j % 16) + "1:2";
+      X10_CHECK_EQUAL(expected, readAll(stream, 0));
+    }
+  }
+  X10_CHECK(!stream.isDropped(0));
+}
+
+// A module state event is collapsed into the last event while no subscriber
+// has read it, other events and other modules are passed on as published
+X10_TEST(streamCollapsesRepeatedModuleState)
+{
+  X10stream stream;
+  stream.subscribe(0);
+  stream.subscribe(1);
+  for(int i = 0; i < 5; i++) stream.publish(X10_STREAM_MODULE_STATE, 'P', 3, 0, 0, 0);
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 4, 0, 0, 0);
+  stream.publish(X10_STREAM_PLC, 'A', 1, CMD_DIM, 0, 0);
+  stream.publish(X10_STREAM_PLC, 'A', 1, CMD_DIM, 0, 0);
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 4, 0, 0, 0);
+  X10_CHECK_EQUAL(5, stream.getQueuedCount(1));
+  X10_CHECK_EQUAL(std::string("MS P3,MS P4,PL A1:4,PL A1:4,MS P4"), readAll(stream, 0));
+  // Subscriber 0 has read the last event, so a repeat is a new change to it
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 4, 0, 0, 0);
+  X10_CHECK_EQUAL(std::string("MS P4"), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("MS P3,MS P4,PL A1:4,PL A1:4,MS P4,MS P4"), readAll(stream, 1));
+  // Collapsing again once every subscriber has it queued
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 4, 0, 0, 0);
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 4, 0, 0, 0);
+  X10_CHECK_EQUAL(std::string("MS P4"), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("MS P4"), readAll(stream, 1));
+}
+
+// A new subscriber has not seen the last event, so it gets the repeat
+X10_TEST(streamPassesRepeatToNewSubscriber)
+{
+  X10stream stream;
+  stream.subscribe(0);
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 3, 0, 0, 0);
+  stream.subscribe(1);
+  stream.publish(X10_STREAM_MODULE_STATE, 'P', 3, 0, 0, 0);
+  X10_CHECK_EQUAL(std::string("MS P3,MS P3"), readAll(stream, 0));
+  X10_CHECK_EQUAL(std::string("MS P3"), readAll(stream, 1));
+}
@@ -0,0 +1,192 @@
+/************************************************************************/
+/* X10 library host tests, buffered and chunked output, v1.0.           */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "../X10test.h"
+#include "X10writer.h"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Keeps each write call as one packet, like the Ethernet shield sends it.
+// Only accepts bytes until limit is reached, like a closed connection.
+class PacketSink : public Print
+{
+
+  public:
+    PacketSink(size_t limit = (size_t)-1) : limit(limit), accepted(0) {}
+    size_t write(uint8_t data)
+    {
+      return write(&data, 1);
+    }
+    size_t write(const uint8_t *data, size_t size)
+    {
+      if(size > limit - accepted) size = limit - accepted;
+      accepted += size;
+      packets.push_back(std::string((const char *)data, size));
+      return size;
+    }
+    std::string text()
+    {
+      std::string all;
+      for(size_t i = 0; i < packets.size(); i++) all += packets[i];
+      return all;
+    }
+    std::vector<std::string> packets;
+
+  private:
+    size_t limit, accepted;
+};
+
+// Decodes chunked body, returns the sizes of the chunks as text, e.g.
+// "5,0", and sets body to the data. Returns "ERROR" when framing is broken.
+static std::string unchunk(const std::string &chunked, std::string &body)
+{
+  std::string sizes;
+  size_t ix = 0;
+  body.clear();
+  for(;;)
+  {
+    size_t lineEnd = chunked.find("\r\n", ix);
+    if(lineEnd == std::string::npos) return "ERROR";
+    size_t size = strtoul(chunked.substr(ix, lineEnd - ix).c_str(), NULL, 16);
+    sizes += (sizes.empty() ? "" : ",") + std::to_string(size);
+    ix = lineEnd + 2;
+    if(chunked.compare(ix + size, 2, "\r\n")) return "ERROR";
+    body += chunked.substr(ix, size);
+    ix += size + 2;
+    if(!size) return ix == chunked.size() ? sizes : "ERROR";
+  }
+}
+
+X10_TEST(writerSendsBufferedOutputInOnePacket)
+{
+  PacketSink sink;
+  X10writer writer;
+  writer.begin(&sink);
+  writer.print("A1 ");
+  writer.print(12, DEC);
+  writer.print(' ');
+  writer.print(0xAB, HEX);
+  X10_CHECK_EQUAL(0u, sink.packets.size());
+  writer.flush();
+  writer.flush();
+  X10_CHECK_EQUAL(1u, sink.packets.size());
+  X10_CHECK_EQUAL(std::string("A1 12 AB"), sink.text());
+  X10_CHECK_EQUAL(8u, writer.getByteCount());
+  X10_CHECK_EQUAL(1, writer.getPacketCount());
+}
+
+X10_TEST(writerSendsFullBufferAsPacket)
+{
+  PacketSink sink;
+  X10writer writer;
+  writer.begin(&sink);
+  std::string output(X10_WRITER_BUFFER_SIZE * 2 + 10, 'x');
+  writer.print(output.c_str());
+  X10_CHECK_EQUAL(2u, sink.packets.size());
+  writer.end();
+  X10_CHECK_EQUAL(3u, sink.packets.size());
+  X10_CHECK_EQUAL((size_t)X10_WRITER_BUFFER_SIZE, sink.packets[0].size());
+  X10_CHECK_EQUAL(output, sink.text());
+}
+
+// Headers written before beginChunked go in the same packet as the first
+// chunk, and end adds the terminating chunk
+X10_TEST(writerFramesChunksAfterHeaders)
+{
+  PacketSink sink;
+  X10writer writer;
+  writer.begin(&sink);
+  writer.print("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+  writer.beginChunked();
+  writer.print("hello");
+  writer.end();
+  X10_CHECK_EQUAL(1u, sink.packets.size());
+  X10_CHECK_EQUAL(std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n005\r\nhello\r\n0\r\n\r\n"), sink.text());
+}
+
+// Flush and end never send an empty chunk before the terminating chunk, since
+// an empty chunk would end the output early
+X10_TEST(writerSkipsEmptyChunks)
+{
+  PacketSink sink;
+  X10writer writer;
+  writer.begin(&sink);
+  writer.beginChunked();
+  writer.flush();
+  X10_CHECK_EQUAL(0u, sink.packets.size());
+  writer.print("ab");
+  writer.flush();
+  writer.flush();
+  writer.end();
+  X10_CHECK_EQUAL(2u, sink.packets.size());
+  X10_CHECK_EQUAL(std::string("002\r\nab\r\n0\r\n\r\n"), sink.text());
+}
+
+// Output larger than the buffer is split into chunks of one packet each, no
+// packet is larger than the buffer
+X10_TEST(writerSplitsLongOutputIntoChunks)
+{
+  PacketSink sink;
+  X10writer writer;
+  writer.begin(&sink);
+  writer.beginChunked();
+  std::string output;
+  for(int i = 0; i < 300; i++) output += std::to_string(i) + ",";
+  writer.print(output.c_str());
+  writer.end();
+  std::string body;
+  std::string sizes = unchunk(sink.text(), body);
+  X10_CHECK_EQUAL(output, body);
+  X10_CHECK(sink.packets.size() > 2);
+  for(size_t i = 0; i < sink.packets.size(); i++)
+  {
+    X10_CHECK(sink.packets[i].size() <= X10_WRITER_BUFFER_SIZE);
+  }
+  uint16_t fullChunk = X10_WRITER_BUFFER_SIZE - X10_WRITER_CHUNK_HEADER - X10_WRITER_CHUNK_TRAILER;
+  X10_CHECK_EQUAL(std::to_string(fullChunk) + ",", sizes.substr(0, sizes.find(',') + 1));
+  X10_CHECK_EQUAL(std::string(",0"), sizes.substr(sizes.size() - 2));
+  X10_CHECK_EQUAL((uint32_t)sink.text().size(), writer.getByteCount());
+  X10_CHECK_EQUAL(sink.packets.size(), (size_t)writer.getPacketCount());
+}
+
+// Output is dropped after a short write, until begin is called again
+X10_TEST(writerDropsOutputAfterWriteError)
+{
+  PacketSink sink(10);
+  X10writer writer;
+  writer.begin(&sink);
+  writer.print("0123456789abcdef");
+  writer.flush();
+  X10_CHECK(writer.getWriteError());
+  X10_CHECK_EQUAL(1u, sink.packets.size());
+  writer.print("more");
+  writer.beginChunked();
+  writer.print("chunk");
+  writer.end();
+  X10_CHECK_EQUAL(1u, sink.packets.size());
+  X10_CHECK_EQUAL(1, writer.getPacketCount());
+  X10_CHECK_EQUAL(std::string("0123456789"), sink.text());
+  PacketSink next;
+  writer.begin(&next);
+  X10_CHECK(!writer.getWriteError());
+  writer.print("ok");
+  writer.end();
+  X10_CHECK_EQUAL(std::string("ok"), next.text());
+}
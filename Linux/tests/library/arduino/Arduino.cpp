@@ -0,0 +1,157 @@
+/************************************************************************/
+/* X10 library host tests, Arduino core stand-in, v1.0.                 */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "avr/eeprom.h"
+
+static unsigned long testMicros;
+static volatile uint8_t testPins[256];
+static void (*testInterrupts[8])(void);
+static uint8_t testEeprom[E2END + 1];
+static bool isEepromErased;
+
+// Interrupts are enabled, as they are when setup is called
+volatile uint8_t SREG = _BV(SREG_I);
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+volatile uint8_t TCCR2A, TCCR2B, TIMSK2, OCR2A, TCNT2, TIFR1, TIFR3, TIFR4, TIFR5, TIFR2;
+volatile uint16_t ICR1, TCNT1, ICR3, TCNT3, ICR4, TCNT4, ICR5, TCNT5;
+volatile uint8_t PCMSK2, PCICR, EICRA, EIMSK;
+volatile uint8_t TIMSK3, TIMSK4, TIMSK5;
+
+unsigned long millis()
+{
+  return testMicros / 1000;
+}
+
+unsigned long micros()
+{
+  return testMicros;
+}
+
+void delay(unsigned long ms)
+{
+  testMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  testMicros += us;
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  testPins[pin] = value ? 1 : 0;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return testPins[pin];
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int)
+{
+  if(interrupt < 8) testInterrupts[interrupt] = isr;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+  if(interrupt < 8) testInterrupts[interrupt] = NULL;
+}
+
+uint8_t digitalPinToPort(uint8_t pin)
+{
+  return pin;
+}
+
+uint8_t digitalPinToBitMask(uint8_t)
+{
+  return 1;
+}
+
+volatile uint8_t *portInputRegister(uint8_t port)
+{
+  return &testPins[port];
+}
+
+volatile uint8_t *portOutputRegister(uint8_t port)
+{
+  return &testPins[port];
+}
+
+volatile uint8_t *portModeRegister(uint8_t)
+{
+  static volatile uint8_t mode;
+  return &mode;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *address)
+{
+  if(!isEepromErased)
+  {
+    memset(testEeprom, 0xFF, sizeof(testEeprom));
+    isEepromErased = true;
+  }
+  return testEeprom[(size_t)address % sizeof(testEeprom)];
+}
+
+void eeprom_write_byte(uint8_t *address, uint8_t value)
+{
+  eeprom_read_byte(address);
+  testEeprom[(size_t)address % sizeof(testEeprom)] = value;
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+  eeprom_write_byte(address, value);
+}
+
+void x10testSetMicros(unsigned long us)
+{
+  testMicros = us;
+}
+
+void x10testAdvanceMicros(unsigned long us)
+{
+  testMicros += us;
+}
+
+void x10testSetPin(uint8_t pin, bool value)
+{
+  testPins[pin] = value ? 1 : 0;
+}
+
+bool x10testGetPin(uint8_t pin)
+{
+  return testPins[pin];
+}
+
+// Calls interrupt routine attached to interrupt, like a pin change would
+void x10testInterrupt(uint8_t interrupt)
+{
+  if(interrupt >= 8 || !testInterrupts[interrupt]) return;
+  // Interrupts are disabled while an interrupt routine runs
+  uint8_t sreg = SREG;
+  cli();
+  testInterrupts[interrupt]();
+  SREG = sreg;
+}
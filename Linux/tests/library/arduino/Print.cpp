@@ -0,0 +1,80 @@
+/************************************************************************/
+/* X10 library host tests, Arduino Print stand-in, v1.0.                */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "Print.h"
+#include <string.h>
+
+size_t Print::write(const uint8_t *data, size_t size)
+{
+  size_t count = 0;
+  while(size--)
+  {
+    if(!write(*data++)) break;
+    count++;
+  }
+  return count;
+}
+
+size_t Print::write(const char *str)
+{
+  return str ? write((const uint8_t *)str, strlen(str)) : 0;
+}
+
+size_t Print::print(const char *str)
+{
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  if(base < 2) base = 10;
+  char text[8 * sizeof(long) + 1];
+  char *str = text + sizeof(text) - 1;
+  *str = '\0';
+  do
+  {
+    uint8_t digit = n % base;
+    n /= base;
+    *--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  }
+  while(n);
+  return write(str);
+}
+
+size_t Print::print(long n, int base)
+{
+  // Like the Arduino core, only decimal numbers get a sign
+  if(base == 10 && n < 0) return print('-') + print(0UL - (unsigned long)n, 10);
+  return print((unsigned long)n, base);
+}
+
+size_t Print::println(const char *str)
+{
+  return print(str) + println();
+}
+
+size_t Print::println()
+{
+  return write("\r\n");
+}
@@ -0,0 +1,57 @@
+/************************************************************************/
+/* X10 library host tests, Arduino Print stand-in, v1.0.                */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for the Arduino Print class: text and numbers are written
+// through the virtual write methods, and a write error flag is kept for the
+// derived class to set
+class Print
+{
+
+  public:
+    Print() : writeError(0) {}
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *data, size_t size);
+    size_t write(const char *str);
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(unsigned long n, int base = 10);
+    size_t print(long n, int base = 10);
+    size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = 10) { return print((long)n, base); }
+    size_t print(unsigned char n, int base = 10) { return print((unsigned long)n, base); }
+    size_t println(const char *str);
+    size_t println();
+    int getWriteError() { return writeError; }
+    void clearWriteError() { setWriteError(0); }
+
+  protected:
+    void setWriteError(int error = 1) { writeError = error; }
+
+  private:
+    int writeError;
+};
+
+#endif
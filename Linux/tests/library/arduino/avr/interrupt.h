@@ -0,0 +1,33 @@
+/************************************************************************/
+/* X10 library host tests, AVR interrupt stand-in, v1.0.                */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef avr_interrupt_h
+#define avr_interrupt_h
+
+#include "avr/io.h"
+
+// Interrupt vectors are plain functions that tests can call. Tests run on one
+// thread, so interrupts are never held off, but sei and cli set the SREG
+// interrupt flag, so that code can tell when it runs in an interrupt.
+#define ISR(vector) extern "C" void vector(void); void vector(void)
+#define SIGNAL(vector) ISR(vector)
+inline void sei() { SREG |= _BV(SREG_I); }
+inline void cli() { SREG &= ~_BV(SREG_I); }
+
+#endif
@@ -0,0 +1,75 @@
+/************************************************************************/
+/* X10 library host tests, AVR register stand-in, v1.0.                 */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef avr_io_h
+#define avr_io_h
+
+#include <stdint.h>
+
+// Timer and interrupt registers, plain variables that tests can inspect
+extern volatile uint8_t SREG, TCCR1A, TCCR1B, TIMSK1, TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+extern volatile uint8_t TCCR2A, TCCR2B, TIMSK2, OCR2A, TCNT2, TIFR1, TIFR3, TIFR4, TIFR5, TIFR2;
+extern volatile uint16_t ICR1, TCNT1, ICR3, TCNT3, ICR4, TCNT4, ICR5, TCNT5;
+extern volatile uint8_t PCMSK2, PCICR, EICRA, EIMSK;
+#define _BV(b) (1 << (b))
+#define SREG_I 7
+#define WGM13 4
+#define WGM33 4
+#define WGM43 4
+#define WGM53 4
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define TOIE1 0
+#define ICIE1 5
+#define ICES1 6
+#define ICNC1 7
+#define ICF1 5
+#define TOV1 0
+#define WGM21 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCF2A 1
+extern volatile uint8_t TIMSK3, TIMSK4, TIMSK5;
+#define ICES4 6
+#define ICNC4 7
+#define ICIE4 5
+#define TOIE4 0
+#define ICF4 5
+#define TOV4 0
+#define CS40 0
+#define CS41 1
+#define ICES5 6
+#define ICNC5 7
+#define ICIE5 5
+#define TOIE5 0
+#define ICF5 5
+#define TOV5 0
+#define CS50 0
+#define CS51 1
+
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+#define E2END 4095
+#else
+#define E2END 1023
+#endif
+
+#endif
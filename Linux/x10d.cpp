@@ -0,0 +1,89 @@
+/************************************************************************/
+/* X10 gateway daemon for Linux, serial port to Unix socket, v1.0.      */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+// Gateway daemon: owns the serial port of an Arduino running one of the X10ex
+// example sketches, and lets many local clients share it, e.g.
+//
+// x10d -b 115200 -s /tmp/x10d.sock /dev/ttyUSB0
+// socat - UNIX-CONNECT:/tmp/x10d.sock
+//
+// See X10gateway.h for the client protocol.
+
+#include "X10gateway.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define X10D_BAUD_RATE 115200
+#define X10D_SOCKET_PATH "/tmp/x10d.sock"
+
+static volatile sig_atomic_t isStopped = 0;
+
+static void stop(int)
+{
+  isStopped = 1;
+}
+
+static int usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-b baud rate] [-s socket path] serial device\n", name);
+  return 2;
+}
+
+int main(int argc, char *argv[])
+{
+  int baudRate = X10D_BAUD_RATE;
+  const char *socketPath = X10D_SOCKET_PATH;
+  int option;
+  while((option = getopt(argc, argv, "b:s:")) != -1)
+  {
+    switch(option)
+    {
+      case 'b': baudRate = atoi(optarg); break;
+      case 's': socketPath = optarg; break;
+      default: return usage(argv[0]);
+    }
+  }
+  if(optind != argc - 1) return usage(argv[0]);
+  int serialFd = X10gateway::openSerial(argv[optind], baudRate);
+  if(serialFd < 0)
+  {
+    fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+    return 1;
+  }
+  X10gateway gateway;
+  if(gateway.begin(serialFd, socketPath))
+  {
+    fprintf(stderr, "%s: %s\n", socketPath, strerror(errno));
+    close(serialFd);
+    return 1;
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  while(!isStopped) gateway.poll(-1);
+  gateway.end();
+  return 0;
+}
@@ -20,24 +20,51 @@
 #include <X10ex.h>
 #include <X10rf.h>
 #include <X10ir.h>
+#include <X10router.h>
+#include <X10admission.h>
+#include <X10http.h>
+#include <X10writer.h>
+#include <X10json.h>
+#include <X10stream.h>
+#include <X10frame.h>
 #include <SPI.h>
 #include <Ethernet.h>
 
+// This sketch needs the 8 KB of SRAM of the ATmega1280/2560 (Arduino Mega). Each Ethernet socket has its own HTTP parser
+// and command batch (about 145 bytes each), and the response writer, event stream, router, admission control and RF/IR
+// event buffers use more than 1 KB together. String literals are kept in SRAM as well, so it does not fit in the 2 KB of
+// the ATmega328. Use the X10_Remote example on smaller boards.
+#if !defined(__AVR_ATmega1280__) && !defined(__AVR_ATmega2560__)
+  #error "X10_Ethernet needs an ATmega1280 or ATmega2560 (8 KB SRAM)"
+#endif
+
 #define DEBUG 0
 
 #define POWER_LINE_MSG "PL:"
 #define POWER_LINE_MSG_TIME 1400
 #define RADIO_FREQ_MSG "RF:"
+#define RADIO_SECURITY_MSG "RS:"
 #define INFRARED_MSG "IR:"
 #define SERIAL_DATA_MSG "SD:"
 #define SERIAL_DATA_THRESHOLD 1000
 #define ETHERNET_REST_MSG "ER:"
+#define ETHERNET_UDP_MSG "EU:"
 #define MODULE_STATE_MSG "MS:"
 #define MSG_BUFFER_ERROR "_ExBuffer"
 #define MSG_DATA_ERROR "_ExSyntax"
 #define MSG_RECEIVE_TIMEOUT "_ExTimOut"
 #define MSG_AUTH_ERROR "_ExNoAuth"
 #define MSG_METHOD_ERROR "_ExMethod"
+#define MSG_EVENTS_DROPPED "_ExEvDrop"
+
+// Serial messages can also be sent as binary frames, see X10frame.h. The host sends a hello frame with mode 1 to switch
+// to binary mode (and mode 0 to switch back to text). In binary mode all text messages are turned off: every host frame is
+// acknowledged with status and the number of commands the host can send right now (credits), so the host can send
+// commands back to back at full baud rate without waiting for a reply to each one. PL, RF and IR messages and module state
+// changes are sent as event frames. Frames that stop half way are dropped after SERIAL_FRAME_TIMEOUT milliseconds.
+#define SERIAL_FRAME_TIMEOUT 100
+// Binary mode event stream subscriber, Ethernet sockets use the subscribers before it
+#define SERIAL_EVENTS_SUBSCRIBER (X10_STREAM_SUBSCRIBERS - 1)
 
 // Default username and password are "test" and "test". NOTE: With basic authentication user name and password is sent in clear text.
 // To generate Base64 string first concatenate the user name and password using colon as a separator. Ex: testusername:testpassword
@@ -45,28 +72,140 @@
 // NOTE: If you would like to disable Basic Authentication, just set the HTTP_AUTH_BASE64 define to an empty string "".
 #define HTTP_AUTH_BASE64 "dGVzdDp0ZXN0"
 
-// The buffer is used to hold data when reading HTTP request lines. If you are using a very long username and password, you might
-// need to increase the buffer size. Using long post strings, for example when executing scenarios with multiple extended commands,
-// might also cause the buffer to run out of space. With a buffer size of 64, you can send a scenario with 20 individual standard
-// commands or 7 individual extended commands. A standard command is 3 bytes long and an extended command is 9 bytes long.
-#define HTTP_BUFFER_MAX 64
+// Request lines and form fields are parsed using X10http, see X10_HTTP_BUFFER_MAX for how long they can be. With a buffer size
+// of 64, you can send a scenario with 20 individual standard commands or 7 individual extended commands. A standard command is
+// 3 bytes long and an extended command is 9 bytes long.
+
+// A POST body can hold commands for many modules, as form fields or JSON (Content-Type: application/json), e.g.
+// house=A&unit=1&on=true&unit=2&brightness=50 or [{"house":"A","unit":1,"on":true},{"house":"A","unit":2,"brightness":50}]
+// Power line commands are collected while the body is received, and queued when the request is done: either all commands
+// are queued, or none are (400 when a command is invalid, 413 when there are too many, 503 when there is not room for all).
+// When a body has more than one command, the response has the result of each command. Scenarios (router rules) are
+// executed when received, they are not part of the batch. The batch is limited by X10admission: a client can't queue more
+// commands than X10_ADMISSION_QUEUE_SIZE at once.
+#define HTTP_BATCH_MAX X10_ADMISSION_QUEUE_SIZE
+#define HTTP_COMMAND_REJECTED 0
+#define HTTP_COMMAND_QUEUED 1
+#define HTTP_COMMAND_INVALID 2
 
 // I recommend disabling the "Expect: 100-continue" on your HTTP client. When posting data with this feature enabled the HTTP client
 // will send an "Expect: 100-continue" request in the header and then wait for the server to respond with a "100 Continue" before
-// sending the body. This makes HTTP posts unnecessarily slow, especially when using slow cell phone connections. The default response
-// timeout is 5 seconds. To disable "Expect: 100-continue" support on the Arduino: just set the timeout defined below to 0.
-#define HTTP_CONTINUE_TIMEOUT 5000
-
-// Ethernet receive HTTP parser constants
-#define HTTP_STATE_PARSE_METHOD   0
-#define HTTP_STATE_AUTHENTICATE   1
-#define HTTP_STATE_WAIT_CONTINUE  2
-#define HTTP_STATE_CONTINUE       3
-#define HTTP_STATE_BODY_DONE      4
-#define HTTP_METHOD_UNKNOWN  0
-#define HTTP_METHOD_GET      1
-#define HTTP_METHOD_POST     2
-#define HTTP_METHOD_DELETE   3
+// sending the body. This makes HTTP posts unnecessarily slow, especially when using slow cell phone connections. To disable
+// "Expect: 100-continue" support on the Arduino: just set the define below to 0.
+#define HTTP_CONTINUE 1
+
+// Connections that don't complete their request within this millisecond threshold are closed
+#define HTTP_RECEIVE_TIMEOUT 5000
+// Max bytes read from each socket per loop, so that one client can't hold up others
+#define HTTP_READ_MAX 64
+
+// HTTP/1.1 clients that poll module state can keep their connection open and send the next request (or several requests at
+// once) without connecting again. Responses are sent in the order requests are received, JSON responses using chunked
+// encoding. The shield only has MAX_SOCK_NUM sockets: connections are closed after HTTP_KEEP_ALIVE_MAX requests, after
+// being idle for HTTP_KEEP_ALIVE_TIMEOUT milliseconds, or when all sockets are in use and a new client could be waiting.
+// To close the connection after every response: just set the HTTP_KEEP_ALIVE define to 0.
+#define HTTP_KEEP_ALIVE 1
+#define HTTP_KEEP_ALIVE_TIMEOUT 15000
+#define HTTP_KEEP_ALIVE_MAX 100
+
+// Clients can get PL, RF and IR events and module state changes pushed to them as server-sent events, in stead of polling
+// module state: "GET /events". Events are sent as soon as there is room for them in the socket send buffer; a client that
+// falls X10_STREAM_BUFFER_SIZE events behind is disconnected. Two sockets are always kept free for REST requests. Idle
+// streams get a comment line every HTTP_EVENTS_PING milliseconds, so that dead clients are detected.
+#define HTTP_EVENTS_PATH "/events"
+#define HTTP_EVENTS_MAX (MAX_SOCK_NUM - 2 - UDP_ENABLED)
+#define HTTP_EVENTS_PING 15000
+// Max length of one event (module state with a long name)
+#define HTTP_EVENT_LENGTH_MAX 192
+
+// Module list responses have a version, the state version of X10ex combined with a random number picked at startup (so
+// that versions from before a restart are not mistaken for current versions). The version is sent as ETag, so clients
+// that send "If-None-Match" get "304 Not Modified" when nothing has changed. Clients can also ask for the modules changed
+// since a version: "GET /?since=<version>" or "GET /A/?since=<version>". When since is not a version from this startup,
+// all modules are returned (the response has no "since" field).
+#define HTTP_SINCE_QUERY "since="
+
+// Wall panels and other small clients can use UDP in stead of HTTP: every module state change is broadcast as a datagram
+// to UDP_PORT, and commands can be sent to UDP_PORT without waiting for a reply. The UDP channel uses one of the
+// MAX_SOCK_NUM sockets (one event stream less). To turn it off: just set the UDP_ENABLED define to 0.
+// Datagrams are UDP_DATAGRAM_SIZE bytes: type, house ('A'-'P'), unit (1-16), command, brightness (0-100 percent) and a
+// 32 bit number, most significant byte first.
+// State datagram ('S'): command is status on (0xD), status off (0xE) or unknown (0xF0), and the number is the module list
+// version (see HTTP_SINCE_QUERY), so panels can drop datagrams that arrive out of order and get "/?since=<version>" when
+// one is lost.
+// Command datagram ('C'): command is an X10 command (brightness is only used with extended code 0x7, pre-set dim), and the
+// number is a sequence number incremented by the sender for every command. The same datagram can be sent several times:
+// commands up to UDP_SEQUENCE_WINDOW behind the last sequence number received from the sender are dropped. Nothing is
+// sent back, state datagrams follow when modules change.
+#define UDP_ENABLED 1
+#define UDP_PORT 10010
+#define UDP_DATAGRAM_SIZE 9
+#define UDP_STATE 'S'
+#define UDP_COMMAND 'C'
+#define UDP_SEQUENCE_WINDOW 64
+// Senders with last sequence number kept, the one that sent a command the longest ago is replaced
+#define UDP_SENDERS_MAX 4
+// Socket status of the UDP socket (SnSR::UDP), it's not an HTTP connection
+#define SOCKET_STATUS_UDP 0x22
+
+// Power line command received in POST body
+struct HttpCommand
+{
+  char house;
+  byte unit;
+  byte command;
+  byte extData;
+  byte extCommand;
+  byte repetitions;
+  byte status;
+};
+
+// HTTP request state per Ethernet socket, requests are parsed as data arrives
+struct HttpConnection
+{
+  X10http http;
+  unsigned long lastMs;
+  unsigned long respondMs;
+  byte requestCount;
+  unsigned long since;
+  unsigned long ifNoneMatch;
+  char house;
+  byte unit;
+  char cmdHouse;
+  byte cmdUnit;
+  bool isActive;
+  bool isStarted;
+  bool isEvents;
+  bool isStreaming;
+  bool isDelta;
+  bool hasIfNoneMatch;
+  bool keepAlive;
+  bool isAuthorized;
+  bool expectContinue;
+  bool isDone;
+  bool bufferError;
+  HttpCommand batch[HTTP_BATCH_MAX];
+  byte batchCount;
+  bool batchOverflow;
+  bool batchInvalid;
+};
+HttpConnection httpConnections[MAX_SOCK_NUM];
+byte httpNextSocket;
+// Socket of the request being parsed, power line commands from REST requests are added to its batch
+byte httpBatchSocket = MAX_SOCK_NUM;
+// Picked at startup, high word of module list versions
+uint16_t httpStartupId;
+// Responses are buffered and sent in as few packets as possible, one response is sent at a time
+X10writer httpWriter;
+// Events pushed to event stream clients, one subscriber per socket
+X10stream x10stream;
+
+// Text messages are only printed in text mode, binary mode uses frames
+struct SerialText : public Print
+{
+  size_t write(uint8_t data);
+};
+SerialText serialText;
 
 // Fields used for serial and byte message reception
 unsigned long sdReceived;
@@ -74,11 +213,34 @@ char bmHouse;
 byte bmUnit;
 byte bmCommand;
 byte bmExtCommand;
+// Fields used for binary serial frames
+X10frame serialFrame;
+bool serialBinary;
+byte serialSequence;
+byte serialEventSequence;
+unsigned long serialFrameMs;
+
+#if UDP_ENABLED
+// Command sender, identified by address and port
+struct UdpSender
+{
+  IPAddress ip;
+  uint16_t port;
+  unsigned long sequence;
+  unsigned long lastMs;
+};
+UdpSender udpSenders[UDP_SENDERS_MAX];
+EthernetUDP udp;
+// X10ex state version when state datagrams were last sent
+uint16_t udpStateVersion;
+#endif
 
 // Choose a MAC-address and IP-address for your controller below.
 // The IP address you should choose depends on your network setup:
 byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
 IPAddress ip(10, 0, 0, 3);
+// State datagrams are sent to this address, e.g. the broadcast address of your network
+IPAddress udpBroadcastIp(255, 255, 255, 255);
 
 // X10 Power Line Communication Library
 X10ex x10ex = X10ex(
@@ -95,7 +257,8 @@ X10ex x10ex = X10ex(
 X10rf x10rf = X10rf(
   0, // Receive Interrupt Number (0 = Standard Arduino External Interrupt)
   2, // Receive Interrupt Pin (Pin 2 must be used with interrupt 0)
-  radioFreqEvent // Event triggered when RF message is received
+  radioFreqEvent, // Event triggered when RF message is received
+  radioSecurityEvent // Event triggered when RF security message is received
 );
 // X10 Infrared Receiver Library
 X10ir x10ir = X10ir(
@@ -104,6 +267,15 @@ X10ir x10ir = X10ir(
   'A', // Default House Code
   infraredEvent // Event triggered when IR message is received
 );
+// X10 Event Router Library
+X10router x10router = X10router(
+  &x10ex, // Power line interface used to send routed commands
+  handleRouterScene // Event triggered when a rule executes a scenario
+);
+// X10 Admission Control Library, shares the power line fairly between network, serial, RF and IR
+X10admission x10admission = X10admission(
+  &x10ex // Power line interface messages are passed on to
+);
 // Ethernet server library
 EthernetServer server = EthernetServer(
   80 // Start listening on port 80 (http)
@@ -117,57 +289,115 @@ void setup()
   x10ex.begin();
   x10rf.begin();
   x10ir.begin();
+  // Load router rules saved in EEPROM, or use the default rules
+  if(x10router.load()) addDefaultRules();
+  // Module list versions from before restart are detected using a random startup id (analog pin 0 must be unconnected)
+  randomSeed(analogRead(0));
+  httpStartupId = random(0x10000);
   // Start the Ethernet Server library
   Ethernet.begin(mac, ip);
   server.begin();
+#if UDP_ENABLED
+  udp.begin(UDP_PORT);
+  udpStateVersion = x10ex.getStateVersion();
+#endif
   // X10 is printed in Serial Monitor at startup if you have connected your Arduino correctly
-  Serial.println("X10");
+  serialText.println("X10");
 }
 
 void loop()
 {
+  // Pass buffered RF and IR events on to the callbacks
+  x10rf.poll();
+  x10ir.poll();
+  // Pass queued network, serial, RF and IR commands on to the power line interface
+  x10admission.poll();
+  if(serialBinary) sendSerialEvents();
+  // Drop frame that stopped half way
+  if(serialFrame.isStarted() && millis() - serialFrameMs > SERIAL_FRAME_TIMEOUT) serialFrame.begin();
   if(!Serial.available()) ethernetReceive();
+#if UDP_ENABLED
+  udpReceive();
+  sendUdpStates();
+#endif
 }
 
 // Process messages received from X10 modules over the power line
 void powerLineEvent(char house, byte unit, byte command, byte extData, byte extCommand, byte remainingBits)
 {
   printX10Message(POWER_LINE_MSG, house, unit, command, extData, extCommand, remainingBits);
+  x10stream.publish(X10_STREAM_PLC, house, unit, command, extData, extCommand);
+  if(unit && unit != DATA_UNKNOWN) x10stream.publish(X10_STREAM_MODULE_STATE, house, unit, 0, 0, 0);
+  x10router.route(X10_ROUTER_SOURCE_PLC, house, unit, command, false);
 }
 
 // Process commands received from X10 compatible RF remote
 void radioFreqEvent(char house, byte unit, byte command, bool isRepeat)
 {
-  if(!isRepeat) printX10Message(RADIO_FREQ_MSG, house, unit, command, 0, 0, 0);
+  if(!isRepeat)
+  {
+    printX10Message(RADIO_FREQ_MSG, house, unit, command, 0, 0, 0);
+    x10stream.publish(X10_STREAM_RF, house, unit, command, 0, 0);
+  }
   // Check if command is handled by scenario; if not continue
-  if(!handleUnitScenario(house, unit, command, isRepeat, false))
+  if(!handleUnitScenario(X10_ROUTER_SOURCE_RF, house, unit, command, isRepeat, false))
   {
     // Make sure that two or more repetitions are used for bright and dim,
-    // to avoid that commands are beeing buffered seperately when repeated
+    // to avoid that commands are beeing buffered seperately when repeated.
+    // Repeats of a held button go straight to the PL interface, which only
+    // resets the repetitions of the message it is sending: they must not use
+    // admission tokens, or dimming stops after a burst and goes on after the
+    // button is released
     if(command == CMD_BRIGHT || command == CMD_DIM)
     {
-      x10ex.sendCmd(house, unit, command, 2);
+      if(isRepeat) x10ex.sendCmd(house, unit, command, 2);
+      else x10admission.sendCmd(X10_ADMISSION_SOURCE_RF, house, unit, command, 2);
     }
     // Other commands map directly: just forward to PL interface
     else if(!isRepeat)
     {
-      x10ex.sendCmd(house, unit, command, 1);
+      x10admission.sendCmd(X10_ADMISSION_SOURCE_RF, house, unit, command, 1);
     }
   }
 }
 
+// Process events received from X10 compatible RF security sensors (door/window, motion, e.g.)
+void radioSecurityEvent(uint16_t sensorId, byte data, bool isAlert, bool isLowBattery, bool isTamper)
+{
+  serialText.print(RADIO_SECURITY_MSG);
+  serialText.print(sensorId, HEX);
+  printX10ByteAsHex(data);
+  serialText.println();
+  //////////////////////////////
+  // Sample Code
+  // Replace with your own setup
+  //////////////////////////////
+  // Track sensor state using house code P, and the last 4 bits of the sensor id as unit code
+  x10ex.setSensorState('P', (sensorId & 0xF) + 1, isAlert);
+  x10stream.publish(X10_STREAM_MODULE_STATE, 'P', (sensorId & 0xF) + 1, 0, 0, 0);
+}
+
 // Process commands received from X10 compatible IR remote
 void infraredEvent(char house, byte unit, byte command, bool isRepeat)
 {
-  if(!isRepeat) printX10Message(INFRARED_MSG, house, unit, command, 0, 0, 0);
+  if(!isRepeat)
+  {
+    printX10Message(INFRARED_MSG, house, unit, command, 0, 0, 0);
+    x10stream.publish(X10_STREAM_IR, house, unit, command, 0, 0);
+  }
   // Check if command is handled by scenario; if not continue
-  if(!handleUnitScenario(house, unit, command, isRepeat, false))
+  if(!handleUnitScenario(X10_ROUTER_SOURCE_IR, house, unit, command, isRepeat, false))
   {
     // Make sure that two or more repetitions are used for bright and dim,
-    // to avoid that commands are beeing buffered seperately when repeated
+    // to avoid that commands are beeing buffered seperately when repeated.
+    // Repeats of a held button go straight to the PL interface, which only
+    // resets the repetitions of the message it is sending: they must not use
+    // admission tokens, or dimming stops after a burst and goes on after the
+    // button is released
     if(command == CMD_BRIGHT || command == CMD_DIM)
     {
-      x10ex.sendCmd(house, unit, command, 2);
+      if(isRepeat) x10ex.sendCmd(house, unit, command, 2);
+      else x10admission.sendCmd(X10_ADMISSION_SOURCE_IR, house, unit, command, 2);
     }
     // Only repeat bright and dim commands
     else if(!isRepeat)
@@ -175,12 +405,12 @@ void infraredEvent(char house, byte unit, byte command, bool isRepeat)
       // Handle Address Command (House + Unit)
       if(command == CMD_ADDRESS)
       {
-        x10ex.sendAddress(house, unit, 1);
+        x10admission.sendAddress(X10_ADMISSION_SOURCE_IR, house, unit, 1);
       }
       // Other commands map directly: just forward to PL interface
       else
       {
-        x10ex.sendCmd(house, unit, command, 1);
+        x10admission.sendCmd(X10_ADMISSION_SOURCE_IR, house, unit, command, 1);
       }
     }
   }
@@ -234,6 +464,12 @@ void infraredEvent(char house, byte unit, byte command, bool isRepeat)
 //
 void serialEvent()
 {
+  // Binary frames start with a sync byte, that is not a valid text message
+  if(serialBinary || serialFrame.isStarted() || Serial.peek() == X10_FRAME_SYNC)
+  {
+    serialFrameEvent();
+    return;
+  }
   // Read 3 bytes from serial buffer
   if(Serial.available() >= 3)
   {
@@ -243,8 +479,8 @@ void serialEvent()
     if(process3BMessage(SERIAL_DATA_MSG, byte1, byte2, byte3))
     {
       // Return error message if message sent to X10ex was not buffered successfully
-      Serial.print(SERIAL_DATA_MSG);
-      Serial.println(MSG_BUFFER_ERROR);
+      serialText.print(SERIAL_DATA_MSG);
+      serialText.println(MSG_BUFFER_ERROR);
     }
     sdReceived = 0;
   }
@@ -262,293 +498,873 @@ void serialEvent()
       bmHouse = 0;
       bmExtCommand = 0;
       sdReceived = 0;
-      Serial.print(SERIAL_DATA_MSG);
-      Serial.println(MSG_RECEIVE_TIMEOUT);
+      serialText.print(SERIAL_DATA_MSG);
+      serialText.println(MSG_RECEIVE_TIMEOUT);
       // Clear serial input buffer
       while(Serial.read() != -1);
     }
   }
 }
 
-// Process request received from Arduino Ethernet Shield
-void ethernetReceive()
+// Process binary frames received from computer, see X10frame.h for frame types
+void serialFrameEvent()
 {
-  EthernetClient client = server.available();
-  if(client)
+  while(Serial.available())
+  {
+    serialFrameMs = millis();
+    if(serialFrame.parse(Serial.read()) == X10_FRAME_DONE) executeSerialFrame();
+    // Text mode: the rest is text
+    if(!serialBinary && !serialFrame.isStarted()) return;
+  }
+}
+
+void executeSerialFrame()
+{
+  const byte *payload = serialFrame.getPayload();
+  byte length = serialFrame.getLength();
+  byte type = serialFrame.getType();
+  byte sequence = serialFrame.getSequence();
+  byte status = X10_FRAME_OK;
+  if(type == X10_FRAME_HELLO)
+  {
+    if(length < 1)
+    {
+      status = X10_FRAME_INVALID;
+    }
+    else
+    {
+      serialBinary = payload[0];
+      serialSequence = sequence;
+      serialEventSequence = 0;
+      if(serialBinary) x10stream.subscribe(SERIAL_EVENTS_SUBSCRIBER);
+      else x10stream.unsubscribe(SERIAL_EVENTS_SUBSCRIBER);
+    }
+  }
+  // Frames other than hello are only executed in binary mode, and in order
+  else if(!serialBinary)
+  {
+    status = X10_FRAME_UNKNOWN;
+  }
+  else if((int8_t)(sequence - serialSequence) <= 0)
+  {
+    status = X10_FRAME_DUPLICATE;
+  }
+  else if(sequence != (byte)(serialSequence + 1))
+  {
+    status = X10_FRAME_OUT_OF_ORDER;
+  }
+  else
   {
-    while(client.connected())
+    serialSequence = sequence;
+    if(type == X10_FRAME_COMMAND && length >= 6 && payload[0] >= 'A' && payload[0] <= 'P' && payload[1] <= 16 && payload[2] <= 0xF)
     {
-      byte readState = HTTP_STATE_PARSE_METHOD;
-      byte parsingEncoded = 0;
-      byte encodedChar;
-      bool parsingText = false;
-      byte bufferMax = HTTP_BUFFER_MAX;
-      char buffer[HTTP_BUFFER_MAX + 1];
-      byte lastLineLen = HTTP_BUFFER_MAX;
-      byte method = HTTP_METHOD_UNKNOWN;
-      char house = '*';
-      byte unit = 0;
-      bool x10exBufferError = 0;
-      while(client.available())
+      // Check if command is handled by scenario; if not continue
+      if(!handleUnitScenario(X10_ROUTER_SOURCE_USER, payload[0], payload[1], payload[2], false, true))
       {
-        char c = client.read();
-        // Handle encoded characters
-        if(c == '%')
+        if(x10admission.sendExt(X10_ADMISSION_SOURCE_SERIAL, payload[0], payload[1], payload[2], payload[3], payload[4], payload[5]))
         {
-          parsingEncoded = 2;
+          status = X10_FRAME_REJECTED;
         }
-        else if(parsingEncoded)
+      }
+    }
+    else if(type == X10_FRAME_STATE && length >= 2 && payload[0] >= 'A' && payload[0] <= 'P' && payload[1] >= 1 && payload[1] <= 16)
+    {
+      sendSerialModuleState(payload[0], payload[1]);
+    }
+    else if(type == X10_FRAME_SCENARIO && length >= 1)
+    {
+      if(handleSdScenario(payload[0])) status = X10_FRAME_REJECTED;
+    }
+    else if(type == X10_FRAME_COMMAND || type == X10_FRAME_STATE || type == X10_FRAME_SCENARIO)
+    {
+      status = X10_FRAME_INVALID;
+    }
+    else
+    {
+      status = X10_FRAME_UNKNOWN;
+    }
+  }
+  byte ack[] = { status, x10admission.getCredits(X10_ADMISSION_SOURCE_SERIAL) };
+  sendSerialFrame(X10_FRAME_ACK, sequence, ack, sizeof(ack));
+}
+
+// Sends queued events to computer, events are left in queue while the serial send buffer is full
+void sendSerialEvents()
+{
+  if(x10stream.isDropped(SERIAL_EVENTS_SUBSCRIBER))
+  {
+    if(Serial.availableForWrite() < X10_FRAME_SIZE_MAX) return;
+    sendSerialFrame(X10_FRAME_EVENTS_LOST, serialEventSequence++, NULL, 0);
+    x10stream.subscribe(SERIAL_EVENTS_SUBSCRIBER);
+  }
+  X10streamEvent event;
+  while(Serial.availableForWrite() >= X10_FRAME_SIZE_MAX && x10stream.read(SERIAL_EVENTS_SUBSCRIBER, event))
+  {
+    if(event.type == X10_STREAM_MODULE_STATE)
+    {
+      sendSerialModuleState(event.house, event.unit);
+    }
+    else
+    {
+      byte data[] = { event.type, (byte)event.house, event.unit, event.command, event.extData, event.extCommand };
+      sendSerialFrame(X10_FRAME_EVENT, serialEventSequence++, data, sizeof(data));
+    }
+  }
+}
+
+// Sends module state event: command is status on, status off or unknown, and extData is brightness
+void sendSerialModuleState(char house, byte unit)
+{
+  X10state state = x10ex.getModuleState(house, unit);
+  byte data[] =
+  {
+    X10_STREAM_MODULE_STATE, (byte)house, unit,
+    (byte)(state.isKnown ? state.isOn ? CMD_STATUS_ON : CMD_STATUS_OFF : DATA_UNKNOWN),
+    state.data, 0
+  };
+  sendSerialFrame(X10_FRAME_EVENT, serialEventSequence++, data, sizeof(data));
+}
+
+void sendSerialFrame(byte type, byte sequence, const byte *payload, byte length)
+{
+  byte frame[X10_FRAME_SIZE_MAX];
+  Serial.write(frame, X10frame::encode(frame, type, sequence, payload, length));
+}
+
+size_t SerialText::write(uint8_t data)
+{
+  return serialBinary ? 1 : Serial.write(data);
+}
+
+// Process requests received from Arduino Ethernet Shield. Each socket has its own request parser, so a slow client
+// doesn't block other clients or serial processing. Sockets are serviced round robin, and at most HTTP_READ_MAX bytes
+// are read from each socket per call. Pipelined requests are left in the socket until the response to the previous
+// request is sent.
+void ethernetReceive()
+{
+  // Accept new connections (the server keeps a socket listening)
+  server.available();
+  // Start with the next socket on every call, so that sockets take turns being first
+  byte first = httpNextSocket;
+  httpNextSocket = (httpNextSocket + 1) % MAX_SOCK_NUM;
+  byte connectedCount = 0;
+  byte idleSocket = MAX_SOCK_NUM;
+  for(byte i = 0; i < MAX_SOCK_NUM; i++)
+  {
+    byte sock = (first + i) % MAX_SOCK_NUM;
+    EthernetClient client = EthernetClient(sock);
+    HttpConnection &conn = httpConnections[sock];
+    if(UDP_ENABLED && client.status() == SOCKET_STATUS_UDP) continue;
+    // Socket is closed or listening: make sure next connection starts with a new request
+    if(!client.connected())
+    {
+      if(conn.isStreaming) x10stream.unsubscribe(sock);
+      conn.isActive = false;
+      continue;
+    }
+    // Event stream: requests are not read from socket
+    if(conn.isActive && conn.isStreaming)
+    {
+      sendHttpEvents(client, sock);
+      if(conn.isActive) connectedCount++;
+      continue;
+    }
+    if(!conn.isActive)
+    {
+      conn.requestCount = 0;
+      beginHttpRequest(sock);
+      conn.isActive = true;
+    }
+    // Parse received data until request is done
+    for(byte n = 0; n < HTTP_READ_MAX && !conn.isDone && client.available(); n++)
+    {
+      parseHttpRequest(client, sock, client.read());
+      conn.lastMs = millis();
+      conn.isStarted = true;
+    }
+    if(conn.isDone)
+    {
+      // Response is delayed after power line commands, so that module state is updated when it is sent
+      if((long)(millis() - conn.respondMs) >= 0)
+      {
+        sendHttpResponse(client, sock);
+        conn.requestCount++;
+        if(conn.keepAlive && !httpWriter.getWriteError())
         {
-          parsingEncoded--;
-          if(parsingEncoded) encodedChar = charHexToDecimal(c) * 16;
-          else c = charHexToDecimal(c) + encodedChar;
+          beginHttpRequest(sock);
         }
-        // Handle "normal" characters
-        if(!parsingEncoded)
+        // Response headers are sent, start sending events
+        else if(conn.isEvents && !httpWriter.getWriteError() && sock != SERIAL_EVENTS_SUBSCRIBER && !x10stream.subscribe(sock))
         {
-          // Enable quoted text parser (allows lower case and space)
-          if(c == '"')
-          {
-            parsingText = !parsingText;
-          }
-          // Space is only stored when parsing HTTP method or quoted text
-          else if(isgraph(c) || ((readState == HTTP_STATE_PARSE_METHOD || parsingText) && c == ' '))
-          {
-            // Space is normally replaced with '+' in encoded strings
-            if(parsingText && c == '+') c = ' ';
-            // When parsing quoted text or Base64 string, characters are not converted to upper case
-            buffer[HTTP_BUFFER_MAX - bufferMax] =
-              parsingText || readState == HTTP_STATE_AUTHENTICATE ?
-              c : toupper(c);
-            buffer[HTTP_BUFFER_MAX - --bufferMax] = '\0';
-          }
+          conn.isStreaming = true;
+          conn.lastMs = millis();
         }
-        // We have reached end of line, buffer or transmission
-        if(c == '\n' || !bufferMax || !client.available())
+        else
         {
-          byte lineLen = strlen(buffer);
-          // Parse request method and path
-          if(readState == HTTP_STATE_PARSE_METHOD)
-          {
-            // If method is GET
-            if(!strncmp(buffer, "GET", 3))
-            {
-              method = HTTP_METHOD_GET;
-            }
-            // If method is POST
-            else if(!strncmp(buffer, "POST", 4))
-            {
-              method = HTTP_METHOD_POST;
-            }
-            // If method is DELETE
-            else if(!strncmp(buffer, "DELETE", 6))
-            {
-              method = HTTP_METHOD_DELETE;
-            }
-            // Parse path (house and unit)
-            byte ix = stringIndexOf(buffer, '/', 0, 0, 0);
-            if(buffer[ix] == '/')
-            {
-              char data = buffer[ix + 1];
-              if(data >= 'A' && data <= 'P')
-              {
-                house = data;
-                if(buffer[ix + 2] == '/')
-                {
-                  unit = stringToDecimal(buffer, ix + 3, ix + 5);
-                }
-              }
-            }
-            readState = HTTP_STATE_AUTHENTICATE;
-          }
-          // Validate user credentials (stored in Base64 string)
-          else if(readState == HTTP_STATE_AUTHENTICATE)
-          {
-            if(!lineLen) break;
-            byte base64Len = strlen(HTTP_AUTH_BASE64);
-            // Base64 string should be found at position 19 excluding whitespace
-            if(!base64Len || (base64Len == lineLen - 19 && !strncmp(buffer + 19, HTTP_AUTH_BASE64, base64Len)))
-            {
-              readState = HTTP_STATE_CONTINUE;
-            }
-          }
-#if HTTP_CONTINUE_TIMEOUT > 0
-          // Look for "Expect: 100-continue"
-          else if(readState == HTTP_STATE_CONTINUE && method == HTTP_METHOD_POST && !strncmp(buffer, "EXPECT:100-CONTINUE", 19))
-          {
-            client.println("HTTP/1.1 100 Continue\n");
-            readState = HTTP_STATE_WAIT_CONTINUE;
-          }
-          // Wait for client to receive "100 Continue" and start sending body
-          else if(readState == HTTP_STATE_WAIT_CONTINUE && !client.available() && lastLineLen)
-          {
-            int i;
-            for(int i = HTTP_CONTINUE_TIMEOUT; i > 0 && !client.available(); i--)
-            {
-              delay(1);
-            }
-            if(!i)
-            {
-              Serial.print(ETHERNET_REST_MSG);
-              Serial.println(MSG_RECEIVE_TIMEOUT);
-            }
-            readState = HTTP_STATE_CONTINUE;
-          }
-#endif
-          // Parse body and execute commands, after blank line seperating body from head has been received
-          if(readState >= HTTP_STATE_WAIT_CONTINUE && method == HTTP_METHOD_POST && !lastLineLen)
-          {
-            char cmdHouse = house;
-            byte cmdUnit = unit;
-            byte bufferLen = stringIndexOf(buffer, '\0', 0, HTTP_BUFFER_MAX, HTTP_BUFFER_MAX);
-            byte endIx = 0;
-            while(endIx < bufferLen)
-            {
-              byte startIx = endIx > 0 ? endIx + 1 : 0;
-              // Update command end index
-              endIx = stringIndexOf(buffer, '&', startIx, bufferLen, bufferLen);
-              // Get index of equal sign
-              byte eq = stringIndexOf(buffer, '=', startIx, endIx, 0);
-              if(eq > startIx)
-              {
-                // If user specified house code, use it in stead of the one parsed from path
-                if(!strncmp(buffer + startIx, "HOUSE", eq - startIx))
-                {
-                  cmdHouse = buffer[eq + 1];
-                }
-                // If user specified unit code, use it in stead of the one parsed from path
-                else if(!strncmp(buffer + startIx, "UNIT", eq - startIx))
-                {
-                  cmdUnit = stringToDecimal(buffer, eq + 1, endIx);
-                }
-                // Parse set module type command (0 = Unknown, 1 = Appliance, 2 = Dimmer, 3 = Sensor)
-                else if(!strncmp(buffer + startIx, "TYPE", eq - startIx))
-                {
-                  x10ex.setModuleType(cmdHouse, cmdUnit, stringToDecimal(buffer, eq + 1, endIx));
-                }
-                // Parse set module name command (max. 16 characters)
-                else if(!strncmp(buffer + startIx, "NAME", eq - startIx))
-                {
-                  x10ex.setModuleName(cmdHouse, cmdUnit, buffer + eq + 1, endIx - eq - 1);
-                }
-                // Parse on command (true, false, 1 and 0 are valid input)
-                else if(!strncmp(buffer + startIx, "ON", eq - startIx))
-                {
-                  byte cmd;
-                  cmd =
-                    !strncmp(buffer + eq + 1, "TRUE", endIx - eq - 1 > 4 ? endIx - eq - 1 : 4) ||
-                    !strncmp(buffer + eq + 1, "1", endIx - eq - 1) ?
-                    CMD_ON : CMD_OFF;
-                  // Check if command is handled by scenario; if not continue
-                  if(!handleUnitScenario(cmdHouse, cmdUnit, cmd, false, true))
-                  {
-                    x10exBufferError = x10ex.sendCmd(cmdHouse, cmdUnit, cmd, 2);
-                  }
-                  if(!x10exBufferError)
-                  {
-                    printX10Message(ETHERNET_REST_MSG, cmdHouse, cmdUnit, cmd, 0, 0, 0);
-                    delay(POWER_LINE_MSG_TIME);
-                  }
-                  break;
-                }
-                // Parse brightness command (0-100 percent)
-                else if(!strncmp(buffer + startIx, "BRIGHTNESS", eq - startIx))
-                {
-                  byte brightness = x10ex.percentToX10Brightness(stringToDecimal(buffer, eq + 1, endIx));
-                  x10exBufferError = x10ex.sendExt(cmdHouse, cmdUnit, CMD_EXTENDED_CODE, brightness, EXC_PRE_SET_DIM, 2);
-                  if(!x10exBufferError)
-                  {
-                    printX10Message(ETHERNET_REST_MSG, cmdHouse, cmdUnit, CMD_EXTENDED_CODE, brightness, EXC_PRE_SET_DIM, 0);
-                    delay(POWER_LINE_MSG_TIME);
-                  }
-                  break;
-                }
-                // Parse 3 byte command (Up to 16, 3 or 9 byte commands, are supported)
-                else if(!strncmp(buffer + startIx, "CMD", eq - startIx))
-                {
-                  while(endIx - eq - 1 >= 3 && !x10exBufferError)
-                  {
-                    x10exBufferError = process3BMessage(ETHERNET_REST_MSG, buffer[eq + 1], buffer[eq + 2], buffer[eq + 3]);
-                    eq += 3;
-                  }
-                  break;
-                }
-              }
-            }
-            readState = HTTP_STATE_BODY_DONE;
-          }
-          // Execute delete module state and info
-          else if(readState == HTTP_STATE_CONTINUE && method == HTTP_METHOD_DELETE)
-          {
-            x10ex.wipeModuleState(house, unit);
-            x10ex.wipeModuleInfo(house, unit);
-          }
-          parsingText = false;
-          bufferMax = HTTP_BUFFER_MAX;
-          buffer[0] = '\0';
-          lastLineLen = lineLen;
+          delay(1);
+          client.stop();
+          conn.isActive = false;
+          continue;
         }
-        // Check if we are done receiving
-        if((readState == HTTP_STATE_CONTINUE && method != HTTP_METHOD_POST) || readState == HTTP_STATE_BODY_DONE) break;
       }
-      client.print("HTTP/1.1");
-      // State AUTH_START means user has not provided valid credentials yet
-      if(readState <= HTTP_STATE_AUTHENTICATE)
+    }
+    // Close connections that stop sending before the request is done
+    else if(conn.isStarted && millis() - conn.lastMs > HTTP_RECEIVE_TIMEOUT)
+    {
+      serialText.print(ETHERNET_REST_MSG);
+      serialText.println(MSG_RECEIVE_TIMEOUT);
+      client.stop();
+      conn.isActive = false;
+      continue;
+    }
+    // Close connections that are idle between requests
+    else if(!conn.isStarted && millis() - conn.lastMs > (conn.requestCount ? HTTP_KEEP_ALIVE_TIMEOUT : HTTP_RECEIVE_TIMEOUT))
+    {
+      client.stop();
+      conn.isActive = false;
+      continue;
+    }
+    connectedCount++;
+    // Find the kept alive connection that has been idle the longest
+    if(!conn.isStarted && conn.requestCount &&
+      (idleSocket == MAX_SOCK_NUM || (long)(conn.lastMs - httpConnections[idleSocket].lastMs) < 0))
+    {
+      idleSocket = sock;
+    }
+  }
+  // No socket is left listening for new clients: free up the socket of the longest idle kept alive connection
+  if(connectedCount >= MAX_SOCK_NUM - UDP_ENABLED && idleSocket < MAX_SOCK_NUM)
+  {
+    EthernetClient(idleSocket).stop();
+    httpConnections[idleSocket].isActive = false;
+  }
+}
+
+#if UDP_ENABLED
+// Process command datagrams received from wall panels, one datagram per call so that HTTP clients are not held up
+void udpReceive()
+{
+  int length = udp.parsePacket();
+  if(length <= 0) return;
+  byte data[UDP_DATAGRAM_SIZE];
+  if(length != UDP_DATAGRAM_SIZE || udp.read(data, UDP_DATAGRAM_SIZE) != UDP_DATAGRAM_SIZE || data[0] != UDP_COMMAND ||
+    data[1] < 'A' || data[1] > 'P' || data[2] > 16 || data[3] > 0xF || data[4] > 100)
+  {
+    serialText.print(ETHERNET_UDP_MSG);
+    serialText.println(MSG_DATA_ERROR);
+    return;
+  }
+  unsigned long sequence = (unsigned long)data[5] << 24 | (unsigned long)data[6] << 16 | (unsigned long)data[7] << 8 | data[8];
+  if(isUdpDuplicate(udp.remoteIP(), udp.remotePort(), sequence)) return;
+  char house = data[1];
+  byte unit = data[2];
+  byte command = data[3];
+  bool x10exBufferError = 0;
+  if(command == CMD_EXTENDED_CODE)
+  {
+    byte brightness = x10ex.percentToX10Brightness(data[4]);
+    printX10Message(ETHERNET_UDP_MSG, house, unit, command, brightness, EXC_PRE_SET_DIM, 0);
+    x10exBufferError = x10admission.sendExt(X10_ADMISSION_SOURCE_NETWORK, house, unit, command, brightness, EXC_PRE_SET_DIM, 1);
+  }
+  else
+  {
+    printX10Message(ETHERNET_UDP_MSG, house, unit, command, 0, 0, 0);
+    // Check if command is handled by scenario; if not continue
+    if(!handleUnitScenario(X10_ROUTER_SOURCE_USER, house, unit, command, false, true))
+    {
+      x10exBufferError = x10admission.sendExt(
+        X10_ADMISSION_SOURCE_NETWORK, house, unit, command, 0, 0, command == CMD_BRIGHT || command == CMD_DIM ? 2 : 1);
+    }
+  }
+  if(x10exBufferError)
+  {
+    serialText.print(ETHERNET_UDP_MSG);
+    serialText.println(MSG_BUFFER_ERROR);
+  }
+}
+
+// Returns true when sequence number is not newer than the last one from sender, otherwise it's kept as the last one
+bool isUdpDuplicate(IPAddress ip, uint16_t port, unsigned long sequence)
+{
+  byte oldest = 0;
+  for(byte i = 0; i < UDP_SENDERS_MAX; i++)
+  {
+    UdpSender &sender = udpSenders[i];
+    if(sender.port == port && sender.ip == ip)
+    {
+      if(sender.sequence - sequence < UDP_SEQUENCE_WINDOW) return true;
+      oldest = i;
+      break;
+    }
+    if((long)(sender.lastMs - udpSenders[oldest].lastMs) < 0) oldest = i;
+  }
+  UdpSender &sender = udpSenders[oldest];
+  sender.ip = ip;
+  sender.port = port;
+  sender.sequence = sequence;
+  sender.lastMs = millis();
+  return false;
+}
+
+// Broadcasts state datagram for every module changed since last call
+void sendUdpStates()
+{
+  uint16_t stateVersion = x10ex.getStateVersion();
+  if(stateVersion == udpStateVersion) return;
+  unsigned long version = getHttpVersion(stateVersion);
+  for(short i = 0; i < 256; i++)
+  {
+    char house = 'A' + (i >> 4);
+    byte unit = (i & 0xF) + 1;
+    if(!x10ex.isModuleChanged(house, unit, udpStateVersion)) continue;
+    X10state state = x10ex.getModuleState(house, unit);
+    // Wiped modules can only be told apart from modules never seen when versions are kept per module
+    if(!state.isSeen && X10_MODULE_VERSIONS < 2) continue;
+    byte data[UDP_DATAGRAM_SIZE] =
+    {
+      UDP_STATE, (byte)house, unit,
+      (byte)(state.isKnown ? state.isOn ? CMD_STATUS_ON : CMD_STATUS_OFF : DATA_UNKNOWN),
+      (byte)(state.isKnown && state.data ? x10ex.x10BrightnessToPercent(state.data) : 0),
+      (byte)(version >> 24), (byte)(version >> 16), (byte)(version >> 8), (byte)version
+    };
+    udp.beginPacket(udpBroadcastIp, UDP_PORT);
+    udp.write(data, UDP_DATAGRAM_SIZE);
+    udp.endPacket();
+  }
+  udpStateVersion = stateVersion;
+}
+#endif
+
+void beginHttpRequest(byte sock)
+{
+  HttpConnection &conn = httpConnections[sock];
+  conn.http.begin();
+  conn.lastMs = millis();
+  conn.respondMs = 0;
+  conn.isStarted = false;
+  conn.keepAlive = false;
+  conn.isEvents = false;
+  conn.isStreaming = false;
+  conn.isDelta = false;
+  conn.hasIfNoneMatch = false;
+  conn.house = '*';
+  conn.unit = 0;
+  conn.cmdHouse = '*';
+  conn.cmdUnit = 0;
+  conn.isAuthorized = !strlen(HTTP_AUTH_BASE64);
+  conn.expectContinue = false;
+  conn.batchCount = 0;
+  conn.batchOverflow = false;
+  conn.batchInvalid = false;
+  conn.isDone = false;
+  conn.bufferError = false;
+}
+
+// Parses one byte of request and executes the request when it is done
+void parseHttpRequest(EthernetClient &client, byte sock, char c)
+{
+  HttpConnection &conn = httpConnections[sock];
+  byte events = conn.http.parse(c);
+  // Parse path (house and unit)
+  if(events & X10_HTTP_REQUEST)
+  {
+    const char *path = conn.http.getPath();
+    char data = toupper(path[1]);
+    // Path ends where query starts
+    byte pathLen = strcspn(path, "?");
+    if(pathLen == strlen(HTTP_EVENTS_PATH) && !strncmp(path, HTTP_EVENTS_PATH, pathLen))
+    {
+      conn.isEvents = conn.http.getMethod() == X10_HTTP_METHOD_GET;
+    }
+    else if(path[0] == '/' && data >= 'A' && data <= 'P')
+    {
+      conn.house = data;
+      if(path[2] == '/')
       {
-        client.println(" 401 Authorization Required\nWWW-Authenticate: Basic realm=\"Secure Area\"\nContent-Type: text/html\n");
-        client.print("<html><body>401 Unauthorized</body></html>");
-        Serial.print(ETHERNET_REST_MSG);
-        Serial.println(MSG_AUTH_ERROR);
+        conn.unit = stringToDecimal(path, 3, pathLen < 5 ? pathLen : 5);
       }
-      // User is trying to execute unsupported HTTP request method
-      else if(method == HTTP_METHOD_UNKNOWN)
+    }
+    // Parse "since" query parameter, only modules changed since given version are returned
+    const char *since = strstr(path + pathLen, HTTP_SINCE_QUERY);
+    if(since && (since[-1] == '?' || since[-1] == '&'))
+    {
+      conn.since = strtoul(since + strlen(HTTP_SINCE_QUERY), NULL, 10);
+      conn.isDelta = true;
+    }
+    conn.cmdHouse = conn.house;
+    conn.cmdUnit = conn.unit;
+    // HTTP/1.1 connections are persistent by default, HTTP/1.0 connections are always closed after response
+    conn.keepAlive = HTTP_KEEP_ALIVE && conn.http.isHttp11() && conn.requestCount + 1 < HTTP_KEEP_ALIVE_MAX;
+  }
+  else if(events & X10_HTTP_HEADER)
+  {
+    const char *value = conn.http.getValue();
+    // Validate user credentials (stored in Base64 string)
+    if(!strcmp(conn.http.getName(), "AUTHORIZATION"))
+    {
+      if(!strncmp(value, "Basic ", 6) && !strcmp(value + 6, HTTP_AUTH_BASE64)) conn.isAuthorized = true;
+    }
+    // Look for "Expect: 100-continue"
+    else if(!strcmp(conn.http.getName(), "EXPECT"))
+    {
+      conn.expectContinue = !strcasecmp(value, "100-continue");
+    }
+    // Look for "If-None-Match: <version>", weak and strong ETags are treated the same
+    else if(!strcmp(conn.http.getName(), "IF-NONE-MATCH"))
+    {
+      if(!strncmp(value, "W/", 2)) value += 2;
+      if(value[0] == '"') value++;
+      conn.ifNoneMatch = strtoul(value, NULL, 10);
+      conn.hasIfNoneMatch = true;
+    }
+    // Look for "Connection: close"
+    else if(!strcmp(conn.http.getName(), "CONNECTION"))
+    {
+      if(!strcasecmp(value, "close")) conn.keepAlive = false;
+    }
+  }
+  // Headers are done and body follows
+  if(events & X10_HTTP_BODY)
+  {
+    // User has not provided valid credentials: respond without reading body, body is dropped with the connection
+    if(!conn.isAuthorized)
+    {
+      conn.keepAlive = false;
+      conn.isDone = true;
+    }
+#if HTTP_CONTINUE
+    else if(conn.expectContinue)
+    {
+      client.print("HTTP/1.1 100 Continue\r\n\r\n");
+    }
+#endif
+  }
+  // Execute commands in body
+  if(events & X10_HTTP_FIELD && conn.isAuthorized && conn.http.getMethod() == X10_HTTP_METHOD_POST)
+  {
+    executeHttpField(sock, conn.http.getName(), conn.http.getValue(), conn.http.getValueLength());
+  }
+  if(events & X10_HTTP_DONE)
+  {
+    // Request line is malformed: the rest of the request can't be told apart from the next request
+    if(events & X10_HTTP_ERROR) conn.keepAlive = false;
+    // Execute delete module state and info
+    if(conn.isAuthorized && conn.http.getMethod() == X10_HTTP_METHOD_DELETE)
+    {
+      x10ex.wipeModuleState(conn.house, conn.unit);
+      x10ex.wipeModuleInfo(conn.house, conn.unit);
+      if(conn.house != '*' && conn.unit > 0 && conn.unit <= 16)
       {
-        client.println(" 501 Not Implemented\nContent-Type: application/json\n");
-        Serial.print(ETHERNET_REST_MSG);
-        Serial.println(MSG_METHOD_ERROR);
+        x10stream.publish(X10_STREAM_MODULE_STATE, conn.house, conn.unit, 0, 0, 0);
       }
-      // Response is always sent after successful GET, POST or DELETE request
-      else
+    }
+    // Queue power line commands received in POST body
+    queueHttpCommands(sock);
+    conn.isDone = true;
+  }
+}
+
+// Executes one form field received in POST body. Power line commands are added to the batch of the request.
+void executeHttpField(byte sock, const char *name, const char *value, byte valueLen)
+{
+  HttpConnection &conn = httpConnections[sock];
+  // If user specified house code, use it in stead of the one parsed from path
+  if(!strcmp(name, "HOUSE"))
+  {
+    conn.cmdHouse = toupper(value[0]);
+  }
+  // If user specified unit code, use it in stead of the one parsed from path
+  else if(!strcmp(name, "UNIT"))
+  {
+    conn.cmdUnit = stringToDecimal(value, 0, valueLen);
+  }
+  // Parse set module type command (0 = Unknown, 1 = Appliance, 2 = Dimmer, 3 = Sensor)
+  else if(!strcmp(name, "TYPE"))
+  {
+    x10ex.setModuleType(conn.cmdHouse, conn.cmdUnit, stringToDecimal(value, 0, valueLen));
+    x10stream.publish(X10_STREAM_MODULE_STATE, conn.cmdHouse, conn.cmdUnit, 0, 0, 0);
+  }
+  // Parse set module name command (max. 16 characters)
+  else if(!strcmp(name, "NAME"))
+  {
+    x10ex.setModuleName(conn.cmdHouse, conn.cmdUnit, (char *)value, valueLen);
+    x10stream.publish(X10_STREAM_MODULE_STATE, conn.cmdHouse, conn.cmdUnit, 0, 0, 0);
+  }
+  // Parse on command (true, false, 1 and 0 are valid input)
+  else if(!strcmp(name, "ON"))
+  {
+    byte cmd = !strcmp(value, "TRUE") || !strcmp(value, "1") ? CMD_ON : CMD_OFF;
+    printX10Message(ETHERNET_REST_MSG, conn.cmdHouse, conn.cmdUnit, cmd, 0, 0, 0);
+    // Check if command is handled by scenario; if not continue
+    if(!handleUnitScenario(X10_ROUTER_SOURCE_USER, conn.cmdHouse, conn.cmdUnit, cmd, false, true))
+    {
+      addHttpCommand(sock, conn.cmdHouse, conn.cmdUnit, cmd, 0, 0, 2);
+    }
+  }
+  // Parse brightness command (0-100 percent)
+  else if(!strcmp(name, "BRIGHTNESS"))
+  {
+    byte brightness = x10ex.percentToX10Brightness(stringToDecimal(value, 0, valueLen));
+    printX10Message(ETHERNET_REST_MSG, conn.cmdHouse, conn.cmdUnit, CMD_EXTENDED_CODE, brightness, EXC_PRE_SET_DIM, 0);
+    addHttpCommand(sock, conn.cmdHouse, conn.cmdUnit, CMD_EXTENDED_CODE, brightness, EXC_PRE_SET_DIM, 2);
+  }
+  // Parse router rule command, add rule given as 18 hex characters (see X10router.h)
+  // or remove all rules when value is CLEAR. Rules are saved in EEPROM if possible.
+  else if(!strcmp(name, "RULE"))
+  {
+    if(!strcmp(value, "CLEAR"))
+    {
+      x10router.clearRules();
+      x10router.save();
+    }
+    else if(valueLen != 2 * sizeof(X10rule) || x10router.addRule(value))
+    {
+      serialText.print(ETHERNET_REST_MSG);
+      serialText.println(MSG_DATA_ERROR);
+    }
+    else
+    {
+      x10router.save();
+    }
+  }
+  // Parse 3 byte command (Up to 16, 3 or 9 byte commands, are supported)
+  else if(!strcmp(name, "CMD"))
+  {
+    httpBatchSocket = sock;
+    for(byte i = 0; i + 3 <= valueLen; i += 3)
+    {
+      process3BMessage(ETHERNET_REST_MSG, value[i], value[i + 1], value[i + 2]);
+    }
+    httpBatchSocket = MAX_SOCK_NUM;
+  }
+}
+
+// Adds power line command to batch of request, returns true when batch is full
+bool addHttpCommand(byte sock, char house, byte unit, byte command, byte extData, byte extCommand, byte repetitions)
+{
+  HttpConnection &conn = httpConnections[sock];
+  if(conn.batchCount >= HTTP_BATCH_MAX)
+  {
+    conn.batchOverflow = true;
+    return 1;
+  }
+  HttpCommand &cmd = conn.batch[conn.batchCount++];
+  cmd.house = house;
+  cmd.unit = unit;
+  cmd.command = command;
+  cmd.extData = extData;
+  cmd.extCommand = extCommand;
+  cmd.repetitions = repetitions;
+  cmd.status = HTTP_COMMAND_REJECTED;
+  if(house < 'A' || house > 'P' || unit > 16 || command > 0xF)
+  {
+    cmd.status = HTTP_COMMAND_INVALID;
+    conn.batchInvalid = true;
+  }
+  return 0;
+}
+
+// Queues all commands in batch of request, or none of them
+void queueHttpCommands(byte sock)
+{
+  HttpConnection &conn = httpConnections[sock];
+  if(!conn.batchCount || conn.batchOverflow || conn.batchInvalid) return;
+  // Admission control queue is not emptied until loop continues, so all commands are accepted when there are enough credits
+  if(conn.batchCount > x10admission.getCredits(X10_ADMISSION_SOURCE_NETWORK))
+  {
+    conn.bufferError = true;
+    return;
+  }
+  for(byte i = 0; i < conn.batchCount; i++)
+  {
+    HttpCommand &cmd = conn.batch[i];
+    if(!x10admission.sendExt(
+      X10_ADMISSION_SOURCE_NETWORK, cmd.house, cmd.unit, cmd.command, cmd.extData, cmd.extCommand, cmd.repetitions))
+    {
+      cmd.status = HTTP_COMMAND_QUEUED;
+    }
+  }
+  conn.respondMs = millis() + POWER_LINE_MSG_TIME;
+}
+
+// Sends message through admission control, except messages received in REST requests that are added to request batch
+bool sendX10Message(byte source, char house, byte unit, byte command, byte extData, byte extCommand, byte repetitions)
+{
+  if(source == X10_ADMISSION_SOURCE_NETWORK && httpBatchSocket < MAX_SOCK_NUM)
+  {
+    return addHttpCommand(httpBatchSocket, house, unit, command, extData, extCommand, repetitions);
+  }
+  return x10admission.sendExt(source, house, unit, command, extData, extCommand, repetitions);
+}
+
+// Sends response to request, headers are terminated by CRLF so that clients can tell where the response ends on a
+// kept alive connection. Error responses have a Content-Length, and JSON responses are chunked when the connection is
+// kept alive (or ended by closing the connection when not).
+void sendHttpResponse(EthernetClient &client, byte sock)
+{
+  HttpConnection &conn = httpConnections[sock];
+  httpWriter.begin(&client);
+  httpWriter.print("HTTP/1.1");
+  // User has not provided valid credentials
+  if(!conn.isAuthorized)
+  {
+    const char body[] = "<html><body>401 Unauthorized</body></html>";
+    httpWriter.print(" 401 Authorization Required\r\nWWW-Authenticate: Basic realm=\"Secure Area\"\r\nContent-Type: text/html\r\n");
+    sendHttpConnectionHeaders(sock, sizeof(body) - 1);
+    httpWriter.print(body);
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_AUTH_ERROR);
+  }
+  // User is trying to execute unsupported HTTP request method
+  else if(conn.http.getMethod() == X10_HTTP_METHOD_UNKNOWN)
+  {
+    httpWriter.print(" 501 Not Implemented\r\nContent-Type: application/json\r\n");
+    sendHttpConnectionHeaders(sock, 0);
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_METHOD_ERROR);
+  }
+  // Batch has more commands than can ever be queued at once
+  else if(conn.batchOverflow)
+  {
+    httpWriter.print(" 413 Payload Too Large\r\n");
+    sendHttpBatchResults(sock);
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_DATA_ERROR);
+  }
+  // Batch has invalid commands
+  else if(conn.batchInvalid)
+  {
+    httpWriter.print(" 400 Bad Request\r\n");
+    sendHttpBatchResults(sock);
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_DATA_ERROR);
+  }
+  // Command was rejected by admission control or power line buffer is full, or there are no free event streams: tell
+  // client to back off
+  else if(conn.bufferError || (conn.isEvents && x10stream.getSubscriberCount() - x10stream.isSubscribed(SERIAL_EVENTS_SUBSCRIBER) >= HTTP_EVENTS_MAX))
+  {
+    conn.isEvents = false;
+    httpWriter.print(" 503 Service Unavailable\r\nRetry-After: 1\r\nX-Credits: ");
+    httpWriter.println(x10admission.getCredits(X10_ADMISSION_SOURCE_NETWORK));
+    sendHttpBatchResults(sock);
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_BUFFER_ERROR);
+  }
+  // Start event stream, events are sent by sendHttpEvents. Stream is ended by closing the connection.
+  else if(conn.isEvents)
+  {
+    conn.keepAlive = false;
+    httpWriter.print(" 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n");
+    sendHttpConnectionHeaders(sock, -1);
+  }
+  // All commands in batch were queued
+  else if(conn.batchCount > 1)
+  {
+    httpWriter.print(" 200 OK\r\nX-Credits: ");
+    httpWriter.println(x10admission.getCredits(X10_ADMISSION_SOURCE_NETWORK));
+    sendHttpBatchResults(sock);
+  }
+  // Nothing has changed since client got the version it has
+  else if(
+    conn.http.getMethod() == X10_HTTP_METHOD_GET &&
+    conn.hasIfNoneMatch && conn.ifNoneMatch == getHttpVersion(x10ex.getStateVersion()))
+  {
+    httpWriter.print(" 304 Not Modified\r\n");
+    sendHttpVersionHeaders(conn.ifNoneMatch);
+    if(!conn.keepAlive) httpWriter.print("Connection: close\r\n");
+    httpWriter.print("\r\n");
+  }
+  // Response is always sent after successful GET, POST or DELETE request
+  else
+  {
+    // Version is read before module state, modules changed while state is sent are in the next delta
+    uint16_t stateVersion = x10ex.getStateVersion();
+    // Delta is only returned for versions from this startup that are not newer than current version
+    bool isDelta =
+      conn.isDelta && conn.since >> 16 == httpStartupId && (int16_t)((uint16_t)conn.since - stateVersion) <= 0;
+    // Return JSON response, credits is number of commands client can send right now
+    httpWriter.print(" 200 OK\r\nX-Credits: ");
+    httpWriter.println(x10admission.getCredits(X10_ADMISSION_SOURCE_NETWORK));
+    sendHttpVersionHeaders(getHttpVersion(stateVersion));
+    httpWriter.print("Content-Type: application/json\r\n");
+    sendHttpConnectionHeaders(sock, -1);
+    if(conn.keepAlive) httpWriter.beginChunked();
+    if(conn.house != '*' && conn.unit > 0 && conn.unit <= 16)
+    {
+      erPrintModuleState(conn.house, conn.unit, true, true);
+    }
+    else
+    {
+      httpWriter.print("{\"version\":");
+      httpWriter.print(getHttpVersion(stateVersion), DEC);
+      if(isDelta)
+      {
+        httpWriter.print(",\"since\":");
+        httpWriter.print(conn.since, DEC);
+      }
+      httpWriter.print(",\"module\":[");
+      bool isFirst = true;
+      // All units using specified house code, or all units
+      short i = 0;
+      short endIx = 256;
+      if(conn.house != '*')
       {
-        // Return JSON response
-        client.println(" 200 OK\nContent-Type: application/json\n");
-        if(house != '*' && unit > 0 && unit <= 16)
+        i = (conn.house - 0x41) << 4;
+        endIx = i + 16;
+      }
+      for(; i < endIx; i++)
+      {
+        char house = (i >> 4) + 0x41;
+        byte unit = (i & 0xF) + 1;
+        // Delta: changed modules are returned even if they are no longer seen (e.g. wiped), so client can remove them
+        if(isDelta)
         {
-          erPrintModuleState(client, house, unit, true, true);
+          if(x10ex.isModuleChanged(house, unit, conn.since) && erPrintModuleState(house, unit, isFirst, true)) isFirst = false;
         }
-        else
+        else if(erPrintModuleState(house, unit, isFirst, false))
         {
-          client.println("{\n\"module\":\n[");
-          bool isFirst = true;
-          // All units using specified house code
-          if(house != '*')
-          {
-            for(byte i = 1; i <= 16; i++)
-            {
-              if(erPrintModuleState(client, house, i, isFirst, false)) isFirst = false;
-            }
-          }
-          // All units
-          else
-          {
-            for(short i = 0; i < 256; i++)
-            {
-              if(erPrintModuleState(client, (i >> 4) + 0x41, (i & 0xF) + 1, isFirst, false)) isFirst = false;
-            }
-          }
-          client.print("\n]\n}");
+          isFirst = false;
         }
       }
-      delay(1);
-      client.stop();
+      httpWriter.print("]}");
     }
   }
+  // Send what is left in buffer (and last chunk)
+  httpWriter.end();
+#if DEBUG
+  serialText.print("DEBUG=");
+  serialText.print(ETHERNET_REST_MSG);
+  serialText.print(httpWriter.getByteCount(), DEC);
+  serialText.print("_Bytes_");
+  serialText.print(httpWriter.getPacketCount(), DEC);
+  serialText.println("_Packets");
+#endif
+}
+
+// Sends queued events to event stream client, one packet per event. Events are left in queue while the socket send
+// buffer is full; when the queue is full the client is dropped.
+void sendHttpEvents(EthernetClient &client, byte sock)
+{
+  HttpConnection &conn = httpConnections[sock];
+  // Anything client sends is ignored
+  for(byte n = 0; n < HTTP_READ_MAX && client.available(); n++) client.read();
+  if(x10stream.isDropped(sock))
+  {
+    serialText.print(ETHERNET_REST_MSG);
+    serialText.println(MSG_EVENTS_DROPPED);
+    x10stream.unsubscribe(sock);
+    client.stop();
+    conn.isActive = false;
+    return;
+  }
+  httpWriter.begin(&client);
+  X10streamEvent event;
+  while(client.availableForWrite() >= HTTP_EVENT_LENGTH_MAX && !httpWriter.getWriteError() && x10stream.read(sock, event))
+  {
+    httpWriter.print("event:");
+    httpWriter.print(
+      event.type == X10_STREAM_PLC ? "PL" :
+      event.type == X10_STREAM_RF ? "RF" :
+      event.type == X10_STREAM_IR ? "IR" : "MS");
+    httpWriter.print("\ndata:");
+    if(event.type == X10_STREAM_MODULE_STATE)
+    {
+      x10printJsonModule(
+        httpWriter, x10ex, event.house, event.unit,
+        x10ex.getModuleState(event.house, event.unit), x10ex.getModuleInfo(event.house, event.unit));
+    }
+    else
+    {
+      x10printJsonCommand(httpWriter, event.house, event.unit, event.command, event.extData, event.extCommand);
+    }
+    httpWriter.print("\n\n");
+    httpWriter.flush();
+    conn.lastMs = millis();
+  }
+  // Comment line keeps idle stream alive
+  if(millis() - conn.lastMs > HTTP_EVENTS_PING)
+  {
+    httpWriter.print(":\n");
+    httpWriter.flush();
+    conn.lastMs = millis();
+  }
+  if(httpWriter.getWriteError())
+  {
+    x10stream.unsubscribe(sock);
+    client.stop();
+    conn.isActive = false;
+  }
+}
+
+// Ends headers of response to POST request, when body had more than one command, or when a command was invalid or there
+// were too many, the body has the result of each command: {"result":[{"command":{...},"status":"queued"},...]}
+void sendHttpBatchResults(byte sock)
+{
+  HttpConnection &conn = httpConnections[sock];
+  if(conn.batchCount <= 1 && !conn.batchOverflow && !conn.batchInvalid)
+  {
+    sendHttpConnectionHeaders(sock, 0);
+    return;
+  }
+  httpWriter.print("Content-Type: application/json\r\n");
+  sendHttpConnectionHeaders(sock, -1);
+  if(conn.keepAlive) httpWriter.beginChunked();
+  httpWriter.print("{\"result\":[");
+  for(byte i = 0; i < conn.batchCount; i++)
+  {
+    HttpCommand &cmd = conn.batch[i];
+    if(i) httpWriter.print(',');
+    httpWriter.print("{\"command\":");
+    x10printJsonCommand(httpWriter, cmd.house, cmd.unit, cmd.command, cmd.extData, cmd.extCommand);
+    httpWriter.print(",\"status\":\"");
+    httpWriter.print(
+      cmd.status == HTTP_COMMAND_QUEUED ? "queued" :
+      cmd.status == HTTP_COMMAND_INVALID ? "invalid" : "rejected");
+    httpWriter.print("\"}");
+  }
+  httpWriter.print("]}");
+}
+
+// Module list version: startup id in high word and X10ex state version in low word
+unsigned long getHttpVersion(uint16_t stateVersion)
+{
+  return (unsigned long)httpStartupId << 16 | stateVersion;
+}
+
+void sendHttpVersionHeaders(unsigned long version)
+{
+  httpWriter.print("ETag: \"");
+  httpWriter.print(version, DEC);
+  httpWriter.print("\"\r\nX-Version: ");
+  httpWriter.println(version, DEC);
+}
+
+// Ends response headers, content length is -1 when body length is not known up front (body is chunked when connection
+// is kept alive)
+void sendHttpConnectionHeaders(byte sock, int contentLength)
+{
+  HttpConnection &conn = httpConnections[sock];
+  if(contentLength >= 0)
+  {
+    httpWriter.print("Content-Length: ");
+    httpWriter.println(contentLength, DEC);
+  }
+  else if(conn.keepAlive)
+  {
+    httpWriter.print("Transfer-Encoding: chunked\r\n");
+  }
+  if(!conn.keepAlive)
+  {
+    httpWriter.print("Connection: close\r\n");
+  }
+  httpWriter.print("\r\n");
 }
 
 // Processes and executes 3 byte serial and ethernet messages.
 bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
 {
   bool x10exBufferError = 0;
+  byte source = strcmp(type, ETHERNET_REST_MSG) ? X10_ADMISSION_SOURCE_SERIAL : X10_ADMISSION_SOURCE_NETWORK;
   // Convert byte2 from hex to decimal unless command is request module state
   if(byte1 != 'R') byte2 = charHexToDecimal(byte2);
   // Convert byte3 from hex to decimal unless command is wipe module state
@@ -566,9 +1382,9 @@ bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
     {
       printX10Message(type, bmHouse, bmUnit, byte3, 0, 0, 8 * Serial.available());
       // Check if command is handled by scenario; if not continue
-      if(!handleUnitScenario(bmHouse, bmUnit, bmCommand, false, true))
+      if(!handleUnitScenario(X10_ROUTER_SOURCE_USER, bmHouse, bmUnit, bmCommand, false, true))
       {
-        x10exBufferError = x10ex.sendCmd(bmHouse, bmUnit, bmCommand, bmCommand == CMD_BRIGHT || bmCommand == CMD_DIM ? 2 : 1);
+        x10exBufferError = sendX10Message(source, bmHouse, bmUnit, bmCommand, 0, 0, bmCommand == CMD_BRIGHT || bmCommand == CMD_DIM ? 2 : 1);
       }        
       bmHouse = 0;
     }
@@ -586,7 +1402,7 @@ bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
     else
     {
       printX10Message(type, bmHouse, bmUnit, bmCommand, data, bmExtCommand, 8 * Serial.available());
-      x10exBufferError = x10ex.sendExt(bmHouse, bmUnit, bmCommand, data, bmExtCommand, 1);
+      x10exBufferError = sendX10Message(source, bmHouse, bmUnit, bmCommand, data, bmExtCommand, 1);
       bmHouse = 0;
     }
   }
@@ -594,22 +1410,22 @@ bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
   else if(byte1 == 'S')
   {
     byte scenario = byte2 * 16 + byte3;
-    Serial.print(type);
-    Serial.print("S");
-    if(scenario <= 0xF) { Serial.print("0"); }
-    Serial.println(scenario, HEX);
+    serialText.print(type);
+    serialText.print("S");
+    if(scenario <= 0xF) { serialText.print("0"); }
+    serialText.println(scenario, HEX);
     handleSdScenario(scenario);
   }
   // Check if request module state command was received (byte1 = Request State Character, byte2 = House, byte3 = Unit)
   else if(byte1 == 'R' && ((byte2 >= 'A' && byte2 <= 'P') || byte2 == '*'))
   {
-    Serial.print(type);
-    Serial.print("R");
-    Serial.print(byte2);
+    serialText.print(type);
+    serialText.print("R");
+    serialText.print(byte2);
     // All modules
     if(byte2 == '*')
     {
-      Serial.println('*');
+      serialText.println('*');
       for(short i = 0; i < 256; i++)
       {
         sdPrintModuleState((i >> 4) + 0x41, i & 0xF);
@@ -619,13 +1435,13 @@ bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
     {
       if(byte3 <= 0xF)
       {
-        Serial.println(byte3, HEX);
+        serialText.println(byte3, HEX);
         sdPrintModuleState(byte2, byte3);
       }
       // All units using specified house code
       else
       {
-        Serial.println('*');
+        serialText.println('*');
         for(byte i = 0; i < 16; i++)
         {
           sdPrintModuleState(byte2, i);
@@ -636,19 +1452,19 @@ bool process3BMessage(const char type[], byte byte1, byte byte2, byte byte3)
   // Check if request wipe module state command was received (byte1 = Request State Character, byte2 = Wipe Character, byte3 = House)
   else if(byte1 == 'R' && byte2 == 'W' && ((byte3 >= 'A' && byte3 <= 'P') || byte3 == '*'))
   {
-    Serial.print(type);
-    Serial.print("RW");
-    Serial.println((char)byte3);
+    serialText.print(type);
+    serialText.print("RW");
+    serialText.println((char)byte3);
     x10ex.wipeModuleState(byte3);
-    Serial.print(MODULE_STATE_MSG);
-    Serial.print(byte3 >= 'A' && byte3 <= 'P' ? (char)byte3 : '*');
-    Serial.println("__");
+    serialText.print(MODULE_STATE_MSG);
+    serialText.print(byte3 >= 'A' && byte3 <= 'P' ? (char)byte3 : '*');
+    serialText.println("__");
   }
   // Unknown command/data
   else
   {
-    Serial.print(type);
-    Serial.println(MSG_DATA_ERROR);
+    serialText.print(type);
+    serialText.println(MSG_DATA_ERROR);
   }
   return x10exBufferError;
 }
@@ -659,7 +1475,7 @@ void printX10Message(const char type[], char house, byte unit, byte command, byt
   // Ignore non X10 commands like the CMD_ADDRESS command used by the IR library
   if(command <= 0xF)
   {
-    Serial.print(command, HEX);
+    serialText.print(command, HEX);
     if(extCommand || (extData && (command == CMD_STATUS_ON || command == CMD_STATUS_OFF)))
     {
       printX10ByteAsHex(extCommand);
@@ -668,9 +1484,9 @@ void printX10Message(const char type[], char house, byte unit, byte command, byt
   }
   else
   {
-    Serial.print("_");
+    serialText.print("_");
   }
-  Serial.println();
+  serialText.println();
 #if DEBUG
   printDebugX10Message(type, house, unit, command, extData, extCommand, remainingBits);
 #endif
@@ -678,8 +1494,8 @@ void printX10Message(const char type[], char house, byte unit, byte command, byt
 
 void printX10TypeHouseUnit(const char type[], char house, byte unit, byte command)
 {
-  Serial.print(type);
-  Serial.print(house);
+  serialText.print(type);
+  serialText.print(house);
   if(
     unit &&
     unit != DATA_UNKNOWN/* &&
@@ -688,11 +1504,11 @@ void printX10TypeHouseUnit(const char type[], char house, byte unit, byte comman
     command != CMD_ALL_LIGHTS_OFF &&
     command != CMD_HAIL_REQUEST*/)
   {
-    Serial.print(unit - 1, HEX);
+    serialText.print(unit - 1, HEX);
   }
   else
   {
-    Serial.print("_");
+    serialText.print("_");
   }
 }
 
@@ -710,45 +1526,13 @@ void sdPrintModuleState(char house, byte unit)
   }
 }
 
-bool erPrintModuleState(EthernetClient client, char house, byte unit, bool isFirst, bool printUnseenModules)
+bool erPrintModuleState(char house, byte unit, bool isFirst, bool printUnseenModules)
 {
   X10state state = x10ex.getModuleState(house, unit);
-  X10info info = x10ex.getModuleInfo(house, unit);
   if(state.isSeen || printUnseenModules)
   {
-    if(!isFirst) client.println(",");
-    client.print("{\n\"house\": \"");
-    client.print(house);
-    client.println("\",");
-    client.print("\"unit\": ");
-    client.print(unit, DEC);
-    client.print(",\n\"url\": \"/");
-    client.print(house);
-    client.print("/");
-    client.print(unit, DEC);
-    client.print("/\"");
-    if(info.type)
-    {
-      client.print(",\n\"type\": ");
-      client.print(info.type, DEC);
-    }
-    if(strlen(info.name))
-    {
-      client.print(",\n\"name\": \"");
-      client.print(info.name);
-      client.print("\"");
-    }
-    if(state.isKnown)
-    {
-      client.print(",\n\"on\": ");
-      client.print(state.isOn ? "true" : "false");
-      if(state.data)
-      {
-        client.print(",\n\"brightness\": ");
-        client.print(x10ex.x10BrightnessToPercent(state.data), DEC);
-      }
-    }
-    client.print("\n}");
+    if(!isFirst) httpWriter.print(',');
+    x10printJsonModule(httpWriter, x10ex, house, unit, state, x10ex.getModuleInfo(house, unit));
     return true;
   }
   return false;
@@ -756,9 +1540,9 @@ bool erPrintModuleState(EthernetClient client, char house, byte unit, bool isFir
 
 void printX10ByteAsHex(byte data)
 {
-  Serial.print("x");
-  if(data <= 0xF) { Serial.print("0"); }
-  Serial.print(data, HEX);
+  serialText.print("x");
+  if(data <= 0xF) { serialText.print("0"); }
+  serialText.print(data, HEX);
 }
 
 byte charHexToDecimal(byte input)
@@ -790,16 +1574,8 @@ byte stringToDecimal(const char input[], byte startPos, byte endPos)
   return decimal;
 }
 
-short stringIndexOf(const char string[], char find, byte startPos, byte endPos, short notFoundValue)
-{
-  char *ixStr = strchr(string + startPos, find);
-  return
-    ixStr - string < 0 || (endPos > 0 && ixStr - string > endPos) ?
-    notFoundValue : ixStr - string;
-}
-
 // Handles scenario execute commands received as serial data message
-void handleSdScenario(byte scenario)
+bool handleSdScenario(byte scenario)
 {
   switch(scenario)
   {
@@ -807,20 +1583,58 @@ void handleSdScenario(byte scenario)
     // Sample Code
     // Replace with your own setup
     //////////////////////////////
-    case 0x01: sendAllLightsOn(); break;
-    case 0x02: sendHallAndKitchenOn(); break;
-    case 0x03: sendLivingRoomOn(); break;
-    case 0x04: sendLivingRoomTvScenario(); break;
-    case 0x05: sendLivingRoomMovieScenario(); break;
-    case 0x11: sendAllLightsOff(); break;
-    case 0x12: sendHallAndKitchenOff(); break;
-    case 0x13: sendLivingRoomOff(); break;
+    case 0x01: return sendAllLightsOn();
+    case 0x02: return sendHallAndKitchenOn();
+    case 0x03: return sendLivingRoomOn();
+    case 0x04: return sendLivingRoomTvScenario();
+    case 0x05: return sendLivingRoomMovieScenario();
+    case 0x11: return sendAllLightsOff();
+    case 0x12: return sendHallAndKitchenOff();
+    case 0x13: return sendLivingRoomOff();
+  }
+  return 0;
+}
+
+// Handles scenarios executed by router rules, uses the serial data scenario numbers
+bool handleRouterScene(byte scene, byte command)
+{
+  return handleSdScenario(scene);
+}
+
+// Adds the default router rules, used when no rules are saved in EEPROM
+void addDefaultRules()
+{
+  //////////////////////////////
+  // Sample Code
+  // Replace with your own setup
+  //////////////////////////////
+  // Placeholder unit codes used by RF and IR remotes, and REST/serial commands, that trigger scenarios.
+  // Other commands to these units (bright, dim, held buttons, e.g.) are dropped, they are not real modules.
+  // This uses 15 of the X10_ROUTER_MAX_RULES rules.
+  const byte sources = X10_ROUTER_SOURCE_RF | X10_ROUTER_SOURCE_IR | X10_ROUTER_SOURCE_USER;
+  const byte scenes[][3] =
+  {
+    // Unit, On scenario, Off scenario
+    { 5, 0x02, 0x12 }, // HallAndKitchen
+    { 10, 0x01, 0x11 }, // AllLights
+    { 11, 0x03, 0x13 }, // LivingRoom
+    { 12, 0x04, 0x03 }, // LivingRoomTv (off reverts to LivingRoom)
+    { 13, 0x05, 0x03 }, // LivingRoomMovie (off reverts to LivingRoom)
+  };
+  for(byte i = 0; i < sizeof(scenes) / sizeof(scenes[0]); i++)
+  {
+    X10rule on = { sources, 'A', scenes[i][0], CMD_ON, 0, X10_ACTION_SCENE, 0, 0, scenes[i][1] };
+    X10rule off = { sources, 'A', scenes[i][0], CMD_OFF, 0, X10_ACTION_SCENE, 0, 0, scenes[i][2] };
+    X10rule drop = { sources, 'A', scenes[i][0], X10_ROUTER_SAME, X10_RULE_REPEAT, X10_ACTION_DROP, 0, 0, 0 };
+    x10router.addRule(on);
+    x10router.addRule(off);
+    x10router.addRule(drop);
   }
 }
 
 // Handles scenarios triggered when receiving unit on/off commands
 // Use this method to trigger scenarios from simple RF/IR remotes
-bool handleUnitScenario(char house, byte unit, byte command, bool isRepeat, bool failOnBufferError)
+bool handleUnitScenario(byte source, char house, byte unit, byte command, bool isRepeat, bool failOnBufferError)
 {
   //////////////////////////////
   // Sample Code
@@ -829,63 +1643,18 @@ bool handleUnitScenario(char house, byte unit, byte command, bool isRepeat, bool
 
   bool bufferError = 0;
 
-  // Ignore all house codes except A
-  if(house != 'A') return 0;
-
   // Unit 4 is an old X10 lamp module that doesn't remember state on its own. Use the
   // following method to revert to buffered state when these modules are turned on
-  if(unit == 4)
+  if(house == 'A' && unit == 4)
   {
     bufferError = handleOldLampModuleState(house, unit, command, isRepeat);
-  }  
-  // Unit 5 is a placeholder unit code used by RF and IR remotes that triggers HallAndKitchen scenario
-  else if(unit == 5)
-  {
-    if(!isRepeat)
-    {
-      if(command == CMD_ON) bufferError = sendHallAndKitchenOn();
-      else if(command == CMD_OFF) bufferError = sendHallAndKitchenOff();
-    }
-  }
-  // Unit 10 is a placeholder unit code used by RF and IR remotes that triggers AllLights scenario
-  else if(unit == 10)
-  {
-    if(!isRepeat)
-    {
-      if(command == CMD_ON) bufferError = sendAllLightsOn();
-      else if(command == CMD_OFF) bufferError = sendAllLightsOff();
-    }
-  }
-  // Unit 11 is a placeholder unit code used by RF and IR remotes that triggers LivingRoom scenario
-  else if(unit == 11)
-  {
-    if(!isRepeat)
-    {
-      if(command == CMD_ON) bufferError = sendLivingRoomOn();
-      else if(command == CMD_OFF) bufferError = sendLivingRoomOff();
-    }
-  }
-  // Unit 12 is a placeholder unit code used by RF and IR remotes that triggers LivingRoomTv scenario
-  else if(unit == 12)
-  {
-    if(!isRepeat)
-    {
-      if(command == CMD_ON) bufferError = sendLivingRoomTvScenario();
-      else if(command == CMD_OFF) bufferError = sendLivingRoomOn();
-    }
-  }
-  // Unit 13 is a placeholder unit code used by RF and IR remotes that triggers LivingRoomMovie scenario
-  else if(unit == 13)
-  {
-    if(!isRepeat)
-    {
-      if(command == CMD_ON) bufferError = sendLivingRoomMovieScenario();
-      else if(command == CMD_OFF) bufferError = sendLivingRoomOn();
-    }
   }
+  // Scenarios triggered by placeholder unit codes are handled by router rules
   else
   {
-    return 0;
+    byte routed = x10router.route(source, house, unit, command, isRepeat);
+    if(!routed) return 0;
+    bufferError = routed == X10_ROUTE_BUFFER_ERROR;
   }
   return !failOnBufferError || !bufferError;
 }
@@ -917,83 +1686,92 @@ bool handleOldLampModuleState(char house, byte unit, byte command, bool isRepeat
 
 bool sendAllLightsOn()
 {
-  return
-    // Bedroom
-    x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1) ||
-    // Dining Table
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    // Hall
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    // Couch
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    // Kitchen
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1) ||
-    // TV Backlight
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  // Scenario is sent as a whole or not at all
+  if(x10ex.beginBatch(6)) return 1;
+  // Bedroom
+  x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1);
+  // Dining Table
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  // Hall
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  // Couch
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  // Kitchen
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  // TV Backlight
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendAllLightsOff()
 {
-  return
-    x10ex.sendCmd('A', 7, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(6)) return 1;
+  x10ex.sendCmd('A', 7, CMD_OFF, 1);
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOn()
 {
-  return
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOff()
 {
-  return
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOn()
 {
-  return
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOff()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomTvScenario()
 {
-  return
-    x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomMovieScenario()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 #if DEBUG
 
 void printDebugX10Message(const char type[], char house, byte unit, byte command, byte extData, byte extCommand, int remainingBits)
 {
-  Serial.print("DEBUG=");
+  serialText.print("DEBUG=");
   printX10TypeHouseUnit(type, house, unit, command);
   switch(command)
   {
@@ -1002,36 +1780,36 @@ void printDebugX10Message(const char type[], char house, byte unit, byte command
     case CMD_ADDRESS:
       break;
     case CMD_ALL_UNITS_OFF:
-      Serial.println("_AllUnitsOff");
+      serialText.println("_AllUnitsOff");
       break;
     case CMD_ALL_LIGHTS_ON:
-      Serial.println("_AllLightsOn");
+      serialText.println("_AllLightsOn");
       break;
     case CMD_ON:
-      Serial.print("_On");
+      serialText.print("_On");
       printDebugX10Brightness("_Brightness", extData);
       break;
     case CMD_OFF:
-      Serial.print("_Off");
+      serialText.print("_Off");
       printDebugX10Brightness("_Brightness", extData);
       break;
     case CMD_DIM:
-      Serial.println("_Dim");
+      serialText.println("_Dim");
       break;
     case CMD_BRIGHT:
-      Serial.println("_Bright");
+      serialText.println("_Bright");
       break;
     case CMD_ALL_LIGHTS_OFF:
-      Serial.println("_AllLightsOff");
+      serialText.println("_AllLightsOff");
       break;
     case CMD_EXTENDED_CODE:
-      Serial.print("_ExtendedCode");
+      serialText.print("_ExtendedCode");
       break;
     case CMD_HAIL_REQUEST:
-      Serial.println("_HailReq");
+      serialText.println("_HailReq");
       break;
     case CMD_HAIL_ACKNOWLEDGE:
-      Serial.println("_HailAck");
+      serialText.println("_HailAck");
       break;
     // Enable X10_USE_PRE_SET_DIM in X10ex header file
     // to use X10 standard message PRE_SET_DIM commands
@@ -1040,22 +1818,22 @@ void printDebugX10Message(const char type[], char house, byte unit, byte command
       printDebugX10Brightness("_PreSetDim", extData);
       break;
     case CMD_EXTENDED_DATA:
-      Serial.print("_ExtendedData");
+      serialText.print("_ExtendedData");
       break;
     case CMD_STATUS_ON:
-      Serial.println("_StatusOn");
+      serialText.println("_StatusOn");
       break;
     case CMD_STATUS_OFF:
-      Serial.println("_StatusOff");
+      serialText.println("_StatusOff");
       break;
     case CMD_STATUS_REQUEST:
-      Serial.println("_StatusReq");
+      serialText.println("_StatusReq");
       break;
     case DATA_UNKNOWN:
-      Serial.println("_Unknown");
+      serialText.println("_Unknown");
       break;
     default:
-      Serial.println();
+      serialText.println();
   }
   if(extCommand)
   {
@@ -1065,17 +1843,17 @@ void printDebugX10Message(const char type[], char house, byte unit, byte command
         printDebugX10Brightness("_PreSetDim", extData);
         break;
       default:
-        Serial.print("_");
-        Serial.print(extCommand, HEX);
-        Serial.print("_");
-        Serial.println(extData, HEX);
+        serialText.print("_");
+        serialText.print(extCommand, HEX);
+        serialText.print("_");
+        serialText.println(extData, HEX);
     }
   }
   if(remainingBits)
   {
     printX10TypeHouseUnit(type, house, unit, command);
-    Serial.print("_ErrorBitCount=");
-    Serial.println(remainingBits, DEC);
+    serialText.print("_ErrorBitCount=");
+    serialText.println(remainingBits, DEC);
   }
 }
 
@@ -1083,13 +1861,13 @@ void printDebugX10Brightness(const char source[], byte extData)
 {
   if(extData > 0)
   {
-    Serial.print(source);
-    Serial.print("_");
-    Serial.println(x10ex.x10BrightnessToPercent(extData), DEC);
+    serialText.print(source);
+    serialText.print("_");
+    serialText.println(x10ex.x10BrightnessToPercent(extData), DEC);
   }
   else
   {
-    Serial.println();
+    serialText.println();
   }
 }
 
@@ -26,6 +26,7 @@
 #define POWER_LINE_MSG "PL:"
 #define POWER_LINE_BUFFER_ERROR "PL:_ExBuffer"
 #define RADIO_FREQ_MSG "RF:"
+#define RADIO_SECURITY_MSG "RS:"
 #define INFRARED_MSG "IR:"
 #define SERIAL_DATA_MSG "SD:"
 #define SERIAL_DATA_THRESHOLD 1000
@@ -55,7 +56,8 @@ X10ex x10ex = X10ex(
 X10rf x10rf = X10rf(
   0, // Receive Interrupt Number (0 = Standard Arduino External Interrupt)
   2, // Receive Interrupt Pin (Pin 2 must be used with interrupt 0)
-  radioFreqEvent // Event triggered when RF message is received
+  radioFreqEvent, // Event triggered when RF message is received
+  radioSecurityEvent // Event triggered when RF security message is received
 );
 // X10 Infrared Receiver Library
 X10ir x10ir = X10ir(
@@ -78,7 +80,11 @@ void setup()
 }
 
 void loop()
-{ }
+{
+  // Pass buffered RF and IR events on to the callbacks
+  x10rf.poll();
+  x10ir.poll();
+}
 
 // Process messages received from X10 modules over the power line
 void powerLineEvent(char house, byte unit, byte command, byte extData, byte extCommand, byte remainingBits)
@@ -107,6 +113,21 @@ void radioFreqEvent(char house, byte unit, byte command, bool isRepeat)
   }
 }
 
+// Process events received from X10 compatible RF security sensors (door/window, motion, e.g.)
+void radioSecurityEvent(uint16_t sensorId, byte data, bool isAlert, bool isLowBattery, bool isTamper)
+{
+  Serial.print(RADIO_SECURITY_MSG);
+  Serial.print(sensorId, HEX);
+  printX10ByteAsHex(data);
+  Serial.println();
+  //////////////////////////////
+  // Sample Code
+  // Replace with your own setup
+  //////////////////////////////
+  // Track sensor state using house code P, and the last 4 bits of the sensor id as unit code
+  x10ex.setSensorState('P', (sensorId & 0xF) + 1, isAlert);
+}
+
 // Process commands received from X10 compatible IR remote
 void infraredEvent(char house, byte unit, byte command, bool isRepeat)
 {
@@ -520,76 +541,85 @@ bool handleOldLampModuleState(char house, byte unit, byte command, bool isRepeat
 
 bool sendAllLightsOn()
 {
-  return
-    // Bedroom
-    x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1) ||
-    // Livingroom table
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    // Hall
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    // Livingroom couch
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    // Kitchen
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1) ||
-    // Livingroom shelves
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  // Scenario is sent as a whole or not at all
+  if(x10ex.beginBatch(6)) return 1;
+  // Bedroom
+  x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1);
+  // Livingroom table
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  // Hall
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  // Livingroom couch
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  // Kitchen
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  // Livingroom shelves
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendAllLightsOff()
 {
-  return
-    x10ex.sendCmd('A', 7, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(6)) return 1;
+  x10ex.sendCmd('A', 7, CMD_OFF, 1);
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOn()
 {
-  return
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOff()
 {
-  return
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOn()
 {
-  return
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOff()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomTvScenario()
 {
-  return
-    x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomMovieScenario()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 #if DEBUG
@@ -349,74 +349,83 @@ void handleSdScenario(byte scenario)
 
 bool sendAllLightsOn()
 {
-  return
-    // Bedroom
-    x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1) ||
-    // Livingroom table
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    // Hall
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    // Livingroom couch
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    // Kitchen
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1) ||
-    // Livingroom shelves
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  // Scenario is sent as a whole or not at all
+  if(x10ex.beginBatch(6)) return 1;
+  // Bedroom
+  x10ex.sendExtDim('A', 7, 80, EXC_DIM_TIME_4, 1);
+  // Livingroom table
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  // Hall
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  // Livingroom couch
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  // Kitchen
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  // Livingroom shelves
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendAllLightsOff()
 {
-  return
-    x10ex.sendCmd('A', 7, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(6)) return 1;
+  x10ex.sendCmd('A', 7, CMD_OFF, 1);
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOn()
 {
-  return
-    x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendExtDim('A', 8, 75, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 9, 100, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendHallAndKitchenOff()
 {
-  return
-    x10ex.sendCmd('A', 8, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  if(x10ex.beginBatch(2)) return 1;
+  x10ex.sendCmd('A', 8, CMD_OFF, 1);
+  x10ex.sendCmd('A', 9, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOn()
 {
-  return
-    x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 70, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 90, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 40, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomOff()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendCmd('A', 4, CMD_OFF, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomTvScenario()
 {
-  return
-    x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendExtDim('A', 2, 40, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 3, 30, EXC_DIM_TIME_4, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
 
 bool sendLivingRoomMovieScenario()
 {
-  return
-    x10ex.sendCmd('A', 2, CMD_OFF, 1) ||
-    x10ex.sendCmd('A', 3, CMD_OFF, 1) ||
-    x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  if(x10ex.beginBatch(3)) return 1;
+  x10ex.sendCmd('A', 2, CMD_OFF, 1);
+  x10ex.sendCmd('A', 3, CMD_OFF, 1);
+  x10ex.sendExtDim('A', 4, 25, EXC_DIM_TIME_4, 1);
+  return x10ex.endBatch();
 }
@@ -0,0 +1,218 @@
+/************************************************************************/
+/* X10 PLC admission control library, fair power line sharing, v1.6.    */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10admission.h"
+
+X10admission::X10admission(X10ex *x10ex)
+{
+  this->x10ex = x10ex;
+  memset(sources, 0, sizeof(sources));
+  for(uint8_t ix = 0; ix < X10_ADMISSION_SOURCES; ix++)
+  {
+    setRate(ix, X10_ADMISSION_BURST, X10_ADMISSION_REFILL_MS);
+  }
+  currentIx = 0;
+  isQuantumAdded = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Sets token bucket of source, the bucket starts out full. Refill period 0
+// turns rate limiting off for the source (the queue still limits bursts).
+void X10admission::setRate(uint8_t source, uint8_t burst, uint16_t refillMs)
+{
+  if(source >= X10_ADMISSION_SOURCES) return;
+  X10source &src = sources[source];
+  src.burst = burst;
+  src.tokens = burst;
+  src.refillMs = refillMs;
+  src.refilledMs = millis();
+}
+
+bool X10admission::sendAddress(uint8_t source, uint8_t house, uint8_t unit, uint8_t repetitions)
+{
+  // See X10ex sendAddress
+  return sendCmd(source, house, unit, CMD_STATUS_REQUEST, repetitions);
+}
+
+bool X10admission::sendCmd(uint8_t source, uint8_t house, uint8_t command, uint8_t repetitions)
+{
+  return sendCmd(source, house, 0, command, repetitions);
+}
+
+bool X10admission::sendCmd(uint8_t source, uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions)
+{
+  return sendExt(source, house, unit, command, 0, 0, repetitions);
+}
+
+bool X10admission::sendExtDim(uint8_t source, uint8_t house, uint8_t unit, uint8_t percent, uint8_t time, uint8_t repetitions)
+{
+  if(percent == 0)
+  {
+    return sendExt(source, house, unit, CMD_OFF, 0, 0, repetitions);
+  }
+  return sendExt(
+    source, house, unit, CMD_EXTENDED_CODE,
+    x10ex->percentToX10Brightness(percent, time), EXC_PRE_SET_DIM,
+    repetitions);
+}
+
+// Queues message, returns true when input is invalid, or when message was
+// rejected because source has no tokens left or its queue is full
+bool X10admission::sendExt(
+  uint8_t source, uint8_t house, uint8_t unit, uint8_t command,
+  uint8_t extData, uint8_t extCommand, uint8_t repetitions)
+{
+  // Validate input, invalid messages don't use tokens
+  if(source >= X10_ADMISSION_SOURCES || x10parseHouse(house) > 0xF || unit > 16)
+  {
+    return 1;
+  }
+  X10source &src = sources[source];
+  refill(src);
+  if(!src.tokens)
+  {
+    src.stats.limited++;
+    return 1;
+  }
+  if(src.queueCount >= X10_ADMISSION_QUEUE_SIZE)
+  {
+    src.stats.overflows++;
+    return 1;
+  }
+  src.tokens--;
+  X10queuedMsg &msg = src.queue[(src.queueStart + src.queueCount) % X10_ADMISSION_QUEUE_SIZE];
+  msg.house = house;
+  msg.unit = unit;
+  msg.command = command;
+  msg.extData = extData;
+  msg.extCommand = extCommand;
+  msg.repetitions = repetitions;
+  src.queueCount++;
+  src.stats.accepted++;
+  return 0;
+}
+
+// Returns number of messages source can send before messages are rejected
+uint8_t X10admission::getCredits(uint8_t source)
+{
+  if(source >= X10_ADMISSION_SOURCES) return 0;
+  X10source &src = sources[source];
+  refill(src);
+  uint8_t queueFree = X10_ADMISSION_QUEUE_SIZE - src.queueCount;
+  return src.tokens < queueFree ? src.tokens : queueFree;
+}
+
+uint8_t X10admission::getQueuedCount(uint8_t source)
+{
+  return source < X10_ADMISSION_SOURCES ? sources[source].queueCount : 0;
+}
+
+X10admissionStats X10admission::getStats(uint8_t source)
+{
+  if(source >= X10_ADMISSION_SOURCES) return (X10admissionStats) { 0, 0, 0, 0 };
+  return sources[source].stats;
+}
+
+// Moves queued messages to the X10ex send buffer, call from loop. Sources are
+// visited round robin; each visit adds a quantum to the source's deficit, and
+// messages are moved while their cost fits in the deficit.
+void X10admission::poll()
+{
+  uint8_t visited = 0;
+  while(visited < X10_ADMISSION_SOURCES && x10ex->getBufferedCount() <= X10_ADMISSION_MAX_BUFFERED)
+  {
+    X10source &src = sources[currentIx];
+    // Idle sources don't save up deficit
+    if(!src.queueCount)
+    {
+      src.deficit = 0;
+      nextSource();
+      visited++;
+      continue;
+    }
+    if(!isQuantumAdded)
+    {
+      src.deficit += X10_ADMISSION_QUANTUM;
+      isQuantumAdded = 1;
+    }
+    X10queuedMsg &msg = src.queue[src.queueStart];
+    uint16_t msgCost = cost(msg);
+    if(msgCost > src.deficit)
+    {
+      nextSource();
+      visited++;
+      continue;
+    }
+    // Send buffer is full: try again on next poll
+    if(x10ex->sendExt(msg.house, msg.unit, msg.command, msg.extData, msg.extCommand, msg.repetitions))
+    {
+      return;
+    }
+    src.deficit -= msgCost;
+    src.queueStart = (src.queueStart + 1) % X10_ADMISSION_QUEUE_SIZE;
+    src.queueCount--;
+    src.stats.sent++;
+    visited = 0;
+  }
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+void X10admission::refill(X10source &source)
+{
+  if(!source.refillMs)
+  {
+    source.tokens = source.burst;
+    return;
+  }
+  uint32_t elapsedMs = millis() - source.refilledMs;
+  if(elapsedMs < source.refillMs) return;
+  uint32_t added = elapsedMs / source.refillMs;
+  source.refilledMs += added * source.refillMs;
+  // Full bucket: tokens are not saved up while source is idle
+  if(added >= (uint8_t)(source.burst - source.tokens))
+  {
+    source.tokens = source.burst;
+    source.refilledMs = millis();
+  }
+  else
+  {
+    source.tokens += added;
+  }
+}
+
+// Returns power line cycles used by message
+uint16_t X10admission::cost(const X10queuedMsg &msg)
+{
+  uint16_t cycles =
+    msg.command == CMD_EXTENDED_CODE || msg.command == CMD_EXTENDED_DATA ?
+    X10_ADMISSION_EXT_CYCLES : X10_ADMISSION_STD_CYCLES;
+  return cycles * (msg.repetitions ? msg.repetitions : 1);
+}
+
+void X10admission::nextSource()
+{
+  currentIx = (currentIx + 1) % X10_ADMISSION_SOURCES;
+  isQuantumAdded = 0;
+}
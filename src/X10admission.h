@@ -0,0 +1,120 @@
+/************************************************************************/
+/* X10 PLC admission control library, fair power line sharing, v1.6.    */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10admission_h
+#define X10admission_h
+
+#include "Arduino.h"
+#include "X10ex.h"
+
+// Number of message sources, e.g. network clients, serial host, RF and IR
+#define X10_ADMISSION_SOURCES          4
+// Messages queued per source. Each queued message uses 6 bytes of memory
+#define X10_ADMISSION_QUEUE_SIZE       4
+// Default token bucket: each source may send a burst of this many messages,
+// and then one message per refill period
+#define X10_ADMISSION_BURST            4
+#define X10_ADMISSION_REFILL_MS     1000
+// Messages are moved to the X10ex send buffer when it holds no more than this
+// number of messages, so that the order messages are sent in is decided here
+#define X10_ADMISSION_MAX_BUFFERED     1
+// Deficit round robin quantum, in power line cycles. Sending a message costs
+// the cycles it uses (including silence after it) times its repetitions.
+#define X10_ADMISSION_QUANTUM         34
+#define X10_ADMISSION_STD_CYCLES      14
+#define X10_ADMISSION_EXT_CYCLES      34
+
+// Sources used by the examples, any source number below X10_ADMISSION_SOURCES
+// can be used
+#define X10_ADMISSION_SOURCE_NETWORK   0
+#define X10_ADMISSION_SOURCE_SERIAL    1
+#define X10_ADMISSION_SOURCE_RF        2
+#define X10_ADMISSION_SOURCE_IR        3
+
+// Per source counters, they wrap around
+struct X10admissionStats
+{
+  uint16_t accepted;    // Messages queued
+  uint16_t limited;     // Messages rejected because source had no tokens left
+  uint16_t overflows;   // Messages rejected because source queue was full
+  uint16_t sent;        // Messages moved to the X10ex send buffer
+};
+
+// Shares the power line fairly between message sources. Each source has its
+// own token bucket and queue, so one client sending commands in a loop only
+// fills its own queue, and messages from other sources are still accepted.
+// Queued messages are moved to the X10ex send buffer using deficit round
+// robin, so each source gets an equal share of power line cycles, whether it
+// sends standard or extended messages:
+//
+// if(x10admission.sendCmd(X10_ADMISSION_SOURCE_NETWORK, 'A', 3, CMD_ON, 1)) ... // Rejected
+//
+// getCredits returns how many messages a source can send right now, so that
+// front ends can tell clients to back off before messages are rejected.
+// Call poll from loop; methods are not interrupt safe, so don't send from the
+// X10ex receive callback. Each message uses a token, so repeats of a held RF or
+// IR bright/dim button should be sent straight to X10ex, which resets the
+// repetitions of the message it is sending instead of buffering the repeat.
+class X10admission
+{
+
+  public:
+    X10admission(X10ex *x10ex);
+    // Public methods
+    void setRate(uint8_t source, uint8_t burst, uint16_t refillMs);
+    bool sendAddress(uint8_t source, uint8_t house, uint8_t unit, uint8_t repetitions);
+    bool sendCmd(uint8_t source, uint8_t house, uint8_t command, uint8_t repetitions);
+    bool sendCmd(uint8_t source, uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions);
+    bool sendExtDim(uint8_t source, uint8_t house, uint8_t unit, uint8_t percent, uint8_t time, uint8_t repetitions);
+    bool sendExt(
+      uint8_t source, uint8_t house, uint8_t unit, uint8_t command,
+      uint8_t extData, uint8_t extCommand, uint8_t repetitions);
+    uint8_t getCredits(uint8_t source);
+    uint8_t getQueuedCount(uint8_t source);
+    X10admissionStats getStats(uint8_t source);
+    void poll();
+
+  private:
+    struct X10queuedMsg
+    {
+      uint8_t house, unit, command, extData, extCommand, repetitions;
+    };
+    struct X10source
+    {
+      X10queuedMsg queue[X10_ADMISSION_QUEUE_SIZE];
+      uint8_t queueStart, queueCount;
+      uint8_t tokens, burst;
+      uint16_t refillMs;
+      uint32_t refilledMs;
+      uint16_t deficit;
+      X10admissionStats stats;
+    };
+    // Set in constructor
+    X10ex *x10ex;
+    X10source sources[X10_ADMISSION_SOURCES];
+    // Deficit round robin fields
+    uint8_t currentIx;
+    bool isQuantumAdded;
+    // Private methods
+    void refill(X10source &source);
+    uint16_t cost(const X10queuedMsg &msg);
+    void nextSource();
+};
+
+#endif
@@ -0,0 +1,181 @@
+/************************************************************************/
+/* X10 RF and IR edge capture library, v1.6.                            */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10capture.h"
+#include "X10ex.h"
+
+#if X10_CAPTURE_TIMER
+  #if !defined(__AVR_ATmega1280__) && !defined(__AVR_ATmega2560__)
+    #error "X10_CAPTURE_TIMER requires an ATmega1280 or ATmega2560 (Timer4 or Timer5)"
+  #elif X10_CAPTURE_TIMER == 4 && X10_MAX_INTERFACES > 2
+    #error "X10_CAPTURE_TIMER 4 is used by the third power line interface, see X10_MAX_INTERFACES"
+  #elif X10_CAPTURE_TIMER == 5 && X10_MAX_INTERFACES > 3
+    #error "X10_CAPTURE_TIMER 5 is used by the fourth power line interface, see X10_MAX_INTERFACES"
+  #endif
+#endif
+
+#if X10_CAPTURE_TIMER == 4
+  #define X10_CAPTURE_PIN       49
+  #define X10_CAPTURE_TCCRA     TCCR4A
+  #define X10_CAPTURE_TCCRB     TCCR4B
+  #define X10_CAPTURE_TIMSK     TIMSK4
+  #define X10_CAPTURE_TIFR      TIFR4
+  #define X10_CAPTURE_ICR       ICR4
+  #define X10_CAPTURE_ICNC      ICNC4
+  #define X10_CAPTURE_ICES      ICES4
+  #define X10_CAPTURE_ICIE      ICIE4
+  #define X10_CAPTURE_TOIE      TOIE4
+  #define X10_CAPTURE_ICF       ICF4
+  #define X10_CAPTURE_TOV       TOV4
+  #define X10_CAPTURE_CS0       CS40
+  #define X10_CAPTURE_CS1       CS41
+  #define X10_CAPTURE_CAPT_vect TIMER4_CAPT_vect
+  #define X10_CAPTURE_OVF_vect  TIMER4_OVF_vect
+#elif X10_CAPTURE_TIMER == 5
+  #define X10_CAPTURE_PIN       48
+  #define X10_CAPTURE_TCCRA     TCCR5A
+  #define X10_CAPTURE_TCCRB     TCCR5B
+  #define X10_CAPTURE_TIMSK     TIMSK5
+  #define X10_CAPTURE_TIFR      TIFR5
+  #define X10_CAPTURE_ICR       ICR5
+  #define X10_CAPTURE_ICNC      ICNC5
+  #define X10_CAPTURE_ICES      ICES5
+  #define X10_CAPTURE_ICIE      ICIE5
+  #define X10_CAPTURE_TOIE      TOIE5
+  #define X10_CAPTURE_ICF       ICF5
+  #define X10_CAPTURE_TOV       TOV5
+  #define X10_CAPTURE_CS0       CS50
+  #define X10_CAPTURE_CS1       CS51
+  #define X10_CAPTURE_CAPT_vect TIMER5_CAPT_vect
+  #define X10_CAPTURE_OVF_vect  TIMER5_OVF_vect
+#endif
+
+#if X10_CAPTURE_TIMER
+X10capture *x10capture = NULL;
+
+ISR(X10_CAPTURE_CAPT_vect)
+{
+  uint16_t ticks = X10_CAPTURE_ICR;
+  bool rising = X10_CAPTURE_TCCRB & _BV(X10_CAPTURE_ICES);
+  // Capture the opposite edge next, changing edge may set the capture flag
+  X10_CAPTURE_TCCRB ^= _BV(X10_CAPTURE_ICES);
+  X10_CAPTURE_TIFR = _BV(X10_CAPTURE_ICF);
+  // Timer wrapped before edge was captured, but overflow interrupt has not run yet
+  if(X10_CAPTURE_TIFR & _BV(X10_CAPTURE_TOV) && ticks < 0x8000)
+  {
+    X10_CAPTURE_TIFR = _BV(X10_CAPTURE_TOV);
+    x10capture->timerOverflow();
+  }
+  x10capture->capture(ticks, rising);
+}
+
+ISR(X10_CAPTURE_OVF_vect)
+{
+  x10capture->timerOverflow();
+}
+#endif
+
+X10capture::X10capture()
+{
+  edgeBfStart = 0;
+  edgeBfEnd = 0;
+  lastTicks = 0;
+  idleOverflows = 0;
+  overflowCount = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Returns true when edge capture is not supported (X10_CAPTURE_TIMER is 0)
+bool X10capture::begin()
+{
+#if X10_CAPTURE_TIMER
+  pinMode(X10_CAPTURE_PIN, INPUT);
+  x10capture = this;
+  uint8_t sreg = SREG;
+  cli();
+  // Normal mode with noise canceler and prescaler 64, first edge captured is
+  // the opposite of the current level
+  X10_CAPTURE_TCCRA = 0;
+  X10_CAPTURE_TCCRB =
+    _BV(X10_CAPTURE_ICNC) | _BV(X10_CAPTURE_CS1) | _BV(X10_CAPTURE_CS0) |
+    (digitalRead(X10_CAPTURE_PIN) ? 0 : _BV(X10_CAPTURE_ICES));
+  X10_CAPTURE_TIFR = _BV(X10_CAPTURE_ICF) | _BV(X10_CAPTURE_TOV);
+  X10_CAPTURE_TIMSK = _BV(X10_CAPTURE_ICIE) | _BV(X10_CAPTURE_TOIE);
+  SREG = sreg;
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+// Reads the oldest buffered edge: the level that ended and how long it lasted
+// Returns false when no edges are buffered
+bool X10capture::read(bool &level, uint16_t &lengthUs)
+{
+  if(edgeBfStart == edgeBfEnd) return 0;
+  uint16_t edge = edgeBf[edgeBfStart];
+  edgeBfStart = (edgeBfStart + 1) & (X10_CAPTURE_BUFFER_SIZE - 1);
+  level = edge >> 15;
+  uint32_t us = (uint32_t)(edge & 0x7FFF) * X10_CAPTURE_US_PER_TICK;
+  lengthUs = us > 0xFFFF ? 0xFFFF : us;
+  return 1;
+}
+
+// Returns number of edges dropped because the buffer was full
+uint16_t X10capture::getOverflowCount()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t count = overflowCount;
+  SREG = sreg;
+  return count;
+}
+
+//////////////////////////////
+/// Public (Interrupt Methods)
+//////////////////////////////
+
+void X10capture::capture(uint16_t ticks, bool rising)
+{
+  uint16_t length = ticks - lastTicks;
+  // Timer wrapped more than once or length doesn't fit in buffer: use max length
+  if(idleOverflows > 1 || (idleOverflows && ticks >= lastTicks) || length > 0x7FFF)
+  {
+    length = 0x7FFF;
+  }
+  lastTicks = ticks;
+  idleOverflows = 0;
+  uint8_t next = (edgeBfEnd + 1) & (X10_CAPTURE_BUFFER_SIZE - 1);
+  if(next == edgeBfStart)
+  {
+    if(overflowCount < 0xFFFF) overflowCount++;
+    return;
+  }
+  // Level that ended is low when edge is rising
+  edgeBf[edgeBfEnd] = length | (rising ? 0 : 0x8000);
+  edgeBfEnd = next;
+}
+
+void X10capture::timerOverflow()
+{
+  if(idleOverflows < 2) idleOverflows++;
+}
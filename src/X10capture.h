@@ -0,0 +1,68 @@
+/************************************************************************/
+/* X10 RF and IR edge capture library, v1.6.                            */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10capture_h
+#define X10capture_h
+
+#include "Arduino.h"
+
+// 16 bit timer used to timestamp RF or IR receive edges in hardware (input
+// capture). The timestamp is latched when the edge occurs, so pulse lengths
+// are not skewed when the capture interrupt is delayed by other interrupts,
+// e.g. the X10ex IO timer while transmitting on the power line.
+// Set to 0: Disabled, RF and IR receivers measure pulses using micros().
+// Set to 4: Timer4, receiver must be connected to ICP4 (Mega pin 49).
+// Set to 5: Timer5, receiver must be connected to ICP5 (Mega pin 48).
+// Only the ATmega1280/2560 is supported, on the ATmega328 the only input
+// capture unit belongs to Timer1, which is used by X10ex. The timer can't
+// be used by a power line interface (see X10_MAX_INTERFACES in X10ex.h),
+// nor by other libraries (e.g. Servo uses Timer5 on the Mega).
+#define X10_CAPTURE_TIMER         0
+// Set buffer size to the number of edges you would like to buffer. A
+// standard RF message is 66 edges, so the default holds a whole message
+// with room to spare when loop is slow. A buffered edge uses 2 bytes of
+// memory. Must be a power of two, 128 at most.
+#define X10_CAPTURE_BUFFER_SIZE 128
+// Timer is run with a prescaler of 64 (4us per tick at 16MHz)
+#define X10_CAPTURE_US_PER_TICK (64000000UL / F_CPU)
+
+class X10capture
+{
+
+  public:
+    X10capture();
+    // Public methods
+    bool begin();
+    bool read(bool &level, uint16_t &lengthUs);
+    uint16_t getOverflowCount();
+    // Public methods (called from interrupt)
+    void capture(uint16_t ticks, bool rising);
+    void timerOverflow();
+
+  private:
+    // Edge buffer: bit 16 is the level that ended, bits 1-15 its length in ticks
+    uint16_t volatile edgeBf[X10_CAPTURE_BUFFER_SIZE];
+    uint8_t volatile edgeBfStart, edgeBfEnd;
+    uint16_t volatile overflowCount;
+    // Used by interrupt triggered methods
+    uint16_t lastTicks;
+    uint8_t idleOverflows;
+};
+
+#endif
@@ -0,0 +1,34 @@
+/************************************************************************/
+/* X10 house and unit code encode and decode helpers, v1.6.             */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10codec.h"
+
+#define X10_CODEC_ROW(f, i) f(i), f(i + 1), f(i + 2), f(i + 3)
+
+const uint8_t x10encodeTable[16] PROGMEM =
+{
+  X10_CODEC_ROW(x10encodeConst, 0), X10_CODEC_ROW(x10encodeConst, 4),
+  X10_CODEC_ROW(x10encodeConst, 8), X10_CODEC_ROW(x10encodeConst, 12),
+};
+
+const uint8_t x10decodeTable[16] PROGMEM =
+{
+  X10_CODEC_ROW(x10decodeConst, 0), X10_CODEC_ROW(x10decodeConst, 4),
+  X10_CODEC_ROW(x10decodeConst, 8), X10_CODEC_ROW(x10decodeConst, 12),
+};
@@ -0,0 +1,86 @@
+/************************************************************************/
+/* X10 house and unit code encode and decode helpers, v1.6.             */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10codec_h
+#define X10codec_h
+
+#include "Arduino.h"
+#include "avr/pgmspace.h"
+
+// House codes A-P and unit codes 1-16 share the same 4 bit codes, the code of
+// index N (house 'A' + N or unit N + 1) is nibble N of this constant:
+// B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
+// B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100
+#define X10_CODEC_CODES 0xC480B3F7D591A2E6ULL
+
+// Compile time encode and decode, used to generate the lookup tables
+constexpr uint8_t x10encodeConst(uint8_t index)
+{
+  return X10_CODEC_CODES >> (index << 2) & 0xF;
+}
+
+constexpr uint8_t x10decodeConst(uint8_t code, uint8_t index = 0)
+{
+  return index > 0xF || x10encodeConst(index) == code ? index : x10decodeConst(code, index + 1);
+}
+
+constexpr bool x10codecIsValid(uint8_t index = 0)
+{
+  return index > 0xF || (x10decodeConst(x10encodeConst(index)) == index && x10codecIsValid(index + 1));
+}
+
+static_assert(x10codecIsValid(), "X10_CODEC_CODES must map every code to exactly one index");
+
+// Lookup tables generated at compile time, defined in X10codec.cpp so that
+// there is one copy in flash, not one per file including this header
+extern const uint8_t x10encodeTable[16] PROGMEM;
+extern const uint8_t x10decodeTable[16] PROGMEM;
+
+// Returns the 4 bit code of house (0-15) or unit (0-15)
+static inline uint8_t x10encode(uint8_t index)
+{
+  return pgm_read_byte(&x10encodeTable[index & 0xF]);
+}
+
+// Returns the house (0-15) or unit (0-15) of a 4 bit code
+static inline uint8_t x10decode(uint8_t code)
+{
+  return pgm_read_byte(&x10decodeTable[code & 0xF]);
+}
+
+// Returns house 'A'-'P', 'a'-'p' or 0-15 as 0-15, invalid houses are > 15
+static inline uint8_t x10parseHouse(uint8_t house)
+{
+  return house - (house <= 0xF ? 0 : house >= 0x61 ? 0x61 : 0x41);
+}
+
+// Returns the 4 least significant bits in reverse order
+static inline uint8_t x10reverseNibble(uint8_t data)
+{
+  return (data & B0001) << 3 | (data & B0010) << 1 | (data & B0100) >> 1 | (data & B1000) >> 3;
+}
+
+static inline uint8_t x10reverseByte(uint8_t data)
+{
+  data = data >> 4 | data << 4;
+  data = (data & B11001100) >> 2 | (data & B00110011) << 2;
+  return (data & B10101010) >> 1 | (data & B01010101) << 1;
+}
+
+#endif
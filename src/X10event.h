@@ -0,0 +1,102 @@
+/************************************************************************/
+/* X10 RF and IR event buffer library, v1.6.                            */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10event_h
+#define X10event_h
+
+#include "Arduino.h"
+
+// Keeps the compiler from moving buffer reads and writes past index updates
+#define X10_EVENT_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+// Received command, passed on to the receive callback when poll is called
+struct X10event
+{
+  char house;
+  uint8_t unit;
+  uint8_t command;
+  bool isRepeat;    // Event is a repeat of an event already passed on
+  uint8_t repeats;  // Number of repeats received before event was passed on
+  uint32_t ms;      // Time event was received (millis)
+};
+
+// Event buffer written from interrupt (single producer) and read from loop
+// (single consumer) without disabling interrupts. A repeat is collapsed into
+// the last buffered event when it's the same command, but only if that event
+// isn't the next one to be read. Size must be a power of two.
+template<class E, uint8_t SIZE> class X10eventBuffer
+{
+
+  public:
+    X10eventBuffer()
+    {
+      bfStart = 0;
+      bfEnd = 0;
+      overflowCount = 0;
+    }
+    // Public methods
+    // Reads the oldest buffered event, returns false when buffer is empty
+    bool read(E &event)
+    {
+      if(bfStart == bfEnd) return 0;
+      X10_EVENT_BARRIER();
+      event = bf[bfStart];
+      X10_EVENT_BARRIER();
+      bfStart = (bfStart + 1) & (SIZE - 1);
+      return 1;
+    }
+    // Returns number of events dropped because the buffer was full
+    uint16_t getOverflowCount()
+    {
+      uint8_t sreg = SREG;
+      cli();
+      uint16_t count = overflowCount;
+      SREG = sreg;
+      return count;
+    }
+    // Public methods (called from interrupt)
+    void write(const E &event)
+    {
+      if(event.isRepeat && ((bfEnd - bfStart) & (SIZE - 1)) > 1)
+      {
+        E &last = bf[(bfEnd - 1) & (SIZE - 1)];
+        if(last.house == event.house && last.unit == event.unit && last.command == event.command)
+        {
+          if(last.repeats < 0xFF) last.repeats++;
+          return;
+        }
+      }
+      uint8_t next = (bfEnd + 1) & (SIZE - 1);
+      if(next == bfStart)
+      {
+        if(overflowCount < 0xFFFF) overflowCount++;
+        return;
+      }
+      bf[bfEnd] = event;
+      X10_EVENT_BARRIER();
+      bfEnd = next;
+    }
+
+  private:
+    E bf[SIZE];
+    uint8_t volatile bfStart, bfEnd;
+    uint16_t volatile overflowCount;
+};
+
+#endif
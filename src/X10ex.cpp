@@ -19,46 +19,92 @@
 
 #include "X10ex.h"
 
-const uint8_t X10ex::HOUSE_CODE[16] =
-{
-  B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
-  B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100,
-};
-const uint8_t X10ex::UNIT_CODE[16] =
-{
-  B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
-  B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100,
-};
+#if X10_MAX_INTERFACES > 1 && !defined(__AVR_ATmega1280__) && !defined(__AVR_ATmega2560__)
+  #error "X10_MAX_INTERFACES > 1 requires an ATmega1280 or ATmega2560 (Timer3, Timer4 and Timer5)"
+#endif
 
-X10ex *x10exInstance = NULL;
+// One instance per IO timer, indexed by timer (0 = Timer1, 1 = Timer3, 2 = Timer4, 3 = Timer5)
+X10ex *x10exInstance[X10_MAX_INTERFACES];
+// Send buffers of instances created by the public constructor, indexed by timer
+X10msg volatile x10exSendBf[X10_MAX_INTERFACES][X10_BUFFER_SIZE];
+uint16_t volatile X10ex::stateVersion;
+#if X10_MODULE_VERSIONS >= 2
+uint16_t volatile X10ex::moduleVersion[256];
+#elif X10_MODULE_VERSIONS
+uint16_t volatile X10ex::moduleVersion[16];
+#endif
 
-void x10exZeroCross_wrapper()
+// Zero cross interrupt wrappers are generated at compile time, one per interface
+template<uint8_t ix> void x10exZeroCross_wrapper()
 {
-  if(x10exInstance) x10exInstance->zeroCross();
+  if(x10exInstance[ix]) x10exInstance[ix]->zeroCross();
 }
 
+typedef void (*x10exWrapper_t)();
+const x10exWrapper_t x10exZeroCross_wrappers[X10_MAX_INTERFACES] =
+{
+  x10exZeroCross_wrapper<0>,
+#if X10_MAX_INTERFACES > 1
+  x10exZeroCross_wrapper<1>,
+#endif
+#if X10_MAX_INTERFACES > 2
+  x10exZeroCross_wrapper<2>,
+#endif
+#if X10_MAX_INTERFACES > 3
+  x10exZeroCross_wrapper<3>,
+#endif
+};
+
 // Hack to get extra interrupt on non ATmega8, 168 and 328 pin 4 to 7
 #if defined(__AVR_ATmega8__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__)
 SIGNAL(PCINT2_vect)
 {
-  if(x10exInstance) x10exInstance->zeroCross();
+  if(x10exInstance[0]) x10exInstance[0]->zeroCross();
 }
 #endif
 
-void x10exIoTimer_wrapper()
+ISR(TIMER1_OVF_vect)
 {
-  if(x10exInstance) x10exInstance->ioTimer();
+  if(x10exInstance[0]) x10exInstance[0]->ioTimer();
 }
 
-ISR(TIMER1_OVF_vect)
+#if X10_MAX_INTERFACES > 1
+ISR(TIMER3_OVF_vect)
+{
+  if(x10exInstance[1]) x10exInstance[1]->ioTimer();
+}
+#endif
+
+#if X10_MAX_INTERFACES > 2
+ISR(TIMER4_OVF_vect)
 {
-  x10exIoTimer_wrapper();
+  if(x10exInstance[2]) x10exInstance[2]->ioTimer();
+}
+#endif
+
+#if X10_MAX_INTERFACES > 3
+ISR(TIMER5_OVF_vect)
+{
+  if(x10exInstance[3]) x10exInstance[3]->ioTimer();
+}
+#endif
+
+X10ex::X10ex(
+  uint8_t zeroCrossInt, uint8_t zeroCrossPin, uint8_t transmitPin,
+  uint8_t receivePin, bool receiveTransmits, plcReceiveCallback_t plcReceiveCallback,
+  uint8_t phases, uint8_t sineWaveHz, uint8_t timer) :
+  X10ex(
+    zeroCrossInt, zeroCrossPin, transmitPin, receivePin, receiveTransmits, plcReceiveCallback,
+    phases, sineWaveHz, timer, NULL, X10_BUFFER_SIZE)
+{
+  if(timerIx != 0xFF) sendBf = x10exSendBf[timerIx];
 }
 
 X10ex::X10ex(
   uint8_t zeroCrossInt, uint8_t zeroCrossPin, uint8_t transmitPin,
   uint8_t receivePin, bool receiveTransmits, plcReceiveCallback_t plcReceiveCallback,
-  uint8_t phases, uint8_t sineWaveHz)
+  uint8_t phases, uint8_t sineWaveHz, uint8_t timer,
+  X10msg volatile *sendBf, uint8_t sendBfSize)
 {
   this->zeroCrossInt = zeroCrossInt;
   this->zeroCrossPin = zeroCrossPin;
@@ -72,17 +118,66 @@ X10ex::X10ex(
   this->plcReceiveCallback = plcReceiveCallback;
   // Setup IO fields
   ioStopState = phases * 2;
-  inputDelayCycles = round(.5 * F_CPU * X10_SAMPLE_DELAY / 1000000);
+  inputDelayCycles = X10_US_TO_CYCLES(X10_SAMPLE_DELAY);
   // Sine wave half cycle devided by number of phases
-  outputDelayCycles = round(.5 * F_CPU / phases / sineWaveHz / 2);
-  outputLengthCycles = round(.5 * F_CPU * X10_SIGNAL_LENGTH / 1000000);
+  uint16_t quarterCycles = 4 * phases * sineWaveHz;
+  outputDelayCycles = (F_CPU + quarterCycles / 2) / quarterCycles;
+  outputLengthCycles = X10_US_TO_CYCLES(X10_SIGNAL_LENGTH);
   // Init. misc fields
-  sendBfEnd = X10_BUFFER_SIZE - 1;
+  this->sendBf = sendBf;
+  this->sendBfSize = sendBfSize;
+  sendBfStart = 0;
+  sendBfEnd = 0;
+  sendBfBatchEnd = 0;
+  isBatching = 0;
+  batchError = 0;
+  sendBfLastMs = 0;
+  ioState = 0;
+  zcInput = 0;
+  zcOutput = 0;
+  zeroCount = 0;
+  sentCount = 0;
+  sendOffset = 0;
+  receivedDataBit = 0;
+  receivedCount = 0;
+  receivedBits = 0;
+  receiveBuffer = 0;
   rxHouse = DATA_UNKNOWN;
   rxUnit = DATA_UNKNOWN;
   rxExtUnit = DATA_UNKNOWN;
   rxCommand = DATA_UNKNOWN;
-  x10exInstance = this;
+  rxData = 0;
+  rxExtCommand = 0;
+  // Setup IO timer registers
+  timerIx = timer == 1 ? 0 : timer - 2;
+  switch(timer)
+  {
+    case 1:
+      tccrA = &TCCR1A; tccrB = &TCCR1B; timsk = &TIMSK1; icr = &ICR1; tcnt = &TCNT1;
+      break;
+#if X10_MAX_INTERFACES > 1
+    case 3:
+      tccrA = &TCCR3A; tccrB = &TCCR3B; timsk = &TIMSK3; icr = &ICR3; tcnt = &TCNT3;
+      break;
+#endif
+#if X10_MAX_INTERFACES > 2
+    case 4:
+      tccrA = &TCCR4A; tccrB = &TCCR4B; timsk = &TIMSK4; icr = &ICR4; tcnt = &TCNT4;
+      break;
+#endif
+#if X10_MAX_INTERFACES > 3
+    case 5:
+      tccrA = &TCCR5A; tccrB = &TCCR5B; timsk = &TIMSK5; icr = &ICR5; tcnt = &TCNT5;
+      break;
+#endif
+    // Timer not supported or not enabled: interface is not started by begin method,
+    // and a buffer of one slot is always full, so no messages are buffered
+    default:
+      timerIx = 0xFF;
+      this->sendBfSize = 1;
+      return;
+  }
+  x10exInstance[timerIx] = this;
 }
 
 //////////////////////////////
@@ -91,6 +186,7 @@ X10ex::X10ex(
 
 void X10ex::begin()
 {
+  if(timerIx == 0xFF) return;
   // Using arduino digitalWrite here ensures that pins are
   // set up correctly (pwm timers are turned off, etc).
 #if defined(ARDUINO) && ARDUINO >= 101
@@ -104,13 +200,13 @@ void X10ex::begin()
 #endif
   pinMode(transmitPin, OUTPUT);
   digitalWrite(transmitPin, LOW);
-  // Setup IO timer
-  TCCR1A = 0;
-  TCCR1B = _BV(WGM13) & ~(_BV(CS10) | _BV(CS11) | _BV(CS12));
-  TIMSK1 = _BV(TOIE1);
-  ICR1 = inputDelayCycles;
+  // Setup IO timer (register bits are identical for Timer1, 3, 4 and 5)
+  *tccrA = 0;
+  *tccrB = _BV(WGM13) & ~(_BV(CS10) | _BV(CS11) | _BV(CS12));
+  *timsk = _BV(TOIE1);
+  *icr = inputDelayCycles;
   // Attach zero cross interrupt
-  attachInterrupt(zeroCrossInt, x10exZeroCross_wrapper, CHANGE);
+  attachInterrupt(zeroCrossInt, x10exZeroCross_wrappers[timerIx], CHANGE);
   // Make sure interrupts are enabled
   sei();
   // Hack to get extra interrupt on non ATmega8, 168 and 328 pin 4 to 7
@@ -156,7 +252,7 @@ bool X10ex::sendDim(uint8_t house, uint8_t unit, uint8_t percent, uint8_t repeti
     return sendExt(
       house, unit, brightness >> 4 ? CMD_PRE_SET_DIM_1 : CMD_PRE_SET_DIM_0,
       // Reverse nibble before sending
-      (((brightness * 0x0802LU & 0x22110LU) | (brightness * 0x8020LU & 0x88440LU)) * 0x10101LU >> 20) & B1111, 0,
+      x10reverseNibble(brightness), 0,
       repetitions);
   }
 }
@@ -184,15 +280,20 @@ bool X10ex::sendExtDim(uint8_t house, uint8_t unit, uint8_t percent, uint8_t tim
 // Returns true when command was buffered successfully
 bool X10ex::sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand, uint8_t repetitions)
 {
-  house = parseHouseCode(house);
+  house = x10parseHouse(house);
   unit--;
+  // Messages sent from interrupts, e.g. the power line receive callback, are
+  // never part of a batch: errors don't drop the batch
+  bool isInterrupt = !(SREG & _BV(SREG_I));
+  bool isBatched = isBatching && !isInterrupt;
   // Validate input
   if(house > 0xF || (unit > 0xF && unit != 0xFF))
   {
+    batchError |= isBatched;
     return 1;
   }
   // Add house nibble (bit 32-29)
-  uint32_t message = (uint32_t)HOUSE_CODE[house] << 28;
+  uint32_t message = (uint32_t)x10encode(house) << 28;
   // No unit code X10 message
   if(unit == 0xFF)
   {
@@ -205,9 +306,9 @@ bool X10ex::sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extDat
   else if(command != CMD_EXTENDED_CODE && command != CMD_EXTENDED_DATA)
   {
     // If type is preset dim, send data; if not, repeat house code
-    uint8_t houseData = (command & B1110) == CMD_PRE_SET_DIM_0 ? extData : HOUSE_CODE[house];
+    uint8_t houseData = (command & B1110) == CMD_PRE_SET_DIM_0 ? extData : x10encode(house);
     message |=
-      (uint32_t)UNIT_CODE[unit] << 24 | // Add unit nibble (bit 28-25)
+      (uint32_t)x10encode(unit) << 24 | // Add unit nibble (bit 28-25)
       (uint16_t)houseData << 8 |        // Add house/data nibble (bit 12-9)
       (uint16_t)command << 4 |          // Add command nibble (bit 8-5)
       1 << 3 |                          // Set message type (bit 4) to 1 (command)
@@ -219,37 +320,107 @@ bool X10ex::sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extDat
     message |=
       (uint32_t)command << 24 |         // Add command nibble (bit 28-25)
       1LU << 23 |                       // Set message type (bit 24) to 1 (command)
-      (uint32_t)UNIT_CODE[unit] << 19 | // Add unit nibble (bit 23-20)
+      (uint32_t)x10encode(unit) << 19 | // Add unit nibble (bit 23-20)
       (uint32_t)extData << 11 |         // Set extended data byte (bit 19-12)
       (uint16_t)extCommand << 3 |       // Set extended command byte (bit 11-4)
       X10_MSG_EXT;                      // Set data type (bit 3-1)
   }
-  // Current command is buffered again
-  if(sendBf[sendBfStart].repetitions > 0 && sendBf[sendBfStart].message == message)
+  uint32_t ms = millis();
+  bool bufferError = 0;
+  // Messages can also be sent from the power line receive callback: the
+  // buffer is changed with interrupts disabled, so no message is half written
+  uint8_t sreg = SREG;
+  cli();
+  // Current command is buffered again (batches are always sent in order)
+  if(!isBatched && sendBfStart != sendBfEnd && sendBf[sendBfStart].message == message)
   {
     // Just reset repetitions
     sendBf[sendBfStart].repetitions = repetitions;
-    sendBfLastMs = millis();
-    return 0;
+    sendBfLastMs = ms;
+  }
+  // Open batch starts at end of buffer, so other messages from interrupts are
+  // rejected until it ends
+  else if(isBatching && isInterrupt)
+  {
+    bufferError = 1;
   }
-  // If slots are available in buffer
-  else if((sendBfEnd + 2) % X10_BUFFER_SIZE != sendBfStart)
+  else
   {
-    // Make sure identical message is not sent within rebuffer delay
-    if(sendBf[sendBfEnd].message != message || millis() > sendBfLastMs + X10_REBUFFER_DELAY || sendBfLastMs - 1 > millis())
+    uint8_t end = isBatched ? sendBfBatchEnd : sendBfEnd;
+    uint8_t next = end + 1 < sendBfSize ? end + 1 : 0;
+    // If slots are available in buffer
+    if(next != sendBfStart)
     {
-      sendBfEnd = (sendBfEnd + 1) % X10_BUFFER_SIZE;
-      // Buffer message and repetitions
-      sendBf[sendBfEnd].message = message;
-      sendBf[sendBfEnd].repetitions = repetitions;
-      sendBfLastMs = millis();
+      // Make sure identical message is not sent within rebuffer delay
+      if(isBatched || sendBf[end ? end - 1 : sendBfSize - 1].message != message ||
+        ms > sendBfLastMs + X10_REBUFFER_DELAY || sendBfLastMs - 1 > ms)
+      {
+        // Buffer message and repetitions
+        sendBf[end].message = message;
+        sendBf[end].repetitions = repetitions;
+        // Message is sent when end is moved past it, batches when they end
+        if(isBatched) sendBfBatchEnd = next;
+        else sendBfEnd = next;
+        sendBfLastMs = ms;
+      }
+      // Return success even if message was not rebuffered because of rebuffer delay
+      // There is really no point in buffering two identical commands in quick succession
+      // If commands must be repeated several times, use the repetitions attribute
+    }
+    else
+    {
+      bufferError = 1;
+      batchError |= isBatched;
     }
-    // Return success even if message was not rebuffered because of rebuffer delay
-    // There is really no point in buffering two identical commands in quick succession
-    // If commands must be repeated several times, use the repetitions attribute
-    return 0;
   }
-  return 1;
+  SREG = sreg;
+  return bufferError;
+}
+
+// Starts batch of messages, e.g. a scenario: messages buffered before endBatch
+// is called are sent together or not at all. Returns true, and starts no batch,
+// when there are less than count free slots in buffer. While the batch is open,
+// messages sent from interrupts are rejected, unless they repeat the message
+// being sent.
+bool X10ex::beginBatch(uint8_t count)
+{
+  if(isBatching || count > sendBfSize - 1 - getBufferedCount())
+  {
+    return 1;
+  }
+  batchError = 0;
+  sendBfBatchEnd = sendBfEnd;
+  isBatching = 1;
+  return 0;
+}
+
+// Sends messages buffered since beginBatch was called. Returns true when the
+// batch was dropped because one of the messages could not be buffered.
+bool X10ex::endBatch()
+{
+  if(!isBatching)
+  {
+    return 1;
+  }
+  isBatching = 0;
+  if(batchError)
+  {
+    return 1;
+  }
+  // End is a single byte, so the zero cross interrupt sees all or none of the batch
+  sendBfEnd = sendBfBatchEnd;
+  return 0;
+}
+
+// Returns number of messages in send buffer, including the one being sent
+uint8_t X10ex::getBufferedCount()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t count = sendBfEnd - sendBfStart;
+  if(sendBfEnd < sendBfStart) count += sendBfSize;
+  SREG = sreg;
+  return count;
 }
 
 X10state X10ex::getModuleState(uint8_t house, uint8_t unit)
@@ -263,7 +434,7 @@ X10state X10ex::getModuleState(uint8_t house, uint8_t unit)
   #if X10_PERSIST_MOD_DATA == 1
   uint8_t state = eepromRead(house, unit);
   #else
-  house = parseHouseCode(house);
+  house = x10parseHouse(house);
   unit--;
   uint8_t state = 0;
   if(house <= 0xF && unit <= 0xF) state = moduleState[house << 4 | unit];
@@ -294,6 +465,72 @@ void X10ex::wipeModuleState(uint8_t house, uint8_t unit)
 #endif
 }
 
+// Used to track state of sensors that are not on the power line, e.g. RF security
+// sensors. Module is marked as a sensor and state is only written when changed.
+void X10ex::setSensorState(uint8_t house, uint8_t unit, bool isOn)
+{
+#if X10_PERSIST_MOD_DATA
+  uint8_t state = isOn ? B11000000 : B10000000;
+  #if X10_PERSIST_MOD_DATA == 1
+  bool isChanged = eepromRead(house, unit) != state;
+  if(isChanged) eepromWrite(house, unit, state);
+  uint8_t infoData = eepromRead(house, unit, 256);
+  if(infoData >> 6 != MODULE_TYPE_SENSOR)
+  {
+    eepromWrite(house, unit, infoData | MODULE_TYPE_SENSOR << 6, 256);
+    isChanged = 1;
+  }
+  if(isChanged) updateVersion(house, unit);
+  #else
+  uint8_t houseIx = x10parseHouse(house);
+  uint8_t unitIx = unit - 1;
+  if(houseIx <= 0xF && unitIx <= 0xF && moduleState[houseIx << 4 | unitIx] != state)
+  {
+    moduleState[houseIx << 4 | unitIx] = state;
+    updateVersion(house, unit);
+  }
+  #endif
+#endif
+}
+
+// Returns version of latest module state or info change
+uint16_t X10ex::getStateVersion()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t version = stateVersion;
+  SREG = sreg;
+  return version;
+}
+
+// Returns state version at the time module state or info last changed, or 0
+// when module has not changed since start
+uint16_t X10ex::getModuleVersion(uint8_t house, uint8_t unit)
+{
+  house = x10parseHouse(house);
+  unit--;
+  if(house > 0xF || unit > 0xF) return 0;
+  uint8_t sreg = SREG;
+  cli();
+#if X10_MODULE_VERSIONS >= 2
+  uint16_t version = moduleVersion[house << 4 | unit];
+#elif X10_MODULE_VERSIONS
+  uint16_t version = moduleVersion[house];
+#else
+  uint16_t version = stateVersion;
+#endif
+  SREG = sreg;
+  return version;
+}
+
+// Returns true when module state or info has changed after given state
+// version. Versions wrap around, so a module that has not changed during
+// the last 32768 changes may seem changed.
+bool X10ex::isModuleChanged(uint8_t house, uint8_t unit, uint16_t version)
+{
+  return (int16_t)(getModuleVersion(house, unit) - version) > 0;
+}
+
 #if X10_PERSIST_MOD_DATA == 1
 X10info X10ex::getModuleInfo(uint8_t house, uint8_t unit)
 {
@@ -325,6 +562,7 @@ void X10ex::setModuleType(uint8_t house, uint8_t unit, uint8_t type)
     updateModuleState(house, unit, DATA_UNKNOWN);
     // Update module type
     eepromWrite(house, unit, (eepromRead(house, unit, 256) | B11000000) & (type << 6 | B111111), 256);
+    updateVersion(house, unit);
   }
 }
 
@@ -370,6 +608,7 @@ bool X10ex::setModuleName(uint8_t house, uint8_t unit, char name[X10_INFO_NAME_L
       break;
     }
   }
+  updateVersion(house, unit);
   return 0;
 }
   #endif
@@ -385,14 +624,12 @@ void X10ex::wipeModuleInfo(uint8_t house, uint8_t unit)
 
 uint8_t X10ex::percentToX10Brightness(uint8_t brightness, uint8_t time)
 {
-  brightness = brightness >= 100 ? 62 : round(brightness / 100.0 * 62.0);
-  brightness |= time >= B11 ? B11000000 : time << 6;
-  return brightness;
+  return x10percentToBrightness(brightness, time);
 }
 
 uint8_t X10ex::x10BrightnessToPercent(uint8_t brightness)
 {
-  return round(100.0 * (brightness & B111111) / 62.0);
+  return x10brightnessToPercent(brightness);
 }
 
 //////////////////////////////
@@ -403,10 +640,10 @@ void X10ex::zeroCross()
 {
   zcInput = 0;
   // Start IO timer
-  TCNT1 = 1;
-  TCCR1B |= _BV(CS10);
+  *tcnt = 1;
+  *tccrB |= _BV(CS10);
   // Get bit to output from buffer
-  if(sendBf[sendBfStart].repetitions && (sentCount || zeroCount > X10_PRE_CMD_CYCLES - 1))
+  if(sendBfStart != sendBfEnd && (sentCount || zeroCount > X10_PRE_CMD_CYCLES - 1))
   {
     // Start output as soon as possible after zero crossing
     if(zcOutput) fastDigitalWrite(transmitPort, transmitBitMask, HIGH);
@@ -423,17 +660,17 @@ void X10ex::ioTimer()
   // Read input
   if(ioState == 1)
   {
-    ICR1 = outputLengthCycles - inputDelayCycles;
-    zcInput = receiveTransmits || !sendBf[sendBfStart].repetitions ? !(*portInputRegister(receivePort) & receiveBitMask) : 0;
+    *icr = outputLengthCycles - inputDelayCycles;
+    zcInput = receiveTransmits || sendBfStart == sendBfEnd ? !(*portInputRegister(receivePort) & receiveBitMask) : 0;
   }
   // Set output low, stop timer, and check receive
   else if((!zcOutput && ioState == 2) || ioState == ioStopState)
   {
     fastDigitalWrite(transmitPort, transmitBitMask, LOW);
     // Stop IO timer
-    TCCR1B &= ~_BV(CS10);
+    *tccrB &= ~_BV(CS10);
     // Reset timer (ready for next zero cross)
-    ICR1 = inputDelayCycles;
+    *icr = inputDelayCycles;
     ioState = 0;
     // If start sequence is found: receive message
     if(receivedCount)
@@ -465,13 +702,13 @@ void X10ex::ioTimer()
   // Set output High
   else if(ioState % 2)
   {
-    ICR1 = outputLengthCycles;
+    *icr = outputLengthCycles;
     fastDigitalWrite(transmitPort, transmitBitMask, HIGH);
   }
   // Set output Low
   else if(ioState)
   {
-    ICR1 = outputDelayCycles - outputLengthCycles;
+    *icr = outputDelayCycles - outputLengthCycles;
     fastDigitalWrite(transmitPort, transmitBitMask, LOW);
   }
   ioState++;
@@ -496,11 +733,13 @@ bool X10ex::getBitToSend()
     bool isOdd = sentCount % 2;
     // Get bit position in buffer
     uint8_t bitPosition = (sentCount - (isOdd ? 3 : 4)) / 2;
+    // Message is not changed while it's being sent, read it once
+    uint32_t message = sendBf[sendBfStart].message;
     // Get data type
-    uint8_t type = sendBf[sendBfStart].message & B111;
+    uint8_t type = message & B111;
     // Get bit to send from buffer, and xor it with odd field
     // to make complement bit for every even zero cross count
-    output = !(sendBf[sendBfStart].message >> 32 - bitPosition & B1) ^ isOdd;
+    output = !(message >> (32 - bitPosition) & B1) ^ isOdd;
     // If type is standard X10 message
     if(type == X10_MSG_STD)
     {
@@ -519,7 +758,7 @@ bool X10ex::getBitToSend()
     if(sentCount == 62 || (type == X10_MSG_CMD && sentCount == 22))
     {
       // If message has no unit code and command is BRIGHT or DIM: repeat without any silence
-      zeroCount = type == X10_MSG_CMD && (sendBf[sendBfStart].message >> 24 & B1110) == CMD_DIM ? 7 : 0;
+      zeroCount = type == X10_MSG_CMD && (message >> 24 & B1110) == CMD_DIM ? 7 : 0;
       sentCount = 0;
       sendOffset = 0;
       if(sendBf[sendBfStart].repetitions > 1)
@@ -528,8 +767,7 @@ bool X10ex::getBitToSend()
       }
       else
       {
-        sendBf[sendBfStart].repetitions = 0;
-        sendBfStart = (sendBfStart + 1) % X10_BUFFER_SIZE;
+        sendBfStart = sendBfStart + 1 < sendBfSize ? sendBfStart + 1 : 0;
       }
     }
   }
@@ -549,7 +787,7 @@ void X10ex::receiveMessage()
   {
     receivedBits++;
     // Buffer one byte
-    if(receivedBits < 9) receiveBuffer += receivedDataBit << 8 - receivedBits;
+    if(receivedBits < 9) receiveBuffer += receivedDataBit << (8 - receivedBits);
     // At zero crossing 22 standard message is complete: parse it
     if(receivedCount == 22)
     {
@@ -566,8 +804,8 @@ void X10ex::receiveMessage()
   {
     if(rxCommand != DATA_UNKNOWN)
     {
-      uint8_t house = findCodeIndex(HOUSE_CODE, rxHouse) + 65;
-      uint8_t unit = findCodeIndex(UNIT_CODE, rxExtUnit != DATA_UNKNOWN ? rxExtUnit : rxUnit) + 1;
+      uint8_t house = x10decode(rxHouse) + 65;
+      uint8_t unit = x10decode(rxExtUnit != DATA_UNKNOWN ? rxExtUnit : rxUnit) + 1;
 #if X10_PERSIST_MOD_DATA
       if(unit) updateModuleState(house, unit, rxCommand);
 #endif
@@ -600,7 +838,7 @@ void X10ex::receiveStandardMessage()
     rxData =
       (
         // Get the four least significant bits in reverse (bit 8-5 => 1-4)
-        ((((receiveBuffer * 0x0802LU & 0x22110LU) | (receiveBuffer * 0x8020LU & 0x88440LU)) * 0x10101LU >> 16) & B1111) +
+        x10reverseNibble(receiveBuffer >> 4) +
         // Add most significant bit (bit 1 => 5)
         ((receiveBuffer & B0001) << 4)
       ) * 2;
@@ -643,7 +881,7 @@ void X10ex::updateModuleState(uint8_t house, uint8_t unit, uint8_t command)
   #if X10_PERSIST_MOD_DATA == 1
   uint8_t state = eepromRead(house, unit);
   #else
-  uint8_t state = moduleState[parseHouseCode(house) << 4 | (unit - 1)];
+  uint8_t state = moduleState[x10parseHouse(house) << 4 | (unit - 1)];
   #endif
   // Bit 1 and 2 in state byte has the state, last 6 bits is brightness
   // 00 = Not seen, Not known, Not On
@@ -708,9 +946,17 @@ void X10ex::updateModuleState(uint8_t house, uint8_t unit, uint8_t command)
     }
   }
   #if X10_PERSIST_MOD_DATA == 1
-  eepromWrite(house, unit, state);
+  if(state != eepromRead(house, unit))
+  {
+    eepromWrite(house, unit, state);
+    updateVersion(house, unit);
+  }
   #else
-  moduleState[parseHouseCode(house) << 4 | (unit - 1)] = state;
+  if(state != moduleState[x10parseHouse(house) << 4 | (unit - 1)])
+  {
+    moduleState[x10parseHouse(house) << 4 | (unit - 1)] = state;
+    updateVersion(house, unit);
+  }
   #endif
 }
 #endif
@@ -718,7 +964,8 @@ void X10ex::updateModuleState(uint8_t house, uint8_t unit, uint8_t command)
 void X10ex::wipeModuleData(uint8_t house, uint8_t unit, bool info)
 {
 #if X10_PERSIST_MOD_DATA
-  house = parseHouseCode(house);
+  updateVersion(house, unit);
+  house = x10parseHouse(house);
   unit--;
   uint16_t ix = 0;
   uint8_t endIx = 255;
@@ -763,6 +1010,47 @@ void X10ex::wipeModuleData(uint8_t house, uint8_t unit, bool info)
 #endif
 }
 
+// Increments state version and sets version of module to it, if house is
+// outside range A-P all modules are set, if unit is outside range 1-16 all
+// modules in house are set. Interrupts are only disabled while one version
+// is set, so that wiping all modules doesn't delay the power line interface.
+void X10ex::updateVersion(uint8_t house, uint8_t unit)
+{
+  house = x10parseHouse(house);
+  unit--;
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t version = ++stateVersion;
+  SREG = sreg;
+#if X10_MODULE_VERSIONS
+  #if X10_MODULE_VERSIONS >= 2
+  uint16_t ix = 0;
+  uint8_t endIx = 255;
+  if(house <= 0xF)
+  {
+    ix = house << 4;
+    endIx = unit <= 0xF ? ix + unit : ix + 0xF;
+    if(unit <= 0xF) ix += unit;
+  }
+  #else
+  uint16_t ix = house <= 0xF ? house : 0;
+  uint8_t endIx = house <= 0xF ? house : 0xF;
+  #endif
+  while(ix <= endIx)
+  {
+    cli();
+    // Don't move version back if module was changed again from interrupt,
+    // i.e. if module version is newer than version and not newer than now
+    if((uint16_t)(moduleVersion[ix] - version - 1) >= (uint16_t)(stateVersion - version))
+    {
+      moduleVersion[ix] = version;
+    }
+    SREG = sreg;
+    ix++;
+  }
+#endif
+}
+
 #if X10_PERSIST_MOD_DATA == 1
 uint8_t X10ex::eepromRead(uint16_t address)
 {
@@ -772,7 +1060,7 @@ uint8_t X10ex::eepromRead(uint16_t address)
 
 uint8_t X10ex::eepromRead(uint8_t house, uint8_t unit, uint16_t offset)
 {
-  house = parseHouseCode(house);
+  house = x10parseHouse(house);
   unit--;
   // If house or unit code is out of range: return 0
   if(house > 0xF || unit > 0xF) return 0;
@@ -787,7 +1075,7 @@ uint8_t X10ex::eepromWrite(uint16_t address, uint8_t data)
 
 uint8_t X10ex::eepromWrite(uint8_t house, uint8_t unit, uint8_t data, uint16_t offset)
 {
-  house = parseHouseCode(house);
+  house = x10parseHouse(house);
   unit--;
   // If house and unit code is within valid range
   if(house <= 0xF && unit <= 0xF)
@@ -803,20 +1091,6 @@ void X10ex::clearReceiveBuffer()
   receiveBuffer = 0;
 }
 
-uint8_t X10ex::parseHouseCode(uint8_t house)
-{
-  return house - (house < 0xF ? 0 : house >= 0x61 ? 0x61 : 0x41);
-}
-
-int8_t X10ex::findCodeIndex(const uint8_t codeList[16], uint8_t code)
-{
-  for(uint8_t i = 0; i <= 0xF; i++)
-  {
-    if(codeList[i] == code) return i;
-  }
-  return -1;
-}
-
 void X10ex::fastDigitalWrite(uint8_t port, uint8_t bitMask, uint8_t value)
 {
   if(port == NOT_A_PIN) return;
@@ -22,6 +22,7 @@
 
 #include "Arduino.h"
 #include "avr/eeprom.h"
+#include "X10codec.h"
 
 // Number of silent power line cycles before command is sent
 #define X10_PRE_CMD_CYCLES    6
@@ -29,9 +30,13 @@
 #define X10_SAMPLE_DELAY    500
 // Signal length should be set to 1000us according to spec
 #define X10_SIGNAL_LENGTH  1000
+// Rounded number of IO timer cycles (F_CPU / 2 Hz) in given microseconds,
+// computed at compile time so that no floating point math is linked in
+#define X10_US_TO_CYCLES(us) ((uint16_t)(((uint64_t)F_CPU * (us) + 1000000) / 2000000))
 // Set buffer size to the number of individual messages you would like to
 // buffer, plus one. The buffer is useful when triggering a scenario e.g.
-// Each slot in the buffer uses 5 bytes of memory
+// Each slot in the buffer uses 5 bytes of memory. This is the size used by
+// the X10ex constructor, use X10exConfigured to set it per interface.
 #define X10_BUFFER_SIZE      17
 // Set the min delay, in ms, between buffering of two identical messages
 // This delay does not affect message repeats (when button is held)
@@ -41,16 +46,40 @@
 // Set to 1: Module state data and module info is stored in EEPROM.
 // Set to 2: State data is stored in volatile memory and cleared on
 // reboot. Module types and names are not stored when state is set to 2.
+// Can also be set by the build, the host tests use 2.
+#ifndef X10_PERSIST_MOD_DATA
 #define X10_PERSIST_MOD_DATA  1
+#endif
 // Length of module names stored in EEPROM, do not change if you don't
 // know what you are doing. 4 and 8 should be valid, but this isn't tested.
 #define X10_INFO_NAME_LEN    16
+// Module state versions, used to tell which modules have changed since a
+// given state version. Set to 2: Each module has its own version (uses 512
+// bytes of memory). Set to 1: Modules share the version of their house code
+// (uses 32 bytes), so all modules in a house seem changed when one changes.
+// Versions are shared by all interfaces, so they use no memory per interface.
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define X10_MODULE_VERSIONS   2
+#else
+#define X10_MODULE_VERSIONS   1
+#endif
 // Enable this to use X10 standard message PRE_SET_DIM commands.
 // PRE_SET_DIM commands do not work with any of the European modules I've
 // tested. I have no idea if it works at all, but it's part of the X10
 // standard. If you're using a PLC interface and modules that support
 // extended code: use the "sendExtDim" method in stead.
 #define X10_USE_PRE_SET_DIM   0
+// Number of power line interfaces that can be used at the same time, e.g.
+// one interface per phase. Each interface needs its own 16 bit IO timer:
+// Timer1 is used by the first interface, and on the ATmega1280/2560 Timer3,
+// Timer4 and Timer5 can be used by additional interfaces. Only increase
+// this if you need it, timers used here can't be used by other libraries.
+// Each interface has its own send buffer, and its own 256 bytes of module
+// state when X10_PERSIST_MOD_DATA is 2.
+// Can also be set by the build, the host tests use 4.
+#ifndef X10_MAX_INTERFACES
+#define X10_MAX_INTERFACES    1
+#endif
 
 // These are message buffer data types used to seperate X10 standard
 // message format from extended message format, e.g.
@@ -111,6 +140,29 @@ struct X10info
   char name[X10_INFO_NAME_LEN + 1];
 };
 
+// Converts percent (0-100) and dim time (EXC_DIM_TIME_*) to the brightness
+// byte of an extended code PRE_SET_DIM command, at compile time when given
+// constants
+constexpr uint8_t x10percentToBrightness(uint8_t percent, uint8_t time = EXC_DIM_TIME_4)
+{
+  return
+    (percent >= 100 ? 62 : (percent * 62 + 50) / 100) |
+    (time >= B11 ? B11000000 : time << 6);
+}
+
+// Converts the brightness of an extended code PRE_SET_DIM command to percent
+constexpr uint8_t x10brightnessToPercent(uint8_t brightness)
+{
+  return ((brightness & B111111) * 100 + 31) / 62;
+}
+
+// Per interface settings, see X10exConfigured
+struct X10exConfig
+{
+  // Number of individual messages buffered, plus one (2-255)
+  static const uint8_t bufferSize = X10_BUFFER_SIZE;
+};
+
 class X10ex
 {
 
@@ -118,10 +170,12 @@ class X10ex
     typedef void (*plcReceiveCallback_t)(char, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
     // Phase retransmits not needed on European systems using the XM10 PLC interface,
     // so the phases and sineWaveHz parameters are optional and defaults to 1 and 50.
+    // The timer parameter selects the 16 bit IO timer used by the interface (1, 3, 4
+    // or 5), when more than one interface is used; see X10_MAX_INTERFACES.
     X10ex(
       uint8_t zeroCrossInt, uint8_t zeroCrossPin, uint8_t transmitPin,
       uint8_t receivePin, bool receiveTransmits, plcReceiveCallback_t plcReceiveCallback,
-      uint8_t phases = 1, uint8_t sineWaveHz = 50);
+      uint8_t phases = 1, uint8_t sineWaveHz = 50, uint8_t timer = 1);
     // Public methods
     void begin();
     bool sendAddress(uint8_t house, uint8_t unit, uint8_t repetitions);
@@ -132,8 +186,15 @@ class X10ex
 #endif
     bool sendExtDim(uint8_t house, uint8_t unit, uint8_t percent, uint8_t time, uint8_t repetitions);
     bool sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand, uint8_t repetitions);
+    bool beginBatch(uint8_t count);
+    bool endBatch();
+    uint8_t getBufferedCount();
     X10state getModuleState(uint8_t house, uint8_t unit);
     void wipeModuleState(uint8_t house = '*', uint8_t unit = 0);
+    void setSensorState(uint8_t house, uint8_t unit, bool isOn);
+    uint16_t getStateVersion();
+    uint16_t getModuleVersion(uint8_t house, uint8_t unit);
+    bool isModuleChanged(uint8_t house, uint8_t unit, uint16_t version);
 #if X10_PERSIST_MOD_DATA == 1
     X10info getModuleInfo(uint8_t house, uint8_t unit);
     void setModuleType(uint8_t house, uint8_t unit, uint8_t type);
@@ -146,21 +207,38 @@ class X10ex
     uint8_t x10BrightnessToPercent(uint8_t brightness);
     void zeroCross();
     void ioTimer();
+
+  protected:
+    // Used by X10exConfigured, the send buffer belongs to the caller
+    X10ex(
+      uint8_t zeroCrossInt, uint8_t zeroCrossPin, uint8_t transmitPin,
+      uint8_t receivePin, bool receiveTransmits, plcReceiveCallback_t plcReceiveCallback,
+      uint8_t phases, uint8_t sineWaveHz, uint8_t timer,
+      X10msg volatile *sendBf, uint8_t sendBfSize);
   
   private:
-    static const uint8_t HOUSE_CODE[16];
-    static const uint8_t UNIT_CODE[16];
     // Set in constructor
     uint8_t zeroCrossInt, zeroCrossPin, transmitPin, transmitPort, transmitBitMask, receivePin, receivePort, receiveBitMask, ioStopState;
     uint16_t inputDelayCycles, outputDelayCycles, outputLengthCycles;
+    // IO timer registers, set in constructor (timerIx is 0xFF when timer is invalid)
+    uint8_t timerIx;
+    volatile uint8_t *tccrA, *tccrB, *timsk;
+    volatile uint16_t *icr, *tcnt;
     bool receiveTransmits;
     plcReceiveCallback_t plcReceiveCallback;
     // Transmit and receive fields
     int8_t ioState;
     bool volatile zcInput, zcOutput;
     // Transmit fields
-    X10msg volatile sendBf[X10_BUFFER_SIZE];
+    // Send buffer ring: start is the message being sent and is only moved by
+    // the zero cross interrupt, end is one past the last message and is only
+    // moved by the send methods. The buffer is empty when they are equal.
+    X10msg volatile *sendBf;
+    uint8_t sendBfSize;
     uint8_t volatile sendBfStart, sendBfEnd;
+    // End of batch being buffered, moved to sendBfEnd when batch ends
+    uint8_t sendBfBatchEnd;
+    bool isBatching, batchError;
     uint32_t sendBfLastMs;
     uint8_t zeroCount, sentCount, sendOffset;
     // Receive fields
@@ -170,6 +248,16 @@ class X10ex
     // State stored in byte (8=On/Off, 7=State Known/Unknown, 6-1 data)
 #if X10_PERSIST_MOD_DATA >= 2
     uint8_t moduleState[256];
+#endif
+    // Version is incremented on every module state or info change, and the
+    // changed modules are set to the new version. Versions wrap around. They
+    // are shared by all interfaces: a module changed through any interface
+    // is newer than the versions clients have seen.
+    static uint16_t volatile stateVersion;
+#if X10_MODULE_VERSIONS >= 2
+    static uint16_t volatile moduleVersion[256];
+#elif X10_MODULE_VERSIONS
+    static uint16_t volatile moduleVersion[16];
 #endif
     // Private methods
     bool getBitToSend();
@@ -180,6 +268,7 @@ class X10ex
     void updateModuleState(uint8_t house, uint8_t unit, uint8_t command);
 #endif
     void wipeModuleData(uint8_t house, uint8_t unit, bool info);
+    void updateVersion(uint8_t house, uint8_t unit);
 #if X10_PERSIST_MOD_DATA == 1
     uint8_t eepromRead(uint16_t address);
     uint8_t eepromRead(uint8_t house, uint8_t unit, uint16_t offset = 0);
@@ -187,9 +276,35 @@ class X10ex
     uint8_t eepromWrite(uint8_t house, uint8_t unit, uint8_t data, uint16_t offset = 0);
 #endif
     void clearReceiveBuffer();
-    uint8_t parseHouseCode(uint8_t house);
-    int8_t findCodeIndex(const uint8_t codeList[16], uint8_t code);
     void fastDigitalWrite(uint8_t port, uint8_t bitMask, uint8_t value);
 };
 
+// Interface with its own send buffer size, so interfaces in the same sketch
+// can be configured differently, e.g. a larger buffer for the interface that
+// sends scenarios:
+//
+// struct SceneConfig : X10exConfig { static const uint8_t bufferSize = 33; };
+// X10exConfigured<SceneConfig> x10ex(0, 2, 9, 8, 0, powerLineEvent);
+//
+// The buffer is part of the instance. The buffers used by the X10ex
+// constructor are not linked in when only X10exConfigured is used.
+template<class Config = X10exConfig> class X10exConfigured : public X10ex
+{
+
+  public:
+    X10exConfigured(
+      uint8_t zeroCrossInt, uint8_t zeroCrossPin, uint8_t transmitPin,
+      uint8_t receivePin, bool receiveTransmits, plcReceiveCallback_t plcReceiveCallback,
+      uint8_t phases = 1, uint8_t sineWaveHz = 50, uint8_t timer = 1) :
+      X10ex(
+        zeroCrossInt, zeroCrossPin, transmitPin, receivePin, receiveTransmits, plcReceiveCallback,
+        phases, sineWaveHz, timer, sendBfConfigured, Config::bufferSize)
+    {
+    }
+
+  private:
+    static_assert(Config::bufferSize >= 2, "X10exConfig bufferSize must be 2-255");
+    X10msg volatile sendBfConfigured[Config::bufferSize];
+};
+
 #endif
\ No newline at end of file
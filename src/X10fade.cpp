@@ -0,0 +1,212 @@
+/************************************************************************/
+/* X10 PLC fade library, smooth dimming with pre-set-dim steps, v1.6.   */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10fade.h"
+
+// Used as last sent brightness before first step is sent
+#define X10_FADE_NONE 0xFF
+
+X10fade::X10fade(X10ex *x10ex)
+{
+  this->x10ex = x10ex;
+  memset(fades, 0, sizeof(fades));
+  fadingCount = 0;
+  nextIx = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Starts fading module from its current brightness to brightness in percent,
+// replacing any fade of the same module. Percent 0 ends the fade with off.
+// Returns true on invalid input or when X10_FADE_MAX modules are fading.
+bool X10fade::fade(char house, uint8_t unit, uint8_t percent, uint32_t durationMs)
+{
+  house = toupper(house);
+  if(house < 'A' || house > 'P' || unit < 1 || unit > 16) return 1;
+  X10state state = x10ex->getModuleState(house, unit);
+  // Module is on with unknown brightness: assume full brightness
+  // Module state is unknown: assume module is off
+  uint8_t startLevel = state.isKnown && state.isOn ? (state.data ? state.data : 62) : 0;
+  uint8_t targetLevel = x10ex->percentToX10Brightness(percent) & B111111;
+  uint8_t sreg = SREG;
+  cli();
+  int8_t ix = find(house, unit);
+  // Module is fading: continue from last brightness sent
+  if(ix >= 0)
+  {
+    if(fades[ix].lastSent != X10_FADE_NONE) startLevel = fades[ix].lastSent;
+  }
+  else
+  {
+    for(ix = X10_FADE_MAX - 1; ix >= 0 && fades[ix].isActive; ix--);
+    if(ix < 0)
+    {
+      SREG = sreg;
+      return 1;
+    }
+    fadingCount++;
+  }
+  X10fadeState &fade = fades[ix];
+  fade.isActive = 1;
+  fade.house = house;
+  fade.unit = unit;
+  fade.startLevel = startLevel;
+  fade.targetLevel = targetLevel;
+  // Already at target: send target once, to make sure module is in sync
+  fade.lastSent = startLevel != targetLevel ? startLevel : X10_FADE_NONE;
+  fade.startMs = millis();
+  fade.durationMs = durationMs < X10_FADE_MAX_DURATION ? durationMs : X10_FADE_MAX_DURATION;
+  SREG = sreg;
+  return 0;
+}
+
+// Cancels fade, the module is left at the last brightness sent. Unit 0 cancels
+// all fades in house. Returns true when no fade was cancelled.
+bool X10fade::cancel(char house, uint8_t unit)
+{
+  bool notFound = 1;
+  house = toupper(house);
+  uint8_t sreg = SREG;
+  cli();
+  for(uint8_t ix = 0; ix < X10_FADE_MAX; ix++)
+  {
+    if(fades[ix].isActive && fades[ix].house == house && (!unit || fades[ix].unit == unit))
+    {
+      remove(ix);
+      notFound = 0;
+    }
+  }
+  SREG = sreg;
+  return notFound;
+}
+
+bool X10fade::isFading(char house, uint8_t unit)
+{
+  uint8_t sreg = SREG;
+  cli();
+  bool fading = find(toupper(house), unit) >= 0;
+  SREG = sreg;
+  return fading;
+}
+
+uint8_t X10fade::getFadingCount()
+{
+  return fadingCount;
+}
+
+// Buffers at most one fade step, call from loop. Fades take turns, starting
+// with the fade after the one that last buffered a step.
+void X10fade::poll()
+{
+  if(!fadingCount || x10ex->getBufferedCount() > X10_FADE_MAX_BUFFERED) return;
+  for(uint8_t i = 0; i < X10_FADE_MAX; i++)
+  {
+    uint8_t ix = nextIx;
+    nextIx = (nextIx + 1) % X10_FADE_MAX;
+    if(step(ix)) break;
+  }
+}
+
+// Cancels fades of module when another command is received for it. Received
+// steps already sent by the fade (echoes) are ignored. Unit 0 cancels all fades
+// in house, e.g. on all units off.
+void X10fade::receive(char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand)
+{
+  uint8_t sreg = SREG;
+  cli();
+  for(uint8_t ix = 0; ix < X10_FADE_MAX; ix++)
+  {
+    X10fadeState &fade = fades[ix];
+    if(!fade.isActive || fade.house != house || (unit && fade.unit != unit)) continue;
+    if(command == CMD_EXTENDED_CODE && extCommand == EXC_PRE_SET_DIM && fade.lastSent != X10_FADE_NONE)
+    {
+      uint8_t level = extData & B111111;
+      if(
+        (level >= fade.startLevel && level <= fade.lastSent) ||
+        (level <= fade.startLevel && level >= fade.lastSent)) continue;
+    }
+    remove(ix);
+  }
+  SREG = sreg;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+// Returns index of active fade, or -1 when module is not fading
+int8_t X10fade::find(char house, uint8_t unit)
+{
+  for(uint8_t ix = 0; ix < X10_FADE_MAX; ix++)
+  {
+    if(fades[ix].isActive && fades[ix].house == house && fades[ix].unit == unit) return ix;
+  }
+  return -1;
+}
+
+void X10fade::remove(uint8_t ix)
+{
+  fades[ix].isActive = 0;
+  fadingCount--;
+}
+
+// Buffers step to the brightness due now, returns true when a step was buffered
+bool X10fade::step(uint8_t ix)
+{
+  uint8_t sreg = SREG;
+  cli();
+  X10fadeState fade = fades[ix];
+  SREG = sreg;
+  if(!fade.isActive) return 0;
+  uint32_t elapsedMs = millis() - fade.startMs;
+  uint8_t level = fade.targetLevel;
+  if(elapsedMs < fade.durationMs)
+  {
+    // Duration is limited, so that change times elapsed fits in 32 bits
+    uint8_t change = fade.targetLevel > fade.startLevel ?
+      fade.targetLevel - fade.startLevel : fade.startLevel - fade.targetLevel;
+    change = change * elapsedMs / fade.durationMs;
+    level = fade.targetLevel > fade.startLevel ? fade.startLevel + change : fade.startLevel - change;
+  }
+  bool isLast = level == fade.targetLevel;
+  // Skip steps too small to be seen, but always send the last step
+  if(fade.lastSent != X10_FADE_NONE)
+  {
+    uint8_t change = level > fade.lastSent ? level - fade.lastSent : fade.lastSent - level;
+    if(!change || (!isLast && change < X10_FADE_MIN_STEP)) return 0;
+  }
+  bool bufferError = level ?
+    x10ex->sendExt(fade.house, fade.unit, CMD_EXTENDED_CODE, level, EXC_PRE_SET_DIM, 1) :
+    x10ex->sendCmd(fade.house, fade.unit, CMD_OFF, 1);
+  if(bufferError) return 0;
+  cli();
+  // Fade may have been cancelled or replaced by receive callback meanwhile
+  X10fadeState &current = fades[ix];
+  if(
+    current.isActive && current.house == fade.house &&
+    current.unit == fade.unit && current.startMs == fade.startMs)
+  {
+    if(isLast) remove(ix);
+    else current.lastSent = level;
+  }
+  SREG = sreg;
+  return 1;
+}
@@ -0,0 +1,88 @@
+/************************************************************************/
+/* X10 PLC fade library, smooth dimming with pre-set-dim steps, v1.6.   */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10fade_h
+#define X10fade_h
+
+#include "Arduino.h"
+#include "X10ex.h"
+
+// Max number of modules fading at the same time. Each fade uses 14 bytes of
+// memory
+#define X10_FADE_MAX             4
+// A fade step is only buffered when the send buffer holds no more than this
+// number of messages. With an empty buffer, each step has the brightness due
+// when the power line is free, and other commands don't queue behind steps.
+#define X10_FADE_MAX_BUFFERED    0
+// Smallest brightness change (of 62 levels) sent, except for the last step
+#define X10_FADE_MIN_STEP        2
+// Longest fade in milliseconds, longer fades are cut to this (about 18 hours)
+#define X10_FADE_MAX_DURATION    0x3FFFFFFLU
+
+// Ramps dimmers from their current brightness (see X10ex getModuleState) to a
+// target brightness over a given duration, using extended pre-set-dim steps.
+// The dim time of extended pre-set-dim is ignored by many modules, so each
+// step sets brightness directly. Steps are sent round robin when several
+// modules fade. A step skips straight to the brightness due when it is sent,
+// so the fewest steps are sent when the power line is busy, e.g.
+//
+// x10fade.fade('A', 3, 0, 60000); // Fade A3 to off over a minute
+//
+// Call poll from loop. A fade is cancelled when another command is received
+// for the same module; the power line receive callback should forward to the
+// fade receive method:
+//
+// void powerLineEvent(char house, byte unit, byte command, byte extData, byte extCommand, byte remainingBits)
+// {
+//   x10fade.receive(house, unit, command, extData, extCommand);
+// }
+class X10fade
+{
+
+  public:
+    X10fade(X10ex *x10ex);
+    // Public methods
+    bool fade(char house, uint8_t unit, uint8_t percent, uint32_t durationMs);
+    bool cancel(char house, uint8_t unit);
+    bool isFading(char house, uint8_t unit);
+    uint8_t getFadingCount();
+    void poll();
+    void receive(char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand);
+
+  private:
+    struct X10fadeState
+    {
+      bool isActive;
+      char house;
+      uint8_t unit;
+      // X10 brightness 0-62, lastSent is X10_FADE_NONE until first step is sent
+      uint8_t startLevel, targetLevel, lastSent;
+      uint32_t startMs, durationMs;
+    };
+    // Set in constructor
+    X10ex *x10ex;
+    X10fadeState fades[X10_FADE_MAX];
+    uint8_t fadingCount, nextIx;
+    // Private methods
+    int8_t find(char house, uint8_t unit);
+    void remove(uint8_t ix);
+    bool step(uint8_t ix);
+};
+
+#endif
@@ -0,0 +1,142 @@
+/************************************************************************/
+/* X10 binary frame library, serial frames with CRC and sequence, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10frame.h"
+
+#define X10_FRAME_STATE_SYNC    0
+#define X10_FRAME_STATE_LENGTH  1
+#define X10_FRAME_STATE_DATA    2
+#define X10_FRAME_STATE_DONE    3
+
+X10frame::X10frame()
+{
+  begin();
+  errorCount = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Resets parser, the next frame starts at the next sync byte
+void X10frame::begin()
+{
+  state = X10_FRAME_STATE_SYNC;
+  length = 0;
+  ix = 0;
+}
+
+// Parses next byte, returns X10_FRAME_* event. Type, sequence and payload are
+// valid until the next byte is parsed.
+uint8_t X10frame::parse(uint8_t c)
+{
+  switch(state)
+  {
+    case X10_FRAME_STATE_DONE:
+    case X10_FRAME_STATE_SYNC:
+      state = c == X10_FRAME_SYNC ? X10_FRAME_STATE_LENGTH : X10_FRAME_STATE_SYNC;
+      return X10_FRAME_NONE;
+    case X10_FRAME_STATE_LENGTH:
+      if(c > X10_FRAME_PAYLOAD_MAX)
+      {
+        errorCount++;
+        // Length can't be a sync byte, so look for the next one
+        begin();
+        return X10_FRAME_ERROR;
+      }
+      length = c;
+      ix = 0;
+      crc = crc16(0xFFFF, c);
+      state = X10_FRAME_STATE_DATA;
+      return X10_FRAME_NONE;
+  }
+  buffer[ix++] = c;
+  // Type, sequence and payload are included in CRC
+  if(ix <= length + 2) crc = crc16(crc, c);
+  if(ix < length + 4) return X10_FRAME_NONE;
+  state = X10_FRAME_STATE_DONE;
+  if((buffer[ix - 2] | buffer[ix - 1] << 8) != crc)
+  {
+    errorCount++;
+    return X10_FRAME_ERROR;
+  }
+  return X10_FRAME_DONE;
+}
+
+// Returns true while a frame is half way received
+bool X10frame::isStarted()
+{
+  return state == X10_FRAME_STATE_LENGTH || state == X10_FRAME_STATE_DATA;
+}
+
+uint8_t X10frame::getType()
+{
+  return buffer[0];
+}
+
+uint8_t X10frame::getSequence()
+{
+  return buffer[1];
+}
+
+const uint8_t *X10frame::getPayload()
+{
+  return buffer + 2;
+}
+
+uint8_t X10frame::getLength()
+{
+  return length;
+}
+
+// Returns number of frames dropped because of length or CRC errors, it wraps
+// around
+uint16_t X10frame::getErrorCount()
+{
+  return errorCount;
+}
+
+// Writes frame to buffer (X10_FRAME_SIZE_MAX bytes), returns frame length or
+// 0 when payload is too long
+uint8_t X10frame::encode(
+  uint8_t *frame, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length)
+{
+  if(length > X10_FRAME_PAYLOAD_MAX) return 0;
+  frame[0] = X10_FRAME_SYNC;
+  frame[1] = length;
+  frame[2] = type;
+  frame[3] = sequence;
+  memcpy(frame + 4, payload, length);
+  uint16_t crc = 0xFFFF;
+  for(uint8_t ix = 1; ix < length + 4; ix++) crc = crc16(crc, frame[ix]);
+  frame[length + 4] = crc;
+  frame[length + 5] = crc >> 8;
+  return length + X10_FRAME_OVERHEAD;
+}
+
+// CRC-16 CCITT (polynomial 0x1021) of one more byte
+uint16_t X10frame::crc16(uint16_t crc, uint8_t data)
+{
+  crc ^= (uint16_t)data << 8;
+  for(uint8_t bit = 0; bit < 8; bit++)
+  {
+    crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
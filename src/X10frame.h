@@ -0,0 +1,120 @@
+/************************************************************************/
+/* X10 binary frame library, serial frames with CRC and sequence, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10frame_h
+#define X10frame_h
+
+// The frame codec only depends on the C library, so the same code can be used
+// by a host program talking to the controller
+#if defined(ARDUINO)
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <string.h>
+#endif
+
+// Frame layout: sync, length, type, sequence, payload (length bytes) and a
+// CRC-16 (CCITT, initial value 0xFFFF, low byte first) of length, type,
+// sequence and payload. The sync byte is never sent as text by the examples.
+#define X10_FRAME_SYNC           0xA5
+#define X10_FRAME_PAYLOAD_MAX       8
+#define X10_FRAME_OVERHEAD          6
+#define X10_FRAME_SIZE_MAX         (X10_FRAME_PAYLOAD_MAX + X10_FRAME_OVERHEAD)
+
+// Frame types sent by host. Host frames are numbered in order: a frame that
+// isn't the one after the last frame received is not executed (see ack
+// status), so the host can send frames without waiting for acks, and resend
+// all frames from the first one that wasn't acknowledged.
+// Hello: mode (1 = binary, 0 = text), any sequence number is accepted and the
+// next frame must have the one after it
+#define X10_FRAME_HELLO          0x01
+// Command: house ('A'-'P'), unit (1-16, 0 = none), command, extData,
+// extCommand and repetitions
+#define X10_FRAME_COMMAND        0x02
+// State request: house ('A'-'P') and unit (1-16)
+#define X10_FRAME_STATE          0x03
+// Scenario: scenario number
+#define X10_FRAME_SCENARIO       0x04
+// Frame types sent by controller
+// Ack: status and credits (commands the host can send right now), the
+// sequence number is the one of the acknowledged frame
+#define X10_FRAME_ACK            0x81
+// Event: type, house, unit, command, extData and extCommand, sequence
+// numbers are counted separately from host sequence numbers
+#define X10_FRAME_EVENT          0x82
+// Events lost: host didn't read events fast enough and some were dropped,
+// module state should be requested again
+#define X10_FRAME_EVENTS_LOST    0x83
+
+// Ack status
+#define X10_FRAME_OK                0
+// No credits left or power line buffer is full, resend later
+#define X10_FRAME_REJECTED          1
+#define X10_FRAME_INVALID           2
+// Frame was received before, it's not executed again
+#define X10_FRAME_DUPLICATE         3
+// Frames were lost, resend from the one after the last acknowledged frame
+#define X10_FRAME_OUT_OF_ORDER      4
+#define X10_FRAME_UNKNOWN           5
+
+// Parse events, parse returns one of these
+#define X10_FRAME_NONE              0
+// Frame received: getType, getSequence, getPayload and getLength
+#define X10_FRAME_DONE              1
+// Frame was too long or CRC did not match, frame is dropped
+#define X10_FRAME_ERROR             2
+
+// Incremental frame parser and encoder. Bytes are passed in one at a time,
+// bytes outside frames (e.g. text) are skipped until the next sync byte:
+//
+// while(Serial.available())
+// {
+//   if(frame.parse(Serial.read()) == X10_FRAME_DONE) ... frame.getType()
+// }
+//
+// A frame is dropped when its CRC doesn't match, so the sender must resend
+// frames that are not acknowledged. If a frame stops half way, call begin to
+// resynchronize (e.g. after a timeout).
+class X10frame
+{
+
+  public:
+    X10frame();
+    // Public methods
+    void begin();
+    uint8_t parse(uint8_t c);
+    bool isStarted();
+    uint8_t getType();
+    uint8_t getSequence();
+    const uint8_t *getPayload();
+    uint8_t getLength();
+    uint16_t getErrorCount();
+    static uint8_t encode(
+      uint8_t *frame, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length);
+    static uint16_t crc16(uint16_t crc, uint8_t data);
+
+  private:
+    uint8_t state, length, ix;
+    uint16_t crc;
+    // Type, sequence, payload and CRC
+    uint8_t buffer[X10_FRAME_PAYLOAD_MAX + 4];
+    uint16_t errorCount;
+};
+
+#endif
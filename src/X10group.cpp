@@ -0,0 +1,181 @@
+/************************************************************************/
+/* X10 multi interface dispatcher library, v1.6.                        */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10group.h"
+
+X10group::X10group(
+  X10ex *interfaces[], uint8_t count, uint8_t route,
+  X10ex::plcReceiveCallback_t plcReceiveCallback)
+{
+  this->interfaces = interfaces;
+  this->count = count;
+  this->route = route;
+  this->plcReceiveCallback = plcReceiveCallback;
+  // All house codes are routed to the first interface until set otherwise
+  memset(houseInterface, 0, sizeof(houseInterface));
+  memset((uint8_t *)moduleInterface, 0, sizeof(moduleInterface));
+  nextIx = 0;
+  lastSentIx = 0;
+  lastSentHouse = DATA_UNKNOWN;
+  lastSentUnit = DATA_UNKNOWN;
+  lastSentCommand = DATA_UNKNOWN;
+  lastSentMs = 0;
+  lastRxIx = 0;
+  lastRxHouse = DATA_UNKNOWN;
+  lastRxUnit = DATA_UNKNOWN;
+  lastRxCommand = DATA_UNKNOWN;
+  lastRxExtData = 0;
+  lastRxExtCommand = 0;
+  lastRxMs = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+void X10group::setHouseInterface(uint8_t house, uint8_t interfaceIx)
+{
+  house = x10parseHouse(house);
+  if(house <= 0xF && interfaceIx < count) houseInterface[house] = interfaceIx;
+}
+
+X10ex *X10group::getHouseInterface(uint8_t house)
+{
+  house = x10parseHouse(house);
+  return interfaces[house <= 0xF ? houseInterface[house] : 0];
+}
+
+bool X10group::sendAddress(uint8_t house, uint8_t unit, uint8_t repetitions)
+{
+  return sendCmd(house, unit, CMD_STATUS_REQUEST, repetitions);
+}
+
+bool X10group::sendCmd(uint8_t house, uint8_t command, uint8_t repetitions)
+{
+  return sendCmd(house, 0, command, repetitions);
+}
+
+bool X10group::sendCmd(uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions)
+{
+  return sendExt(house, unit, command, 0, 0, repetitions);
+}
+
+bool X10group::sendExtDim(uint8_t house, uint8_t unit, uint8_t percent, uint8_t time, uint8_t repetitions)
+{
+  if(percent == 0)
+  {
+    return sendExt(house, unit, CMD_OFF, 0, 0, repetitions);
+  }
+  else
+  {
+    return sendExt(
+      house, unit, CMD_EXTENDED_CODE,
+      interfaces[0]->percentToX10Brightness(percent, time), EXC_PRE_SET_DIM,
+      repetitions);
+  }
+}
+
+// Returns true when command could not be buffered by any of the interfaces
+bool X10group::sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand, uint8_t repetitions)
+{
+  if(route == X10_GROUP_ROUTE_HOUSE)
+  {
+    return getHouseInterface(house)->sendExt(house, unit, command, extData, extCommand, repetitions);
+  }
+  // Commands repeated within the rebuffer delay (e.g. bright and dim when button is held)
+  // must go to the same interface, or they would be transmitted as separate messages
+  if(
+    house == lastSentHouse && unit == lastSentUnit && command == lastSentCommand &&
+    millis() - lastSentMs < X10_REBUFFER_DELAY)
+  {
+    lastSentMs = millis();
+    return interfaces[lastSentIx]->sendExt(house, unit, command, extData, extCommand, repetitions);
+  }
+  // Try interfaces in turn, starting with the one after the last used
+  for(uint8_t i = 0; i < count; i++)
+  {
+    uint8_t ix = nextIx;
+    nextIx = (nextIx + 1) % count;
+    if(!interfaces[ix]->sendExt(house, unit, command, extData, extCommand, repetitions))
+    {
+      lastSentIx = ix;
+      lastSentHouse = house;
+      lastSentUnit = unit;
+      lastSentCommand = command;
+      lastSentMs = millis();
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Returns state from the interface that last received a message addressed to
+// module, or from the first interface that has seen the module when none of
+// them has received a message to it since startup
+X10state X10group::getModuleState(uint8_t house, uint8_t unit)
+{
+  uint8_t houseIx = x10parseHouse(house);
+  uint8_t unitIx = unit - 1;
+  if(houseIx > 0xF || unitIx > 0xF)
+  {
+    return interfaces[0]->getModuleState(house, unit);
+  }
+  uint8_t ix = houseIx << 4 | unitIx;
+  uint8_t interfaceIx = moduleInterface[ix >> 2] >> (ix & 3) * 2 & B11;
+  X10state state = interfaces[interfaceIx < count ? interfaceIx : 0]->getModuleState(house, unit);
+  for(uint8_t i = 0; i < count && !state.isSeen; i++)
+  {
+    state = interfaces[i]->getModuleState(house, unit);
+  }
+  return state;
+}
+
+//////////////////////////////
+/// Public (Interrupt Methods)
+//////////////////////////////
+
+void X10group::receive(
+  uint8_t interfaceIx, char house, uint8_t unit, uint8_t command,
+  uint8_t extData, uint8_t extCommand, uint8_t remainingBits)
+{
+  // Ignore message if identical message was just received on another interface
+  if(
+    interfaceIx != lastRxIx && house == lastRxHouse && unit == lastRxUnit && command == lastRxCommand &&
+    extData == lastRxExtData && extCommand == lastRxExtCommand && millis() - lastRxMs < X10_GROUP_DEDUP_DELAY)
+  {
+    return;
+  }
+  lastRxIx = interfaceIx;
+  lastRxHouse = house;
+  lastRxUnit = unit;
+  lastRxCommand = command;
+  lastRxExtData = extData;
+  lastRxExtCommand = extCommand;
+  lastRxMs = millis();
+  // Interface now has the latest state of module
+  uint8_t houseIx = x10parseHouse(house);
+  uint8_t unitIx = unit - 1;
+  if(houseIx <= 0xF && unitIx <= 0xF)
+  {
+    uint8_t ix = houseIx << 4 | unitIx;
+    uint8_t shift = (ix & 3) * 2;
+    moduleInterface[ix >> 2] = (moduleInterface[ix >> 2] & ~(B11 << shift)) | (interfaceIx & B11) << shift;
+  }
+  if(plcReceiveCallback) plcReceiveCallback(house, unit, command, extData, extCommand, remainingBits);
+}
@@ -0,0 +1,87 @@
+/************************************************************************/
+/* X10 multi interface dispatcher library, v1.6.                        */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10group_h
+#define X10group_h
+
+#include "Arduino.h"
+#include "X10ex.h"
+
+// Messages are sent using the interface selected for the house code
+#define X10_GROUP_ROUTE_HOUSE        0
+// Messages are sent using the next interface with room in its buffer
+#define X10_GROUP_ROUTE_ROUND_ROBIN  1
+// When an identical message is received on more than one interface within
+// this millisecond threshold (e.g. because of phase coupling), it is only
+// passed on to the receive callback once. Repeats received on the same
+// interface are always passed on.
+#define X10_GROUP_DEDUP_DELAY      250
+
+// Groups two or more X10ex power line interfaces (e.g. one per phase), so
+// they can be used as one. Each interface transmits from its own buffer, so
+// messages routed to different interfaces are sent in parallel. Received
+// messages are merged; the receive callback of every interface in the group
+// should forward to the group receive method:
+//
+// void powerLineEventPhase2(char house, byte unit, byte command, byte extData, byte extCommand, byte remainingBits)
+// {
+//   x10group.receive(1, house, unit, command, extData, extCommand, remainingBits);
+// }
+//
+// Each interface only knows the state of modules it has heard messages to,
+// use the group getModuleState to get the state from the interface that
+// last received a message addressed to the module.
+class X10group
+{
+
+  public:
+    X10group(
+      X10ex *interfaces[], uint8_t count, uint8_t route,
+      X10ex::plcReceiveCallback_t plcReceiveCallback);
+    // Public methods
+    void setHouseInterface(uint8_t house, uint8_t interfaceIx);
+    X10ex *getHouseInterface(uint8_t house);
+    bool sendAddress(uint8_t house, uint8_t unit, uint8_t repetitions);
+    bool sendCmd(uint8_t house, uint8_t command, uint8_t repetitions);
+    bool sendCmd(uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions);
+    bool sendExtDim(uint8_t house, uint8_t unit, uint8_t percent, uint8_t time, uint8_t repetitions);
+    bool sendExt(uint8_t house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand, uint8_t repetitions);
+    X10state getModuleState(uint8_t house, uint8_t unit);
+    void receive(
+      uint8_t interfaceIx, char house, uint8_t unit, uint8_t command,
+      uint8_t extData, uint8_t extCommand, uint8_t remainingBits);
+
+  private:
+    // Set in constructor
+    X10ex **interfaces;
+    uint8_t count, route;
+    X10ex::plcReceiveCallback_t plcReceiveCallback;
+    uint8_t houseInterface[16];
+    // Round robin fields
+    uint8_t nextIx, lastSentIx, lastSentHouse, lastSentUnit, lastSentCommand;
+    uint32_t lastSentMs;
+    // Receive dedup fields
+    uint8_t lastRxIx, lastRxHouse, lastRxUnit, lastRxCommand, lastRxExtData, lastRxExtCommand;
+    uint32_t lastRxMs;
+    // Interface that last received message addressed to module, 2 bits per
+    // module (X10_MAX_INTERFACES is at most 4)
+    uint8_t volatile moduleInterface[64];
+};
+
+#endif
@@ -0,0 +1,317 @@
+/************************************************************************/
+/* X10 HTTP request parser library, incremental and non-blocking, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10http.h"
+
+#define X10_HTTP_STATE_REQUEST  0
+#define X10_HTTP_STATE_HEADERS  1
+#define X10_HTTP_STATE_BODY     2
+#define X10_HTTP_STATE_DONE     3
+
+X10http::X10http()
+{
+  begin();
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Resets parser, call before parsing a new request
+void X10http::begin()
+{
+  state = X10_HTTP_STATE_REQUEST;
+  method = X10_HTTP_METHOD_UNKNOWN;
+  http11 = 0;
+  isJson = 0;
+  bodyLeft = 0;
+  isCleared = 1;
+  clearBuffer();
+}
+
+// Parses next byte of request, returns X10_HTTP_* event bits. Name and value
+// are valid until the next byte is parsed.
+uint8_t X10http::parse(char c)
+{
+  if(state == X10_HTTP_STATE_DONE) return X10_HTTP_NONE;
+  if(!isCleared) clearBuffer();
+  if(state == X10_HTTP_STATE_BODY) return parseBody(c);
+  if(c == '\n') return endLine();
+  if(c == '\r') return X10_HTTP_NONE;
+  // Request path may be url encoded
+  if(state == X10_HTTP_STATE_REQUEST && decode(c)) return X10_HTTP_NONE;
+  append(c);
+  return X10_HTTP_NONE;
+}
+
+bool X10http::isDone()
+{
+  return state == X10_HTTP_STATE_DONE;
+}
+
+uint8_t X10http::getMethod()
+{
+  return method;
+}
+
+bool X10http::isHttp11()
+{
+  return http11;
+}
+
+// Only valid when X10_HTTP_REQUEST is returned
+const char *X10http::getPath()
+{
+  return getValue();
+}
+
+const char *X10http::getName()
+{
+  return buffer;
+}
+
+const char *X10http::getValue()
+{
+  return buffer + (valueIx ? valueIx : length);
+}
+
+uint8_t X10http::getValueLength()
+{
+  return valueIx ? length - valueIx : 0;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+void X10http::append(char c)
+{
+  if(length < X10_HTTP_BUFFER_MAX)
+  {
+    buffer[length++] = c;
+    buffer[length] = '\0';
+  }
+}
+
+void X10http::clearBuffer()
+{
+  buffer[0] = '\0';
+  length = 0;
+  valueIx = 0;
+  encodedLeft = 0;
+  isQuoted = 0;
+  isEscaped = 0;
+  isValue = 0;
+  isCleared = 1;
+}
+
+// Returns true while an url encoded character is parsed, c is set to the
+// decoded character when done
+bool X10http::decode(char &c)
+{
+  if(encodedLeft)
+  {
+    encodedLeft--;
+    if(encodedLeft)
+    {
+      encodedChar = hexToDecimal(c) << 4;
+      return 1;
+    }
+    c = encodedChar | hexToDecimal(c);
+    return 0;
+  }
+  if(c == '%')
+  {
+    encodedLeft = 2;
+    return 1;
+  }
+  return 0;
+}
+
+// Splits buffer in name and value at separator
+void X10http::split(uint8_t ix, uint8_t skip)
+{
+  buffer[ix] = '\0';
+  valueIx = ix + skip < length ? ix + skip : length;
+}
+
+uint8_t X10http::endLine()
+{
+  uint8_t events =
+    state == X10_HTTP_STATE_REQUEST ? endRequestLine() : endHeader();
+  isCleared = 0;
+  return events;
+}
+
+// Request line: method, path and version separated by space
+uint8_t X10http::endRequestLine()
+{
+  // Empty lines before request are ignored
+  if(!length) return X10_HTTP_NONE;
+  // Path is decoded while parsed and may hold spaces, version doesn't
+  char *pathStart = strchr(buffer, ' ');
+  char *pathEnd = pathStart ? strrchr(pathStart + 1, ' ') : NULL;
+  if(!pathEnd)
+  {
+    state = X10_HTTP_STATE_DONE;
+    return X10_HTTP_ERROR | X10_HTTP_DONE;
+  }
+  http11 = !strcmp(pathEnd + 1, "HTTP/1.1");
+  *pathEnd = '\0';
+  length = pathEnd - buffer;
+  split(pathStart - buffer, 1);
+  method =
+    !strcmp(buffer, "GET") ? X10_HTTP_METHOD_GET :
+    !strcmp(buffer, "POST") ? X10_HTTP_METHOD_POST :
+    !strcmp(buffer, "DELETE") ? X10_HTTP_METHOD_DELETE :
+    X10_HTTP_METHOD_UNKNOWN;
+  state = X10_HTTP_STATE_HEADERS;
+  return X10_HTTP_REQUEST;
+}
+
+// Header line: name and value separated by colon, blank line ends headers
+uint8_t X10http::endHeader()
+{
+  if(!length)
+  {
+    if(bodyLeft)
+    {
+      state = X10_HTTP_STATE_BODY;
+      return X10_HTTP_BODY;
+    }
+    state = X10_HTTP_STATE_DONE;
+    return X10_HTTP_DONE;
+  }
+  char *colon = strchr(buffer, ':');
+  if(!colon) return X10_HTTP_NONE;
+  uint8_t ix = colon - buffer;
+  // Trim spaces around name and value
+  uint8_t skip = 1;
+  while(ix + skip < length && buffer[ix + skip] == ' ') skip++;
+  while(length > ix + skip && buffer[length - 1] == ' ') buffer[--length] = '\0';
+  split(ix, skip);
+  while(ix > 0 && buffer[ix - 1] == ' ') buffer[--ix] = '\0';
+  for(char *c = buffer; *c; c++) *c = toupper(*c);
+  if(!strcmp(buffer, "CONTENT-LENGTH")) bodyLeft = strtoul(getValue(), NULL, 10);
+  if(!strcmp(buffer, "CONTENT-TYPE")) isJson = strstr(getValue(), "json") || strstr(getValue(), "JSON");
+  return X10_HTTP_HEADER;
+}
+
+// Body: url encoded form fields separated by '&'
+uint8_t X10http::parseBody(char c)
+{
+  uint8_t events = X10_HTTP_NONE;
+  bodyLeft--;
+  if(isJson)
+  {
+    events = parseJsonBody(c);
+  }
+  else if(!encodedLeft && c == '&')
+  {
+    events = endField();
+  }
+  else if(!encodedLeft && c == '=' && !valueIx)
+  {
+    append('\0');
+    valueIx = length;
+  }
+  else if(!decode(c))
+  {
+    // Enable quoted text parser (allows lower case and space)
+    if(c == '"') isQuoted = !isQuoted;
+    else if(isQuoted) append(c == '+' ? ' ' : c);
+    else if(isgraph(c)) append(toupper(c));
+  }
+  if(!bodyLeft)
+  {
+    // Last field is ended here, unless body ends with '&'
+    if(isCleared) events |= endField();
+    events |= X10_HTTP_DONE;
+    state = X10_HTTP_STATE_DONE;
+  }
+  return events;
+}
+
+// JSON body: a string followed by colon is a name, the string or literal
+// after it is the value. Objects and arrays are not tracked.
+uint8_t X10http::parseJsonBody(char c)
+{
+  if(isQuoted)
+  {
+    if(isEscaped)
+    {
+      isEscaped = 0;
+    }
+    else if(c == '\\')
+    {
+      isEscaped = 1;
+      return X10_HTTP_NONE;
+    }
+    else if(c == '"')
+    {
+      isQuoted = 0;
+      // String value ends field
+      if(isValue) return endField();
+      return X10_HTTP_NONE;
+    }
+    append(isValue ? c : toupper(c));
+  }
+  else if(c == '"')
+  {
+    // A name starts a new field, anything buffered that wasn't a value is dropped
+    if(!isValue) clearBuffer();
+    isQuoted = 1;
+  }
+  else if(c == ':' && !isValue)
+  {
+    append('\0');
+    valueIx = length;
+    isValue = 1;
+  }
+  else if(c == ',' || c == '}' || c == ']')
+  {
+    // Literal value ends field
+    if(isValue) return endField();
+  }
+  else if(c == '{' || c == '[')
+  {
+    // Value is an object or array: name is dropped, and the fields in it are
+    // passed on
+    if(isValue) clearBuffer();
+  }
+  else if(isValue && isgraph(c))
+  {
+    append(toupper(c));
+  }
+  return X10_HTTP_NONE;
+}
+
+uint8_t X10http::endField()
+{
+  isCleared = 0;
+  return length ? X10_HTTP_FIELD : X10_HTTP_NONE;
+}
+
+uint8_t X10http::hexToDecimal(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  c = toupper(c);
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return 0;
+}
@@ -0,0 +1,125 @@
+/************************************************************************/
+/* X10 HTTP request parser library, incremental and non-blocking, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10http_h
+#define X10http_h
+
+// The parser only depends on the C library, so it can be built and tested on
+// a PC, fed from a file or socket in stead of an Ethernet shield
+#if defined(ARDUINO)
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#endif
+
+// Holds the request line, one header line or one form field at a time. With a
+// buffer size of 64, a form field can hold 20 standard commands or 7 extended
+// commands (see the X10_Ethernet example). Longer lines are truncated.
+#define X10_HTTP_BUFFER_MAX      64
+
+#define X10_HTTP_METHOD_UNKNOWN   0
+#define X10_HTTP_METHOD_GET       1
+#define X10_HTTP_METHOD_POST      2
+#define X10_HTTP_METHOD_DELETE    3
+
+// Parse events, parse returns one or more of these bits
+#define X10_HTTP_NONE          0x00
+// Request line parsed: getMethod and getPath
+#define X10_HTTP_REQUEST       0x01
+// Header parsed: getName (upper case) and getValue
+#define X10_HTTP_HEADER        0x02
+// Headers done and body follows, e.g. time to send "100 Continue"
+#define X10_HTTP_BODY          0x04
+// Form field parsed from url encoded or JSON body: getName and getValue
+#define X10_HTTP_FIELD         0x08
+// Request done, further input is ignored until begin is called
+#define X10_HTTP_DONE          0x10
+// Request line is malformed, further input is ignored until begin is called
+#define X10_HTTP_ERROR         0x20
+
+// Incremental HTTP/1.x request parser. Bytes are passed in one at a time as
+// they arrive, so one parser per connection can be resumed on every loop
+// without waiting for the rest of the request:
+//
+// while(client.available() && !http.isDone())
+// {
+//   uint8_t events = http.parse(client.read());
+//   if(events & X10_HTTP_FIELD) ... http.getName(), http.getValue()
+// }
+//
+// Body is parsed as url encoded form fields. Unquoted field values are
+// converted to upper case and whitespace is dropped, text in quotes keeps
+// case and spaces ('+' is space). Bodies without Content-Length are empty.
+//
+// When Content-Type is JSON, each name and value pair in the body is passed
+// on as a form field, in the order received, whatever object or array it's
+// in; e.g. [{"house":"A","unit":3,"on":true},{"house":"B",...}] is parsed
+// as house=A&unit=3&on=true&house=B... Names and values that are not strings
+// are converted to upper case, string values keep case. Only the escape
+// sequences \" and \\ are decoded. Since only one field is buffered at a
+// time, bodies of any length are parsed.
+class X10http
+{
+
+  public:
+    X10http();
+    // Public methods
+    void begin();
+    uint8_t parse(char c);
+    bool isDone();
+    uint8_t getMethod();
+    bool isHttp11();
+    const char *getPath();
+    const char *getName();
+    const char *getValue();
+    uint8_t getValueLength();
+
+  private:
+    // Parser state
+    uint8_t state, method;
+    bool http11, isJson;
+    uint32_t bodyLeft;
+    // Line or field buffer: name, '\0', value, '\0'. Buffer is cleared when
+    // the byte after a parsed line or field is parsed.
+    char buffer[X10_HTTP_BUFFER_MAX + 1];
+    uint8_t length, valueIx;
+    bool isCleared;
+    // Url encoding and quoted text fields
+    uint8_t encodedLeft, encodedChar;
+    bool isQuoted;
+    // JSON fields
+    bool isEscaped, isValue;
+    // Private methods
+    void append(char c);
+    void clearBuffer();
+    bool decode(char &c);
+    void split(uint8_t ix, uint8_t skip);
+    uint8_t endLine();
+    uint8_t endRequestLine();
+    uint8_t endHeader();
+    uint8_t parseBody(char c);
+    uint8_t parseJsonBody(char c);
+    uint8_t endField();
+    static uint8_t hexToDecimal(char c);
+};
+
+#endif
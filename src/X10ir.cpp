@@ -18,24 +18,37 @@
 /************************************************************************/
 
 #include "X10ir.h"
+#include "X10irDecoder.h"
 
-const uint8_t X10ir::HOUSE_CODE[16] =
+X10ir *x10irInstance[X10_IR_MAX_RECEIVERS];
+uint8_t x10irInstanceCount = 0;
+
+// Receive interrupt wrappers are generated at compile time, one per receiver
+template<uint8_t ix> void x10irReceive_wrapper()
 {
-  B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
-  B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100,
-};
-const uint8_t X10ir::UNIT_CODE[16] =
+  x10irInstance[ix]->receive();
+}
+
+typedef void (*x10irWrapper_t)();
+const x10irWrapper_t x10irReceive_wrappers[X10_IR_MAX_RECEIVERS] =
 {
-  B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
-  B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100,
+  x10irReceive_wrapper<0>,
+#if X10_IR_MAX_RECEIVERS > 1
+  x10irReceive_wrapper<1>,
+#endif
+#if X10_IR_MAX_RECEIVERS > 2
+  x10irReceive_wrapper<2>,
+#endif
+#if X10_IR_MAX_RECEIVERS > 3
+  x10irReceive_wrapper<3>,
+#endif
 };
 
-X10ir *x10irInstance = NULL;
-
-void x10irReceive_wrapper()
-{
-  if(x10irInstance) x10irInstance->receive();
-}
+uint8_t X10ir::lastIx = 0xFF;
+uint8_t X10ir::lastUnit;
+uint8_t X10ir::lastCommand;
+char X10ir::lastHouse;
+uint32_t X10ir::lastMs;
 
 X10ir::X10ir(uint8_t receiveInt, uint8_t receivePin, char defaultHouse, irReceiveCallback_t irReceiveCallback)
 {
@@ -44,12 +57,22 @@ X10ir::X10ir(uint8_t receiveInt, uint8_t receivePin, char defaultHouse, irReceiv
   this->receivePort = digitalPinToPort(receivePin);
   this->receiveBitMask = digitalPinToBitMask(receivePin);
   this->irReceiveCallback = irReceiveCallback;
+  capture = NULL;
+  decoders = NULL;
+  edgeUs = 0;
+  receiveEnded = 0;
 #if X10_IR_UNIT_RESET_TIME
   this->defaultHouse = defaultHouse;
 #endif
   house = defaultHouse;
   command = DATA_UNKNOWN;
-  x10irInstance = this;
+  // Receivers beyond X10_IR_MAX_RECEIVERS are not started by begin method
+  receiverIx = x10irInstanceCount;
+  if(receiverIx < X10_IR_MAX_RECEIVERS)
+  {
+    x10irInstance[receiverIx] = this;
+    x10irInstanceCount++;
+  }
 }
 
 //////////////////////////////
@@ -58,109 +81,204 @@ X10ir::X10ir(uint8_t receiveInt, uint8_t receivePin, char defaultHouse, irReceiv
 
 void X10ir::begin()
 {
-  if(irReceiveCallback)
+  if(!capture && irReceiveCallback && receiverIx < X10_IR_MAX_RECEIVERS)
   {
     pinMode(receivePin, INPUT);
-    attachInterrupt(receiveInt, x10irReceive_wrapper, CHANGE);
+    attachInterrupt(receiveInt, x10irReceive_wrappers[receiverIx], CHANGE);
   }
 }
 
+// Use in stead of begin when the receiver is connected to the capture timer input
+// pin (see X10capture.h), poll must then be called from loop to decode the edges
+// Returns true when edge capture is not supported
+bool X10ir::beginCapture(X10capture *capture)
+{
+  if(capture->begin()) return 1;
+  this->capture = capture;
+  begin();
+  return 0;
+}
+
+// Decodes edges buffered by the capture timer and passes buffered events on
+// to the callback, call from loop
+void X10ir::poll()
+{
+  bool level;
+  uint16_t lengthUs;
+  while(capture && capture->read(level, lengthUs))
+  {
+    decodeEdge(level, lengthUs);
+    // Edge time is only known by the capture timer, so idle time is counted
+    // from when the edge is decoded
+    edgeUs = micros();
+  }
+  // Let decoders end frames that are only ended by the silence after them
+  uint8_t sreg = SREG;
+  cli();
+  if(
+    decoders && micros() - edgeUs > X10_IR_DECODER_IDLE_US &&
+    *portInputRegister(receivePort) & receiveBitMask)
+  {
+    for(X10irDecoder *decoder = decoders; decoder; decoder = decoder->next)
+    {
+      decoder->idle();
+    }
+  }
+  SREG = sreg;
+#if X10_IR_DEFERRED_EVENTS
+  while(eventBf.read(event))
+  {
+    irReceiveCallback(event.house, event.unit, event.command, event.isRepeat);
+  }
+#endif
+}
+
+// Adds a third party protocol decoder (NEC, RC5 or Sony) run on the receive pin
+void X10ir::addDecoder(X10irDecoder *decoder)
+{
+  uint8_t sreg = SREG;
+  cli();
+  decoder->receiver = this;
+  decoder->next = decoders;
+  decoders = decoder;
+  SREG = sreg;
+}
+
+// Returns the learned length window of bit 0 or bit 1
+const X10pulseClass &X10ir::getPulseClass(bool bit)
+{
+  return bit ? engine.bit1 : engine.bit0;
+}
+
+// Returns the number of rejected frames per reason and the last reason
+const X10pulseStats &X10ir::getRejectStats()
+{
+  return engine.stats;
+}
+
+#if X10_IR_DEFERRED_EVENTS
+// Returns the event being passed on, use in callback to get the number of
+// repeats collapsed into the event and when it was received
+const X10event &X10ir::getEvent()
+{
+  return event;
+}
+
+// Returns number of events dropped because poll was not called often enough
+uint16_t X10ir::getEventOverflowCount()
+{
+  return eventBf.getOverflowCount();
+}
+#endif
+
+// Forgets learned bit lengths and clears rejected frame counters
+void X10ir::resetPulseClasses()
+{
+  uint8_t sreg = SREG;
+  cli();
+  engine.bit0.reset();
+  engine.bit1.reset();
+  engine.stats.reset();
+  SREG = sreg;
+}
+
 //////////////////////////////
 /// Public (Interrupt Methods)
 //////////////////////////////
 
 void X10ir::receive()
 {
-  // Receive pin is Low
-  if(!(*portInputRegister(receivePort) & receiveBitMask))
+  uint32_t lengthUs = micros() - edgeUs;
+  edgeUs += lengthUs;
+  // Level that ended is the opposite of the current level
+  decodeEdge(!(*portInputRegister(receivePort) & receiveBitMask), lengthUs > 0xFFFF ? 0xFFFF : lengthUs);
+}
+
+// Called by third party protocol decoders when a code in their code map is received
+void X10ir::handleDecoded(char house, uint8_t unit, uint8_t command, bool isRepeat)
+{
+  this->house = house;
+  this->unit = unit;
+  this->command = command;
+  receiveEnded = millis();
+  triggerCallback(isRepeat);
+}
+
+//////////////////////////////
+/// Protocol Descriptor
+//////////////////////////////
+
+// Frames are only checked when the end burst is received
+uint8_t X10irProtocol::checkFrame(uint32_t buffer, uint16_t /* extBuffer */, uint8_t bits, bool isEnded)
+{
+  if(!isEnded || (bits != 10 && bits != 8)) return X10_FRAME_CONTINUE;
+  // Data bits are followed by the same number of complementary bits
+  uint8_t dataBits = bits / 2;
+  uint8_t mask = (1 << dataBits) - 1;
+  if(((buffer >> dataBits ^ buffer) & mask) != mask) return X10_FRAME_INVALID;
+  return bits == 10 ? X10_IR_FRAME_COMMAND : X10_IR_FRAME_HOUSE;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+void X10ir::decodeEdge(bool level, uint16_t lengthUs)
+{
+  // X10 IR pulse length is the time the receive pin was low
+  if(!level) decodePulse(lengthUs);
+  for(X10irDecoder *decoder = decoders; decoder; decoder = decoder->next)
   {
-    lowUs = micros();
+    decoder->decode(level, lengthUs);
   }
-  // Receive pin is High
-  else
+}
+
+void X10ir::decodePulse(uint16_t lengthUs)
+{
+  switch(engine.decode(lengthUs))
   {
-    if(lowUs)
-    {
-      lowUs = micros() - lowUs;
-      if(lowUs >= X10_IR_SB_MIN && lowUs <= X10_IR_SB_MAX)
+    case X10_PULSE_REPEAT:
+      // A held button keeps the house and unit codes from being reset
+      receiveEnded = millis();
+      triggerCallback(1);
+      break;
+    case X10_PULSE_FRAME:
+      if(engine.format == X10_IR_FRAME_COMMAND)
       {
-#if X10_IR_UNIT_RESET_TIME
-        // If more than specified unit reset time in milliseconds has passed since the last successful
-        // IR command was received, set the house and unit code back to their default values
-        if(receiveEnded && (millis() - receiveEnded > X10_IR_UNIT_RESET_TIME || receiveEnded > millis()))
-        {
-          house = defaultHouse;
-          unit = 0;
-        }
-#endif
-        // Since receiving every command repeat will waste CPU cycles, let's assume that a
-        // consecutive command received within a certain threshold is the same as the last one
-        if(receiveEnded && millis() > receiveEnded && millis() - receiveEnded < X10_IR_REPEAT_THRESHOLD)
-        {
-          receiveEnded = millis();
-          triggerCallback(1);
-        }
-        else
-        {
-          receiveEnded = 0;
-          receiveBuffer = 0;
-          receivedCount = 1;
-        }
+        handleCommand((engine.buffer >> 5 & B11111) << 3);
       }
-      else if(receivedCount)
+      else
       {
-        // Message to long: stop receiving
-        if(receivedCount > 11)
-        {
-          receivedCount = -1;
-        }
-        // Binary one received: add to buffer
-        else if(lowUs >= X10_IR_BIT1_MIN && lowUs <= X10_IR_BIT1_MAX)
-        {
-          receiveBuffer += B1 << (16 - receivedCount);
-        }
-        // Invalid pulse length or end pulse: stop receiving
-        else if(lowUs < X10_IR_BIT0_MIN || lowUs > X10_IR_BIT0_MAX)
-        {
-          // If end pulse was detected: validate and parse
-          if(lowUs > X10_IR_EB_MIN)
-          {
-            // Unit and Command (5 bits + 5 complementary bits)
-            if(receivedCount == 11 && validateData(receiveBuffer, 5))
-            {
-              handleCommand(receiveBuffer >> 8 & B11111000);
-            }
-            // House (4 bits + 4 complementary bits)
-            else if(receivedCount == 9 && validateData(receiveBuffer, 4))
-            {
-              // Mark byte as house code by setting last bit
-              handleCommand(receiveBuffer >> 8 & B11110000 | B1);
-            }
-          }
-          receivedCount = -1;
-        }
-        receivedCount++;
+        // Mark byte as house code by setting last bit
+        handleCommand((engine.buffer >> 4 & B1111) << 4 | B1);
       }
-    }
+      break;
   }
 }
 
-//////////////////////////////
-/// Private
-//////////////////////////////
-
 void X10ir::handleCommand(uint8_t data)
 {
+#if X10_IR_UNIT_RESET_TIME
+  // If more than specified unit reset time in milliseconds has passed since the last successful
+  // IR command was received, set the house and unit code back to their default values. This is
+  // checked when a valid frame is received, not on every start burst like in v1.x, so a start
+  // burst of a frame that fails validation no longer resets them.
+  if(receiveEnded && (millis() - receiveEnded > X10_IR_UNIT_RESET_TIME || receiveEnded > millis()))
+  {
+    house = defaultHouse;
+    unit = 0;
+  }
+#endif
   receiveEnded = millis();
   switch(data & B1111)
   {
     case X10_IR_TYPE_HOUSE:
-      house = findCodeIndex(HOUSE_CODE, data >> 4) + 65;
+      house = x10decode(data >> 4) + 65;
       unit = 0;
       command = DATA_UNKNOWN;
       break;
     case X10_IR_TYPE_UNIT:
-      unit = findCodeIndex(UNIT_CODE, data >> 4) + 1;
+      unit = x10decode(data >> 4) + 1;
       command = CMD_ADDRESS;
       triggerCallback(0);
       break;
@@ -173,34 +291,28 @@ void X10ir::handleCommand(uint8_t data)
 
 void X10ir::triggerCallback(bool isRepeat)
 {
+  // Drop command if it was just passed on by another receiver
   if(
+    lastIx != receiverIx && lastIx != 0xFF && house == lastHouse && unit == lastUnit &&
+    command == lastCommand && millis() - lastMs < X10_IR_REPEAT_THRESHOLD)
+  {
+    return;
+  }
+  lastIx = receiverIx;
+  lastHouse = house;
+  lastUnit = unit;
+  lastCommand = command;
+  lastMs = millis();
+  bool isHouseCommand =
     command == CMD_ALL_UNITS_OFF ||
     command == CMD_ALL_LIGHTS_ON ||
     command == CMD_DIM ||
-    command == CMD_BRIGHT)
-  {
-    irReceiveCallback(house, 0, command, isRepeat);
-  }
-  else if(unit > 0)
-  {
-    irReceiveCallback(house, unit, command, isRepeat);
-  }
-}
-
-bool X10ir::validateData(uint16_t data, uint8_t bits)
-{
-  for(uint8_t i = 0; i < bits; i++)
-  {
-    if(data >> 15 - i & B1 == data >> 15 - bits - i & B1) return 0;
-  }
-  return 1;
-}
-
-int8_t X10ir::findCodeIndex(const uint8_t codeList[16], uint8_t code)
-{
-  for(uint8_t i = 0; i <= 0xF; i++)
-  {
-    if(codeList[i] == code) return i;
-  }
-  return -1;
+    command == CMD_BRIGHT;
+  if(!isHouseCommand && !unit) return;
+#if X10_IR_DEFERRED_EVENTS
+  X10event commandEvent = { house, (uint8_t)(isHouseCommand ? 0 : unit), command, isRepeat, 0, lastMs };
+  eventBf.write(commandEvent);
+#else
+  irReceiveCallback(house, isHouseCommand ? 0 : unit, command, isRepeat);
+#endif
 }
\ No newline at end of file
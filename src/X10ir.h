@@ -21,6 +21,10 @@
 #define X10ir_h
 
 #include "Arduino.h"
+#include "X10pulse.h"
+#include "X10capture.h"
+#include "X10event.h"
+#include "X10codec.h"
 
 // With IR remotes: house, unit and command are sent separately. A default
 // house code is set when initializing the IR library; this makes it
@@ -30,6 +34,8 @@
 // reset the house and unit codes to their default values after some time.
 // The default behavior is to reset the house and unit codes after 20
 // seconds of silence. To disable this feature set the reset time to 0.
+// Repeats (button held) count as IR commands. The reset is applied when the
+// next valid frame is received, before it is handled.
 #define X10_IR_UNIT_RESET_TIME  20000
 
 // IR initial start burst min length
@@ -38,6 +44,9 @@
 #define X10_IR_SB_MAX            4400
 // IR end burst min length
 #define X10_IR_EB_MIN           11000
+// IR bit 0 and bit 1 min and max lengths. When X10_PULSE_LEARN is enabled
+// (see X10pulse.h) these are the initial windows, and the learned windows
+// never extend more than a quarter of the lengths outside them.
 // IR bit 0 min length
 #define X10_IR_BIT0_MIN          1050
 // IR bit 0 max length
@@ -50,11 +59,25 @@
 // of the last command received, it is assumed that the following command
 // is the same and that it does not need to be parsed
 #define X10_IR_REPEAT_THRESHOLD   250
+// Number of IR receivers that can be used at the same time. When the same
+// command is received by more than one receiver within the repeat threshold,
+// it is only passed on to the receive callback by the first receiver.
+#define X10_IR_MAX_RECEIVERS        2
+// Received commands are buffered by the receive interrupt and passed on to
+// the callback when poll is called from loop. Set to 0 to call the callback
+// directly from the receive interrupt.
+#define X10_IR_DEFERRED_EVENTS      1
+// Number of buffered events, must be a power of two (one slot is kept free)
+#define X10_IR_EVENT_BUFFER_SIZE    8
 
 #define X10_IR_TYPE_HOUSE   B0001
 #define X10_IR_TYPE_UNIT    B0000
 #define X10_IR_TYPE_COMMAND B1000
 
+// IR frame formats, returned by X10irProtocol::checkFrame
+#define X10_IR_FRAME_COMMAND  0 // Unit or command: 5 bits + 5 complementary bits
+#define X10_IR_FRAME_HOUSE    1 // House: 4 bits + 4 complementary bits
+
 #define DATA_UNKNOWN        0xF0
 
 #define CMD_ADDRESS         0x10
@@ -66,6 +89,25 @@
 #define CMD_DIM             B0100
 #define CMD_BRIGHT          B0101
 
+// X10 IR protocol descriptor used by the pulse engine (see X10pulse.h)
+class X10irDecoder;
+
+struct X10irProtocol
+{
+  static const uint16_t SB_MIN = X10_IR_SB_MIN;
+  static const uint16_t RSB_MIN = X10_IR_SB_MIN;
+  static const uint16_t SB_MAX = X10_IR_SB_MAX;
+  static const uint16_t BIT0_MIN = X10_IR_BIT0_MIN;
+  static const uint16_t BIT0_MAX = X10_IR_BIT0_MAX;
+  static const uint16_t BIT1_MIN = X10_IR_BIT1_MIN;
+  static const uint16_t BIT1_MAX = X10_IR_BIT1_MAX;
+  static const uint16_t EB_MIN = X10_IR_EB_MIN;
+  static const uint8_t MAX_BITS = 10;
+  static const bool MSB_FIRST = 1;
+  static const uint16_t REPEAT_THRESHOLD = X10_IR_REPEAT_THRESHOLD;
+  static uint8_t checkFrame(uint32_t buffer, uint16_t extBuffer, uint8_t bits, bool isEnded);
+};
+
 class X10ir
 {
 
@@ -74,28 +116,50 @@ public:
   X10ir(uint8_t receiveInt, uint8_t receivePin, char defaultHouse, irReceiveCallback_t irReceiveCallback);
   // Public methods
   void begin();
+  bool beginCapture(X10capture *capture);
+  void poll();
+  void addDecoder(X10irDecoder *decoder);
+  const X10pulseClass &getPulseClass(bool bit);
+  const X10pulseStats &getRejectStats();
+  void resetPulseClasses();
+#if X10_IR_DEFERRED_EVENTS
+  const X10event &getEvent();
+  uint16_t getEventOverflowCount();
+#endif
   void receive();
+  void handleDecoded(char house, uint8_t unit, uint8_t command, bool isRepeat);
   
 private:
-  static const uint8_t HOUSE_CODE[16];
-  static const uint8_t UNIT_CODE[16];
   // Set in constructor
   uint8_t receiveInt, receivePin, receivePort, receiveBitMask;
   irReceiveCallback_t irReceiveCallback;
+  // Set when edges are timestamped by capture timer
+  X10capture *capture;
+  // Third party protocol decoders run on the same pin (see X10irDecoder.h)
+  X10irDecoder *decoders;
   // Used by interrupt triggered methods
-  uint32_t lowUs, receiveEnded;
+  uint32_t edgeUs, receiveEnded;
 #if X10_IR_UNIT_RESET_TIME
   char defaultHouse;
 #endif
   char house;
   uint8_t unit, command;
-  int8_t receivedCount;
-  uint16_t receiveBuffer;
+  X10pulseEngine<X10irProtocol> engine;
+  // Shared by all receivers, used to drop commands received by more than one receiver
+  static uint8_t lastIx, lastUnit, lastCommand;
+  static char lastHouse;
+  static uint32_t lastMs;
+  uint8_t receiverIx;
+#if X10_IR_DEFERRED_EVENTS
+  // Written by receive interrupt, read by poll
+  X10eventBuffer<X10event, X10_IR_EVENT_BUFFER_SIZE> eventBf;
+  X10event event;
+#endif
   // Private methods
   void triggerCallback(bool isRepeat);
+  void decodeEdge(bool level, uint16_t lengthUs);
+  void decodePulse(uint16_t lengthUs);
   void handleCommand(uint8_t data);
-  bool validateData(uint16_t data, uint8_t bits);
-  int8_t findCodeIndex(const uint8_t codeList[16], uint8_t code);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+/************************************************************************/
+/* X10 IR receiver library, third party IR protocol decoders, v1.6.     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10irDecoder.h"
+#include "X10ir.h"
+
+#define X10_IR_NEC_IDLE   0
+#define X10_IR_NEC_HEADER 1
+#define X10_IR_NEC_DATA   2
+
+X10irDecoder::X10irDecoder(const X10irCode *codeMap, uint8_t codeCount)
+{
+  this->codeMap = codeMap;
+  this->codeCount = codeCount;
+  receiver = NULL;
+  next = NULL;
+  hasLastCode = 0;
+  lastCode = 0;
+  lastMs = 0;
+}
+
+//////////////////////////////
+/// Protected
+//////////////////////////////
+
+// Looks up code in code map and passes the mapped command on to the receiver
+void X10irDecoder::handleCode(uint16_t code, bool isRepeat)
+{
+  for(uint8_t i = 0; i < codeCount; i++)
+  {
+    if(pgm_read_word(&codeMap[i].code) == code)
+    {
+      uint8_t houseUnit = pgm_read_byte(&codeMap[i].houseUnit);
+      receiver->handleDecoded(
+        (houseUnit >> 4) + 65, (houseUnit & B1111) + 1,
+        pgm_read_byte(&codeMap[i].command), isRepeat);
+      return;
+    }
+  }
+}
+
+// Returns true when the same code was received within the repeat threshold
+bool X10irDecoder::isRepeatCode(uint16_t code)
+{
+  bool isRepeat = hasLastCode && code == lastCode && millis() - lastMs < X10_IR_CODE_REPEAT_THRESHOLD;
+  hasLastCode = 1;
+  lastCode = code;
+  lastMs = millis();
+  return isRepeat;
+}
+
+//////////////////////////////
+/// NEC
+//////////////////////////////
+
+X10irNec::X10irNec(const X10irCode *codeMap, uint8_t codeCount) :
+  X10irDecoder(codeMap, codeCount)
+{
+  state = X10_IR_NEC_IDLE;
+}
+
+void X10irNec::decode(bool level, uint16_t lengthUs)
+{
+  // Mark
+  if(!level)
+  {
+    if(lengthUs >= X10_IR_NEC_HDR_MARK_MIN && lengthUs <= X10_IR_NEC_HDR_MARK_MAX)
+    {
+      state = X10_IR_NEC_HEADER;
+    }
+    else if(lengthUs < X10_IR_NEC_BIT_MARK_MIN || lengthUs > X10_IR_NEC_BIT_MARK_MAX)
+    {
+      state = X10_IR_NEC_IDLE;
+    }
+  }
+  // Space after header mark: data follows, or this is a repeat code
+  else if(state == X10_IR_NEC_HEADER)
+  {
+    state = X10_IR_NEC_IDLE;
+    if(lengthUs >= X10_IR_NEC_HDR_SPACE_MIN && lengthUs <= X10_IR_NEC_HDR_SPACE_MAX)
+    {
+      state = X10_IR_NEC_DATA;
+      count = 0;
+      buffer = 0;
+    }
+    else if(lengthUs >= X10_IR_NEC_RPT_SPACE_MIN && lengthUs <= X10_IR_NEC_RPT_SPACE_MAX)
+    {
+      // Repeat code is ignored when no code was received before it
+      if(hasLastCode && millis() - lastMs < X10_IR_CODE_REPEAT_THRESHOLD)
+      {
+        lastMs = millis();
+        handleCode(lastCode, 1);
+      }
+    }
+  }
+  // Space after bit mark: bit length is given by space length
+  else if(state == X10_IR_NEC_DATA)
+  {
+    if(lengthUs >= X10_IR_NEC_BIT1_SPACE_MIN && lengthUs <= X10_IR_NEC_BIT1_SPACE_MAX)
+    {
+      buffer |= 1LU << count;
+    }
+    else if(lengthUs > X10_IR_NEC_BIT0_SPACE_MAX)
+    {
+      state = X10_IR_NEC_IDLE;
+      return;
+    }
+    if(++count == 32)
+    {
+      state = X10_IR_NEC_IDLE;
+      uint8_t command = buffer >> 16;
+      // Command is followed by its complement (address may be extended to 16 bits)
+      if((uint8_t)(buffer >> 24) == (uint8_t)~command)
+      {
+        uint16_t code = (buffer & 0xFF) << 8 | command;
+        handleCode(code, isRepeatCode(code));
+      }
+    }
+  }
+}
+
+//////////////////////////////
+/// RC5
+//////////////////////////////
+
+X10irRc5::X10irRc5(const X10irCode *codeMap, uint8_t codeCount) :
+  X10irDecoder(codeMap, codeCount)
+{
+  halfCount = 0xFF;
+  lastToggle = 0xFF;
+}
+
+void X10irRc5::decode(bool level, uint16_t lengthUs)
+{
+  uint8_t halfBits =
+    lengthUs >= X10_IR_RC5_HALF_MIN && lengthUs <= X10_IR_RC5_HALF_MAX ? 1 :
+    lengthUs >= X10_IR_RC5_FULL_MIN && lengthUs <= X10_IR_RC5_FULL_MAX ? 2 : 0;
+  // Silence ended: first half of start bit is the end of the silence
+  if(level && lengthUs > X10_IR_RC5_FULL_MAX)
+  {
+    halfCount = 0;
+    buffer = 0;
+    addHalfBit(1);
+    return;
+  }
+  if(halfCount == 0xFF) return;
+  if(!halfBits)
+  {
+    halfCount = 0xFF;
+    return;
+  }
+  while(halfBits-- && halfCount != 0xFF)
+  {
+    addHalfBit(level);
+    // Last half bit is always the opposite of the one before, so frame is complete
+    if(halfCount == 27)
+    {
+      halfCount = 0xFF;
+      uint8_t toggle = buffer >> 11 & B1;
+      uint16_t code = (buffer >> 6 & B11111) << 8 | (buffer & B111111) | (~buffer >> 6 & B1000000);
+      bool isRepeat = isRepeatCode(code) && toggle == lastToggle;
+      lastToggle = toggle;
+      handleCode(code, isRepeat);
+    }
+  }
+}
+
+// Adds half bit, a bit is high then low for 1 and low then high for 0
+void X10irRc5::addHalfBit(bool level)
+{
+  if(!(halfCount & B1))
+  {
+    buffer = buffer << 1 | level;
+  }
+  // Second half of bit must be the opposite of the first
+  else if(level == (buffer & B1))
+  {
+    halfCount = 0xFF;
+    return;
+  }
+  halfCount++;
+}
+
+//////////////////////////////
+/// Sony
+//////////////////////////////
+
+X10irSony::X10irSony(const X10irCode *codeMap, uint8_t codeCount) :
+  X10irDecoder(codeMap, codeCount)
+{
+  count = 0xFF;
+}
+
+void X10irSony::decode(bool level, uint16_t lengthUs)
+{
+  // Mark: header or bit
+  if(!level)
+  {
+    if(lengthUs >= X10_IR_SONY_HDR_MARK_MIN && lengthUs <= X10_IR_SONY_HDR_MARK_MAX)
+    {
+      count = 0;
+      buffer = 0;
+    }
+    else if(count < 20 && lengthUs >= X10_IR_SONY_BIT1_MARK_MIN && lengthUs <= X10_IR_SONY_BIT1_MARK_MAX)
+    {
+      buffer |= 1LU << count++;
+    }
+    else if(count < 20 && lengthUs >= X10_IR_SONY_BIT0_MARK_MIN && lengthUs <= X10_IR_SONY_BIT0_MARK_MAX)
+    {
+      count++;
+    }
+    else
+    {
+      count = 0xFF;
+    }
+    // No frame is longer than 20 bits: no need to wait for the silence
+    if(count == 20) endFrame();
+  }
+  // Space: frame is ended by the silence following the last bit
+  else if(count != 0xFF && (lengthUs < X10_IR_SONY_SPACE_MIN || lengthUs > X10_IR_SONY_SPACE_MAX))
+  {
+    endFrame();
+  }
+}
+
+// The silence following the last bit of a 12 or 15 bit frame only ends when
+// the next frame starts, so the frame is ended when the receiver goes idle
+void X10irSony::idle()
+{
+  if(count != 0xFF) endFrame();
+}
+
+//////////////////////////////
+/// Sony (Private)
+//////////////////////////////
+
+void X10irSony::endFrame()
+{
+  if(count == 12 || count == 15 || count == 20)
+  {
+    uint16_t code = buffer;
+    handleCode(code, isRepeatCode(code));
+  }
+  count = 0xFF;
+}
@@ -0,0 +1,165 @@
+/************************************************************************/
+/* X10 IR receiver library, third party IR protocol decoders, v1.6.     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10irDecoder_h
+#define X10irDecoder_h
+
+#include "Arduino.h"
+#include "avr/pgmspace.h"
+
+// Codes received within this millisecond threshold of the same code are
+// passed on as repeats (button is held)
+#define X10_IR_CODE_REPEAT_THRESHOLD  200
+
+// NEC: 9ms header mark, 4.5ms space (2.25ms for repeat code), 32 bits sent
+// least significant bit first as 560us mark and 560us (0) or 1690us (1) space
+#define X10_IR_NEC_HDR_MARK_MIN      8000
+#define X10_IR_NEC_HDR_MARK_MAX     10000
+#define X10_IR_NEC_HDR_SPACE_MIN     4000
+#define X10_IR_NEC_HDR_SPACE_MAX     5000
+#define X10_IR_NEC_RPT_SPACE_MIN     2000
+#define X10_IR_NEC_RPT_SPACE_MAX     2500
+#define X10_IR_NEC_BIT_MARK_MIN       400
+#define X10_IR_NEC_BIT_MARK_MAX       750
+#define X10_IR_NEC_BIT0_SPACE_MAX     750
+#define X10_IR_NEC_BIT1_SPACE_MIN    1400
+#define X10_IR_NEC_BIT1_SPACE_MAX    1900
+
+// RC5: 14 bi-phase bits (start, field, toggle, 5 address and 6 command bits)
+// sent most significant bit first with 889us half bits
+#define X10_IR_RC5_HALF_MIN           640
+#define X10_IR_RC5_HALF_MAX          1140
+#define X10_IR_RC5_FULL_MIN          1460
+#define X10_IR_RC5_FULL_MAX          2000
+
+// Sony SIRC: 2.4ms header mark, 12, 15 or 20 bits sent least significant bit
+// first as 600us (0) or 1200us (1) mark and 600us space (7 command bits first)
+#define X10_IR_SONY_HDR_MARK_MIN     2000
+#define X10_IR_SONY_HDR_MARK_MAX     2800
+#define X10_IR_SONY_BIT0_MARK_MIN     400
+#define X10_IR_SONY_BIT0_MARK_MAX     800
+#define X10_IR_SONY_BIT1_MARK_MIN     900
+#define X10_IR_SONY_BIT1_MARK_MAX    1500
+#define X10_IR_SONY_SPACE_MIN         400
+#define X10_IR_SONY_SPACE_MAX         800
+
+// Decoders that can only tell that a frame is complete by the silence after
+// it are told when the receive pin has been idle (high) this long, so the
+// frame is passed on from poll, not when the next frame starts
+#define X10_IR_DECODER_IDLE_US       2000
+
+// Maps a code received by a decoder to an X10 command. Use X10_IR_CODE to
+// create code map entries, the code map must be stored in PROGMEM, e.g.
+//
+// const X10irCode necCodes[] PROGMEM =
+// {
+//   X10_IR_CODE(0x0012, 'A', 1, CMD_ON),
+//   X10_IR_CODE(0x0013, 'A', 1, CMD_OFF),
+// };
+// X10irNec nec(necCodes, sizeof(necCodes) / sizeof(X10irCode));
+struct X10irCode
+{
+  uint16_t code;
+  uint8_t houseUnit; // House (0-15) in high nibble and unit (1-16) - 1 in low nibble
+  uint8_t command;
+};
+
+#define X10_IR_CODE(code, house, unit, command) \
+  { code, (uint8_t)(((house) - 'A') << 4 | (((unit) - 1) & 0xF)), command }
+
+class X10ir;
+
+// Base class of IR protocol decoders run on the X10ir receive pin. Decoders
+// are fed every edge: the level that ended and how long it lasted. IR
+// receiver modules output low when a mark (modulated burst) is received.
+class X10irDecoder
+{
+
+  public:
+    X10irDecoder(const X10irCode *codeMap, uint8_t codeCount);
+    // Public methods (called from interrupt)
+    virtual void decode(bool level, uint16_t lengthUs) = 0;
+    virtual void idle() { }
+
+  protected:
+    void handleCode(uint16_t code, bool isRepeat);
+    bool isRepeatCode(uint16_t code);
+    // Last code received, valid when hasLastCode is set
+    bool hasLastCode;
+    uint16_t lastCode;
+    uint32_t lastMs;
+
+  private:
+    friend class X10ir;
+    // Set when decoder is added to receiver
+    X10ir *receiver;
+    X10irDecoder *next;
+    // Set in constructor
+    const X10irCode *codeMap;
+    uint8_t codeCount;
+};
+
+// NEC decoder, the code is the address (low byte) and the command:
+// address << 8 | command
+class X10irNec : public X10irDecoder
+{
+
+  public:
+    X10irNec(const X10irCode *codeMap, uint8_t codeCount);
+    virtual void decode(bool level, uint16_t lengthUs);
+
+  private:
+    uint8_t state, count;
+    uint32_t buffer;
+};
+
+// RC5 decoder, the code is the address and the command (the seventh RC5X
+// command bit is set when the field bit is cleared): address << 8 | command
+class X10irRc5 : public X10irDecoder
+{
+
+  public:
+    X10irRc5(const X10irCode *codeMap, uint8_t codeCount);
+    virtual void decode(bool level, uint16_t lengthUs);
+
+  private:
+    uint8_t halfCount, lastToggle;
+    uint16_t buffer;
+    void addHalfBit(bool level);
+};
+
+// Sony SIRC decoder, the code is the address and the command (only the
+// lower 9 address bits are kept from 20 bit frames): address << 7 | command
+// 12 and 15 bit frames are passed on by X10ir poll, once the receive pin has
+// been idle for X10_IR_DECODER_IDLE_US, so poll must be called from loop
+class X10irSony : public X10irDecoder
+{
+
+  public:
+    X10irSony(const X10irCode *codeMap, uint8_t codeCount);
+    virtual void decode(bool level, uint16_t lengthUs);
+    virtual void idle();
+
+  private:
+    uint8_t count;
+    uint32_t buffer;
+    void endFrame();
+};
+
+#endif
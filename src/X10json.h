@@ -0,0 +1,119 @@
+/************************************************************************/
+/* X10 JSON serializer, module state and info as compact JSON, v1.6.    */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10json_h
+#define X10json_h
+
+#include "Arduino.h"
+#include "X10ex.h"
+
+// Prints string in quotes, escaping quotes, backslashes and control characters
+static inline void x10printJsonString(Print &out, const char *str)
+{
+  out.print('"');
+  for(; *str; str++)
+  {
+    char c = *str;
+    if(c == '"' || c == '\\')
+    {
+      out.print('\\');
+      out.print(c);
+    }
+    else if((uint8_t)c < 0x20)
+    {
+      out.print("\\u00");
+      out.print(c >> 4, HEX);
+      out.print(c & 0xF, HEX);
+    }
+    else
+    {
+      out.print(c);
+    }
+  }
+  out.print('"');
+}
+
+// Prints module as one JSON object, e.g.
+// {"house":"A","unit":3,"url":"/A/3/","type":2,"name":"Hall","on":true,"brightness":50}
+// Type and name are left out when not set, on and brightness when not known.
+static inline void x10printJsonModule(
+  Print &out, X10ex &x10ex, char house, uint8_t unit, const X10state &state, const X10info &info)
+{
+  out.print("{\"house\":\"");
+  out.print(house);
+  out.print("\",\"unit\":");
+  out.print(unit, DEC);
+  out.print(",\"url\":\"/");
+  out.print(house);
+  out.print('/');
+  out.print(unit, DEC);
+  out.print("/\"");
+  if(info.type)
+  {
+    out.print(",\"type\":");
+    out.print(info.type, DEC);
+  }
+  if(info.name[0])
+  {
+    out.print(",\"name\":");
+    x10printJsonString(out, info.name);
+  }
+  if(state.isKnown)
+  {
+    out.print(",\"on\":");
+    out.print(state.isOn ? "true" : "false");
+    if(state.data)
+    {
+      out.print(",\"brightness\":");
+      out.print(x10ex.x10BrightnessToPercent(state.data), DEC);
+    }
+  }
+  out.print('}');
+}
+
+// Prints command as one JSON object, e.g. {"house":"A","unit":3,"command":2}
+// Unit is left out when not known, command when it's not an X10 command (e.g.
+// the IR address command), and extended code fields when not extended code.
+static inline void x10printJsonCommand(
+  Print &out, char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand)
+{
+  out.print("{\"house\":\"");
+  out.print(house);
+  out.print('"');
+  if(unit && unit != DATA_UNKNOWN)
+  {
+    out.print(",\"unit\":");
+    out.print(unit, DEC);
+  }
+  if(command <= 0xF)
+  {
+    out.print(",\"command\":");
+    out.print(command, DEC);
+  }
+  if(extCommand)
+  {
+    out.print(",\"extCommand\":");
+    out.print(extCommand, DEC);
+    out.print(",\"extData\":");
+    out.print(extData, DEC);
+  }
+  out.print('}');
+}
+
+#endif
@@ -0,0 +1,78 @@
+/************************************************************************/
+/* X10 RF and IR pulse classifier library, v1.6.                        */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10pulse.h"
+
+X10pulseClass::X10pulseClass(uint16_t fixedMinUs, uint16_t fixedMaxUs)
+{
+  this->fixedMinUs = fixedMinUs;
+  this->fixedMaxUs = fixedMaxUs;
+  reset();
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+void X10pulseClass::reset()
+{
+  minUs = fixedMinUs;
+  maxUs = fixedMaxUs;
+  centerUs = (fixedMinUs + fixedMaxUs) / 2;
+  discard();
+}
+
+// Called when the frame the samples were taken from has passed validation
+void X10pulseClass::learn()
+{
+#if X10_PULSE_LEARN
+  if(sampleCount)
+  {
+    // Moving average applied once per frame: the center moves 1/2^N of the
+    // way towards the average length sampled from the frame. Without the
+    // division, a 32 bit frame would move the center all the way at once.
+    // The step is rounded to nearest, away from zero at half, so that drift
+    // up is tracked as well as drift down (a shift rounds down).
+    int16_t diff = ((int32_t)sampleSum - (int32_t)sampleCount * centerUs) / sampleCount;
+    int16_t half = 1 << (X10_PULSE_LEARN_SHIFT - 1);
+    centerUs += (diff + (diff < 0 ? -half : half)) / (1 << X10_PULSE_LEARN_SHIFT);
+    // The window keeps the width of the fixed window and is centered on the
+    // learned length, but is clamped so it never moves outside safe bounds
+    uint16_t halfWidth = (fixedMaxUs - fixedMinUs) / 2;
+    uint16_t lowBound = fixedMinUs - (fixedMinUs >> X10_PULSE_BOUND_SHIFT);
+    uint16_t highBound = fixedMaxUs + (fixedMaxUs >> X10_PULSE_BOUND_SHIFT);
+    if(centerUs < lowBound + halfWidth) centerUs = lowBound + halfWidth;
+    if(centerUs > highBound - halfWidth) centerUs = highBound - halfWidth;
+    minUs = centerUs - halfWidth;
+    maxUs = centerUs + halfWidth;
+  }
+#endif
+  discard();
+}
+
+X10pulseStats::X10pulseStats()
+{
+  reset();
+}
+
+void X10pulseStats::reset()
+{
+  memset(count, 0, sizeof(count));
+  last = X10_REJECT_NONE;
+}
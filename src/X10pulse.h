@@ -0,0 +1,253 @@
+/************************************************************************/
+/* X10 RF and IR pulse classifier library, v1.6.                        */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10pulse_h
+#define X10pulse_h
+
+#include "Arduino.h"
+
+// Enables learning of bit pulse lengths from valid frames. Set this to 0 to
+// always use the fixed bit length windows defined in the RF and IR headers.
+#define X10_PULSE_LEARN         1
+// The learned center moves 1/2^N of the way towards the average bit length
+// of each valid frame
+#define X10_PULSE_LEARN_SHIFT   5
+// The learned window never extends more than 1/2^N outside fixed window
+#define X10_PULSE_BOUND_SHIFT   2
+
+// Frame rejection reasons
+#define X10_REJECT_NONE         0
+#define X10_REJECT_PULSE_LENGTH 1 // Pulse length outside bit windows
+#define X10_REJECT_CHECK        2 // Complement bits or unused bits check failed
+#define X10_REJECT_BIT_COUNT    3 // Frame ended early or was too long
+#define X10_REJECT_REASONS      4
+
+// Events returned by the pulse engine decode method
+#define X10_PULSE_NONE          0 // Nothing to handle
+#define X10_PULSE_REPEAT        1 // Start burst received within repeat threshold of last frame
+#define X10_PULSE_FRAME         2 // Valid frame received, see engine format and buffers
+
+// Returned by protocol checkFrame methods when no frame format is matched
+#define X10_FRAME_CONTINUE   0xFF // Frame is valid so far, keep receiving
+#define X10_FRAME_INVALID    0xFE // Complement bits or unused bits check failed
+
+// Classifies pulse lengths as one bit value (0 or 1). The window starts out
+// as the fixed min and max lengths. When X10_PULSE_LEARN is enabled, lengths
+// sampled from frames that pass validation move the center of the window,
+// so remotes and receivers with drifting timing are tracked. The window is
+// kept within safe bounds around the fixed window.
+class X10pulseClass
+{
+
+  public:
+    X10pulseClass(uint16_t fixedMinUs, uint16_t fixedMaxUs);
+    // Public methods
+    void reset();
+    void learn();
+    uint16_t getCenterUs() const { return centerUs; }
+    uint16_t getMinUs() const { return minUs; }
+    uint16_t getMaxUs() const { return maxUs; }
+    // Public methods (called from interrupt)
+    bool match(uint16_t lengthUs) const
+    {
+      return lengthUs >= minUs && lengthUs <= maxUs;
+    }
+    void sample(uint16_t lengthUs)
+    {
+#if X10_PULSE_LEARN
+      sampleSum += lengthUs;
+      sampleCount++;
+#endif
+    }
+    void discard()
+    {
+      sampleSum = 0;
+      sampleCount = 0;
+    }
+
+  private:
+    // Set in constructor
+    uint16_t fixedMinUs, fixedMaxUs;
+    // Learned window
+    uint16_t minUs, maxUs, centerUs;
+    // Lengths sampled from frame currently being received
+    uint32_t sampleSum;
+    uint8_t sampleCount;
+};
+
+// Keeps count of rejected frames per reason
+class X10pulseStats
+{
+
+  public:
+    X10pulseStats();
+    // Public methods
+    void reset();
+    uint16_t getCount(uint8_t reason) const { return reason < X10_REJECT_REASONS ? count[reason] : 0; }
+    uint8_t getLast() const { return last; }
+    // Public methods (called from interrupt)
+    void reject(uint8_t reason)
+    {
+      if(count[reason] < 0xFFFF) count[reason]++;
+      last = reason;
+    }
+
+  private:
+    uint16_t count[X10_REJECT_REASONS];
+    uint8_t last;
+};
+
+// Pulse protocol engine shared by the RF and IR receivers. Decodes pulse
+// lengths into frames: start bursts, bit windows, repeat threshold, frame
+// length and rejection reasons are handled here, while frame formats and
+// complement checks are given by the protocol descriptor. A descriptor is
+// a struct with the following static members:
+//
+// SB_MIN, RSB_MIN, SB_MAX: Start burst window, start bursts shorter than
+//   SB_MIN only count when received within the repeat threshold
+// BIT0_MIN, BIT0_MAX, BIT1_MIN, BIT1_MAX: Initial bit windows
+// EB_MIN: End burst min length, when set to 0 any pulse that is neither a
+//   bit nor a start burst ends the frame
+// MAX_BITS: Max bits in a frame (up to 48), bit 33 and up are stored in
+//   the extended buffer
+// MSB_FIRST: Set when bits are shifted into the buffer from the right,
+//   otherwise bits are stored least significant bit first
+// REPEAT_THRESHOLD: Start bursts received within this many milliseconds of
+//   the last valid frame are passed on as repeats
+// uint8_t checkFrame(uint32_t buffer, uint16_t extBuffer, uint8_t bits, bool isEnded):
+//   Called when a bit is received and when the frame is ended. Returns the
+//   frame format when the frame is complete and valid, X10_FRAME_CONTINUE
+//   or X10_FRAME_INVALID.
+template<class P> class X10pulseEngine
+{
+
+  public:
+    X10pulseEngine() :
+      bit0(P::BIT0_MIN, P::BIT0_MAX),
+      bit1(P::BIT1_MIN, P::BIT1_MAX)
+    {
+      isReceiving = 0;
+      receiveEnded = 0;
+    }
+    // Learned bit windows and rejected frame counters
+    X10pulseClass bit0, bit1;
+    X10pulseStats stats;
+    // Last valid frame, set before X10_PULSE_FRAME is returned
+    uint8_t format;
+    uint32_t buffer;
+    uint16_t extBuffer;
+    // Public methods (called from interrupt)
+    uint8_t decode(uint16_t lengthUs)
+    {
+      // Start burst: ends frame in progress, if any
+      if(lengthUs >= P::RSB_MIN && lengthUs <= P::SB_MAX)
+      {
+        uint8_t event = isReceiving ? endFrame(X10_REJECT_BIT_COUNT) : X10_PULSE_NONE;
+        // Since receiving every command repeat will waste CPU cycles, let's assume that a repeated
+        // start burst received within a certain threshold means that the same command is sent again
+        if(receiveEnded && millis() > receiveEnded && millis() - receiveEnded < P::REPEAT_THRESHOLD)
+        {
+          receiveEnded = millis();
+          return X10_PULSE_REPEAT;
+        }
+        receiveEnded = 0;
+        buffer = 0;
+        extBuffer = 0;
+        count = 0;
+        isReceiving = lengthUs >= P::SB_MIN;
+        return event;
+      }
+      if(!isReceiving) return X10_PULSE_NONE;
+      bool bit = bit1.match(lengthUs);
+      if(bit || bit0.match(lengthUs))
+      {
+        // Message to long: stop receiving
+        if(count == P::MAX_BITS) return endFrame(X10_REJECT_BIT_COUNT);
+        if(bit)
+        {
+          bit1.sample(lengthUs);
+          if(P::MSB_FIRST) buffer = buffer << 1 | 1;
+          else if(count < 32) buffer |= 1LU << count;
+          else extBuffer |= 1U << (count - 32);
+        }
+        else
+        {
+          bit0.sample(lengthUs);
+          if(P::MSB_FIRST) buffer <<= 1;
+        }
+        count++;
+        uint8_t format = P::checkFrame(buffer, extBuffer, count, 0);
+        if(format == X10_FRAME_CONTINUE) return X10_PULSE_NONE;
+        if(format == X10_FRAME_INVALID)
+        {
+          reject(X10_REJECT_CHECK);
+          return X10_PULSE_NONE;
+        }
+        return accept(format);
+      }
+      // End burst or invalid pulse length: stop receiving
+      if(lengthUs >= P::EB_MIN)
+      {
+        return endFrame(P::EB_MIN ? X10_REJECT_BIT_COUNT : X10_REJECT_PULSE_LENGTH);
+      }
+      reject(X10_REJECT_PULSE_LENGTH);
+      return X10_PULSE_NONE;
+    }
+
+  private:
+    uint8_t count;
+    bool isReceiving;
+    uint32_t receiveEnded;
+    uint8_t endFrame(uint8_t reason)
+    {
+      uint8_t format = P::checkFrame(buffer, extBuffer, count, 1);
+      if(format == X10_FRAME_CONTINUE)
+      {
+        reject(reason);
+      }
+      else if(format == X10_FRAME_INVALID)
+      {
+        reject(X10_REJECT_CHECK);
+      }
+      else
+      {
+        return accept(format);
+      }
+      return X10_PULSE_NONE;
+    }
+    uint8_t accept(uint8_t format)
+    {
+      // Frame passed validation: learn bit lengths
+      bit0.learn();
+      bit1.learn();
+      this->format = format;
+      isReceiving = 0;
+      receiveEnded = millis();
+      return X10_PULSE_FRAME;
+    }
+    void reject(uint8_t reason)
+    {
+      stats.reject(reason);
+      bit0.discard();
+      bit1.discard();
+      isReceiving = 0;
+    }
+};
+
+#endif
@@ -19,25 +19,83 @@
 
 #include "X10rf.h"
 
-const uint8_t X10rf::HOUSE_CODE[16] =
+X10rf *x10rfInstance[X10_RF_MAX_RECEIVERS];
+uint8_t x10rfInstanceCount = 0;
+
+// Receive interrupt wrappers are generated at compile time, one per receiver
+template<uint8_t ix> void x10rfReceive_wrapper()
+{
+  x10rfInstance[ix]->receive();
+}
+
+typedef void (*x10rfWrapper_t)();
+const x10rfWrapper_t x10rfReceive_wrappers[X10_RF_MAX_RECEIVERS] =
 {
-  B0110,B1110,B0010,B1010,B0001,B1001,B0101,B1101,
-  B0111,B1111,B0011,B1011,B0000,B1000,B0100,B1100,
+  x10rfReceive_wrapper<0>,
+#if X10_RF_MAX_RECEIVERS > 1
+  x10rfReceive_wrapper<1>,
+#endif
+#if X10_RF_MAX_RECEIVERS > 2
+  x10rfReceive_wrapper<2>,
+#endif
+#if X10_RF_MAX_RECEIVERS > 3
+  x10rfReceive_wrapper<3>,
+#endif
 };
 
-X10rf *x10rfInstance = NULL;
+#if X10_RF_TRANSMIT
+X10rf *x10rfTransmitter = NULL;
 
-void x10rfReceive_wrapper()
+// Segments are timed in one go by the 16 bit segment tick counter
+static_assert(
+  (uint32_t)X10_RF_TX_MSG_GAP_LOW * (F_CPU / 1000000) / 64 <= 0xFFFF,
+  "X10_RF_TX_MSG_GAP_LOW is too long for F_CPU, ticks don't fit in 16 bits");
+
+ISR(TIMER2_COMPA_vect)
 {
-  if(x10rfInstance) x10rfInstance->receive();
+  if(x10rfTransmitter) x10rfTransmitter->transmit();
 }
+#endif
+
+uint8_t X10rf::lastIx = 0xFF;
+uint8_t X10rf::lastUnit;
+uint8_t X10rf::lastCommand;
+char X10rf::lastHouse;
+uint16_t X10rf::lastSensorId;
+uint32_t X10rf::lastMs;
 
-X10rf::X10rf(uint8_t receiveInt, uint8_t receivePin, rfReceiveCallback_t rfReceiveCallback)
+X10rf::X10rf(
+  uint8_t receiveInt, uint8_t receivePin, rfReceiveCallback_t rfReceiveCallback,
+  rfSecurityCallback_t rfSecurityCallback, uint8_t transmitPin)
 {
   this->receiveInt = receiveInt;
   this->receivePin = receivePin;
+  this->transmitPin = transmitPin;
   this->rfReceiveCallback = rfReceiveCallback;
-  x10rfInstance = this;
+  this->rfSecurityCallback = rfSecurityCallback;
+  capture = NULL;
+  riseUs = 0;
+  lastWasSecurity = 0;
+  // Receivers beyond X10_RF_MAX_RECEIVERS are not started by begin method
+  receiverIx = x10rfInstanceCount;
+  if(receiverIx < X10_RF_MAX_RECEIVERS)
+  {
+    x10rfInstance[receiverIx] = this;
+    x10rfInstanceCount++;
+  }
+#if X10_RF_TRANSMIT
+  // Only one transmitter is supported, since there is only one Timer2
+  if(transmitPin != X10_RF_NO_PIN)
+  {
+    transmitOut = portOutputRegister(digitalPinToPort(transmitPin));
+    transmitBitMask = digitalPinToBitMask(transmitPin);
+    for(uint8_t i = 0; i < X10_RF_BUFFER_SIZE; i++) sendBf[i].repetitions = 0;
+    sendBfStart = 0;
+    sendBfEnd = X10_RF_BUFFER_SIZE - 1;
+    isTransmitting = 0;
+    x10rfTransmitter = this;
+  }
+#endif
 }
 
 //////////////////////////////
@@ -46,104 +104,422 @@ X10rf::X10rf(uint8_t receiveInt, uint8_t receivePin, rfReceiveCallback_t rfRecei
 
 void X10rf::begin()
 {
-  if(rfReceiveCallback)
+  if(!capture && (rfReceiveCallback || rfSecurityCallback) && receiverIx < X10_RF_MAX_RECEIVERS)
   {
     pinMode(receivePin, INPUT);
-    attachInterrupt(receiveInt, x10rfReceive_wrapper, RISING);
+    attachInterrupt(receiveInt, x10rfReceive_wrappers[receiverIx], RISING);
   }
+#if X10_RF_TRANSMIT
+  if(transmitPin != X10_RF_NO_PIN)
+  {
+    pinMode(transmitPin, OUTPUT);
+    digitalWrite(transmitPin, LOW);
+    // Setup transmit timer: CTC mode, stopped until a message is buffered
+    TCCR2A = _BV(WGM21);
+    TCCR2B = 0;
+    TIMSK2 = _BV(OCIE2A);
+  }
+#endif
 }
 
-//////////////////////////////
-/// Public (Interrupt Methods)
-//////////////////////////////
+// Use in stead of begin when the receiver is connected to the capture timer input
+// pin (see X10capture.h), poll must then be called from loop to decode the edges
+// Returns true when edge capture is not supported
+bool X10rf::beginCapture(X10capture *capture)
+{
+  if(capture->begin()) return 1;
+  this->capture = capture;
+  begin();
+  return 0;
+}
 
-void X10rf::receive()
+// Decodes edges buffered by the capture timer and passes buffered events on
+// to the callbacks, call from loop
+void X10rf::poll()
 {
-  uint16_t lengthUs = micros() - riseUs;
-  riseUs = micros();
-  if(lengthUs >= X10_RF_RSB_MIN && lengthUs <= X10_RF_SB_MAX)
+  bool level;
+  uint16_t lengthUs;
+  while(capture && capture->read(level, lengthUs))
   {
-    // Since receiving every command repeat will waste CPU cycles, let's assume that a repeated
-    // start burst received within a certain threshold means that the same command is sent again
-    if(receiveEnded && millis() > receiveEnded && millis() - receiveEnded < X10_RF_REPEAT_THRESHOLD)
+    // Rising edge: pulse length is measured from the last rising edge
+    if(!level)
     {
-      receiveEnded = millis();
-      rfReceiveCallback(house, unit, command, 1);
+      decodePulse(lengthUs > 0xFFFF - captureHighUs ? 0xFFFF : captureHighUs + lengthUs);
     }
     else
     {
-      receiveEnded = 0;
-      receiveBuffer = 0;
-      if(lengthUs >= X10_RF_SB_MIN) receivedCount = 1;
+      captureHighUs = lengthUs;
     }
   }
-  else if(receivedCount)
+#if X10_RF_DEFERRED_EVENTS
+  while(eventBf.read(event))
   {
-    // Binary one received: add to buffer
-    if(lengthUs >= X10_RF_BIT1_MIN && lengthUs <= X10_RF_BIT1_MAX)
+    if(event.house)
     {
-      receiveBuffer += 1LU << receivedCount - 1;
+      if(rfReceiveCallback) rfReceiveCallback(event.house, event.unit, event.command, event.isRepeat);
     }
-    // Invalid pulse length: stop receiving
-    else if(lengthUs < X10_RF_BIT0_MIN || lengthUs > X10_RF_BIT0_MAX)
+    else if(rfSecurityCallback)
+    {
+      rfSecurityCallback(
+        event.sensorId, event.data, !(event.data & X10_RF_SEC_NORMAL),
+        event.data & X10_RF_SEC_LOW_BATTERY, event.data & X10_RF_SEC_TAMPER);
+    }
+  }
+#endif
+}
+
+// Returns the learned length window of bit 0 or bit 1
+const X10pulseClass &X10rf::getPulseClass(bool bit)
+{
+  return bit ? engine.bit1 : engine.bit0;
+}
+
+// Returns the number of rejected frames per reason and the last reason
+const X10pulseStats &X10rf::getRejectStats()
+{
+  return engine.stats;
+}
+
+#if X10_RF_DEFERRED_EVENTS
+// Returns the event being passed on, use in callbacks to get the number of
+// repeats collapsed into the event and when it was received
+const X10rfEvent &X10rf::getEvent()
+{
+  return event;
+}
+
+// Returns number of events dropped because poll was not called often enough
+uint16_t X10rf::getEventOverflowCount()
+{
+  return eventBf.getOverflowCount();
+}
+#endif
+
+// Forgets learned bit lengths and clears rejected frame counters
+void X10rf::resetPulseClasses()
+{
+  uint8_t sreg = SREG;
+  cli();
+  engine.bit0.reset();
+  engine.bit1.reset();
+  engine.stats.reset();
+  SREG = sreg;
+}
+
+#if X10_RF_TRANSMIT
+// Returns true when command was not buffered, because the buffer is full or because
+// the command can't be sent over RF (only ON, OFF, BRIGHT and DIM are supported)
+bool X10rf::sendCmd(uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions)
+{
+  house = x10parseHouse(house);
+  unit--;
+  if(transmitPin == X10_RF_NO_PIN || house > 0xF) return 1;
+  uint8_t byte1 = x10encode(house);
+  uint8_t byte2;
+  // Bright and dim: no unit code
+  if(command == CMD_BRIGHT || command == CMD_DIM)
+  {
+    byte2 = command == CMD_DIM ? B11001 : B10001;
+  }
+  // On and off: reverse the bit swapping done when receiving
+  else if((command == CMD_ON || command == CMD_OFF) && unit <= 0xF)
+  {
+    byte1 |= (unit & B1000) << 2;
+    byte2 = (unit & B11) << 3 | (unit & B100) >> 1 | (command & B1) << 2;
+  }
+  else
+  {
+    return 1;
+  }
+  // Each byte is followed by its complement
+  uint32_t frame =
+    byte1 | (uint16_t)(uint8_t)~byte1 << 8 |
+    (uint32_t)byte2 << 16 | (uint32_t)(uint8_t)~byte2 << 24;
+  uint32_t ms = millis();
+  bool bufferError = 0;
+  // The transmit interrupt moves the buffer start and counts down repetitions:
+  // the buffer is changed with interrupts disabled, like in X10ex
+  uint8_t sreg = SREG;
+  cli();
+  // Current command is buffered again
+  if(sendBf[sendBfStart].repetitions > 0 && sendBf[sendBfStart].frame == frame)
+  {
+    // Just reset repetitions
+    sendBf[sendBfStart].repetitions = repetitions;
+    sendBfLastMs = ms;
+  }
+  // If slots are available in buffer
+  else if((sendBfEnd + 2) % X10_RF_BUFFER_SIZE != sendBfStart)
+  {
+    // Make sure identical message is not sent within rebuffer delay
+    if(sendBf[sendBfEnd].frame != frame || ms > sendBfLastMs + X10_RF_REBUFFER_DELAY || sendBfLastMs - 1 > ms)
     {
-      receivedCount = -1;
+      sendBfEnd = (sendBfEnd + 1) % X10_RF_BUFFER_SIZE;
+      // Buffer message and repetitions
+      sendBf[sendBfEnd].frame = frame;
+      sendBf[sendBfEnd].repetitions = repetitions;
+      sendBfLastMs = ms;
+      // Start transmit timer if it's not running
+      if(!isTransmitting)
+      {
+        isTransmitting = 1;
+        sentSegment = 0;
+        TCNT2 = 0;
+        startSegment();
+        TCCR2B = _BV(CS22);
+      }
     }
-    // Check that unused bits are not set
-    if(
-      (receivedCount == 8 && (receiveBuffer & B11010000) != 0) ||
-      (receivedCount == 24 && ((receiveBuffer >> 16) & B11100000) != 0))
+  }
+  else
+  {
+    bufferError = 1;
+  }
+  SREG = sreg;
+  return bufferError;
+}
+#endif
+
+//////////////////////////////
+/// Public (Interrupt Methods)
+//////////////////////////////
+
+void X10rf::receive()
+{
+  uint32_t lengthUs = micros() - riseUs;
+  riseUs += lengthUs;
+  decodePulse(lengthUs > 0xFFFF ? 0xFFFF : lengthUs);
+}
+
+#if X10_RF_TRANSMIT
+void X10rf::transmit()
+{
+  // Segment is not complete: start next timer period
+  if(segmentTicks)
+  {
+    // Long segments are split into timer periods of up to 256 ticks, a period is
+    // never made shorter than 128 ticks, to give the interrupt time to complete
+    uint16_t ticks = segmentTicks > 511 ? 256 : segmentTicks > 256 ? segmentTicks / 2 : segmentTicks;
+    OCR2A = ticks - 1;
+    segmentTicks -= ticks;
+    return;
+  }
+  sentSegment++;
+  // Message complete (start burst, 32 bits and stop pulse is 68 segments)
+  if(sentSegment == 68)
+  {
+    sentSegment = 0;
+    if(sendBf[sendBfStart].repetitions > 1)
     {
-      receivedCount = -1;
+      sendBf[sendBfStart].repetitions--;
     }
-    // Receiving bitwize complement bits (9-16 and 25-32): verify and stop if invalid
-    else if(
-      ((receivedCount > 8 && receivedCount <= 16) || (receivedCount > 24 && receivedCount <= 32)) &&
-      (receiveBuffer >> receivedCount - 9) & B1 == (receiveBuffer >> receivedCount - 1) & B1)
+    else
     {
-      receivedCount = -1;
+      sendBf[sendBfStart].repetitions = 0;
+      sendBfStart = (sendBfStart + 1) % X10_RF_BUFFER_SIZE;
+      // Buffer is empty: stop transmit timer
+      if(!sendBf[sendBfStart].repetitions)
+      {
+        TCCR2B = 0;
+        isTransmitting = 0;
+        return;
+      }
+      // Keep silent for a while before next message is sent (segment 0 follows)
+      sentSegment = 0xFF;
+      segmentTicks = X10_RF_TX_TICKS(X10_RF_TX_MSG_GAP_LOW);
+      transmit();
+      return;
     }
-    // Receive complete: parse message
-    if(receivedCount == 32)
+  }
+  startSegment();
+}
+#endif
+
+//////////////////////////////
+/// Protocol Descriptor
+//////////////////////////////
+
+// Checks are made as soon as the bits are received, so invalid frames are dropped early
+uint8_t X10rfProtocol::checkFrame(uint32_t buffer, uint16_t /* extBuffer */, uint8_t bits, bool isEnded)
+{
+  uint8_t byte1 = buffer;
+  uint8_t byte2 = buffer >> 8;
+  // Security frame: only the last nibble of the sensor id is complemented
+  bool isSecurity = byte2 == (byte1 ^ X10_RF_SEC_CHECK_MASK);
+  // Frame ended before all bits were received: only security frames without
+  // extended sensor id (32 bits and up) end this way
+  if(isEnded)
+  {
+    return bits >= 32 && isSecurity ? X10_RF_FRAME_SECURITY : X10_FRAME_CONTINUE;
+  }
+  // Check first byte and its complement (bits 1-16)
+  if(bits == 16)
+  {
+    // Standard frame: all bits are complemented and unused bits are not set
+    if(isSecurity || (byte2 == (uint8_t)~byte1 && !(byte1 & B11010000))) return X10_FRAME_CONTINUE;
+    return X10_FRAME_INVALID;
+  }
+  // Check second byte and its complement (bits 17-32)
+  if(bits == 32)
+  {
+    uint8_t byte3 = buffer >> 16;
+    if((uint8_t)(buffer >> 24) != (uint8_t)~byte3 || (!isSecurity && (byte3 & B11100000)))
     {
-      receivedCount = -1;
-      handleCommand(receiveBuffer & 0xFF, (receiveBuffer >> 16) & 0xFF);
+      return X10_FRAME_INVALID;
     }
-    receivedCount++;
+    // Security frame: keep receiving in case this is an extended frame
+    return isSecurity ? X10_FRAME_CONTINUE : X10_RF_FRAME_STANDARD;
   }
+  // Extended security frame complete (last bit is parity and is not checked)
+  if(bits == X10_RF_SEC_EXT_BITS) return X10_RF_FRAME_SECURITY_EXT;
+  return X10_FRAME_CONTINUE;
 }
 
 //////////////////////////////
 /// Private
 //////////////////////////////
 
+void X10rf::decodePulse(uint16_t lengthUs)
+{
+  switch(engine.decode(lengthUs))
+  {
+    case X10_PULSE_REPEAT:
+      // Security sensors repeat every frame several times, only the first one is passed on
+      if(!lastWasSecurity) triggerCallback(1);
+      break;
+    case X10_PULSE_FRAME:
+      if(engine.format == X10_RF_FRAME_STANDARD)
+      {
+        handleCommand(engine.buffer, engine.buffer >> 16);
+      }
+      else
+      {
+        handleSecurity(engine.format == X10_RF_FRAME_SECURITY_EXT);
+      }
+      break;
+  }
+}
+
 void X10rf::handleCommand(uint8_t byte1, uint8_t byte2)
 {
-  receiveEnded = millis();
+  lastWasSecurity = 0;
   // Get house code
-  house = parseHouseCode(byte1 & B1111);
+  house = x10decode(byte1) + 65;
   // Bright or Dim
   if(byte2 & B1)
   {
     unit = 0;
     // Bit magic to create X10 CMD_DIM (B0100) or CMD_BRIGHT (B0101) nibble
-    command = byte2 >> 3 & B1 ^ B101;
+    command = (byte2 >> 3 & B1) ^ B101;
   }
   // On or Off
   else
   {
     // Swap some bits to create unit integer from binary data
-    unit = (byte2 >> 3 | byte2 << 1 & B100 | byte1 >> 2 & B1000) + 1;
+    unit = (byte2 >> 3 | (byte2 << 1 & B100) | (byte1 >> 2 & B1000)) + 1;
     // Bit magic to create X10 CMD_ON (B0010) or CMD_OFF (B0011) nibble
-    command = byte2 >> 2 & B1 | B10;
+    command = (byte2 >> 2 & B1) | B10;
+  }
+  triggerCallback(0);
+}
+
+void X10rf::handleSecurity(bool isExtended)
+{
+  lastWasSecurity = 1;
+  // Security frames are sent most significant bit first: reverse bytes
+  uint16_t sensorId = x10reverseByte(engine.buffer);
+  if(isExtended) sensorId |= (uint16_t)x10reverseByte(engine.extBuffer) << 8;
+  uint8_t data = x10reverseByte(engine.buffer >> 16);
+  // Drop frame if it was just passed on by another receiver
+  if(
+    lastIx != receiverIx && lastIx != 0xFF && !lastHouse && sensorId == lastSensorId &&
+    millis() - lastMs < X10_RF_REPEAT_THRESHOLD)
+  {
+    return;
+  }
+  lastIx = receiverIx;
+  lastHouse = 0;
+  lastSensorId = sensorId;
+  lastMs = millis();
+#if X10_RF_DEFERRED_EVENTS
+  X10rfEvent securityEvent;
+  securityEvent.house = 0;
+  securityEvent.unit = 0;
+  securityEvent.command = 0;
+  securityEvent.isRepeat = 0;
+  securityEvent.repeats = 0;
+  securityEvent.ms = lastMs;
+  securityEvent.sensorId = sensorId;
+  securityEvent.data = data;
+  eventBf.write(securityEvent);
+#else
+  if(rfSecurityCallback)
+  {
+    rfSecurityCallback(
+      sensorId, data, !(data & X10_RF_SEC_NORMAL),
+      data & X10_RF_SEC_LOW_BATTERY, data & X10_RF_SEC_TAMPER);
   }
-  rfReceiveCallback(house, unit, command, 0);
+#endif
 }
 
-char X10rf::parseHouseCode(uint8_t data)
+void X10rf::triggerCallback(bool isRepeat)
 {
-  for(uint8_t i = 0; i <= 0xF; i++)
+  // Drop command if it was just passed on by another receiver
+  if(
+    lastIx != receiverIx && lastIx != 0xFF && house == lastHouse && unit == lastUnit &&
+    command == lastCommand && millis() - lastMs < X10_RF_REPEAT_THRESHOLD)
   {
-    if(HOUSE_CODE[i] == data) return i + 65;
+    return;
   }
-}
\ No newline at end of file
+  lastIx = receiverIx;
+  lastHouse = house;
+  lastUnit = unit;
+  lastCommand = command;
+  lastMs = millis();
+#if X10_RF_DEFERRED_EVENTS
+  X10rfEvent commandEvent;
+  commandEvent.house = house;
+  commandEvent.unit = unit;
+  commandEvent.command = command;
+  commandEvent.isRepeat = isRepeat;
+  commandEvent.repeats = 0;
+  commandEvent.ms = lastMs;
+  commandEvent.sensorId = 0;
+  commandEvent.data = 0;
+  eventBf.write(commandEvent);
+#else
+  if(rfReceiveCallback) rfReceiveCallback(house, unit, command, isRepeat);
+#endif
+}
+
+#if X10_RF_TRANSMIT
+void X10rf::startSegment()
+{
+  // Even segments: transmit high (start burst, bit and stop pulses)
+  if(!(sentSegment % 2))
+  {
+    *transmitOut |= transmitBitMask;
+    segmentTicks = sentSegment ? X10_RF_TX_TICKS(X10_RF_TX_BIT_HIGH) : X10_RF_TX_TICKS(X10_RF_TX_SB_HIGH);
+  }
+  // Odd segments: transmit low (silence after start burst, bits and stop pulse)
+  else
+  {
+    *transmitOut &= ~transmitBitMask;
+    if(sentSegment == 1)
+    {
+      segmentTicks = X10_RF_TX_TICKS(X10_RF_TX_SB_LOW);
+    }
+    else if(sentSegment == 67)
+    {
+      segmentTicks = X10_RF_TX_TICKS(X10_RF_TX_GAP_LOW);
+    }
+    else
+    {
+      // Bits are sent in the same order as they are received (least significant bit first)
+      segmentTicks =
+        sendBf[sendBfStart].frame >> (sentSegment - 3) / 2 & 1 ?
+        X10_RF_TX_TICKS(X10_RF_TX_BIT1_LOW) : X10_RF_TX_TICKS(X10_RF_TX_BIT0_LOW);
+    }
+  }
+  transmit();
+}
+#endif
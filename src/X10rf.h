@@ -21,6 +21,10 @@
 #define X10rf_h
 
 #include "Arduino.h"
+#include "X10pulse.h"
+#include "X10capture.h"
+#include "X10event.h"
+#include "X10codec.h"
 
 // RF initial start burst min length
 #define X10_RF_SB_MIN           12000
@@ -29,6 +33,9 @@
 // RF repeat start burst min length
 // If you get choppy dimming, lower this threshold
 #define X10_RF_RSB_MIN           7000
+// RF bit 0 and bit 1 min and max lengths. When X10_PULSE_LEARN is enabled
+// (see X10pulse.h) these are the initial windows, and the learned windows
+// never extend more than a quarter of the lengths outside them.
 // RF bit 0 min length
 #define X10_RF_BIT0_MIN          1000
 // RF bit 0 max length
@@ -41,36 +48,168 @@
 // of the last command received, it is assumed that the following command
 // is the same and that it does not need to be parsed
 #define X10_RF_REPEAT_THRESHOLD   200
+// Number of RF receivers that can be used at the same time. When the same
+// command is received by more than one receiver within the repeat threshold,
+// it is only passed on to the receive callback by the first receiver.
+#define X10_RF_MAX_RECEIVERS        2
+// Received commands and security events are buffered by the receive interrupt
+// and passed on to the callbacks when poll is called from loop. Set to 0 to
+// call the callbacks directly from the receive interrupt.
+#define X10_RF_DEFERRED_EVENTS      1
+// Number of buffered events, must be a power of two (one slot is kept free)
+#define X10_RF_EVENT_BUFFER_SIZE    8
+// RF security frames (e.g. DS10 door/window and MS10 motion sensors) start
+// with an 8 bit sensor id followed by a check byte where only one nibble is
+// complemented (mask is given in receive order, least significant bit first)
+#define X10_RF_SEC_CHECK_MASK    0xF0
+// Extended security frames add 8 sensor id bits and a parity bit
+#define X10_RF_SEC_EXT_BITS        41
+// Security data flags (most significant bit first)
+#define X10_RF_SEC_NORMAL        0x80
+#define X10_RF_SEC_TAMPER        0x40
+#define X10_RF_SEC_LOW_BATTERY   0x01
+// Set to 1 to enable RF transmit support. The transmit waveform is generated
+// by Timer2, so Timer2 can't be used by other libraries (e.g. tone) when it's
+// enabled. Can also be set by the build, the host tests use 1.
+#ifndef X10_RF_TRANSMIT
+#define X10_RF_TRANSMIT             0
+#endif
+// Set buffer size to the number of RF messages you would like to buffer,
+// plus one. Each slot in the buffer uses 5 bytes of memory.
+#define X10_RF_BUFFER_SIZE          5
+// Set the min delay, in ms, between buffering of two identical messages
+#define X10_RF_REBUFFER_DELAY     500
+// RF transmit timings in microseconds. A start burst, bit 0 and bit 1 are
+// sent as a high pulse followed by silence, the receiver measures the time
+// between two rising edges (see the receive lengths above). A message is
+// ended by a stop pulse followed by silence until the next repetition.
+#define X10_RF_TX_SB_HIGH        8960
+#define X10_RF_TX_SB_LOW         4480
+#define X10_RF_TX_BIT_HIGH        560
+#define X10_RF_TX_BIT0_LOW        560
+#define X10_RF_TX_BIT1_LOW       1680
+#define X10_RF_TX_GAP_LOW       40000
+// Silence before the next buffered message is sent, receivers assume that
+// a message sent within their repeat threshold is a repeat of the last one
+#define X10_RF_TX_MSG_GAP_LOW  200000
+// Timer2 is run with a prescaler of 64 (4us per tick at 16MHz)
+#define X10_RF_TX_TICKS(us) ((uint16_t)((uint32_t)(us) * (F_CPU / 1000000) / 64))
+// Used when no transmit pin is set
+#define X10_RF_NO_PIN            0xFF
+
+// RF frame formats, returned by X10rfProtocol::checkFrame
+#define X10_RF_FRAME_STANDARD       0
+#define X10_RF_FRAME_SECURITY       1
+#define X10_RF_FRAME_SECURITY_EXT   2
 
 #define CMD_ON      B0010
 #define CMD_OFF     B0011
 #define CMD_DIM     B0100
 #define CMD_BRIGHT  B0101
 
+// X10 RF protocol descriptor used by the pulse engine (see X10pulse.h)
+struct X10rfProtocol
+{
+  static const uint16_t SB_MIN = X10_RF_SB_MIN;
+  static const uint16_t RSB_MIN = X10_RF_RSB_MIN;
+  static const uint16_t SB_MAX = X10_RF_SB_MAX;
+  static const uint16_t BIT0_MIN = X10_RF_BIT0_MIN;
+  static const uint16_t BIT0_MAX = X10_RF_BIT0_MAX;
+  static const uint16_t BIT1_MIN = X10_RF_BIT1_MIN;
+  static const uint16_t BIT1_MAX = X10_RF_BIT1_MAX;
+  static const uint16_t EB_MIN = 0;
+  static const uint8_t MAX_BITS = X10_RF_SEC_EXT_BITS;
+  static const bool MSB_FIRST = 0;
+  static const uint16_t REPEAT_THRESHOLD = X10_RF_REPEAT_THRESHOLD;
+  static uint8_t checkFrame(uint32_t buffer, uint16_t extBuffer, uint8_t bits, bool isEnded);
+};
+
+// Buffered RF event, house is 0 for security events
+struct X10rfEvent : X10event
+{
+  uint16_t sensorId;
+  uint8_t data;
+};
+
 class X10rf
 {
 
 public:
   typedef void (*rfReceiveCallback_t)(char, uint8_t, uint8_t, bool);
-  X10rf(uint8_t receiveInt, uint8_t receivePin, rfReceiveCallback_t rfReceiveCallback);
+  // Sensor id, data, is alert, is low battery and is tamper
+  typedef void (*rfSecurityCallback_t)(uint16_t, uint8_t, bool, bool, bool);
+  // The transmitPin parameter is optional, RF transmit is only enabled when it's set
+  X10rf(
+    uint8_t receiveInt, uint8_t receivePin, rfReceiveCallback_t rfReceiveCallback,
+    rfSecurityCallback_t rfSecurityCallback = NULL, uint8_t transmitPin = X10_RF_NO_PIN);
   // Public methods
   void begin();
+  bool beginCapture(X10capture *capture);
+  void poll();
+#if X10_RF_TRANSMIT
+  bool sendCmd(uint8_t house, uint8_t unit, uint8_t command, uint8_t repetitions);
+#endif
+  const X10pulseClass &getPulseClass(bool bit);
+  const X10pulseStats &getRejectStats();
+  void resetPulseClasses();
+#if X10_RF_DEFERRED_EVENTS
+  const X10rfEvent &getEvent();
+  uint16_t getEventOverflowCount();
+#endif
   void receive();
+#if X10_RF_TRANSMIT
+  void transmit();
+#endif
   
 private:
-  static const uint8_t HOUSE_CODE[16];
   // Set in constructor
-  uint8_t receiveInt, receivePin;
+  uint8_t receiveInt, receivePin, transmitPin;
   rfReceiveCallback_t rfReceiveCallback;
+  rfSecurityCallback_t rfSecurityCallback;
+  // Set when edges are timestamped by capture timer
+  X10capture *capture;
+  uint16_t captureHighUs;
   // Used by interrupt triggered methods
-  uint32_t riseUs, receiveEnded;
+  uint32_t riseUs;
+  X10pulseEngine<X10rfProtocol> engine;
   char house;
   uint8_t unit, command;
-  int8_t receivedCount;
-  uint32_t receiveBuffer;
+  bool lastWasSecurity;
+  // Shared by all receivers, used to drop commands received by more than one receiver
+  static uint8_t lastIx, lastUnit, lastCommand;
+  static char lastHouse;
+  static uint16_t lastSensorId;
+  static uint32_t lastMs;
+  uint8_t receiverIx;
+#if X10_RF_DEFERRED_EVENTS
+  // Written by receive interrupt, read by poll
+  X10eventBuffer<X10rfEvent, X10_RF_EVENT_BUFFER_SIZE> eventBf;
+  X10rfEvent event;
+#endif
+#if X10_RF_TRANSMIT
+  // Transmit fields
+  struct X10rfMsg
+  {
+    uint32_t frame;
+    uint8_t repetitions;
+  };
+  X10rfMsg volatile sendBf[X10_RF_BUFFER_SIZE];
+  uint8_t volatile sendBfStart, sendBfEnd;
+  uint32_t sendBfLastMs;
+  volatile uint8_t *transmitOut;
+  uint8_t transmitBitMask;
+  bool volatile isTransmitting;
+  uint8_t sentSegment;
+  uint16_t segmentTicks;
+#endif
   // Private methods
+  void decodePulse(uint16_t lengthUs);
   void handleCommand(uint8_t byte1, uint8_t byte2);
-  char parseHouseCode(uint8_t data);
+  void handleSecurity(bool isExtended);
+  void triggerCallback(bool isRepeat);
+#if X10_RF_TRANSMIT
+  void startSegment();
+#endif
 };
 
 #endif
@@ -0,0 +1,268 @@
+/************************************************************************/
+/* X10 RF, IR and PLC event router library, v1.6.                       */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10router.h"
+#include "X10ir.h"
+
+// Saved rules start with a marker byte followed by rule count and rules
+#define X10_ROUTER_EEPROM_MARKER 0xA5
+#define X10_ROUTER_RULE_SIZE 9
+#define X10_ROUTER_EEPROM_END \
+  (X10_ROUTER_EEPROM_OFFSET + 2 + X10_ROUTER_MAX_RULES * X10_ROUTER_RULE_SIZE)
+
+static_assert(sizeof(X10rule) == X10_ROUTER_RULE_SIZE, "X10rule is saved byte by byte in EEPROM");
+
+X10router::X10router(X10ex *x10ex, sceneCallback_t sceneCallback)
+{
+  this->x10ex = x10ex;
+  this->sceneCallback = sceneCallback;
+  ruleCount = 0;
+  echoIx = 0;
+  memset(echo, 0, sizeof(echo));
+  buildIndex();
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Executes all rules matching event, returns X10_ROUTE_NONE when no rule
+// matched and X10_ROUTE_BUFFER_ERROR when a command could not be buffered
+uint8_t X10router::route(uint8_t source, char house, uint8_t unit, uint8_t command, bool isRepeat)
+{
+  house = toupper(house);
+  bool echoed = source == X10_ROUTER_SOURCE_PLC && isEcho(house, unit, command);
+  uint8_t result = X10_ROUTE_NONE;
+  for(uint8_t ix = bucket[hash(house, unit)]; ix; ix = next[ix - 1])
+  {
+    const X10rule &rule = rules[ix - 1];
+    if(
+      rule.house == house && rule.unit == unit && (rule.sources & source) &&
+      (rule.command == X10_ROUTER_SAME || rule.command == command) &&
+      (!isRepeat || rule.flags & X10_RULE_REPEAT) &&
+      (!echoed || rule.flags & X10_RULE_ECHO))
+    {
+      if(execute(rule, house, unit, command)) result = X10_ROUTE_BUFFER_ERROR;
+      else if(!result) result = X10_ROUTE_DONE;
+    }
+  }
+  return result;
+}
+
+// Returns true when the rule table is full
+bool X10router::addRule(const X10rule &rule)
+{
+  if(ruleCount >= X10_ROUTER_MAX_RULES) return 1;
+  uint8_t sreg = SREG;
+  cli();
+  rules[ruleCount] = rule;
+  rules[ruleCount].house = toupper(rule.house);
+  if(rule.targetHouse != (char)X10_ROUTER_SAME) rules[ruleCount].targetHouse = toupper(rule.targetHouse);
+  ruleCount++;
+  buildIndex();
+  SREG = sreg;
+  return 0;
+}
+
+// Adds rule given as 18 hex characters, one byte per X10rule field in order,
+// e.g. "034105020000410B02" routes RF and IR A5 ON to A11 ON
+// Returns true on syntax error or when the rule table is full
+bool X10router::addRule(const char *hex)
+{
+  uint8_t data[sizeof(X10rule)];
+  for(uint8_t i = 0; i < sizeof(X10rule) * 2; i++)
+  {
+    char c = toupper(hex[i]);
+    if(!isxdigit(c)) return 1;
+    uint8_t nibble = c <= '9' ? c - '0' : c - 'A' + 10;
+    data[i / 2] = i % 2 ? data[i / 2] << 4 | nibble : nibble;
+  }
+  X10rule rule;
+  memcpy(&rule, data, sizeof(X10rule));
+  return addRule(rule);
+}
+
+// Returns true when index is invalid
+bool X10router::removeRule(uint8_t ix)
+{
+  if(ix >= ruleCount) return 1;
+  uint8_t sreg = SREG;
+  cli();
+  ruleCount--;
+  memmove(&rules[ix], &rules[ix + 1], (ruleCount - ix) * sizeof(X10rule));
+  buildIndex();
+  SREG = sreg;
+  return 0;
+}
+
+// Returns true when index is invalid
+bool X10router::getRule(uint8_t ix, X10rule &rule)
+{
+  if(ix >= ruleCount) return 1;
+  rule = rules[ix];
+  return 0;
+}
+
+uint8_t X10router::getRuleCount()
+{
+  return ruleCount;
+}
+
+void X10router::clearRules()
+{
+  uint8_t sreg = SREG;
+  cli();
+  ruleCount = 0;
+  buildIndex();
+  SREG = sreg;
+}
+
+// Loads rules saved in EEPROM, returns true when no rules are saved
+bool X10router::load()
+{
+#if X10_ROUTER_EEPROM_END <= E2END + 1
+  uint8_t *address = (uint8_t *)X10_ROUTER_EEPROM_OFFSET;
+  uint8_t count = eeprom_read_byte(address + 1);
+  if(eeprom_read_byte(address) != X10_ROUTER_EEPROM_MARKER || count > X10_ROUTER_MAX_RULES) return 1;
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t *data = (uint8_t *)rules;
+  for(uint16_t i = 0; i < count * sizeof(X10rule); i++)
+  {
+    data[i] = eeprom_read_byte(address + 2 + i);
+  }
+  ruleCount = count;
+  buildIndex();
+  SREG = sreg;
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+// Saves rules in EEPROM, returns true when rules don't fit in EEPROM
+bool X10router::save()
+{
+#if X10_ROUTER_EEPROM_END <= E2END + 1
+  uint8_t *address = (uint8_t *)X10_ROUTER_EEPROM_OFFSET;
+  const uint8_t *data = (const uint8_t *)rules;
+  for(uint16_t i = 0; i < ruleCount * sizeof(X10rule); i++)
+  {
+    eeprom_update_byte(address + 2 + i, data[i]);
+  }
+  eeprom_update_byte(address + 1, ruleCount);
+  eeprom_update_byte(address, X10_ROUTER_EEPROM_MARKER);
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+uint8_t X10router::hash(char house, uint8_t unit)
+{
+  return (house + unit * 5) & (X10_ROUTER_BUCKETS - 1);
+}
+
+// Chains rules per bucket in the order they were added
+void X10router::buildIndex()
+{
+  memset(bucket, 0, sizeof(bucket));
+  for(uint8_t ix = ruleCount; ix > 0; ix--)
+  {
+    uint8_t b = hash(rules[ix - 1].house, rules[ix - 1].unit);
+    next[ix - 1] = bucket[b];
+    bucket[b] = ix;
+  }
+}
+
+// Returns true when command was sent by the router, the echo is forgotten
+// when all repetitions of the command have been received
+bool X10router::isEcho(char house, uint8_t unit, uint8_t command)
+{
+  bool found = 0;
+  uint8_t sreg = SREG;
+  cli();
+  for(uint8_t i = 0; i < X10_ROUTER_ECHO_SIZE; i++)
+  {
+    X10echo &sent = echo[i];
+    if(
+      sent.count && sent.house == house && sent.unit == unit && sent.command == command &&
+      millis() - sent.ms < X10_ROUTER_ECHO_TIMEOUT)
+    {
+      sent.count--;
+      found = 1;
+      break;
+    }
+  }
+  SREG = sreg;
+  return found;
+}
+
+// Returns true on buffer error
+bool X10router::execute(const X10rule &rule, char house, uint8_t unit, uint8_t command)
+{
+  if(rule.action == X10_ACTION_SCENE)
+  {
+    return sceneCallback && sceneCallback(rule.data, command);
+  }
+  if(rule.action == X10_ACTION_DROP) return 0;
+  if(rule.targetHouse != (char)X10_ROUTER_SAME) house = rule.targetHouse;
+  if(rule.targetUnit != X10_ROUTER_SAME) unit = rule.targetUnit;
+  bool bufferError;
+  uint8_t repetitions = 1;
+  if(rule.action == X10_ACTION_DIM)
+  {
+    command = CMD_EXTENDED_CODE;
+    bufferError = x10ex->sendExtDim(house, unit, rule.data, EXC_DIM_TIME_4, repetitions);
+  }
+  else
+  {
+    if(rule.data != X10_ROUTER_SAME) command = rule.data;
+    // Two or more repetitions are used for bright and dim, to avoid that
+    // commands are buffered separately when repeated
+    if(command == CMD_BRIGHT || command == CMD_DIM) repetitions = 2;
+    bufferError =
+      command == CMD_ADDRESS ? x10ex->sendAddress(house, unit, repetitions) :
+      x10ex->sendCmd(house, unit, command, repetitions);
+  }
+  if(!bufferError) addEcho(house, unit, command, repetitions);
+  return bufferError;
+}
+
+// Remembers command sent, so that its echoes are not routed again. Commands
+// with unit code are sent with silence between repetitions, so each repetition
+// is received as a message. Bright and dim without unit code are repeated
+// without silence, and are received as one message.
+void X10router::addEcho(char house, uint8_t unit, uint8_t command, uint8_t repetitions)
+{
+  uint8_t sreg = SREG;
+  cli();
+  X10echo &sent = echo[echoIx];
+  sent.house = house;
+  sent.unit = unit;
+  sent.command = command;
+  sent.count = unit ? repetitions : 1;
+  sent.ms = millis();
+  echoIx = (echoIx + 1) % X10_ROUTER_ECHO_SIZE;
+  SREG = sreg;
+}
@@ -0,0 +1,141 @@
+/************************************************************************/
+/* X10 RF, IR and PLC event router library, v1.6.                       */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10router_h
+#define X10router_h
+
+#include "Arduino.h"
+#include "avr/eeprom.h"
+#include "X10ex.h"
+
+// Max number of rules. Each rule uses 10 bytes of memory
+#define X10_ROUTER_MAX_RULES        16
+// Number of (house, unit) hash buckets, must be a power of two
+#define X10_ROUTER_BUCKETS          16
+// EEPROM address where rules are saved, the default is right after the
+// module names stored by X10ex. Rules are only saved when they fit in EEPROM
+// (e.g. not on the ATmega328, where X10ex uses all 1024 bytes).
+#define X10_ROUTER_EEPROM_OFFSET  1024
+// Number of commands sent by the router that are remembered, so that their
+// echo (see the X10ex receiveTransmits parameter) isn't routed again
+#define X10_ROUTER_ECHO_SIZE         4
+// Echo of a sent command must be received within this millisecond threshold
+#define X10_ROUTER_ECHO_TIMEOUT   5000
+
+// Event sources, a rule applies to one or more sources
+#define X10_ROUTER_SOURCE_RF      B0001
+#define X10_ROUTER_SOURCE_IR      B0010
+#define X10_ROUTER_SOURCE_PLC     B0100
+// Commands from serial, REST, e.g.
+#define X10_ROUTER_SOURCE_USER    B1000
+
+// Rule flags: by default rules ignore repeats (button is held) and echoes of
+// commands sent by the router
+#define X10_RULE_REPEAT           B0001
+#define X10_RULE_ECHO             B0010
+
+// Rule actions
+// Send command given in data (or the command received) to target house/unit
+#define X10_ACTION_SEND               0
+// Send extended dim command, data is brightness in percent
+#define X10_ACTION_DIM                1
+// Call scene callback, data is scene number
+#define X10_ACTION_SCENE              2
+// Do nothing: the event is handled, but not passed on
+#define X10_ACTION_DROP               3
+
+// Matches any command, and target house, unit and command same as received
+#define X10_ROUTER_SAME            0xFF
+
+// Route results
+#define X10_ROUTE_NONE                0
+#define X10_ROUTE_DONE                1
+#define X10_ROUTE_BUFFER_ERROR        2
+
+// Rule matched against a received event. All rules matching an event are
+// executed in the order they were added, e.g. one rule per module in a scene.
+struct X10rule
+{
+  uint8_t sources;      // X10_ROUTER_SOURCE_* bits
+  char house;           // 'A'-'P'
+  uint8_t unit;         // 1-16, 0 for commands without unit (bright, dim, e.g.)
+  uint8_t command;      // Command or X10_ROUTER_SAME (any command)
+  uint8_t flags;        // X10_RULE_* bits
+  uint8_t action;       // X10_ACTION_*
+  char targetHouse;     // 'A'-'P' or X10_ROUTER_SAME
+  uint8_t targetUnit;   // 0-16 or X10_ROUTER_SAME
+  uint8_t data;         // Command, brightness or scene number
+};
+
+// Routes RF, IR and power line events to power line commands and scenes using
+// a rule table indexed by house and unit. Call route from the receive
+// callbacks; when no rule matches, the event can be handled as before:
+//
+// void radioFreqEvent(char house, byte unit, byte command, bool isRepeat)
+// {
+//   if(!x10router.route(X10_ROUTER_SOURCE_RF, house, unit, command, isRepeat)) ...
+// }
+class X10router
+{
+
+  public:
+    // Scene number and the command that triggered the scene, returns true on
+    // buffer error
+    typedef bool (*sceneCallback_t)(uint8_t, uint8_t);
+    X10router(X10ex *x10ex, sceneCallback_t sceneCallback = NULL);
+    // Public methods
+    uint8_t route(uint8_t source, char house, uint8_t unit, uint8_t command, bool isRepeat);
+    bool addRule(const X10rule &rule);
+    bool addRule(const char *hex);
+    bool removeRule(uint8_t ix);
+    bool getRule(uint8_t ix, X10rule &rule);
+    uint8_t getRuleCount();
+    void clearRules();
+    bool load();
+    bool save();
+
+  private:
+    // Set in constructor
+    X10ex *x10ex;
+    sceneCallback_t sceneCallback;
+    // Rules and hash chains, bucket and next hold rule index + 1 (0 ends chain)
+    X10rule rules[X10_ROUTER_MAX_RULES];
+    uint8_t ruleCount;
+    uint8_t bucket[X10_ROUTER_BUCKETS];
+    uint8_t next[X10_ROUTER_MAX_RULES];
+    // Commands sent, used to detect echoes
+    struct X10echo
+    {
+      char house;
+      uint8_t unit, command;
+      // Echoes left, one is received per repetition
+      uint8_t count;
+      uint32_t ms;
+    };
+    X10echo echo[X10_ROUTER_ECHO_SIZE];
+    uint8_t echoIx;
+    // Private methods
+    uint8_t hash(char house, uint8_t unit);
+    void buildIndex();
+    bool isEcho(char house, uint8_t unit, uint8_t command);
+    bool execute(const X10rule &rule, char house, uint8_t unit, uint8_t command);
+    void addEcho(char house, uint8_t unit, uint8_t command, uint8_t repetitions);
+};
+
+#endif
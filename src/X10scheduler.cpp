@@ -0,0 +1,244 @@
+/************************************************************************/
+/* X10 PLC scheduler library, delayed and recurring commands, v1.6.     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10scheduler.h"
+
+X10scheduler::X10scheduler(X10ex *x10ex)
+{
+  this->x10ex = x10ex;
+  memset(slot, 0, sizeof(slot));
+  // All timers start out in the free list
+  for(uint8_t ix = 0; ix < X10_SCHEDULER_MAX_TIMERS; ix++)
+  {
+    timers[ix].isPending = 0;
+    timers[ix].generation = 0;
+    timers[ix].next = ix + 2 <= X10_SCHEDULER_MAX_TIMERS ? ix + 2 : 0;
+  }
+  freeList = 1;
+  pendingCount = 0;
+  tick = 0;
+  tickMs = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Sends extended command after delay, and then every period when period is
+// not 0. Returns timer id, or X10_TIMER_NONE when all timers are pending.
+uint16_t X10scheduler::schedule(
+  uint32_t delayMs, uint32_t periodMs, char house, uint8_t unit, uint8_t command,
+  uint8_t extData, uint8_t extCommand, uint8_t repetitions)
+{
+  uint16_t id = add(delayMs, periodMs, NULL);
+  if(id != X10_TIMER_NONE)
+  {
+    X10timer &timer = timers[(uint8_t)id - 1];
+    timer.house = house;
+    timer.unit = unit;
+    timer.command = command;
+    timer.extData = extData;
+    timer.extCommand = extCommand;
+    timer.repetitions = repetitions;
+  }
+  return id;
+}
+
+// Same as schedule, but first command is sent at given millis() time
+uint16_t X10scheduler::scheduleAt(
+  uint32_t ms, uint32_t periodMs, char house, uint8_t unit, uint8_t command,
+  uint8_t extData, uint8_t extCommand, uint8_t repetitions)
+{
+  int32_t delayMs = ms - millis();
+  return schedule(
+    delayMs > 0 ? delayMs : 0, periodMs, house, unit, command,
+    extData, extCommand, repetitions);
+}
+
+// Calls callback with timer id after delay, and then every period when period
+// is not 0. Returns timer id, or X10_TIMER_NONE when all timers are pending.
+uint16_t X10scheduler::schedule(uint32_t delayMs, uint32_t periodMs, timerCallback_t callback)
+{
+  return add(delayMs, periodMs, callback);
+}
+
+// Returns true when timer is not pending
+bool X10scheduler::cancel(uint16_t id)
+{
+  if(!isPending(id)) return 1;
+  uint8_t ix = (uint8_t)id - 1;
+  unlink(ix);
+  release(ix);
+  return 0;
+}
+
+// Restarts timer delay, e.g. when motion is detected before a light is turned
+// off. Returns true when timer is not pending (it has fired or was cancelled).
+bool X10scheduler::rearm(uint16_t id, uint32_t delayMs)
+{
+  if(!isPending(id)) return 1;
+  uint8_t ix = (uint8_t)id - 1;
+  unlink(ix);
+  timers[ix].expiryTick = tick + msToTicks(delayMs);
+  insert(ix);
+  return 0;
+}
+
+// Returns false when the timer has fired (one shot timers) or was cancelled,
+// even if another timer now uses the same slot
+bool X10scheduler::isPending(uint16_t id)
+{
+  uint8_t ix = (uint8_t)id - 1;
+  return ix < X10_SCHEDULER_MAX_TIMERS && timers[ix].isPending && getId(ix) == id;
+}
+
+uint8_t X10scheduler::getPendingCount()
+{
+  return pendingCount;
+}
+
+// Fires due timers, call from loop. Each tick only checks the timers hashed
+// to the tick's slot; when poll is delayed, ticks are caught up one by one.
+void X10scheduler::poll()
+{
+  while(millis() - tickMs >= X10_SCHEDULER_TICK_MS)
+  {
+    tickMs += X10_SCHEDULER_TICK_MS;
+    tick++;
+    if(pendingCount) runSlot();
+  }
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+uint16_t X10scheduler::add(uint32_t delayMs, uint32_t periodMs, timerCallback_t callback)
+{
+  if(!freeList) return X10_TIMER_NONE;
+  uint8_t ix = freeList - 1;
+  X10timer &timer = timers[ix];
+  freeList = timer.next;
+  // Start counting ticks from now when scheduler was idle
+  if(!pendingCount) tickMs = millis();
+  pendingCount++;
+  timer.isPending = 1;
+  timer.callback = callback;
+  timer.expiryTick = tick + msToTicks(delayMs);
+  timer.periodTicks = periodMs ? msToTicks(periodMs) : 0;
+  insert(ix);
+  return getId(ix);
+}
+
+// Id is timer index + 1 in lower byte, so it's never X10_TIMER_NONE
+uint16_t X10scheduler::getId(uint8_t ix)
+{
+  return (uint16_t)timers[ix].generation << 8 | (ix + 1);
+}
+
+// Adds timer to the slot of its expiry tick
+void X10scheduler::insert(uint8_t ix)
+{
+  uint8_t &head = slot[timers[ix].expiryTick & (X10_SCHEDULER_SLOTS - 1)];
+  timers[ix].next = head;
+  head = ix + 1;
+}
+
+void X10scheduler::unlink(uint8_t ix)
+{
+  uint8_t *link = &slot[timers[ix].expiryTick & (X10_SCHEDULER_SLOTS - 1)];
+  while(*link && *link != ix + 1)
+  {
+    link = &timers[*link - 1].next;
+  }
+  if(*link) *link = timers[ix].next;
+}
+
+void X10scheduler::release(uint8_t ix)
+{
+  timers[ix].isPending = 0;
+  timers[ix].generation++;
+  timers[ix].next = freeList;
+  freeList = ix + 1;
+  pendingCount--;
+}
+
+// Rounds up to whole ticks, delay 0 fires on the next tick
+uint32_t X10scheduler::msToTicks(uint32_t ms)
+{
+  uint32_t ticks = (ms + X10_SCHEDULER_TICK_MS - 1) / X10_SCHEDULER_TICK_MS;
+  return ticks ? ticks : 1;
+}
+
+// Fires timers in current slot that are due. Timers are rescheduled before
+// callbacks are called, so callbacks may cancel, rearm or add timers. The
+// slot is scanned again after each timer fired for the same reason.
+void X10scheduler::runSlot()
+{
+  bool fired = 1;
+  while(fired)
+  {
+    fired = 0;
+    for(uint8_t next = slot[tick & (X10_SCHEDULER_SLOTS - 1)]; next; next = timers[next - 1].next)
+    {
+      uint8_t ix = next - 1;
+      X10timer &timer = timers[ix];
+      if((int32_t)(timer.expiryTick - tick) > 0) continue;
+      unlink(ix);
+      // Power line command: retry on next tick when send buffer is full
+      if(!timer.callback)
+      {
+        if(x10ex->sendExt(
+          timer.house, timer.unit, timer.command,
+          timer.extData, timer.extCommand, timer.repetitions))
+        {
+          timer.expiryTick = tick + 1;
+          insert(ix);
+        }
+        else if(timer.periodTicks)
+        {
+          timer.expiryTick += timer.periodTicks;
+          insert(ix);
+        }
+        else
+        {
+          release(ix);
+        }
+      }
+      // Callback
+      else
+      {
+        timerCallback_t callback = timer.callback;
+        uint16_t id = getId(ix);
+        if(timer.periodTicks)
+        {
+          timer.expiryTick += timer.periodTicks;
+          insert(ix);
+        }
+        else
+        {
+          release(ix);
+        }
+        callback(id);
+      }
+      fired = 1;
+      break;
+    }
+  }
+}
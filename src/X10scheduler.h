@@ -0,0 +1,105 @@
+/************************************************************************/
+/* X10 PLC scheduler library, delayed and recurring commands, v1.6.     */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10scheduler_h
+#define X10scheduler_h
+
+#include "Arduino.h"
+#include "X10ex.h"
+
+// Max number of pending timers (up to 254). Each timer uses 20 bytes of
+// memory. Can also be set by the build, the host tests use 64.
+#ifndef X10_SCHEDULER_MAX_TIMERS
+#define X10_SCHEDULER_MAX_TIMERS     8
+#endif
+// Number of timer wheel slots, must be a power of two. Timers are hashed to
+// slots by expiry tick, so each tick only checks the timers in one slot.
+#define X10_SCHEDULER_SLOTS         16
+// Scheduler resolution in milliseconds
+#define X10_SCHEDULER_TICK_MS      100
+
+// Returned when no timer could be scheduled
+#define X10_TIMER_NONE               0
+
+// Schedules power line commands (or callbacks) to run after a delay, at a
+// given time and optionally repeat with a fixed period, e.g. turn off a light
+// 5 minutes after motion was detected:
+//
+// offTimer = x10scheduler.schedule(300000, 0, 'A', 8, CMD_OFF);
+//
+// and restart the delay when motion is detected again:
+//
+// if(x10scheduler.rearm(offTimer, 300000)) offTimer = x10scheduler.schedule(...);
+//
+// Timers fire when poll is called from loop. A timer id is the timer slot and
+// the number of times the slot has been used, so once a timer has fired (one
+// shot timers) or has been cancelled, its id no longer matches the timer that
+// reuses the slot: cancel and rearm then return true, as in the example above.
+// Ids repeat after a slot has been used 256 times.
+class X10scheduler
+{
+
+  public:
+    // Timer id
+    typedef void (*timerCallback_t)(uint16_t);
+    X10scheduler(X10ex *x10ex);
+    // Public methods
+    uint16_t schedule(
+      uint32_t delayMs, uint32_t periodMs, char house, uint8_t unit, uint8_t command,
+      uint8_t extData = 0, uint8_t extCommand = 0, uint8_t repetitions = 1);
+    uint16_t scheduleAt(
+      uint32_t ms, uint32_t periodMs, char house, uint8_t unit, uint8_t command,
+      uint8_t extData = 0, uint8_t extCommand = 0, uint8_t repetitions = 1);
+    uint16_t schedule(uint32_t delayMs, uint32_t periodMs, timerCallback_t callback);
+    bool cancel(uint16_t id);
+    bool rearm(uint16_t id, uint32_t delayMs);
+    bool isPending(uint16_t id);
+    uint8_t getPendingCount();
+    void poll();
+
+  private:
+    struct X10timer
+    {
+      bool isPending;
+      char house;
+      uint8_t unit, command, extData, extCommand, repetitions;
+      uint8_t next;         // Next timer index + 1 in slot or free list
+      uint8_t generation;   // Incremented when timer is released, upper byte of id
+      uint32_t expiryTick;
+      uint32_t periodTicks;
+      timerCallback_t callback;
+    };
+    // Set in constructor
+    X10ex *x10ex;
+    // Timers and wheel slots, slot and free list hold timer index + 1
+    X10timer timers[X10_SCHEDULER_MAX_TIMERS];
+    uint8_t slot[X10_SCHEDULER_SLOTS];
+    uint8_t freeList, pendingCount;
+    uint32_t tick, tickMs;
+    // Private methods
+    uint16_t add(uint32_t delayMs, uint32_t periodMs, timerCallback_t callback);
+    uint16_t getId(uint8_t ix);
+    void insert(uint8_t ix);
+    void unlink(uint8_t ix);
+    void release(uint8_t ix);
+    uint32_t msToTicks(uint32_t ms);
+    void runSlot();
+};
+
+#endif
@@ -0,0 +1,174 @@
+/************************************************************************/
+/* X10 event stream library, one event queue per subscriber, v1.6.      */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10stream.h"
+
+X10stream::X10stream()
+{
+  bfEnd = 0;
+  subscribedMask = 0;
+  droppedMask = 0;
+  droppedCount = 0;
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Starts passing events published from now on to subscriber, returns true
+// when subscriber is out of range
+bool X10stream::subscribe(uint8_t subscriber)
+{
+  if(subscriber >= X10_STREAM_SUBSCRIBERS) return 1;
+  uint8_t sreg = SREG;
+  cli();
+  readIx[subscriber] = bfEnd;
+  subscribedMask |= 1 << subscriber;
+  droppedMask &= ~(1 << subscriber);
+  SREG = sreg;
+  return 0;
+}
+
+// Stops passing events on to subscriber and clears dropped flag
+void X10stream::unsubscribe(uint8_t subscriber)
+{
+  if(subscriber >= X10_STREAM_SUBSCRIBERS) return;
+  uint8_t sreg = SREG;
+  cli();
+  subscribedMask &= ~(1 << subscriber);
+  droppedMask &= ~(1 << subscriber);
+  SREG = sreg;
+}
+
+bool X10stream::isSubscribed(uint8_t subscriber)
+{
+  return subscriber < X10_STREAM_SUBSCRIBERS && subscribedMask & (1 << subscriber);
+}
+
+// Returns true when subscriber fell a full buffer behind and was dropped,
+// stays true until subscriber subscribes again or unsubscribes
+bool X10stream::isDropped(uint8_t subscriber)
+{
+  return subscriber < X10_STREAM_SUBSCRIBERS && droppedMask & (1 << subscriber);
+}
+
+uint8_t X10stream::getSubscriberCount()
+{
+  uint8_t count = 0;
+  for(uint8_t mask = subscribedMask; mask; mask >>= 1)
+  {
+    if(mask & 1) count++;
+  }
+  return count;
+}
+
+uint8_t X10stream::getQueuedCount(uint8_t subscriber)
+{
+  if(!isSubscribed(subscriber)) return 0;
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t count = bfEnd - readIx[subscriber];
+  SREG = sreg;
+  return count;
+}
+
+// Reads the oldest event subscriber has not read, returns false when there
+// are no events left or subscriber is not subscribed
+bool X10stream::read(uint8_t subscriber, X10streamEvent &event)
+{
+  if(subscriber >= X10_STREAM_SUBSCRIBERS) return 0;
+  uint8_t sreg = SREG;
+  cli();
+  bool isRead = subscribedMask & (1 << subscriber) && readIx[subscriber] != bfEnd;
+  if(isRead)
+  {
+    event = bf[readIx[subscriber] & (X10_STREAM_BUFFER_SIZE - 1)];
+    readIx[subscriber]++;
+  }
+  SREG = sreg;
+  return isRead;
+}
+
+// Returns number of subscribers dropped since start, it wraps around
+uint16_t X10stream::getDroppedCount()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t count = droppedCount;
+  SREG = sreg;
+  return count;
+}
+
+//////////////////////////////
+/// Public (Interrupt Methods)
+//////////////////////////////
+
+// Adds event to the queue of every subscriber, subscribers with a full queue
+// are dropped. A module state event is collapsed into the last event when it
+// is the same and no subscriber has read it yet: the state is read when the
+// event is sent, so the repeat adds nothing.
+void X10stream::publish(uint8_t type, char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand)
+{
+  uint8_t sreg = SREG;
+  cli();
+  if(type == X10_STREAM_MODULE_STATE && isLastUnread())
+  {
+    X10streamEvent &last = bf[(uint8_t)(bfEnd - 1) & (X10_STREAM_BUFFER_SIZE - 1)];
+    if(last.type == type && last.house == house && last.unit == unit)
+    {
+      SREG = sreg;
+      return;
+    }
+  }
+  for(uint8_t ix = 0; ix < X10_STREAM_SUBSCRIBERS; ix++)
+  {
+    uint8_t bit = 1 << ix;
+    if(subscribedMask & bit && (uint8_t)(bfEnd - readIx[ix]) >= X10_STREAM_BUFFER_SIZE)
+    {
+      subscribedMask &= ~bit;
+      droppedMask |= bit;
+      droppedCount++;
+    }
+  }
+  X10streamEvent &event = bf[bfEnd & (X10_STREAM_BUFFER_SIZE - 1)];
+  event.type = type;
+  event.house = house;
+  event.unit = unit;
+  event.command = command;
+  event.extData = extData;
+  event.extCommand = extCommand;
+  bfEnd++;
+  SREG = sreg;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+// Returns true when every subscriber has the last event queued, call with
+// interrupts disabled
+bool X10stream::isLastUnread()
+{
+  if(!subscribedMask) return 0;
+  for(uint8_t ix = 0; ix < X10_STREAM_SUBSCRIBERS; ix++)
+  {
+    if(subscribedMask & (1 << ix) && readIx[ix] == bfEnd) return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,92 @@
+/************************************************************************/
+/* X10 event stream library, one event queue per subscriber, v1.6.      */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10stream_h
+#define X10stream_h
+
+#include "Arduino.h"
+
+// Max number of subscribers, e.g. one per Ethernet socket and one for the
+// serial port (max 8)
+#define X10_STREAM_SUBSCRIBERS     5
+// Events buffered for subscribers, a subscriber that falls this many events
+// behind is dropped. Each event uses 6 bytes of memory. Must be a power of two.
+#define X10_STREAM_BUFFER_SIZE    16
+
+// Event types, the examples use the same types as for serial messages
+#define X10_STREAM_PLC             0
+#define X10_STREAM_RF              1
+#define X10_STREAM_IR              2
+#define X10_STREAM_MODULE_STATE    3
+
+struct X10streamEvent
+{
+  uint8_t type;
+  char house;
+  uint8_t unit;
+  uint8_t command;
+  uint8_t extData;
+  uint8_t extCommand;
+};
+
+// Passes each published event on to every subscriber, in the order events are
+// published. Events are kept in one buffer, and each subscriber has its own
+// read position, so the buffer is a bounded queue per subscriber. A slow
+// subscriber is dropped when it falls a full buffer behind, in stead of
+// blocking other subscribers or losing events without notice:
+//
+// x10stream.subscribe(sock);
+// ...
+// while(x10stream.read(sock, event)) ... send event
+// if(x10stream.isDropped(sock)) ... close connection
+//
+// Module state events only say that a module changed, so a repeat of the last
+// module state event is collapsed into it while no subscriber has read it.
+//
+// Publish is interrupt safe, so it can be called from the X10ex receive
+// callback. The other methods are called from loop.
+class X10stream
+{
+
+  public:
+    X10stream();
+    // Public methods
+    bool subscribe(uint8_t subscriber);
+    void unsubscribe(uint8_t subscriber);
+    bool isSubscribed(uint8_t subscriber);
+    bool isDropped(uint8_t subscriber);
+    uint8_t getSubscriberCount();
+    uint8_t getQueuedCount(uint8_t subscriber);
+    bool read(uint8_t subscriber, X10streamEvent &event);
+    uint16_t getDroppedCount();
+    // Public methods (interrupt safe)
+    void publish(uint8_t type, char house, uint8_t unit, uint8_t command, uint8_t extData, uint8_t extCommand);
+
+  private:
+    X10streamEvent bf[X10_STREAM_BUFFER_SIZE];
+    // Index counters wrap around, queued count is end minus read position
+    uint8_t volatile bfEnd;
+    uint8_t volatile readIx[X10_STREAM_SUBSCRIBERS];
+    uint8_t volatile subscribedMask, droppedMask;
+    uint16_t volatile droppedCount;
+    // Private methods
+    bool isLastUnread();
+};
+
+#endif
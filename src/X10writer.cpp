@@ -0,0 +1,158 @@
+/************************************************************************/
+/* X10 buffered writer library, fewer and larger network packets, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#include "X10writer.h"
+
+X10writer::X10writer()
+{
+  begin(NULL);
+}
+
+//////////////////////////////
+/// Public
+//////////////////////////////
+
+// Starts writing to output, output buffered for previous output is dropped
+void X10writer::begin(Print *out)
+{
+  this->out = out;
+  length = 0;
+  byteCount = 0;
+  packetCount = 0;
+  isChunked = 0;
+  clearWriteError();
+}
+
+size_t X10writer::write(uint8_t data)
+{
+  buffer[length++] = data;
+  if(length >= getCapacity()) flush();
+  return 1;
+}
+
+size_t X10writer::write(const uint8_t *data, size_t size)
+{
+  size_t left = size;
+  while(left)
+  {
+    uint16_t count = getCapacity() - length;
+    if(count > left) count = left;
+    memcpy(buffer + length, data, count);
+    length += count;
+    data += count;
+    left -= count;
+    if(length >= getCapacity()) flush();
+  }
+  return size;
+}
+
+// Passes buffered output on, call when done writing
+void X10writer::flush()
+{
+  if(isChunked)
+  {
+    endChunk();
+    send();
+    // Make room for size of next chunk
+    chunkIx = 0;
+    length = X10_WRITER_CHUNK_HEADER;
+  }
+  else
+  {
+    send();
+  }
+}
+
+// Output written after this is sent as chunks
+void X10writer::beginChunked()
+{
+  if(isChunked) return;
+  // Buffered output is sent first, when there's no room for the chunk size
+  if(length + X10_WRITER_CHUNK_HEADER + X10_WRITER_CHUNK_TRAILER >= X10_WRITER_BUFFER_SIZE) send();
+  isChunked = 1;
+  // Output written before this (e.g. headers) is sent as is, in the same packet
+  // as the first chunk
+  chunkIx = length;
+  length += X10_WRITER_CHUNK_HEADER;
+}
+
+// Passes buffered output on, with the last chunk when output is chunked
+void X10writer::end()
+{
+  if(isChunked)
+  {
+    endChunk();
+    memcpy(buffer + length, "0\r\n\r\n", 5);
+    length += 5;
+    isChunked = 0;
+  }
+  send();
+}
+
+uint32_t X10writer::getByteCount()
+{
+  return byteCount;
+}
+
+uint16_t X10writer::getPacketCount()
+{
+  return packetCount;
+}
+
+//////////////////////////////
+/// Private
+//////////////////////////////
+
+uint16_t X10writer::getCapacity()
+{
+  return isChunked ? X10_WRITER_BUFFER_SIZE - X10_WRITER_CHUNK_TRAILER : X10_WRITER_BUFFER_SIZE;
+}
+
+// Sets chunk size in room kept at chunk start and adds chunk end, the room is
+// removed when the chunk is empty (an empty chunk would end the output)
+void X10writer::endChunk()
+{
+  uint16_t size = length - chunkIx - X10_WRITER_CHUNK_HEADER;
+  if(!size)
+  {
+    length = chunkIx;
+    return;
+  }
+  const char hex[] = "0123456789ABCDEF";
+  buffer[chunkIx] = hex[size >> 8 & 0xF];
+  buffer[chunkIx + 1] = hex[size >> 4 & 0xF];
+  buffer[chunkIx + 2] = hex[size & 0xF];
+  buffer[chunkIx + 3] = '\r';
+  buffer[chunkIx + 4] = '\n';
+  buffer[length++] = '\r';
+  buffer[length++] = '\n';
+}
+
+void X10writer::send()
+{
+  if(!length) return;
+  // Output is dropped after a write error, e.g. when connection is closed
+  if(out && !getWriteError())
+  {
+    if(out->write(buffer, length) < length) setWriteError();
+    byteCount += length;
+    packetCount++;
+  }
+  length = 0;
+}
@@ -0,0 +1,83 @@
+/************************************************************************/
+/* X10 buffered writer library, fewer and larger network packets, v1.6. */
+/*                                                                      */
+/* This library is free software: you can redistribute it and/or modify */
+/* it under the terms of the GNU General Public License as published by */
+/* the Free Software Foundation, either version 3 of the License, or    */
+/* (at your option) any later version.                                  */
+/*                                                                      */
+/* This library is distributed in the hope that it will be useful, but  */
+/* WITHOUT ANY WARRANTY; without even the implied warranty of           */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU     */
+/* General Public License for more details.                             */
+/*                                                                      */
+/* You should have received a copy of the GNU General Public License    */
+/* along with this library. If not, see <http://www.gnu.org/licenses/>. */
+/*                                                                      */
+/* Written by Thomas Mittet (code@lookout.no) October 2010.             */
+/************************************************************************/
+
+#ifndef X10writer_h
+#define X10writer_h
+
+#include "Arduino.h"
+
+// Output is passed on when this many bytes are buffered. A full TCP segment
+// (1460 bytes) doesn't fit in RAM, so this is a compromise between packet
+// count and memory use.
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define X10_WRITER_BUFFER_SIZE 512
+#else
+#define X10_WRITER_BUFFER_SIZE 128
+#endif
+
+// Room kept in buffer for chunk size line (3 hex digits) and chunk trailers
+#define X10_WRITER_CHUNK_HEADER  5
+#define X10_WRITER_CHUNK_TRAILER 7
+
+// Buffers output written with print, and passes it on in one write call when
+// the buffer is full or flush is called. On the Ethernet shield each write
+// call is sent as one packet, in stead of one packet per print call:
+//
+// writer.begin(&client);
+// writer.print(...);
+// writer.flush();
+//
+// When beginChunked is called (e.g. after the HTTP headers), the rest of the
+// output is sent using HTTP/1.1 chunked transfer encoding, one chunk per write
+// call, so the length of the output doesn't have to be known up front. Call
+// end when done, to send the last chunk.
+//
+// Bytes and packets (write calls) passed on since begin are counted.
+class X10writer : public Print
+{
+
+  public:
+    X10writer();
+    // Public methods
+    void begin(Print *out);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t size);
+    using Print::write;
+    void flush();
+    void beginChunked();
+    void end();
+    uint32_t getByteCount();
+    uint16_t getPacketCount();
+
+  private:
+    Print *out;
+    uint8_t buffer[X10_WRITER_BUFFER_SIZE];
+    uint16_t length;
+    uint32_t byteCount;
+    uint16_t packetCount;
+    // Chunked transfer encoding fields
+    bool isChunked;
+    uint16_t chunkIx;
+    // Private methods
+    uint16_t getCapacity();
+    void endChunk();
+    void send();
+};
+
+#endif